@@ -1,11 +1,13 @@
 #include "assets.h"
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#define __USE_POSIX
 #include <string.h>
 
+#include "parser.h"
 #include "raylib.h"
 #include "utils.h"
 
@@ -13,7 +15,7 @@
 #define ASSETS_PATH "./assets"
 #endif
 
-#define ARENA_BUF_LEN Kilobyte(500)
+#define ARENA_BUF_LEN Megabyte(2)
 
 #define ASSET_NAME_MAX 64
 
@@ -21,45 +23,133 @@
 
 #define MAX_ASSETENTRIES 16
 #define MAX_TEXTURES     8
+#define MAX_SHARED       16
 #define MAX_SPRITES      256
 #define MAX_ANIMATIONS   16
 #define MAX_TILES        128
 #define MAX_MAPS         1
+#define MAX_EMITTERS     16
+#define MAX_MAP_SIZE     1024
 
 typedef struct AssetEntry {
     AssetLoader loader;
     char name[ASSET_NAME_MAX];
 } AssetEntry;
 
+// A spritesheet's texture, shared by every asset set that loads it. The
+// pixels are kept to parse the sheet again without decoding the image
+typedef struct SharedTexture {
+    char name[ASSET_NAME_MAX];
+    int refs;
+    Texture2D texture;
+    int width, height;
+    Color *pixels;
+
+    // content hash of the image and sprite metadata
+    uint64_t hash;
+
+    // decoded off the GPU thread, uploaded by AssetsUploadPending
+    Image pending;
+} SharedTexture;
+
+// Everything the asset functions below work on, while not current
+struct AssetSet {
+    Arena arena;
+    AssetEntry *entries;
+    int entriesCount;
+    HTable table;
+    int *textures;
+    uint64_t *textureHashes;
+    Sprite *sprites;
+    SpriteUV *spriteUVs;
+    Animation *anims;
+    Tile *tiles;
+    Map *maps;
+    ParticleEmitter *emitters;
+    int counts[ASSET_COUNT];
+};
+
 // Asset loader functions
 static int loadSpritesheet(const char *name);
 static int loadAnimation(const char *name);
 static int loadMap(const char *name);
+static int loadEmitters(const char *name);
+
+// Textures of all sets, refs of zero are free slots
+static pthread_mutex_t sharedLock = PTHREAD_MUTEX_INITIALIZER;
+static SharedTexture sharedTextures[MAX_SHARED];
+
+// the thread owning the GL context, the one that called AssetsInit
+static pthread_t gpuThread;
+static pthread_once_t assetsPathOnce = PTHREAD_ONCE_INIT;
+
+// The calling thread's current set, AssetSetUse swaps them in and out
+static _Thread_local AssetSet *set;
 
 // Liner allocator
-static Arena arenaAlloc;
+static _Thread_local Arena arenaAlloc;
 
 // Asset entries to be loaded
-static AssetEntry *assetEntries;
-static int assetEntriesCount;
+static _Thread_local AssetEntry *assetEntries;
+static _Thread_local int assetEntriesCount;
 
 // Table for storing asset indices
-static HTable assetTable;
-
-// Pointer for all assets loaded
-static Texture2D *assetTextures;
-static Sprite *assetSprites;
-static Animation *assetAnims;
-static Tile *assetTiles;
-static Map *assetMaps;
+static _Thread_local HTable assetTable;
+
+// Pointer for all assets loaded, textures are shared slots
+static _Thread_local int *assetTextures;
+// content hash of each texture's image and sprite metadata
+static _Thread_local uint64_t *assetTextureHashes;
+static _Thread_local Sprite *assetSprites;
+static _Thread_local SpriteUV *assetSpriteUVs;
+static _Thread_local Animation *assetAnims;
+static _Thread_local Tile *assetTiles;
+static _Thread_local Map *assetMaps;
+static _Thread_local ParticleEmitter *assetEmitters;
 
 // Count of every asset type
-static int assetCounts[ASSET_COUNT];
+static _Thread_local int assetCounts[ASSET_COUNT];
 
 // Loaders func pointers
-static int (*loaders[])(const char *) = {loadSpritesheet, loadAnimation, loadMap};
+static int (*loaders[])(const char *) = {loadSpritesheet, loadAnimation, loadMap,
+                                         loadEmitters};
+
+static void saveSet(AssetSet *s) {
+    s->arena = arenaAlloc;
+    s->entries = assetEntries;
+    s->entriesCount = assetEntriesCount;
+    s->table = assetTable;
+    s->textures = assetTextures;
+    s->textureHashes = assetTextureHashes;
+    s->sprites = assetSprites;
+    s->spriteUVs = assetSpriteUVs;
+    s->anims = assetAnims;
+    s->tiles = assetTiles;
+    s->maps = assetMaps;
+    s->emitters = assetEmitters;
+    memcpy(s->counts, assetCounts, sizeof(assetCounts));
+}
 
-int AssetsInit(void) {
+static void loadSet(const AssetSet *s) {
+    arenaAlloc = s->arena;
+    assetEntries = s->entries;
+    assetEntriesCount = s->entriesCount;
+    assetTable = s->table;
+    assetTextures = s->textures;
+    assetTextureHashes = s->textureHashes;
+    assetSprites = s->sprites;
+    assetSpriteUVs = s->spriteUVs;
+    assetAnims = s->anims;
+    assetTiles = s->tiles;
+    assetMaps = s->maps;
+    assetEmitters = s->emitters;
+    memcpy(assetCounts, s->counts, sizeof(assetCounts));
+
+    // the table grows out of whichever thread's view of the arena is current
+    assetTable.arena = &arenaAlloc;
+}
+
+static int initSet(void) {
     // initialize linear allocator
     void *backingBuffer = malloc(ARENA_BUF_LEN);
     ArenaInit(&arenaAlloc, backingBuffer, ARENA_BUF_LEN);
@@ -73,12 +163,17 @@ int AssetsInit(void) {
     assetEntriesCount = 0;
 
     // make room for assets
-    assetTextures = ArenaAlloc(&arenaAlloc, sizeof(Texture2D) * MAX_TEXTURES);
+    assetTextures = ArenaAlloc(&arenaAlloc, sizeof(int) * MAX_TEXTURES);
+    assetTextureHashes = ArenaAlloc(&arenaAlloc, sizeof(uint64_t) * MAX_TEXTURES);
     assetSprites = ArenaAlloc(&arenaAlloc, sizeof(Sprite) * MAX_SPRITES);
+    assetSpriteUVs = ArenaAlloc(&arenaAlloc, sizeof(SpriteUV) * MAX_SPRITES);
     assetAnims = ArenaAlloc(&arenaAlloc, sizeof(Animation) * MAX_ANIMATIONS);
     assetTiles = ArenaAlloc(&arenaAlloc, sizeof(Tile) * MAX_TILES);
     assetMaps = ArenaAlloc(&arenaAlloc, sizeof(Map) * MAX_MAPS);
+    assetEmitters = ArenaAlloc(&arenaAlloc, sizeof(ParticleEmitter) * MAX_EMITTERS);
     memset(assetCounts, 0, sizeof(assetCounts));
+    // sprite 0 is NULL_SPRITE, so zeroed components have no sprite
+    assetCounts[ASSET_SPRITE] = 1;
 
     // init asset table
     HTableInit(&assetTable, &arenaAlloc);
@@ -87,6 +182,116 @@ int AssetsInit(void) {
     return 0;
 }
 
+AssetSet *AssetSetCreate(void) {
+    AssetSet *created = calloc(1, sizeof(*created));
+    if (created == NULL) {
+        return NULL;
+    }
+
+    AssetSet *prev = set;
+    AssetSetUse(created);
+    int err = initSet();
+    AssetSetUse(prev);
+    if (err != 0) {
+        free(created);
+        return NULL;
+    }
+    return created;
+}
+
+void AssetSetUse(AssetSet *next) {
+    if (next == set) {
+        return;
+    }
+
+    if (set != NULL) {
+        saveSet(set);
+    }
+    static const AssetSet none;
+    loadSet(next != NULL ? next : &none);
+    set = next;
+}
+
+AssetSet *AssetSetGet(void) {
+    return set;
+}
+
+static void releaseTexture(int slot) {
+    pthread_mutex_lock(&sharedLock);
+    SharedTexture *shared = &sharedTextures[slot];
+    assert(shared->refs > 0);
+    if (--shared->refs == 0) {
+        TraceLog(LOG_DEBUG, "ASSETS: Unloading shared texture %s", shared->name);
+        if (shared->texture.id != 0) {
+            UnloadTexture(shared->texture);
+        }
+        UnloadImage(shared->pending);
+        UnloadImageColors(shared->pixels);
+        memset(shared, 0, sizeof(*shared));
+    }
+    pthread_mutex_unlock(&sharedLock);
+}
+
+void AssetSetDestroy(AssetSet *destroyed) {
+    AssetSet *prev = set != destroyed ? set : NULL;
+    AssetSetUse(destroyed);
+
+    // textures other sets still use stay loaded
+    for (int i = 0; i < assetCounts[ASSET_TEXTURE]; ++i) {
+        releaseTexture(assetTextures[i]);
+    }
+
+    // free all arena at once
+    TraceLog(LOG_DEBUG, "Cleaning Asset arena (%lu/%lu bytes used)",
+             arenaAlloc.currOffset, ARENA_BUF_LEN);
+    free(arenaAlloc.buff);
+    AssetSetUse(prev);
+    free(destroyed);
+}
+
+void AssetsSetGpuThread(void) {
+    gpuThread = pthread_self();
+}
+
+int AssetsInit(void) {
+    AssetsSetGpuThread();
+
+    AssetSet *created = AssetSetCreate();
+    AssetSetUse(created);
+    return created == NULL;
+}
+
+static void uploadTexture(SharedTexture *shared) {
+    shared->texture = LoadTextureFromImage(shared->pending);
+    if (shared->texture.id == 0) {
+        TraceLog(LOG_ERROR, "ASSETS: Failed to upload texture %s", shared->name);
+    }
+    UnloadImage(shared->pending);
+    shared->pending = (Image){0};
+}
+
+int AssetsUploadPending(int maxUploads) {
+    int pending = 0;
+
+    assert(pthread_equal(pthread_self(), gpuThread));
+    pthread_mutex_lock(&sharedLock);
+    for (int i = 0; i < MAX_SHARED; ++i) {
+        SharedTexture *shared = &sharedTextures[i];
+        if (shared->pending.data == NULL) {
+            continue;
+        }
+        if (maxUploads-- <= 0) {
+            ++pending;
+            continue;
+        }
+
+        uploadTexture(shared);
+    }
+    pthread_mutex_unlock(&sharedLock);
+
+    return pending;
+}
+
 void AssetAdd(AssetLoader loader, const char *name) {
     assert(assetEntriesCount + 1 < MAX_ASSETENTRIES);
     AssetEntry *entry = &assetEntries[assetEntriesCount];
@@ -95,24 +300,166 @@ void AssetAdd(AssetLoader loader, const char *name) {
     ++assetEntriesCount;
 }
 
+static int findSprite(const char *name) {
+    int idx = HTableGet(&assetTable, name);
+    return (NULL_SPRITE < idx && idx < assetCounts[ASSET_SPRITE]) ? idx : -1;
+}
+
+static bool spriteOpaque(const Color *pixels, int stride, int x, int y, int width,
+                         int height) {
+    for (int row = y; row < y + height; ++row) {
+        for (int col = x; col < x + width; ++col) {
+            if (pixels[row * stride + col].a != 255) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// pixels are the texture's, to tell opaque sprites apart
+static bool parseSpritesheet(Scanner *scanner, int textureIdx) {
+    // the slot's size and pixels never change while it's referenced
+    const SharedTexture *tex = &sharedTextures[assetTextures[textureIdx]];
+    const Color *pixels = tex->pixels;
+
+    ScanSkipBlankLines(scanner);
+    while (!ScannerAtEnd(scanner)) {
+        char sprite[ASSET_NAME_MAX];
+        Token spriteName;
+        int x, y, width, height;
+
+        if (!ScanWord(scanner, &spriteName) || !ScanInt(scanner, &x) ||
+            !ScanInt(scanner, &y) || !ScanInt(scanner, &width) ||
+            !ScanInt(scanner, &height)) {
+            return false;
+        }
+        if (!TokenCopy(spriteName, sprite, sizeof(sprite))) {
+            return ScannerFail(scanner, "sprite name is too long");
+        }
+        if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > tex->width ||
+            y + height > tex->height) {
+            return ScannerFail(scanner, "sprite %s is outside of the %dx%d texture",
+                               sprite, tex->width, tex->height);
+        }
+        if (assetCounts[ASSET_SPRITE] >= MAX_SPRITES) {
+            return ScannerFail(scanner, "more than %d sprites", MAX_SPRITES);
+        }
+        if (!ScanEndLine(scanner)) {
+            return false;
+        }
+
+        // creating sprite and adding it to table, textures are at most
+        // 16384 pixels wide so the rectangle fits in 16 bits
+        int spriteCount = assetCounts[ASSET_SPRITE];
+        bool opaque = spriteOpaque(pixels, tex->width, x, y, width, height);
+        assetSprites[spriteCount] = (Sprite){.texture = textureIdx,
+                                             .x = x,
+                                             .y = y,
+                                             .width = width,
+                                             .height = height,
+                                             .opaque = opaque};
+        assetSpriteUVs[spriteCount] =
+            (SpriteUV){.u0 = (float)x / tex->width,
+                       .v0 = (float)y / tex->height,
+                       .u1 = (float)(x + width) / tex->width,
+                       .v1 = (float)(y + height) / tex->height};
+        HTableSet(&assetTable, sprite, spriteCount);
+        ++assetCounts[ASSET_SPRITE];
+
+        ScanSkipBlankLines(scanner);
+    }
+
+    return true;
+}
+
+static int findShared(const char *name) {
+    for (int i = 0; i < MAX_SHARED; ++i) {
+        if (sharedTextures[i].refs > 0 && strcmp(sharedTextures[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Slot of the image's texture with one more reference, decoded only if no
+// set has it yet. Returns -1 if it couldn't be loaded
+static int acquireTexture(const char *imageFilepath) {
+    pthread_mutex_lock(&sharedLock);
+    int slot = findShared(imageFilepath);
+    if (slot >= 0) {
+        ++sharedTextures[slot].refs;
+    }
+    pthread_mutex_unlock(&sharedLock);
+    if (slot >= 0) {
+        return slot;
+    }
+
+    // decoding takes the longest, other loaders keep going meanwhile
+    Image image = LoadImage(imageFilepath);
+    if (image.data == NULL) {
+        // failed to load image
+        return -1;
+    }
+    int imageSize = GetPixelDataSize(image.width, image.height, image.format);
+    uint64_t hash = HashBytes(HASH_SEED, image.data, imageSize);
+    Color *pixels = LoadImageColors(image);
+    if (pixels == NULL) {
+        UnloadImage(image);
+        return -1;
+    }
+
+    pthread_mutex_lock(&sharedLock);
+    slot = findShared(imageFilepath);
+    if (slot >= 0) {
+        // another loader got there first, ours is thrown away
+        ++sharedTextures[slot].refs;
+    } else {
+        for (slot = 0; slot < MAX_SHARED && sharedTextures[slot].refs > 0; ++slot)
+            ;
+        // If this fails, needs to increase max
+        assert(slot < MAX_SHARED);
+
+        SharedTexture *shared = &sharedTextures[slot];
+        *shared = (SharedTexture){.refs = 1,
+                                  .width = image.width,
+                                  .height = image.height,
+                                  .pixels = pixels,
+                                  .hash = hash,
+                                  .pending = image};
+        snprintf(shared->name, sizeof(shared->name), "%s", imageFilepath);
+        if (pthread_equal(pthread_self(), gpuThread)) {
+            uploadTexture(shared);
+        }
+        pixels = NULL;
+        image = (Image){0};
+    }
+    pthread_mutex_unlock(&sharedLock);
+
+    UnloadImageColors(pixels);
+    UnloadImage(image);
+    return slot;
+}
+
 static int loadSpritesheet(const char *name) {
     char imageFilepath[ASSET_NAME_MAX];
     char metaFilepath[ASSET_NAME_MAX];
+    Scanner scanner;
 
     // If this fails, needs to increase maxs
     assert(assetCounts[ASSET_TEXTURE] < MAX_TEXTURES);
-    assert(assetCounts[ASSET_SPRITE] < MAX_SPRITES);
 
     snprintf(imageFilepath, ASSET_NAME_MAX, "%s.png", name);
     snprintf(metaFilepath, ASSET_NAME_MAX, "%s.sprite", name);
 
-    // load image from disc to GPU
+    // reuse the texture if another set has it, the pixels are hashed once
     int textureCount = assetCounts[ASSET_TEXTURE];
-    assetTextures[textureCount] = LoadTexture(imageFilepath);
-    if (assetTextures[textureCount].id <= 0) {
-        // failed to load texture
+    int slot = acquireTexture(imageFilepath);
+    if (slot < 0) {
         return 1;
     }
+    assetTextures[textureCount] = slot;
+    assetTextureHashes[textureCount] = sharedTextures[slot].hash;
     ++assetCounts[ASSET_TEXTURE];
 
     char *metaContent = LoadFileText(metaFilepath);
@@ -120,77 +467,208 @@ static int loadSpritesheet(const char *name) {
         // failed to load file
         return 1;
     }
+    assetTextureHashes[textureCount] = HashBytes(assetTextureHashes[textureCount],
+                                                 metaContent, strlen(metaContent));
 
-    char *lineToken = strtok(metaContent, "\n");
-    while (lineToken != NULL) {
-        char sprite[64];
-        int x, y, width, height;
-        sscanf(lineToken, "%63s %d %d %d %d", sprite, &x, &y, &width, &height);
-
-        // creating sprite and adding it to table
-        int spriteCount = assetCounts[ASSET_SPRITE];
-        assetSprites[spriteCount] =
-            (Sprite){assetTextures[textureCount], {x, y, width, height}};
-        HTableSet(&assetTable, sprite, spriteCount);
-        ++assetCounts[ASSET_SPRITE];
-
-        lineToken = strtok(NULL, "\n");
+    ScannerInit(&scanner, metaFilepath, metaContent);
+    bool ok = parseSpritesheet(&scanner, textureCount);
+    if (!ok) {
+        TraceLog(LOG_ERROR, "%s", scanner.error);
     }
 
     // cleanup
     free(metaContent);
-    return 0;
+    return ok ? 0 : 1;
 }
 
-static int loadAnimation(const char *name) {
-    char animFilepath[ASSET_NAME_MAX];
-
-    // If this fails, needs to increase max
-    assert(assetCounts[ASSET_ANIMATION] < MAX_ANIMATIONS);
-
-    snprintf(animFilepath, ASSET_NAME_MAX, "%s.anim", name);
-
-    char *animContent = LoadFileText(animFilepath);
-    if (animContent == NULL) {
-        // failed to load file
-        return 1;
-    }
-
-    char *lineToken = strtok(animContent, "\n");
-    while (lineToken != NULL) {
-        char animName[64];
-        char spriteName[128];
+static bool parseAnimation(Scanner *scanner) {
+    ScanSkipBlankLines(scanner);
+    while (!ScannerAtEnd(scanner)) {
+        char animName[ASSET_NAME_MAX];
+        // the name, an underscore and any int frame number
+        char spriteName[ASSET_NAME_MAX + 12];
+        Token animToken;
         int frameCount;
         float frameDuration;
 
-        sscanf(lineToken, "%31s %d %f", animName, &frameCount, &frameDuration);
+        if (!ScanWord(scanner, &animToken) || !ScanInt(scanner, &frameCount) ||
+            !ScanFloat(scanner, &frameDuration)) {
+            return false;
+        }
+        if (!TokenCopy(animToken, animName, sizeof(animName))) {
+            return ScannerFail(scanner, "animation name is too long");
+        }
+        if (frameCount <= 0 || frameCount > MAX_ANIM_FRAMES) {
+            return ScannerFail(scanner, "animation %s must have 1 to %d frames",
+                               animName, MAX_ANIM_FRAMES);
+        }
+        if (frameDuration <= 0.0f) {
+            return ScannerFail(scanner, "animation %s has no frame duration", animName);
+        }
+        if (assetCounts[ASSET_ANIMATION] >= MAX_ANIMATIONS) {
+            return ScannerFail(scanner, "more than %d animations", MAX_ANIMATIONS);
+        }
 
         int animCount = assetCounts[ASSET_ANIMATION];
         assetAnims[animCount].frameCount = frameCount;
         assetAnims[animCount].frameDuration = frameDuration;
         for (int i = 0; i < frameCount; ++i) {
-            snprintf(spriteName, 128, "%s_%d", animName, i);
-            assetAnims[animCount].frames[i] = AssetsGetSprite(spriteName);
+            snprintf(spriteName, sizeof(spriteName), "%s_%d", animName, i);
+            int spriteIdx = findSprite(spriteName);
+            if (spriteIdx < 0) {
+                return ScannerFail(scanner, "missing sprite %s", spriteName);
+            }
+            assetAnims[animCount].frames[i] = spriteIdx;
+        }
+        if (!ScanEndLine(scanner)) {
+            return false;
         }
 
         // add asset to table
         HTableSet(&assetTable, animName, animCount);
         ++assetCounts[ASSET_ANIMATION];
 
-        lineToken = strtok(NULL, "\n");
+        ScanSkipBlankLines(scanner);
+    }
+
+    return true;
+}
+
+static int loadAnimation(const char *name) {
+    char animFilepath[ASSET_NAME_MAX];
+    Scanner scanner;
+
+    snprintf(animFilepath, ASSET_NAME_MAX, "%s.anim", name);
+
+    char *animContent = LoadFileText(animFilepath);
+    if (animContent == NULL) {
+        // failed to load file
+        return 1;
+    }
+
+    ScannerInit(&scanner, animFilepath, animContent);
+    bool ok = parseAnimation(&scanner);
+    if (!ok) {
+        TraceLog(LOG_ERROR, "%s", scanner.error);
     }
 
     // cleanup
     free(animContent);
-    return 0;
+    return ok ? 0 : 1;
 }
 
-static int loadMap(const char *name) {
-    char mapFilepath[ASSET_NAME_MAX];
+static bool parseMap(Scanner *scanner, const char *name, Map *map) {
     int tilesetCount;
     int layersCount;
     int width, height;
 
+    // read metadata line
+    ScanSkipBlankLines(scanner);
+    if (!ScanInt(scanner, &tilesetCount) || !ScanInt(scanner, &layersCount) ||
+        !ScanInt(scanner, &width) || !ScanInt(scanner, &height)) {
+        return false;
+    }
+
+    int prevTilesCount = assetCounts[ASSET_TILE];
+    if (tilesetCount <= 0 || prevTilesCount + tilesetCount > MAX_TILES) {
+        return ScannerFail(scanner, "tileset must have 1 to %d tiles",
+                           MAX_TILES - prevTilesCount);
+    }
+    if (layersCount <= 0 || layersCount > MAX_MAP_LAYERS) {
+        return ScannerFail(scanner, "map must have 1 to %d layers", MAX_MAP_LAYERS);
+    }
+    if (width <= 0 || height <= 0 || width > MAX_MAP_SIZE || height > MAX_MAP_SIZE) {
+        return ScannerFail(scanner, "map size must be within %dx%d", MAX_MAP_SIZE,
+                           MAX_MAP_SIZE);
+    }
+
+    size_t layerSize = sizeof(uint16_t) * width * height;
+    size_t arenaLeft = arenaAlloc.buffLen - arenaAlloc.currOffset;
+    if ((layerSize + DEFAULT_ALIGNMENT) * layersCount > arenaLeft) {
+        return ScannerFail(scanner, "map is too large, stream it instead");
+    }
+    if (!ScanEndLine(scanner)) {
+        return false;
+    }
+
+    map->width = width;
+    map->height = height;
+    map->layersCount = layersCount;
+    map->firstTile = prevTilesCount;
+    map->tilesCount = tilesetCount;
+
+    for (int i = 0; i < tilesetCount; ++i) {
+        char spriteName[ASSET_NAME_MAX];
+        Token spriteToken;
+
+        ScanSkipBlankLines(scanner);
+        if (!ScanWord(scanner, &spriteToken)) {
+            return false;
+        }
+        if (!TokenCopy(spriteToken, spriteName, sizeof(spriteName))) {
+            return ScannerFail(scanner, "sprite name is too long");
+        }
+        int spriteIdx = findSprite(spriteName);
+        if (spriteIdx < 0) {
+            return ScannerFail(scanner, "missing sprite %s", spriteName);
+        }
+        if (!ScanEndLine(scanner)) {
+            return false;
+        }
+
+        int tileCount = assetCounts[ASSET_TILE];
+        assetTiles[tileCount].id = tileCount;
+        assetTiles[tileCount].sprite = spriteIdx;
+        assetTiles[tileCount].solid = strncmp(spriteName, "wall", 4) == 0;
+        assetTiles[tileCount].exit = strncmp(spriteName, "drain", 5) == 0;
+        ++assetCounts[ASSET_TILE];
+    }
+
+    for (int layer = 0; layer < layersCount; ++layer) {
+        map->tiles[layer] = ArenaAlloc(&arenaAlloc, layerSize);
+
+        // layers may be separated by blank lines
+        ScanSkipBlankLines(scanner);
+        if (ScannerAtEnd(scanner)) {
+            return ScannerFail(scanner, "expected %d layers, got %d", layersCount,
+                               layer);
+        }
+        if (!ScanTileGrid(scanner, width, height, prevTilesCount, tilesetCount,
+                          map->tiles[layer])) {
+            return false;
+        }
+    }
+
+    ScanSkipBlankLines(scanner);
+    if (!ScannerAtEnd(scanner)) {
+        return ScannerFail(scanner, "expected end of file after %d layers",
+                           layersCount);
+    }
+
+    HTableSet(&assetTable, name, assetCounts[ASSET_MAP]);
+    return true;
+}
+
+static uint64_t hashMapContent(const Map *map, const char *mapContent) {
+    uint64_t hash = HashBytes(HASH_SEED, mapContent, strlen(mapContent));
+
+    // every spritesheet the tiles come from, once each
+    for (int texture = 0; texture < assetCounts[ASSET_TEXTURE]; ++texture) {
+        for (int i = 0; i < map->tilesCount; ++i) {
+            Tile *tile = &assetTiles[map->firstTile + i];
+            if (assetSprites[tile->sprite].texture == texture) {
+                hash = HashBytes(hash, &assetTextureHashes[texture], sizeof(uint64_t));
+                break;
+            }
+        }
+    }
+    return hash;
+}
+
+static int loadMap(const char *name) {
+    char mapFilepath[ASSET_NAME_MAX];
+    Scanner scanner;
+
     // If this fails, needs to increase max
     assert(assetCounts[ASSET_MAP] < MAX_MAPS);
 
@@ -202,63 +680,171 @@ static int loadMap(const char *name) {
         return 1;
     }
 
-    char *endLine;
-    char *lineToken = strtok_r(mapContent, "\n", &endLine);
-    if (lineToken == NULL) {
-        // should have at least one line
-        return 1;
+    ScannerInit(&scanner, mapFilepath, mapContent);
+    Map *map = &assetMaps[assetCounts[ASSET_MAP]];
+    bool ok = parseMap(&scanner, name, map);
+    if (ok) {
+        snprintf(map->name, sizeof(map->name), "%s", name);
+        map->contentHash = hashMapContent(map, mapContent);
+        ++assetCounts[ASSET_MAP];
+    } else {
+        TraceLog(LOG_ERROR, "%s", scanner.error);
     }
 
-    // read metadata line
-    sscanf(lineToken, "%d %d %d %d", &tilesetCount, &layersCount, &width, &height);
-    lineToken = strtok_r(NULL, "\n", &endLine);
+    // cleanup
+    free(mapContent);
+    return ok ? 0 : 1;
+}
 
-    int mapCount = assetCounts[ASSET_MAP];
-    assetMaps[mapCount].width = width;
-    assetMaps[mapCount].height = height;
-    assetMaps[mapCount].layersCount = layersCount;
+static bool scanColor(Scanner *scanner, uint8_t color[4]) {
+    for (int i = 0; i < 4; ++i) {
+        int channel;
+        if (!ScanInt(scanner, &channel)) {
+            return false;
+        }
+        if (channel < 0 || channel > 255) {
+            return ScannerFail(scanner, "color channel %d is out of range", channel);
+        }
+        color[i] = (uint8_t)channel;
+    }
+    return true;
+}
 
-    int prevTilesCount = assetCounts[ASSET_TILE];
+static bool parseEmitterField(Scanner *scanner, Token field, ParticleEmitter *emitter,
+                              bool *hasFade) {
+    bool ok;
+    if (TokenEquals(field, "burst")) {
+        ok = ScanInt(scanner, &emitter->burst);
+    } else if (TokenEquals(field, "life")) {
+        ok = ScanFloat(scanner, &emitter->lifeMin) &&
+             ScanFloat(scanner, &emitter->lifeMax);
+    } else if (TokenEquals(field, "speed")) {
+        ok = ScanFloat(scanner, &emitter->speedMin) &&
+             ScanFloat(scanner, &emitter->speedMax);
+    } else if (TokenEquals(field, "spread")) {
+        ok = ScanFloat(scanner, &emitter->spread);
+    } else if (TokenEquals(field, "size")) {
+        ok = ScanFloat(scanner, &emitter->sizeMin) &&
+             ScanFloat(scanner, &emitter->sizeMax);
+    } else if (TokenEquals(field, "gravity")) {
+        ok = ScanFloat(scanner, &emitter->gravity);
+    } else if (TokenEquals(field, "color")) {
+        ok = scanColor(scanner, emitter->colorStart);
+    } else if (TokenEquals(field, "fade")) {
+        ok = scanColor(scanner, emitter->colorEnd);
+        *hasFade = true;
+    } else {
+        return ScannerFail(scanner, "unknown emitter field %.*s", field.length,
+                           field.start);
+    }
 
-    for (int i = 0; i < tilesetCount; ++i) {
-        char spriteName[64];
-        sscanf(lineToken, "%63s", spriteName);
+    return ok && ScanEndLine(scanner);
+}
 
-        int tileCount = assetCounts[ASSET_TILE];
-        assert(tileCount < MAX_TILES);
-        assetTiles[tileCount].id = tileCount;
-        assetTiles[tileCount].sprite = AssetsGetSprite(spriteName);
-        ++assetCounts[ASSET_TILE];
+static bool parseEmitters(Scanner *scanner) {
+    ScanSkipBlankLines(scanner);
+    while (!ScannerAtEnd(scanner)) {
+        char emitterName[ASSET_NAME_MAX];
+        Token token;
 
-        lineToken = strtok_r(NULL, "\n", &endLine);
-    }
+        if (!ScanWord(scanner, &token)) {
+            return false;
+        }
+        if (!TokenEquals(token, "emitter")) {
+            return ScannerFail(scanner, "expected emitter");
+        }
+        if (!ScanWord(scanner, &token) || !ScanEndLine(scanner)) {
+            return false;
+        }
+        if (!TokenCopy(token, emitterName, sizeof(emitterName))) {
+            return ScannerFail(scanner, "emitter name is too long");
+        }
+        if (assetCounts[ASSET_EMITTER] >= MAX_EMITTERS) {
+            return ScannerFail(scanner, "more than %d emitters", MAX_EMITTERS);
+        }
 
-    for (int layer = 0; layer < layersCount; ++layer) {
-        int tileAccum = 0;
-        while (lineToken != NULL) {
-            char *endColumn;
-            char *columnToken = strtok_r(lineToken, " ", &endColumn);
-            while (columnToken != NULL) {
-                int tile;
-                sscanf(columnToken, "%d", &tile);
-                assetMaps[mapCount].tiles[layer][tileAccum++] = tile + prevTilesCount;
-                columnToken = strtok_r(NULL, " ", &endColumn);
+        int emitterCount = assetCounts[ASSET_EMITTER];
+        ParticleEmitter *emitter = &assetEmitters[emitterCount];
+        *emitter = (ParticleEmitter){.burst = 1,
+                                     .lifeMin = 1.0f,
+                                     .lifeMax = 1.0f,
+                                     .sizeMin = 1.0f,
+                                     .sizeMax = 1.0f,
+                                     .colorStart = {255, 255, 255, 255}};
+        bool hasFade = false;
+
+        for (;;) {
+            ScanSkipBlankLines(scanner);
+            if (ScannerAtEnd(scanner)) {
+                return ScannerFail(scanner, "emitter %s is missing its end",
+                                   emitterName);
             }
-            lineToken = strtok_r(NULL, "\n", &endLine);
+            if (!ScanWord(scanner, &token)) {
+                return false;
+            }
+            if (TokenEquals(token, "end")) {
+                break;
+            }
+            if (!parseEmitterField(scanner, token, emitter, &hasFade)) {
+                return false;
+            }
+        }
+        if (!ScanEndLine(scanner)) {
+            return false;
         }
+        if (emitter->burst <= 0 || emitter->lifeMin <= 0.0f ||
+            emitter->lifeMax < emitter->lifeMin) {
+            return ScannerFail(scanner, "emitter %s needs a burst and a lifetime",
+                               emitterName);
+        }
+
+        // fading out to transparent by default
+        if (!hasFade) {
+            memcpy(emitter->colorEnd, emitter->colorStart, sizeof(emitter->colorEnd));
+            emitter->colorEnd[3] = 0;
+        }
+
+        // add asset to table
+        HTableSet(&assetTable, emitterName, emitterCount);
+        ++assetCounts[ASSET_EMITTER];
+
+        ScanSkipBlankLines(scanner);
+    }
+
+    return true;
+}
+
+static int loadEmitters(const char *name) {
+    char emitterFilepath[ASSET_NAME_MAX];
+    Scanner scanner;
+
+    snprintf(emitterFilepath, ASSET_NAME_MAX, "%s.emitter", name);
+
+    char *emitterContent = LoadFileText(emitterFilepath);
+    if (emitterContent == NULL) {
+        // failed to load file
+        return 1;
     }
 
-    HTableSet(&assetTable, "prison", mapCount);
-    ++assetCounts[ASSET_MAP];
+    ScannerInit(&scanner, emitterFilepath, emitterContent);
+    bool ok = parseEmitters(&scanner);
+    if (!ok) {
+        TraceLog(LOG_ERROR, "%s", scanner.error);
+    }
 
     // cleanup
-    free(mapContent);
-    return 0;
+    free(emitterContent);
+    return ok ? 0 : 1;
 }
 
-int AssetLoadSync(void) {
-    // Set correct directory to start loading
+static void changeToAssetsPath(void) {
     ChangeDirectory(ASSETS_PATH);
+}
+
+int AssetLoadSync(void) {
+    // Set correct directory to start loading. It's the process's, so only
+    // whichever thread loads first changes it
+    pthread_once(&assetsPathOnce, changeToAssetsPath);
 
     for (int i = 0; i < assetEntriesCount; ++i) {
         AssetLoader loader = assetEntries[i].loader;
@@ -272,10 +858,35 @@ int AssetLoadSync(void) {
     return 0;
 }
 
-Sprite AssetsGetSprite(const char *name) {
-    int idx = HTableGet(&assetTable, name);
-    return (0 <= idx && idx < assetCounts[ASSET_SPRITE]) ? assetSprites[idx]
-                                                         : (Sprite){0};
+Texture2D AssetsGetTexture(int textureIdx) {
+    return (0 <= textureIdx && textureIdx < assetCounts[ASSET_TEXTURE])
+               ? sharedTextures[assetTextures[textureIdx]].texture
+               : (Texture2D){0};
+}
+
+SpriteId AssetsGetSpriteId(const char *name) {
+    int idx = findSprite(name);
+    return idx >= 0 ? (SpriteId)idx : NULL_SPRITE;
+}
+
+Sprite AssetsGetSprite(SpriteId sprite) {
+    return sprite < assetCounts[ASSET_SPRITE] ? assetSprites[sprite] : (Sprite){0};
+}
+
+Rectangle AssetsGetSpriteSource(SpriteId sprite) {
+    Sprite s = AssetsGetSprite(sprite);
+    return (Rectangle){s.x, s.y, s.width, s.height};
+}
+
+Texture2D AssetsGetSpriteTexture(SpriteId sprite) {
+    if (sprite == NULL_SPRITE || sprite >= assetCounts[ASSET_SPRITE]) {
+        return (Texture2D){0};
+    }
+    return sharedTextures[assetTextures[assetSprites[sprite].texture]].texture;
+}
+
+SpriteUV AssetsGetSpriteUV(SpriteId sprite) {
+    return sprite < assetCounts[ASSET_SPRITE] ? assetSpriteUVs[sprite] : (SpriteUV){0};
 }
 
 Animation AssetsGetAnimation(const char *name) {
@@ -293,15 +904,14 @@ Map AssetGetMap(const char *name) {
     return (0 <= idx && idx < assetCounts[ASSET_MAP]) ? assetMaps[idx] : (Map){0};
 }
 
+ParticleEmitter AssetsGetEmitter(const char *name) {
+    int idx = HTableGet(&assetTable, name);
+    return (0 <= idx && idx < assetCounts[ASSET_EMITTER]) ? assetEmitters[idx]
+                                                          : (ParticleEmitter){0};
+}
+
 void AssetsDestroy(void) {
-    // clean up textures
-    for (int i = 0; i < assetCounts[ASSET_TEXTURE]; ++i) {
-        UnloadTexture(assetTextures[i]);
+    if (set != NULL) {
+        AssetSetDestroy(set);
     }
-
-    // free all arena at once
-    TraceLog(LOG_DEBUG, "Cleaning Asset arena (%lu/%lu bytes used)",
-             arenaAlloc.currOffset, ARENA_BUF_LEN);
-    ArenaReset(&arenaAlloc);
-    free(arenaAlloc.buff);
 }
@@ -2,17 +2,21 @@
 #define ASSETS_H
 
 #include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "particles.h"
 
 #define MAX_ANIM_FRAMES 4
 #define MAX_MAP_LAYERS  3
-#define MAX_MAP_WIDTH   64
-#define MAX_MAP_HEIGHT  64
-#define MAX_MAP_TILES   MAX_MAP_WIDTH *MAX_MAP_HEIGHT
+#define MAP_TILE_EMPTY  0xFFFF
+#define MAP_NAME_MAX    32
 
 typedef enum {
     ASSET_LOADER_SPRITESHEET = 0,
     ASSET_LOADER_ANIMATION,
     ASSET_LOADER_MAP,
+    ASSET_LOADER_EMITTER,
     ASSET_LOADER_COUNT
 } AssetLoader;
 
@@ -22,40 +26,93 @@ typedef enum {
     ASSET_ANIMATION,
     ASSET_TILE,
     ASSET_MAP,
+    ASSET_EMITTER,
     ASSET_COUNT
 } AssetType;
 
+// Components hold sprite ids, the sprites themselves live in the assets
+typedef uint16_t SpriteId;
+
+#define NULL_SPRITE 0
+
+// Pixel rectangle of a sprite within one of the loaded textures. Opaque
+// sprites have no pixel with any transparency
 typedef struct Sprite {
-    Texture2D tex;
-    Rectangle source;
+    uint16_t texture;
+    uint16_t x, y;
+    uint16_t width, height;
+    bool opaque;
 } Sprite;
 
+// Normalized texture coordinates of a sprite, computed once at load
+typedef struct SpriteUV {
+    float u0, v0;
+    float u1, v1;
+} SpriteUV;
+
 typedef struct Animation {
     int frameCount;
     float frameDuration;
-    Sprite frames[MAX_ANIM_FRAMES];
+    SpriteId frames[MAX_ANIM_FRAMES];
 } Animation;
 
 typedef struct Tile {
     int id;
-    Sprite sprite;
+    SpriteId sprite;
+
+    // blocks movement and projectiles, wall* sprites
+    bool solid;
+
+    // leads to the next level, drain* sprites
+    bool exit;
 } Tile;
 
 typedef struct Map {
+    char name[MAP_NAME_MAX];
     int width, height;
     int layersCount;
-    int tiles[MAX_MAP_LAYERS][MAX_MAP_TILES];
+    int firstTile, tilesCount;
+
+    // width * height tile ids per layer, owned by the asset arena
+    uint16_t *tiles[MAX_MAP_LAYERS];
+
+    // hash of the map file and the spritesheets of its tiles, changes
+    // whenever anything its baked layers are drawn from changes
+    uint64_t contentHash;
 } Map;
 
+// Every asset loaded by one set of AssetAdd calls. Each thread has its own
+// current set, the sets' textures are shared and reference counted
+typedef struct AssetSet AssetSet;
+
+AssetSet *AssetSetCreate(void);
+// only on the GPU thread, textures no other set uses are unloaded
+void AssetSetDestroy(AssetSet *set);
+AssetSet *AssetSetGet(void);
+void AssetSetUse(AssetSet *set);
+
+// create and use a set, the calling thread is the GPU thread from then on
 int AssetsInit(void);
 
+// Textures loaded by any other thread than the GPU thread, the one owning
+// the GL context, wait until uploaded with AssetsUploadPending on it. Returns
+// the number still waiting
+void AssetsSetGpuThread(void);
+int AssetsUploadPending(int maxUploads);
+
 void AssetAdd(AssetLoader loader, const char *name);
 
 int AssetLoadSync(void);
 
 // TODO: implement render textures
 RenderTexture2D AssetCreateTexture(int width, int height);
-Sprite AssetsGetSprite(const char *name);
+Texture2D AssetsGetTexture(int textureIdx);
+
+SpriteId AssetsGetSpriteId(const char *name);
+Sprite AssetsGetSprite(SpriteId sprite);
+Rectangle AssetsGetSpriteSource(SpriteId sprite);
+Texture2D AssetsGetSpriteTexture(SpriteId sprite);
+SpriteUV AssetsGetSpriteUV(SpriteId sprite);
 
 Animation AssetsGetAnimation(const char *name);
 
@@ -63,6 +120,8 @@ Tile AssetsGetTile(int tileId);
 
 Map AssetGetMap(const char *name);
 
+ParticleEmitter AssetsGetEmitter(const char *name);
+
 void AssetsDestroy(void);
 
 #endif // !ASSETS_H
@@ -0,0 +1,107 @@
+#include "collision.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define WORD_BITS 64
+
+int CollisionGridInit(CollisionGrid *grid, Arena *arena, int width, int height,
+                      float cellWidth, float cellHeight) {
+    assert(width > 0 && height > 0 && cellWidth > 0.0f && cellHeight > 0.0f);
+
+    size_t words = ((size_t)width * height + WORD_BITS - 1) / WORD_BITS;
+    grid->width = width;
+    grid->height = height;
+    grid->cellWidth = cellWidth;
+    grid->cellHeight = cellHeight;
+    grid->solid = ArenaAlloc(arena, sizeof(uint64_t) * words);
+
+    return grid->solid == NULL;
+}
+
+void CollisionGridClear(CollisionGrid *grid) {
+    size_t words = ((size_t)grid->width * grid->height + WORD_BITS - 1) / WORD_BITS;
+    memset(grid->solid, 0, sizeof(uint64_t) * words);
+}
+
+void CollisionGridSet(CollisionGrid *grid, int x, int y, bool solid) {
+    assert(0 <= x && x < grid->width && 0 <= y && y < grid->height);
+
+    size_t bit = (size_t)y * grid->width + x;
+    uint64_t mask = (uint64_t)1 << (bit % WORD_BITS);
+    if (solid) {
+        grid->solid[bit / WORD_BITS] |= mask;
+    } else {
+        grid->solid[bit / WORD_BITS] &= ~mask;
+    }
+}
+
+bool CollisionGridSolid(const CollisionGrid *grid, int x, int y) {
+    // nothing gets out of the map
+    if (x < 0 || x >= grid->width || y < 0 || y >= grid->height) {
+        return true;
+    }
+
+    size_t bit = (size_t)y * grid->width + x;
+    return (grid->solid[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+}
+
+static void walkAxis(float start, float delta, float cellSize, int cell, int *step,
+                     float *tMax, float *tDelta) {
+    if (delta > 0.0f) {
+        *step = 1;
+        *tDelta = cellSize / delta;
+        *tMax = ((cell + 1) * cellSize - start) / delta;
+    } else if (delta < 0.0f) {
+        *step = -1;
+        *tDelta = -cellSize / delta;
+        *tMax = (cell * cellSize - start) / delta;
+    } else {
+        *step = 0;
+        *tDelta = FLT_MAX;
+        *tMax = FLT_MAX;
+    }
+}
+
+void GridWalkBegin(GridWalk *walk, const CollisionGrid *grid, float x0, float y0,
+                   float x1, float y1) {
+    walk->x = (int)floorf(x0 / grid->cellWidth);
+    walk->y = (int)floorf(y0 / grid->cellHeight);
+    walk->t = 0.0f;
+
+    walkAxis(x0, x1 - x0, grid->cellWidth, walk->x, &walk->stepX, &walk->tMaxX,
+             &walk->tDeltaX);
+    walkAxis(y0, y1 - y0, grid->cellHeight, walk->y, &walk->stepY, &walk->tMaxY,
+             &walk->tDeltaY);
+}
+
+bool GridWalkNext(GridWalk *walk) {
+    if (walk->tMaxX < walk->tMaxY) {
+        walk->t = walk->tMaxX;
+        walk->tMaxX += walk->tDeltaX;
+        walk->x += walk->stepX;
+    } else {
+        walk->t = walk->tMaxY;
+        walk->tMaxY += walk->tDeltaY;
+        walk->y += walk->stepY;
+    }
+
+    return walk->t <= 1.0f;
+}
+
+bool CollisionGridRaycast(const CollisionGrid *grid, float x0, float y0, float x1,
+                          float y1, float *hitT) {
+    GridWalk walk;
+
+    GridWalkBegin(&walk, grid, x0, y0, x1, y1);
+    do {
+        if (CollisionGridSolid(grid, walk.x, walk.y)) {
+            *hitT = walk.t;
+            return true;
+        }
+    } while (GridWalkNext(&walk));
+
+    return false;
+}
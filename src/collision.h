@@ -0,0 +1,39 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+// Solid tiles of a map, one bit per cell
+typedef struct CollisionGrid {
+    int width, height;
+    float cellWidth, cellHeight;
+    uint64_t *solid;
+} CollisionGrid;
+
+// Cells crossed by a segment, in order (Amanatides-Woo DDA). t is where
+// the segment enters the current cell, from 0 at the start to 1 at the end.
+typedef struct GridWalk {
+    int x, y;
+    int stepX, stepY;
+    float t;
+    float tMaxX, tMaxY;
+    float tDeltaX, tDeltaY;
+} GridWalk;
+
+int CollisionGridInit(CollisionGrid *grid, Arena *arena, int width, int height,
+                      float cellWidth, float cellHeight);
+void CollisionGridClear(CollisionGrid *grid);
+void CollisionGridSet(CollisionGrid *grid, int x, int y, bool solid);
+bool CollisionGridSolid(const CollisionGrid *grid, int x, int y);
+
+void GridWalkBegin(GridWalk *walk, const CollisionGrid *grid, float x0, float y0,
+                   float x1, float y1);
+bool GridWalkNext(GridWalk *walk);
+
+bool CollisionGridRaycast(const CollisionGrid *grid, float x0, float y0, float x1,
+                          float y1, float *hitT);
+
+#endif // !COLLISION_H
@@ -1,104 +1,317 @@
+// mmap and friends for world snapshots
+#define _POSIX_C_SOURCE 200809L
+
 #include "ecs.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "assets.h"
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include "utils.h"
 
-#define ARENA_BUF_LEN Kilobyte(500)
+#define ARENA_BUF_LEN Megabyte(2)
+
+#define MAX_ENTITIES     4096
+#define MAX_TRANSFORM    4096
+#define MAX_SPRITERENDER 4096
+#define MAX_ANIMRENDER   4096
+#define MAX_MAPRENDER    4
+#define MAX_CAMERA       4
+#define MAX_PLAYER       4
 
-#define MAX_ENTITIES     1024
-#define MAX_TRANSFORM    1024
-#define MAX_SPRITERENDER 1024
-#define MAX_ANIMRENDER   256
+// particle quads submitted between batch limit checks
+#define PARTICLE_BATCH_QUADS 1024
 
-#define NULL_ENTITY_COMP -1
+#define MAP_CACHE_MAGIC   "PAWL"
+#define MAP_CACHE_VERSION 2
 
-// Component specific functions
-static int createTransform(void **transformComp);
-static int createSpriteRender(void **spriteRender);
-static int createAnimRender(void **animRender);
-static int createMapRender(void **mapRender);
-static int createCamera(void **cameraComp);
-static int createPlayer(void **playerComp);
+#define SNAPSHOT_MAGIC   "PAWS"
+#define SNAPSHOT_VERSION 4
+#define SNAPSHOT_DELTA   0x1
 
-static void removeTransform(int transformCompId);
-static void removeSpriteRender(int spriteRenderId);
-static void removeAnimRender(int animRenderId);
-static void removeMapRender(int mapRenderId);
-static void removeCamera(int cameraCompId);
-static void removePlayer(int playerCompId);
+// Type-erased pool of one component type, slots are stride bytes apart
+typedef struct CompPool {
+    unsigned char *data;
+    size_t size, stride;
+    int capacity;
+    ComponentInitFn init;
 
-static Arena arenaAlloc;
+    // bumped whenever a component is added or removed
+    uint32_t version;
+} CompPool;
+
+// The calling thread's current world, EcsWorldUse swaps them in and out.
+// Loader threads build the next level's world while the main thread runs
+// the current one
+static _Thread_local EcsWorld *world;
+static _Thread_local Arena worldArena;
 
 // entities
-static Entity *entities;
-static int entitiesCount;
+static _Thread_local Entity *entities;
+static _Thread_local int entitiesCount;
 
 // components
-static TransformComp *compTransform;
-static SpriteRender *compSpriteRender;
-static AnimRender *compAnimRender;
-static MapRender *compMapRender;
-static CameraComp *compCamera;
-static PlayerComp *compPlayer;
-
-static int compCounts[COMP_COUNT];
-
-static int (*compCreateFP[])(void **) = {createTransform,  createSpriteRender,
-                                         createAnimRender, createMapRender,
-                                         createCamera,     createPlayer};
-static void (*compRemoveFP[])(int) = {removeTransform,  removeSpriteRender,
-                                      removeAnimRender, removeMapRender,
-                                      removeCamera,     removePlayer};
+static _Thread_local TransformComp *compTransform;
+static _Thread_local SpriteRender *compSpriteRender;
+static _Thread_local AnimRender *compAnimRender;
+static _Thread_local MapRender *compMapRender;
+static _Thread_local CameraComp *compCamera;
+static _Thread_local PlayerComp *compPlayer;
+
+// every component starts with its 'enabled' flag, so pools can be
+// scanned without knowing the type
+static _Thread_local CompPool compPools[MAX_COMP_TYPES];
+static _Thread_local int compTypesCount;
+
+// Transforms in depth first order, parents before their children and every
+// subtree a contiguous range. Rebuilt when transforms are added, removed or
+// reparented.
+static _Thread_local int *transformOrder;
+static _Thread_local int *transformOrderIndex;
+static _Thread_local int *transformSubtreeSize;
+static _Thread_local int transformOrderCount;
+static _Thread_local bool transformOrderValid;
+static _Thread_local uint32_t transformOrderVersion;
+
+// transforms marked dirty since the last SystemTransformUpdate
+static _Thread_local int *transformDirty;
+static _Thread_local int transformDirtyCount;
+
+// transforms the last SystemTransformUpdate recomputed, every one when it
+// rebuilt the order. Updates are counted so readers can tell they missed one
+static _Thread_local int *transformMoved;
+static _Thread_local int transformMovedCount;
+static _Thread_local bool transformAllMoved;
+static _Thread_local uint32_t transformUpdates;
+
+// A world while it isn't current, the same state as the variables above
+struct EcsWorld {
+    Arena arena;
+    Entity *entities;
+    int entitiesCount;
+    CompPool compPools[MAX_COMP_TYPES];
+    int compTypesCount;
+    int *transformOrder;
+    int *transformOrderIndex;
+    int *transformSubtreeSize;
+    int transformOrderCount;
+    bool transformOrderValid;
+    uint32_t transformOrderVersion;
+    int *transformDirty;
+    int transformDirtyCount;
+    int *transformMoved;
+    int transformMovedCount;
+    bool transformAllMoved;
+    uint32_t transformUpdates;
+};
+
+static void initTransform(void *component) {
+    TransformComp *transfComp = component;
+    transfComp->scale = Vector2One();
+    transfComp->parent = NULL_ENTITY_COMP;
+    transfComp->worldScale = Vector2One();
+}
 
-int EntityCompInit(void) {
+static void initSpriteRender(void *component) {
+    SpriteRender *spriteRender = component;
+    spriteRender->tint = WHITE;
+}
+
+static void initMapRender(void *component) {
+    MapRender *mapRender = component;
+    mapRender->scale = Vector2One();
+}
+
+static void initCamera(void *component) {
+    CameraComp *cameraComp = component;
+    cameraComp->camera.zoom = 1.0f;
+}
+
+static void saveWorld(EcsWorld *w) {
+    w->arena = worldArena;
+    w->entities = entities;
+    w->entitiesCount = entitiesCount;
+    memcpy(w->compPools, compPools, sizeof(compPools));
+    w->compTypesCount = compTypesCount;
+    w->transformOrder = transformOrder;
+    w->transformOrderIndex = transformOrderIndex;
+    w->transformSubtreeSize = transformSubtreeSize;
+    w->transformOrderCount = transformOrderCount;
+    w->transformOrderValid = transformOrderValid;
+    w->transformOrderVersion = transformOrderVersion;
+    w->transformDirty = transformDirty;
+    w->transformDirtyCount = transformDirtyCount;
+    w->transformMoved = transformMoved;
+    w->transformMovedCount = transformMovedCount;
+    w->transformAllMoved = transformAllMoved;
+    w->transformUpdates = transformUpdates;
+}
+
+static void loadWorld(const EcsWorld *w) {
+    worldArena = w->arena;
+    entities = w->entities;
+    entitiesCount = w->entitiesCount;
+    memcpy(compPools, w->compPools, sizeof(compPools));
+    compTypesCount = w->compTypesCount;
+    transformOrder = w->transformOrder;
+    transformOrderIndex = w->transformOrderIndex;
+    transformSubtreeSize = w->transformSubtreeSize;
+    transformOrderCount = w->transformOrderCount;
+    transformOrderValid = w->transformOrderValid;
+    transformOrderVersion = w->transformOrderVersion;
+    transformDirty = w->transformDirty;
+    transformDirtyCount = w->transformDirtyCount;
+    transformMoved = w->transformMoved;
+    transformMovedCount = w->transformMovedCount;
+    transformAllMoved = w->transformAllMoved;
+    transformUpdates = w->transformUpdates;
+
+    compTransform = (TransformComp *)compPools[COMP_TRANSFORM].data;
+    compSpriteRender = (SpriteRender *)compPools[COMP_SPRITERENDER].data;
+    compAnimRender = (AnimRender *)compPools[COMP_ANIMRENDER].data;
+    compMapRender = (MapRender *)compPools[COMP_MAPRENDER].data;
+    compCamera = (CameraComp *)compPools[COMP_CAMERA].data;
+    compPlayer = (PlayerComp *)compPools[COMP_PLAYER].data;
+}
+
+static int initWorld(void) {
     void *backingBuffer = malloc(ARENA_BUF_LEN);
-    ArenaInit(&arenaAlloc, backingBuffer, ARENA_BUF_LEN);
+    ArenaInit(&worldArena, backingBuffer, ARENA_BUF_LEN);
     if (backingBuffer == NULL) {
         TraceLog(LOG_ERROR, "Failed to allocate memory for Arena");
         return 1;
     }
 
-    entities = ArenaAlloc(&arenaAlloc, sizeof(Entity) * MAX_ENTITIES);
-
-    compTransform = ArenaAlloc(&arenaAlloc, sizeof(TransformComp) * MAX_TRANSFORM);
-    compSpriteRender = ArenaAlloc(&arenaAlloc, sizeof(SpriteRender) * MAX_SPRITERENDER);
-    compAnimRender = ArenaAlloc(&arenaAlloc, sizeof(AnimRender) * MAX_ANIMRENDER);
-    compMapRender = ArenaAlloc(&arenaAlloc, sizeof(MapRender));
-    compCamera = ArenaAlloc(&arenaAlloc, sizeof(CameraComp));
-    compPlayer = ArenaAlloc(&arenaAlloc, sizeof(PlayerComp));
-
+    entities = ArenaAlloc(&worldArena, sizeof(Entity) * MAX_ENTITIES);
     EntityCompReset();
 
+    // built-in types, registered in CompType order
+    compTypesCount = 0;
+    ComponentRegister(sizeof(TransformComp), _Alignof(TransformComp), MAX_TRANSFORM,
+                      initTransform);
+    ComponentRegister(sizeof(SpriteRender), _Alignof(SpriteRender), MAX_SPRITERENDER,
+                      initSpriteRender);
+    ComponentRegister(sizeof(AnimRender), _Alignof(AnimRender), MAX_ANIMRENDER, NULL);
+    ComponentRegister(sizeof(MapRender), _Alignof(MapRender), MAX_MAPRENDER,
+                      initMapRender);
+    ComponentRegister(sizeof(CameraComp), _Alignof(CameraComp), MAX_CAMERA, initCamera);
+    ComponentRegister(sizeof(PlayerComp), _Alignof(PlayerComp), MAX_PLAYER, NULL);
+
+    compTransform = (TransformComp *)compPools[COMP_TRANSFORM].data;
+    compSpriteRender = (SpriteRender *)compPools[COMP_SPRITERENDER].data;
+    compAnimRender = (AnimRender *)compPools[COMP_ANIMRENDER].data;
+    compMapRender = (MapRender *)compPools[COMP_MAPRENDER].data;
+    compCamera = (CameraComp *)compPools[COMP_CAMERA].data;
+    compPlayer = (PlayerComp *)compPools[COMP_PLAYER].data;
+
+    transformOrder = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+    transformOrderIndex = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+    transformSubtreeSize = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+    transformDirty = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+    transformMoved = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+
     return 0;
 }
 
+EcsWorld *EcsWorldCreate(void) {
+    EcsWorld *created = calloc(1, sizeof(*created));
+    if (created == NULL) {
+        return NULL;
+    }
+
+    EcsWorld *prev = world;
+    EcsWorldUse(created);
+    int err = initWorld();
+    EcsWorldUse(prev);
+    if (err != 0) {
+        free(created);
+        return NULL;
+    }
+    return created;
+}
+
+void EcsWorldUse(EcsWorld *next) {
+    if (next == world) {
+        return;
+    }
+
+    // nothing is copied but the bookkeeping, the pools stay where they are
+    if (world != NULL) {
+        saveWorld(world);
+    }
+    static const EcsWorld none;
+    loadWorld(next != NULL ? next : &none);
+    world = next;
+}
+
+EcsWorld *EcsWorldGet(void) {
+    return world;
+}
+
+void EcsWorldDestroy(EcsWorld *destroyed) {
+    EcsWorld *prev = world != destroyed ? world : NULL;
+    EcsWorldUse(destroyed);
+
+    // render targets and light maps are the GPU memory a world owns
+    for (int i = 0; i < MAX_MAPRENDER; ++i) {
+        MapRender *mapRender = &compMapRender[i];
+        if (!mapRender->enabled) {
+            continue;
+        }
+        for (int layer = 0; layer < MAX_MAP_LAYERS; ++layer) {
+            if (mapRender->renderLayers[layer].id != 0) {
+                RenderUnloadTarget(mapRender->renderLayers[layer]);
+            }
+        }
+        if (mapRender->lightTexture.id != 0) {
+            UnloadTexture(mapRender->lightTexture);
+        }
+    }
+
+    // free all arena at once
+    TraceLog(LOG_DEBUG, "Cleaning ECS arena (%lu/%lu bytes used)",
+             worldArena.currOffset, ARENA_BUF_LEN);
+    free(worldArena.buff);
+    EcsWorldUse(prev);
+    free(destroyed);
+}
+
+int EntityCompInit(void) {
+    EcsWorld *created = EcsWorldCreate();
+    EcsWorldUse(created);
+    return created == NULL;
+}
+
 void EntityCompReset(void) {
     // reset all entities
     entitiesCount = 0;
     for (int entityId = 0; entityId < MAX_ENTITIES; ++entityId) {
         Entity *entity = &entities[entityId];
         entity->enabled = false;
-        for (int compId = 0; compId < COMP_COUNT; ++compId) {
+        for (int compId = 0; compId < MAX_COMP_TYPES; ++compId) {
             entity->components[compId] = NULL_ENTITY_COMP;
         }
     }
 
     // TODO: reset all components
-    memset(compCounts, 0, sizeof(compCounts));
+    transformOrderValid = false;
 }
 
 void EntityCompDestroy(void) {
-    // free all arena at once
-    TraceLog(LOG_DEBUG, "Cleaning ECS arena (%lu/%lu bytes used)",
-             arenaAlloc.currOffset, ARENA_BUF_LEN);
-    ArenaReset(&arenaAlloc);
-    free(arenaAlloc.buff);
+    if (world != NULL) {
+        EcsWorldDestroy(world);
+    }
 }
 
 int EntityCreate(void) {
@@ -118,6 +331,25 @@ int EntityCreate(void) {
     return entityId;
 }
 
+int EntityCreateBatch(int count) {
+    int run = 0;
+
+    // a single scan for 'count' free ids in a row
+    for (int entityId = 0; entityId < MAX_ENTITIES; ++entityId) {
+        run = entities[entityId].enabled ? 0 : run + 1;
+        if (run == count) {
+            int firstEntity = entityId - count + 1;
+            for (int i = firstEntity; i <= entityId; ++i) {
+                entities[i].enabled = true;
+            }
+            return firstEntity;
+        }
+    }
+
+    assert(0 && "No room for entity batch");
+    return NULL_ENTITY_COMP;
+}
+
 void EntityRemove(int entityId) {
     if (entityId < 0 || entityId >= MAX_ENTITIES) {
         return;
@@ -125,293 +357,1854 @@ void EntityRemove(int entityId) {
 
     Entity *removeEntity = &entities[entityId];
     removeEntity->enabled = false;
-    for (int compType = 0; compType < COMP_COUNT; ++compType) {
+    for (int compType = 0; compType < compTypesCount; ++compType) {
         ComponentRemove(entityId, compType);
         removeEntity->components[compType] = NULL_ENTITY_COMP;
     }
 }
 
-static int createTransform(void **transformComp) {
-    int compId;
-
-    for (compId = 0; compId < MAX_TRANSFORM; ++compId) {
-        if (!compTransform[compId].enabled)
-            break;
-    }
-
-    assert(compId < MAX_TRANSFORM);
-    if (compId >= MAX_TRANSFORM) {
-        *transformComp = NULL;
+CompType ComponentRegister(size_t size, size_t align, int capacity,
+                           ComponentInitFn initFn) {
+    assert(compTypesCount < MAX_COMP_TYPES && "Too many component types");
+    assert(size >= sizeof(bool) && capacity > 0);
+    if (compTypesCount >= MAX_COMP_TYPES) {
         return NULL_ENTITY_COMP;
     }
 
-    compTransform[compId] = (TransformComp){.enabled = true,
-                                            .position = Vector2Zero(),
-                                            .scale = Vector2One(),
-                                            .rotation = 0};
+    // slots keep the alignment of the first one
+    CompType type = compTypesCount++;
+    CompPool *pool = &compPools[type];
+    pool->size = size;
+    pool->stride = (size + align - 1) & ~(align - 1);
+    pool->capacity = capacity;
+    pool->init = initFn;
+    pool->data = ArenaAllocAligned(&worldArena, pool->stride * capacity, align);
+
+    return type;
+}
 
-    *transformComp = &compTransform[compId];
-    return compId;
+static void *compSlot(CompType type, int compId) {
+    return compPools[type].data + compPools[type].stride * compId;
 }
 
-static void removeTransform(int transformCompId) {
-    if (transformCompId >= 0 && transformCompId < MAX_TRANSFORM) {
-        compTransform[transformCompId].enabled = false;
+void *ComponentCreate(int entityId, CompType type) {
+    CompPool *pool = &compPools[type];
+    int compId = entities[entityId].components[type];
+
+    // an entity has one of each type, creating it again resets its slot
+    if (compId == NULL_ENTITY_COMP) {
+        for (compId = 0; compId < pool->capacity; ++compId) {
+            if (!*(bool *)compSlot(type, compId))
+                break;
+        }
+
+        assert(compId < pool->capacity);
+        if (compId >= pool->capacity) {
+            return NULL;
+        }
+        ++pool->version;
+    }
+
+    void *component = compSlot(type, compId);
+    memset(component, 0, pool->stride);
+    *(bool *)component = true;
+    if (pool->init != NULL) {
+        pool->init(component);
     }
+
+    entities[entityId].components[type] = compId;
+    return component;
 }
 
-static int createSpriteRender(void **spriteRender) {
-    int compId;
+void *ComponentCreateBatch(int firstEntity, int count, CompType type,
+                           const void *init) {
+    int run = 0;
+    int firstComp = NULL_ENTITY_COMP;
 
-    for (compId = 0; compId < MAX_SPRITERENDER; ++compId) {
-        if (!compSpriteRender[compId].enabled)
+    for (int compId = 0; compId < compPools[type].capacity; ++compId) {
+        run = *(bool *)compSlot(type, compId) ? 0 : run + 1;
+        if (run == count) {
+            firstComp = compId - count + 1;
             break;
+        }
     }
 
-    assert(compId < MAX_SPRITERENDER);
-    if (compId >= MAX_SPRITERENDER) {
-        *spriteRender = NULL;
-        return NULL_ENTITY_COMP;
+    assert(firstComp != NULL_ENTITY_COMP && "No room for component batch");
+    if (firstComp == NULL_ENTITY_COMP) {
+        return NULL;
     }
 
-    compSpriteRender[compId] = (SpriteRender){
-        .enabled = true, .sprite = {0}, .tint = WHITE, .flipX = false, .flipY = false};
+    unsigned char *comps = compSlot(type, firstComp);
+    for (int i = 0; i < count; ++i) {
+        unsigned char *comp = compSlot(type, firstComp + i);
+        memcpy(comp, init, compPools[type].size);
+        *(bool *)comp = true;
+        entities[firstEntity + i].components[type] = firstComp + i;
+    }
+    ++compPools[type].version;
 
-    *spriteRender = &compSpriteRender[compId];
-    return compId;
+    return comps;
 }
 
-static void removeSpriteRender(int spriteRenderId) {
-    if (spriteRenderId >= 0 && spriteRenderId < MAX_SPRITERENDER) {
-        compSpriteRender[spriteRenderId].enabled = false;
-    }
+void *ComponentGet(int entityId, CompType type) {
+    int compId = entities[entityId].components[type];
+    return compId == NULL_ENTITY_COMP ? NULL : compSlot(type, compId);
+}
+
+// a child whose parent is gone becomes a root where it is
+static void orphanTransform(TransformComp *transfComp) {
+    transfComp->parent = NULL_ENTITY_COMP;
+    transfComp->position = transfComp->worldPosition;
+    transfComp->scale = transfComp->worldScale;
+    transfComp->rotation = transfComp->worldRotation;
 }
 
-static int createAnimRender(void **animRender) {
-    int compId;
+// Before the slot can be reused, so no child follows the next transform in
+// it. Only the subtree is looked at while the order is current
+static void orphanChildren(int compTransId) {
+    bool ordered = transformOrderValid &&
+                   transformOrderVersion == compPools[COMP_TRANSFORM].version;
+    int start = ordered ? transformOrderIndex[compTransId] + 1 : 0;
+    int end = ordered ? start + transformSubtreeSize[compTransId] - 1 : MAX_TRANSFORM;
+    for (int k = start; k < end; ++k) {
+        TransformComp *transfComp = &compTransform[ordered ? transformOrder[k] : k];
+        if (transfComp->enabled && transfComp->parent == compTransId) {
+            orphanTransform(transfComp);
+        }
+    }
+}
 
-    for (compId = 0; compId < MAX_ANIMRENDER; ++compId) {
-        if (!compAnimRender[compId].enabled)
-            break;
+void ComponentRemove(int entityId, CompType type) {
+    int compId = entities[entityId].components[type];
+    if (compId >= 0 && compId < compPools[type].capacity) {
+        if (type == COMP_TRANSFORM) {
+            orphanChildren(compId);
+        }
+        *(bool *)compSlot(type, compId) = false;
+        ++compPools[type].version;
     }
+    entities[entityId].components[type] = NULL_ENTITY_COMP;
+}
 
-    assert(compId < MAX_ANIMRENDER);
-    if (compId >= MAX_ANIMRENDER) {
-        *animRender = NULL;
-        return NULL_ENTITY_COMP;
+void TransformSetParent(int entityId, int parentEntity) {
+    int compTransId = entities[entityId].components[COMP_TRANSFORM];
+    if (compTransId == NULL_ENTITY_COMP) {
+        return;
     }
 
-    compAnimRender[compId] =
-        (AnimRender){.enabled = true, .anim = {0}, .frameTime = 0.0f};
+    int parent = parentEntity == NULL_ENTITY_COMP
+                     ? NULL_ENTITY_COMP
+                     : entities[parentEntity].components[COMP_TRANSFORM];
+    for (int p = parent; p != NULL_ENTITY_COMP; p = compTransform[p].parent) {
+        assert(p != compTransId && "Transform parented to its own child");
+        if (p == compTransId) {
+            return;
+        }
+    }
 
-    *animRender = &compAnimRender[compId];
-    return compId;
+    compTransform[compTransId].parent = parent;
+    transformOrderValid = false;
 }
 
-static void removeAnimRender(int animRenderId) {
-    if (animRenderId >= 0 && animRenderId < MAX_ANIMRENDER) {
-        compAnimRender[animRenderId].enabled = false;
+void TransformMarkDirty(int entityId) {
+    int compTransId = entities[entityId].components[COMP_TRANSFORM];
+    if (compTransId == NULL_ENTITY_COMP || compTransform[compTransId].dirty) {
+        return;
     }
+
+    compTransform[compTransId].dirty = true;
+    transformDirty[transformDirtyCount++] = compTransId;
 }
 
-static int createMapRender(void **mapRender) {
-    compMapRender->enabled = true;
-    compMapRender->map = (Map){0};
-    compMapRender->tileWidth = 0;
-    compMapRender->tileHeight = 0;
-    compMapRender->screenWidth = 0;
-    compMapRender->screenHeight = 0;
-    compMapRender->scale = Vector2One();
-    compMapRender->renderLayersCount = 0;
-    memset(compMapRender->renderLayers, 0, sizeof(compMapRender->renderLayers));
-    *mapRender = compMapRender;
-    return 0;
+void CommandBufferInit(CommandBuffer *cmds, Arena *arena, int maxCommands,
+                       size_t maxDataBytes) {
+    cmds->commands = ArenaAlloc(arena, sizeof(Command) * maxCommands);
+    cmds->commandsCapacity = maxCommands;
+    cmds->data = ArenaAlloc(arena, maxDataBytes);
+    cmds->dataCapacity = maxDataBytes;
+    cmds->createdIds = ArenaAlloc(arena, sizeof(int) * maxCommands);
+    CommandBufferReset(cmds);
 }
 
-static void removeMapRender(int mapRenderId) {
-    if (mapRenderId >= 0) {
-        compMapRender->enabled = false;
-    }
+void CommandBufferReset(CommandBuffer *cmds) {
+    cmds->commandsCount = 0;
+    cmds->dataSize = 0;
+    cmds->createdCount = 0;
 }
 
-static int createCamera(void **cameraComp) {
-    compCamera->enabled = true;
-    compCamera->camera =
-        (Camera2D){.target = Vector2Zero(), .offset = Vector2Zero(), .zoom = 1.0f};
-    compCamera->targetTransf = NULL;
-    compCamera->offset = Vector2Zero();
-    *cameraComp = compCamera;
-    return 0;
+static Command *pushCommand(CommandBuffer *cmds, CommandType type, int entityId,
+                            CompType compType) {
+    assert(cmds->commandsCount < cmds->commandsCapacity);
+    if (cmds->commandsCount >= cmds->commandsCapacity) {
+        return NULL;
+    }
+
+    Command *cmd = &cmds->commands[cmds->commandsCount++];
+    *cmd = (Command){type, compType, entityId, -1};
+    return cmd;
 }
 
-static void removeCamera(int cameraCompId) {
-    if (cameraCompId >= 0) {
-        compCamera->enabled = false;
+// Entities created by a buffer get negative ids until it's played back,
+// they're only valid in commands of that same buffer.
+#define PENDING_ENTITY(idx)       (-(idx)-2)
+#define PENDING_INDEX(entityId)   (-(entityId)-2)
+#define IS_PENDING_ENTITY(entity) ((entity) < NULL_ENTITY_COMP)
+
+int CmdEntityCreate(CommandBuffer *cmds) {
+    int entityId = PENDING_ENTITY(cmds->createdCount);
+    if (pushCommand(cmds, CMD_ENTITY_CREATE, entityId, 0) == NULL) {
+        return NULL_ENTITY_COMP;
     }
+    ++cmds->createdCount;
+    return entityId;
 }
 
-static int createPlayer(void **playerComp) {
-    compPlayer->enabled = true;
-    compPlayer->speed = 0.0f;
-    compPlayer->idleAnim = (Animation){0};
-    compPlayer->runAnim = (Animation){0};
-    *playerComp = compPlayer;
-    return 0;
+void CmdEntityRemove(CommandBuffer *cmds, int entityId) {
+    pushCommand(cmds, CMD_ENTITY_REMOVE, entityId, 0);
 }
 
-static void removePlayer(int playerCompId) {
-    if (playerCompId >= 0) {
-        compPlayer->enabled = false;
+void CmdComponentAdd(CommandBuffer *cmds, int entityId, CompType type,
+                     const void *init) {
+    size_t dataOffset =
+        (cmds->dataSize + DEFAULT_ALIGNMENT - 1) & ~(DEFAULT_ALIGNMENT - 1);
+    if (init != NULL) {
+        assert(dataOffset + compPools[type].size <= cmds->dataCapacity);
+        if (dataOffset + compPools[type].size > cmds->dataCapacity) {
+            return;
+        }
+    }
+
+    Command *cmd = pushCommand(cmds, CMD_COMPONENT_ADD, entityId, type);
+    if (cmd != NULL && init != NULL) {
+        // keep a copy, the caller's value may not live until playback
+        memcpy(&cmds->data[dataOffset], init, compPools[type].size);
+        cmd->dataOffset = dataOffset;
+        cmds->dataSize = dataOffset + compPools[type].size;
     }
 }
 
-void *ComponentCreate(int entityId, CompType type) {
-    int compId;
-    void *component = NULL;
-    compId = compCreateFP[type](&component);
-    entities[entityId].components[type] = compId;
-    return component;
+void CmdComponentRemove(CommandBuffer *cmds, int entityId, CompType type) {
+    pushCommand(cmds, CMD_COMPONENT_REMOVE, entityId, type);
 }
 
-void ComponentRemove(int entityId, CompType type) {
-    int compId = entities[entityId].components[type];
-    compRemoveFP[type](compId);
+typedef struct CommandRef {
+    CommandBuffer *buffer;
+    Command *cmd;
+} CommandRef;
+
+static int resolveEntity(CommandBuffer *cmds, int entityId) {
+    return IS_PENDING_ENTITY(entityId) ? cmds->createdIds[PENDING_INDEX(entityId)]
+                                       : entityId;
 }
 
-void SystemMapInit(int mapEntity) {
-    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
-    if (mapRenderId == NULL_ENTITY_COMP) {
+static void playCommand(CommandBuffer *cmds, Command *cmd) {
+    int entityId = resolveEntity(cmds, cmd->entityId);
+    if (entityId < 0 || entityId >= MAX_ENTITIES || !entities[entityId].enabled) {
         return;
     }
 
-    MapRender *mapRender = compMapRender;
-    Map *map = &mapRender->map;
-    int layersCount = mapRender->renderLayersCount;
+    switch (cmd->type) {
+    case CMD_COMPONENT_ADD: {
+        void *comp = ComponentCreate(entityId, cmd->compType);
+        if (comp != NULL && cmd->dataOffset >= 0) {
+            memcpy(comp, &cmds->data[cmd->dataOffset], compPools[cmd->compType].size);
+            *(bool *)comp = true;
+        }
+    } break;
+    case CMD_COMPONENT_REMOVE:
+        ComponentRemove(entityId, cmd->compType);
+        break;
+    case CMD_ENTITY_REMOVE:
+        EntityRemove(entityId);
+        break;
+    default:
+        break;
+    }
+}
 
-    for (int layer = 0; layer < layersCount; ++layer) {
-        // create texture and enable for drawing
-        mapRender->renderLayers[layer] = LoadRenderTexture(
-            mapRender->tileWidth * map->width, mapRender->tileHeight * map->height);
-        BeginTextureMode(mapRender->renderLayers[layer]);
+// the component type, after every type for entity removes
+static int commandKey(const Command *cmd) {
+    return cmd->type == CMD_ENTITY_REMOVE ? compTypesCount : (int)cmd->compType;
+}
 
-        for (int y = 0; y < map->height; ++y) {
-            for (int x = 0; x < map->width; ++x) {
-                int tileId = map->tiles[layer][y * map->width + x];
-                Tile tile = AssetsGetTile(tileId);
+void CommandBufferPlayback(CommandBuffer **buffers, int buffersCount) {
+    TempArena temp = TempArenaBegin(&worldArena);
+    int *bucketStart = ArenaAlloc(&worldArena, sizeof(int) * (MAX_ENTITIES + 1));
+    int total = 0;
+
+    // create entities first so every other command can refer to them
+    for (int b = 0; b < buffersCount; ++b) {
+        CommandBuffer *cmds = buffers[b];
+        for (int i = 0; i < cmds->commandsCount; ++i) {
+            Command *cmd = &cmds->commands[i];
+            if (cmd->type == CMD_ENTITY_CREATE) {
+                cmds->createdIds[PENDING_INDEX(cmd->entityId)] = EntityCreate();
+            }
+        }
+    }
 
-                // draw tile to texture layer
-                float invY = map->height - 1 - y;
-                Rectangle src = tile.sprite.source;
-                Rectangle dest = {x * mapRender->tileWidth,
-                                  invY * mapRender->tileHeight, src.width, src.height};
-                src.height = -src.height;
-                DrawTexturePro(tile.sprite.tex, src, dest, Vector2Zero(), 0, WHITE);
+    // Radix sort, by entity then by component type, both stable: one type's
+    // pool is walked in entity order and each entity's commands on a component
+    // keep the order they were recorded in, buffer by buffer, so a remove
+    // followed by an add leaves it there. Entity removes come last, commands on
+    // no entity are dropped
+    for (int b = 0; b < buffersCount; ++b) {
+        CommandBuffer *cmds = buffers[b];
+        for (int i = 0; i < cmds->commandsCount; ++i) {
+            int entityId = resolveEntity(cmds, cmds->commands[i].entityId);
+            if (cmds->commands[i].type != CMD_ENTITY_CREATE && 0 <= entityId &&
+                entityId < MAX_ENTITIES) {
+                ++bucketStart[entityId + 1];
+                ++total;
+            }
+        }
+    }
+    for (int entityId = 0; entityId < MAX_ENTITIES; ++entityId) {
+        bucketStart[entityId + 1] += bucketStart[entityId];
+    }
+
+    CommandRef *sorted = ArenaAlloc(&worldArena, sizeof(CommandRef) * (total + 1));
+    for (int b = 0; b < buffersCount; ++b) {
+        CommandBuffer *cmds = buffers[b];
+        for (int i = 0; i < cmds->commandsCount; ++i) {
+            Command *cmd = &cmds->commands[i];
+            int entityId = resolveEntity(cmds, cmd->entityId);
+            if (cmd->type != CMD_ENTITY_CREATE && 0 <= entityId &&
+                entityId < MAX_ENTITIES) {
+                sorted[bucketStart[entityId]++] = (CommandRef){cmds, cmd};
             }
         }
+    }
+
+    int typeStart[MAX_COMP_TYPES + 2] = {0};
+    for (int i = 0; i < total; ++i) {
+        ++typeStart[commandKey(sorted[i].cmd) + 1];
+    }
+    for (int key = 0; key <= compTypesCount; ++key) {
+        typeStart[key + 1] += typeStart[key];
+    }
+    CommandRef *ordered = ArenaAlloc(&worldArena, sizeof(CommandRef) * (total + 1));
+    for (int i = 0; i < total; ++i) {
+        ordered[typeStart[commandKey(sorted[i].cmd)]++] = sorted[i];
+    }
+
+    for (int i = 0; i < total; ++i) {
+        playCommand(ordered[i].buffer, ordered[i].cmd);
+    }
+    TempArenaEnd(temp);
 
-        EndTextureMode();
+    for (int b = 0; b < buffersCount; ++b) {
+        CommandBufferReset(buffers[b]);
     }
 }
 
-void SystemRenderEntities(AList *renderEntities) {
-    for (size_t entityId = 0; entityId < AListSize(renderEntities); ++entityId) {
-        int compTransId = entities[entityId].components[COMP_TRANSFORM];
-        int compSRId = entities[entityId].components[COMP_SPRITERENDER];
-        if (compTransId == NULL_ENTITY_COMP || compSRId == NULL_ENTITY_COMP) {
-            continue;
+typedef enum {
+    SNAPSHOT_ENTITIES = 0,
+    SNAPSHOT_COMPONENTS,
+    SNAPSHOT_MAP_TILES = SNAPSHOT_COMPONENTS + MAX_COMP_TYPES
+} SnapshotBlockType;
+
+typedef struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t blocksCount;
+    uint64_t snapshotId;
+    uint64_t baseId;
+    uint64_t payloadSize;
+    uint64_t storedSize;
+} SnapshotHeader;
+
+// Payload starts with the block table, offsets are relative to the payload
+// so snapshots don't depend on where they are loaded
+typedef struct SnapshotBlock {
+    uint32_t type;
+    uint32_t stride;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t offset;
+} SnapshotBlock;
+
+typedef struct MappedFile {
+    unsigned char *data;
+    size_t size;
+} MappedFile;
+
+static int mapFile(const char *filepath, MappedFile *file) {
+    struct stat st;
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return 1;
+    }
+
+    file->size = st.st_size;
+    file->data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return file->data == MAP_FAILED;
+}
+
+static void unmapFile(MappedFile *file) {
+    munmap(file->data, file->size);
+}
+
+// Tiles of every baked map, one after the other in pool order
+static int snapshotTilesCount(void) {
+    int tilesCount = 0;
+    for (int i = 0; i < MAX_MAPRENDER; ++i) {
+        Map *map = &compMapRender[i].map;
+        if (compMapRender[i].enabled && compMapRender[i].stream == NULL) {
+            tilesCount += map->width * map->height * map->layersCount;
         }
+    }
+    return tilesCount;
+}
 
-        TransformComp *transfComp = &compTransform[compTransId];
-        SpriteRender *spriteRender = &compSpriteRender[compSRId];
+static int snapshotLayout(SnapshotBlock *blocks, size_t *payloadSize) {
+    int blocksCount = 0;
+    size_t offset = sizeof(SnapshotBlock) * (compTypesCount + 2);
 
-        Rectangle src = spriteRender->sprite.source;
-        src.width = spriteRender->flipX ? -src.width : src.width;
-        src.height = spriteRender->flipY ? -src.height : src.height;
+    blocks[blocksCount++] = (SnapshotBlock){SNAPSHOT_ENTITIES, sizeof(Entity),
+                                            MAX_ENTITIES, 0, 0};
+    for (int type = 0; type < compTypesCount; ++type) {
+        blocks[blocksCount++] = (SnapshotBlock){SNAPSHOT_COMPONENTS + type,
+                                                compPools[type].stride,
+                                                compPools[type].capacity, 0, 0};
+    }
+    // tiles can change at runtime, see MapSetTile
+    int tilesCount = snapshotTilesCount();
+    blocks[blocksCount++] =
+        (SnapshotBlock){SNAPSHOT_MAP_TILES, sizeof(uint16_t), tilesCount, 0, 0};
+
+    for (int i = 0; i < blocksCount; ++i) {
+        offset = (offset + DEFAULT_ALIGNMENT - 1) & ~(DEFAULT_ALIGNMENT - 1);
+        blocks[i].offset = offset;
+        offset += (size_t)blocks[i].stride * blocks[i].count;
+    }
 
-        Rectangle dest = {transfComp->position.x, transfComp->position.y,
-                          spriteRender->sprite.source.width * transfComp->scale.x,
-                          spriteRender->sprite.source.height * transfComp->scale.y};
+    *payloadSize = offset;
+    return blocksCount;
+}
 
-        DrawTexturePro(spriteRender->sprite.tex, src, dest, Vector2Zero(),
-                       transfComp->rotation, spriteRender->tint);
+static void *snapshotPool(int blockType) {
+    if (blockType == SNAPSHOT_ENTITIES) {
+        return entities;
     }
+    return compPools[blockType - SNAPSHOT_COMPONENTS].data;
 }
 
-void SystemAnimationUpdate(AList *animEntities, float dt) {
-    for (size_t entityId = 0; entityId < AListSize(animEntities); ++entityId) {
-        int compSRId = entities[entityId].components[COMP_SPRITERENDER];
-        int compARId = entities[entityId].components[COMP_ANIMRENDER];
-        if (compARId == NULL_ENTITY_COMP || compSRId == NULL_ENTITY_COMP) {
-            continue;
+// Registered component types are saved as they are, they must not hold
+// pointers. Sprites are asset ids and are saved as they are too
+static void fixupPools(CameraComp *cameras, MapRender *mapRenders, bool toFile) {
+    // the camera target becomes a transform index plus one
+    for (int i = 0; i < MAX_CAMERA; ++i) {
+        CameraComp *camera = &cameras[i];
+        if (toFile) {
+            uintptr_t targetIdx =
+                camera->targetTransf
+                    ? (uintptr_t)(camera->targetTransf - compTransform) + 1
+                    : 0;
+            camera->targetTransf = (TransformComp *)targetIdx;
+        } else {
+            uintptr_t targetIdx = (uintptr_t)camera->targetTransf;
+            camera->targetTransf =
+                targetIdx != 0 ? &compTransform[targetIdx - 1] : NULL;
         }
+    }
 
-        SpriteRender *spriteRender = &compSpriteRender[compSRId];
-        AnimRender *animRender = &compAnimRender[compARId];
-
-        int frameCount = animRender->anim.frameCount;
-        float frameDur = animRender->anim.frameDuration;
-        int currentFrame = (int)(animRender->frameTime / frameDur) % frameCount;
-        animRender->frameTime += dt;
-        spriteRender->sprite = animRender->anim.frames[currentFrame];
+    for (int i = 0; toFile && i < MAX_MAPRENDER; ++i) {
+        // GPU, asset and game memory can't be saved, they're kept on load
+        MapRender *mapRender = &mapRenders[i];
+        memset(mapRender->map.tiles, 0, sizeof(mapRender->map.tiles));
+        memset(mapRender->renderLayers, 0, sizeof(mapRender->renderLayers));
+        mapRender->stream = NULL;
+        mapRender->cacheDir = NULL;
+        mapRender->lights = NULL;
+        mapRender->lightTexture = (Texture2D){0};
     }
 }
 
-void SystemMapRenderLayer(int mapEntity, int layer) {
-    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
-    if (mapRenderId == NULL_ENTITY_COMP) {
-        return;
+// Delta payloads are runs of (unchanged bytes, changed bytes, changed bytes
+// xor base), so a snapshot close to its base is mostly skipped runs.
+static size_t deltaEncode(const unsigned char *payload, const unsigned char *base,
+                          size_t size, unsigned char *out) {
+    size_t written = 0;
+    size_t i = 0;
+
+    while (i < size) {
+        size_t same = i;
+        while (same < size && payload[same] == base[same]) {
+            ++same;
+        }
+        size_t diff = same;
+        while (diff < size && payload[diff] != base[diff]) {
+            ++diff;
+        }
+
+        uint64_t runs[2] = {same - i, diff - same};
+        memcpy(&out[written], runs, sizeof(runs));
+        written += sizeof(runs);
+        for (size_t j = same; j < diff; ++j) {
+            out[written++] = payload[j] ^ base[j];
+        }
+        i = diff;
     }
 
-    MapRender *mapRender = compMapRender;
-    Texture2D layerTex = mapRender->renderLayers[layer].texture;
+    return written;
+}
 
-    // draw map
-    Rectangle src = {0, 0, layerTex.width, layerTex.height};
-    Rectangle dest = {0, 0, layerTex.width * mapRender->scale.x,
-                      layerTex.height * mapRender->scale.y};
-    DrawTexturePro(layerTex, src, dest, Vector2Zero(), 0, WHITE);
+static int deltaDecode(const unsigned char *delta, size_t deltaSize,
+                       const unsigned char *base, size_t size, unsigned char *out) {
+    size_t read = 0;
+    size_t i = 0;
+
+    memcpy(out, base, size);
+    while (read + sizeof(uint64_t) * 2 <= deltaSize) {
+        uint64_t runs[2];
+        memcpy(runs, &delta[read], sizeof(runs));
+        read += sizeof(runs);
+
+        i += runs[0];
+        if (i + runs[1] > size || read + runs[1] > deltaSize) {
+            return 1;
+        }
+        for (uint64_t j = 0; j < runs[1]; ++j) {
+            out[i++] ^= delta[read++];
+        }
+    }
+
+    return read != deltaSize;
 }
 
-void SystemCameraUpdate(int cameraEntity) {
-    int cameraCompId = entities[cameraEntity].components[COMP_CAMERA];
-    if (cameraCompId == NULL_ENTITY_COMP) {
-        return;
+static const unsigned char *checkSnapshot(MappedFile *file, SnapshotHeader *header) {
+    memcpy(header, file->data, sizeof(*header));
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->storedSize != file->size - sizeof(*header)) {
+        return NULL;
     }
+    return file->data + sizeof(*header);
+}
 
-    if (compCamera->targetTransf != NULL) {
-        compCamera->camera.target = compCamera->targetTransf->position;
+// Tiles are laid out by the maps of the snapshot, stored, or the live maps
+// when writing. Live maps without tiles are skipped over on load
+static void copyMapTiles(unsigned char *tiles, const MapRender *stored) {
+    size_t offset = 0;
+    for (int i = 0; i < MAX_MAPRENDER; ++i) {
+        MapRender *mapRender = &compMapRender[i];
+        const Map *layout = stored != NULL ? &stored[i].map : &mapRender->map;
+        bool enabled = stored != NULL ? stored[i].enabled : mapRender->enabled;
+        if (!enabled || mapRender->stream != NULL) {
+            continue;
+        }
+
+        Map *map = &mapRender->map;
+        size_t layerSize = sizeof(uint16_t) * layout->width * layout->height;
+        for (int layer = 0; layer < layout->layersCount; ++layer, offset += layerSize) {
+            if (stored == NULL) {
+                memcpy(tiles + offset, map->tiles[layer], layerSize);
+            } else if (map->tiles[layer] != NULL) {
+                memcpy(map->tiles[layer], tiles + offset, layerSize);
+            }
+        }
+
+        // baked layers are redrawn on the next SystemMapRebake
+        for (int layer = 0; stored != NULL && layer < mapRender->renderLayersCount;
+             ++layer) {
+            mapRender->dirtyCount[layer] = 1;
+            mapRender->dirtyRects[layer][0] =
+                (MapDirtyRect){0, 0, map->width, map->height};
+        }
     }
+}
 
-    compCamera->camera.offset = compCamera->offset;
+// Maps of the snapshot must have the size of the live ones they're loaded
+// into, returns the tiles they hold or -1
+static long storedTilesCount(const MapRender *stored) {
+    long tilesCount = 0;
+    for (int i = 0; i < MAX_MAPRENDER; ++i) {
+        const Map *map = &stored[i].map;
+        const Map *live = &compMapRender[i].map;
+        if (!stored[i].enabled || compMapRender[i].stream != NULL) {
+            continue;
+        }
+
+        if (live->tiles[0] != NULL &&
+            (map->width != live->width || map->height != live->height ||
+             map->layersCount != live->layersCount)) {
+            return -1;
+        }
+        if (map->width < 0 || map->height < 0 || map->layersCount < 0 ||
+            map->layersCount > MAX_MAP_LAYERS) {
+            return -1;
+        }
+        tilesCount += (long)map->width * map->height * map->layersCount;
+    }
+    return tilesCount;
 }
 
-void SystemPlayerUpdate(int playerEntity, Vector2 input, float dt) {
-    int transformCompId = entities[playerEntity].components[COMP_TRANSFORM];
-    int spriteCompId = entities[playerEntity].components[COMP_SPRITERENDER];
-    int animCompId = entities[playerEntity].components[COMP_ANIMRENDER];
-    int playerCompId = entities[playerEntity].components[COMP_PLAYER];
-    if (transformCompId == NULL_ENTITY_COMP || spriteCompId == NULL_ENTITY_COMP ||
-        animCompId == NULL_ENTITY_COMP || playerCompId == NULL_ENTITY_COMP) {
-        return;
+int WorldSnapshotWrite(const char *filepath, const char *baseFilepath) {
+    SnapshotBlock blocks[MAX_COMP_TYPES + 2];
+    size_t payloadSize;
+    int blocksCount = snapshotLayout(blocks, &payloadSize);
+
+    unsigned char *payload = calloc(1, payloadSize);
+    if (payload == NULL) {
+        return 1;
     }
 
-    TransformComp *transfComp = &compTransform[transformCompId];
-    SpriteRender *spriteComp = &compSpriteRender[spriteCompId];
-    AnimRender *animComp = &compAnimRender[animCompId];
-    PlayerComp *playerComp = compPlayer;
+    // raw copies of every pool, then pointers are turned into indices
+    memcpy(payload, blocks, sizeof(SnapshotBlock) * blocksCount);
+    for (int i = 0; i < blocksCount; ++i) {
+        size_t blockSize = (size_t)blocks[i].stride * blocks[i].count;
+        if (blocks[i].type == SNAPSHOT_MAP_TILES) {
+            copyMapTiles(payload + blocks[i].offset, NULL);
+        } else {
+            memcpy(payload + blocks[i].offset, snapshotPool(blocks[i].type), blockSize);
+        }
+    }
+    SnapshotBlock *compBlocks = &blocks[SNAPSHOT_COMPONENTS];
+    fixupPools((CameraComp *)(payload + compBlocks[COMP_CAMERA].offset),
+               (MapRender *)(payload + compBlocks[COMP_MAPRENDER].offset), true);
+
+    // only needs to tell snapshots apart, for delta bases
+    uint64_t snapshotId = ((uint64_t)time(NULL) << 32) ^ (uintptr_t)payload;
+    SnapshotHeader header = {.version = SNAPSHOT_VERSION,
+                             .blocksCount = blocksCount,
+                             .snapshotId = snapshotId,
+                             .payloadSize = payloadSize,
+                             .storedSize = payloadSize};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+
+    unsigned char *stored = payload;
+    unsigned char *delta = NULL;
+    MappedFile baseFile;
+    if (baseFilepath != NULL && mapFile(baseFilepath, &baseFile) == 0) {
+        SnapshotHeader baseHeader;
+        const unsigned char *base = checkSnapshot(&baseFile, &baseHeader);
+
+        // a delta is only worth it against a full snapshot of the same layout
+        if (base != NULL && !(baseHeader.flags & SNAPSHOT_DELTA) &&
+            baseHeader.payloadSize == payloadSize) {
+            // worst case is alternating bytes, each with its own run header
+            delta = malloc(payloadSize * (1 + sizeof(uint64_t) * 2) + 1);
+            if (delta != NULL) {
+                header.storedSize = deltaEncode(payload, base, payloadSize, delta);
+                header.flags |= SNAPSHOT_DELTA;
+                header.baseId = baseHeader.snapshotId;
+                stored = delta;
+            }
+        }
+        unmapFile(&baseFile);
+    }
 
-    Vector2 vel = Vector2Scale(input, dt * playerComp->speed);
-    transfComp->position = Vector2Add(transfComp->position, vel);
+    FILE *file = fopen(filepath, "wb");
+    int err = file == NULL;
+    if (file != NULL) {
+        err = fwrite(&header, sizeof(header), 1, file) != 1 ||
+              fwrite(stored, header.storedSize, 1, file) != 1;
+        err = fclose(file) != 0 || err;
+    }
+    if (err) {
+        TraceLog(LOG_ERROR, "Failed to write snapshot %s", filepath);
+    }
 
-    if (Vector2Equals(vel, Vector2Zero())) {
-        animComp->anim = playerComp->idleAnim;
-    } else {
-        animComp->anim = playerComp->runAnim;
+    free(delta);
+    free(payload);
+    return err;
+}
+
+static int applySnapshot(const unsigned char *payload, size_t payloadSize,
+                         int blocksCount) {
+    SnapshotBlock expected[MAX_COMP_TYPES + 2];
+    SnapshotBlock blocks[MAX_COMP_TYPES + 2];
+    size_t expectedSize;
+
+    // blocks must match this build's pools exactly, only map tiles may differ
+    int expectedCount = snapshotLayout(expected, &expectedSize);
+    if (blocksCount != expectedCount ||
+        payloadSize < sizeof(SnapshotBlock) * blocksCount) {
+        return 1;
+    }
+    memcpy(blocks, payload, sizeof(SnapshotBlock) * blocksCount);
+    for (int i = 0; i < blocksCount; ++i) {
+        size_t blockSize = (size_t)blocks[i].stride * blocks[i].count;
+        if (blocks[i].type != expected[i].type ||
+            blocks[i].stride != expected[i].stride ||
+            blocks[i].offset + blockSize > payloadSize ||
+            (blocks[i].type != SNAPSHOT_MAP_TILES &&
+             blocks[i].count != expected[i].count)) {
+            return 1;
+        }
     }
 
-    if (vel.x > 0) {
-        spriteComp->flipX = false;
+    // nothing is touched unless the maps fit the live ones
+    SnapshotBlock tiles = blocks[blocksCount - 1];
+    SnapshotBlock maps = blocks[SNAPSHOT_COMPONENTS + COMP_MAPRENDER];
+    const MapRender *stored = (const MapRender *)(payload + maps.offset);
+    if (storedTilesCount(stored) != (long)tiles.count) {
+        return 1;
+    }
+
+    // keep what only makes sense in this process
+    MapRender liveMaps[MAX_MAPRENDER];
+    memcpy(liveMaps, compMapRender, sizeof(liveMaps));
+
+    for (int i = 0; i < blocksCount; ++i) {
+        size_t blockSize = (size_t)blocks[i].stride * blocks[i].count;
+        if (blocks[i].type != SNAPSHOT_MAP_TILES) {
+            memcpy(snapshotPool(blocks[i].type), payload + blocks[i].offset, blockSize);
+        }
+    }
+    fixupPools(compCamera, compMapRender, false);
+    transformOrderValid = false;
+
+    for (int i = 0; i < MAX_MAPRENDER; ++i) {
+        MapRender *mapRender = &compMapRender[i];
+        Map *live = &liveMaps[i].map;
+        memcpy(mapRender->map.tiles, live->tiles, sizeof(live->tiles));
+        mapRender->map.width = live->width;
+        mapRender->map.height = live->height;
+        mapRender->map.layersCount = live->layersCount;
+        memcpy(mapRender->renderLayers, liveMaps[i].renderLayers,
+               sizeof(liveMaps[i].renderLayers));
+        mapRender->stream = liveMaps[i].stream;
+        mapRender->cacheDir = liveMaps[i].cacheDir;
+        mapRender->lights = liveMaps[i].lights;
+        mapRender->lightTexture = liveMaps[i].lightTexture;
+    }
+
+    // the block table was checked against the payload size above
+    copyMapTiles((unsigned char *)payload + tiles.offset, stored);
+    return 0;
+}
+
+int WorldSnapshotRead(const char *filepath, const char *baseFilepath) {
+    MappedFile file;
+    SnapshotHeader header;
+
+    if (mapFile(filepath, &file) != 0) {
+        TraceLog(LOG_ERROR, "Failed to open snapshot %s", filepath);
+        return 1;
+    }
+
+    const unsigned char *stored = checkSnapshot(&file, &header);
+    const unsigned char *payload = stored;
+    unsigned char *decoded = NULL;
+    int err = stored == NULL;
+
+    if (!err && (header.flags & SNAPSHOT_DELTA)) {
+        MappedFile baseFile;
+        SnapshotHeader baseHeader;
+
+        err = baseFilepath == NULL || mapFile(baseFilepath, &baseFile) != 0;
+        if (!err) {
+            const unsigned char *base = checkSnapshot(&baseFile, &baseHeader);
+            decoded = malloc(header.payloadSize);
+            err = base == NULL || decoded == NULL ||
+                  baseHeader.snapshotId != header.baseId ||
+                  baseHeader.payloadSize != header.payloadSize ||
+                  deltaDecode(stored, header.storedSize, base, header.payloadSize,
+                              decoded) != 0;
+            payload = decoded;
+            unmapFile(&baseFile);
+        }
+    }
+
+    if (!err) {
+        err = applySnapshot(payload, header.payloadSize, header.blocksCount);
+    }
+    if (err) {
+        TraceLog(LOG_ERROR, "Invalid snapshot %s", filepath);
+    }
+
+    free(decoded);
+    unmapFile(&file);
+    return err;
+}
+
+uint64_t WorldStateHash(void) {
+    // fields are hashed one by one, struct padding is never read
+    uint64_t hash = HASH_SEED;
+
+    for (int entityId = 0; entityId < MAX_ENTITIES; ++entityId) {
+        Entity *entity = &entities[entityId];
+        if (!entity->enabled) {
+            continue;
+        }
+        hash = HashBytes(hash, &entityId, sizeof(entityId));
+        hash = HashBytes(hash, entity->components, sizeof(entity->components));
+    }
+
+    for (int i = 0; i < MAX_TRANSFORM; ++i) {
+        TransformComp *transf = &compTransform[i];
+        if (transf->enabled) {
+            hash = HashBytes(hash, &transf->position, sizeof(transf->position));
+            hash = HashBytes(hash, &transf->scale, sizeof(transf->scale));
+            hash = HashBytes(hash, &transf->rotation, sizeof(transf->rotation));
+        }
+    }
+    for (int i = 0; i < MAX_SPRITERENDER; ++i) {
+        SpriteRender *sprite = &compSpriteRender[i];
+        if (sprite->enabled) {
+            Rectangle source = AssetsGetSpriteSource(sprite->sprite);
+            hash = HashBytes(hash, &source, sizeof(source));
+            hash = HashBytes(hash, &sprite->flipX, sizeof(sprite->flipX));
+            hash = HashBytes(hash, &sprite->flipY, sizeof(sprite->flipY));
+        }
+    }
+    for (int i = 0; i < MAX_ANIMRENDER; ++i) {
+        AnimRender *anim = &compAnimRender[i];
+        if (anim->enabled) {
+            int frameCount = anim->anim.frameCount;
+            hash = HashBytes(hash, &frameCount, sizeof(frameCount));
+            hash = HashBytes(hash, &anim->frameTime, sizeof(anim->frameTime));
+        }
+    }
+    for (int i = 0; i < MAX_CAMERA; ++i) {
+        CameraComp *cameraComp = &compCamera[i];
+        if (cameraComp->enabled) {
+            hash = HashBytes(hash, &cameraComp->camera.target,
+                             sizeof(cameraComp->camera.target));
+        }
+    }
+
+    return hash;
+}
+
+static int mapLayersDrawn(const MapRender *mapRender) {
+    return mapRender->renderLayersCount < mapRender->map.layersCount
+               ? mapRender->renderLayersCount
+               : mapRender->map.layersCount;
+}
+
+// texture a map layer is baked into
+static int bakedLayer(const MapRender *mapRender, int layer) {
+    return layer < mapRender->mergedLayers ? 0 : layer;
+}
+
+// map layers baked into a texture, [first, last)
+static void bakedLayerRange(const MapRender *mapRender, int baked, int *first,
+                            int *last) {
+    int drawn = mapLayersDrawn(mapRender);
+    *first = baked;
+    *last = baked + 1;
+    if (baked == 0 && mapRender->mergedLayers > 1) {
+        *last = mapRender->mergedLayers < drawn ? mapRender->mergedLayers : drawn;
+    }
+}
+
+static bool tileCoversCell(const MapRender *mapRender, int tileId) {
+    Sprite sprite = AssetsGetSprite(AssetsGetTile(tileId).sprite);
+    return sprite.opaque && sprite.width >= mapRender->tileWidth &&
+           sprite.height >= mapRender->tileHeight;
+}
+
+// whatever is under an opaque tile of a higher drawn layer never shows, not
+// even entities drawn in between
+static bool tileHidden(const MapRender *mapRender, int layer, int x, int y) {
+    const Map *map = &mapRender->map;
+    int drawn = mapLayersDrawn(mapRender);
+
+    for (int above = layer + 1; above < drawn; ++above) {
+        if (tileCoversCell(mapRender, map->tiles[above][y * map->width + x])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void drawMapTiles(MapRender *mapRender, int baked, MapDirtyRect region) {
+    Map *map = &mapRender->map;
+    int first, last;
+
+    bakedLayerRange(mapRender, baked, &first, &last);
+    for (int layer = first; layer < last; ++layer) {
+        for (int y = region.y; y < region.y + region.height; ++y) {
+            for (int x = region.x; x < region.x + region.width; ++x) {
+                if (tileHidden(mapRender, layer, x, y)) {
+                    continue;
+                }
+
+                // draw tile to texture layer
+                int tileId = map->tiles[layer][y * map->width + x];
+                Tile tile = AssetsGetTile(tileId);
+                float invY = map->height - 1 - y;
+                Rectangle src = AssetsGetSpriteSource(tile.sprite);
+                Rectangle dest = {x * mapRender->tileWidth,
+                                  invY * mapRender->tileHeight, src.width, src.height};
+                RenderDrawSprite(tile.sprite, dest, 0, WHITE, false, true);
+            }
+        }
+    }
+}
+
+static MapBakeStats mapBakeStats(const MapRender *mapRender) {
+    const Map *map = &mapRender->map;
+    MapBakeStats stats = {.layersDrawn = mapLayersDrawn(mapRender)};
+
+    for (int layer = 0; layer < stats.layersDrawn; ++layer) {
+        if (bakedLayer(mapRender, layer) == layer) {
+            ++stats.texturesDrawn;
+        }
+        for (int y = 0; y < map->height; ++y) {
+            for (int x = 0; x < map->width; ++x) {
+                ++stats.tilesCount;
+                stats.tilesHidden += tileHidden(mapRender, layer, x, y);
+            }
+        }
+    }
+    return stats;
+}
+
+// Baked layer pixels as read back from the render texture, upside down. Which
+// layers were merged and drawn changes the pixels as much as the content
+typedef struct MapCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t contentHash;
+    int32_t width, height;
+    int32_t mergedLayers, layersDrawn;
+} MapCacheHeader;
+
+static void cachedLayerPath(const MapRender *mapRender, int layer, char *path,
+                            size_t pathLen) {
+    snprintf(path, pathLen, "%s/%s_layer%d.bake", mapRender->cacheDir,
+             mapRender->map.name, layer);
+}
+
+static bool loadCachedLayer(MapRender *mapRender, int layer) {
+    Texture2D texture = mapRender->renderLayers[layer].texture;
+    char path[512];
+    MapCacheHeader header;
+
+    cachedLayerPath(mapRender, layer, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    // a cache made from other assets is rebaked and overwritten
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, MAP_CACHE_MAGIC, 4) == 0 &&
+                 header.version == MAP_CACHE_VERSION &&
+                 header.contentHash == mapRender->map.contentHash &&
+                 header.width == texture.width && header.height == texture.height &&
+                 header.mergedLayers == mapRender->mergedLayers &&
+                 header.layersDrawn == mapLayersDrawn(mapRender);
+    size_t pixelsSize = (size_t)texture.width * texture.height * 4;
+    void *pixels = valid ? malloc(pixelsSize) : NULL;
+    valid = pixels != NULL && fread(pixels, pixelsSize, 1, file) == 1;
+    fclose(file);
+
+    if (valid) {
+        // the whole layer in a single upload
+        UpdateTexture(texture, pixels);
+        TraceLog(LOG_DEBUG, "Loaded baked map layer %d from %s", layer, path);
+    }
+    free(pixels);
+    return valid;
+}
+
+static void saveCachedLayer(const MapRender *mapRender, int layer) {
+    Image image = LoadImageFromTexture(mapRender->renderLayers[layer].texture);
+    if (image.data == NULL || image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+        UnloadImage(image);
+        return;
+    }
+
+    MapCacheHeader header = {.magic = MAP_CACHE_MAGIC,
+                             .version = MAP_CACHE_VERSION,
+                             .contentHash = mapRender->map.contentHash,
+                             .width = image.width,
+                             .height = image.height,
+                             .mergedLayers = mapRender->mergedLayers,
+                             .layersDrawn = mapLayersDrawn(mapRender)};
+    char path[512], tmpPath[520];
+    cachedLayerPath(mapRender, layer, path, sizeof(path));
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    // written aside and renamed, a crash never leaves half a layer behind
+    mkdir(mapRender->cacheDir, 0755);
+    FILE *file = fopen(tmpPath, "wb");
+    bool ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(image.data, (size_t)image.width * image.height * 4, 1, file) == 1;
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    }
+    ok = ok && rename(tmpPath, path) == 0;
+    if (!ok) {
+        TraceLog(LOG_WARNING, "Failed to cache baked map layer %s", path);
+        remove(tmpPath);
+    }
+    UnloadImage(image);
+}
+
+void SystemMapInit(int mapEntity) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    Map *map = &mapRender->map;
+    if (mapRender->stream != NULL) {
+        // streamed maps are too large to bake
+        return;
+    }
+
+    int layersCount = mapLayersDrawn(mapRender);
+    for (int layer = 0; layer < layersCount; ++layer) {
+        if (bakedLayer(mapRender, layer) != layer) {
+            // part of the merged texture
+            mapRender->renderLayers[layer] = (RenderTexture2D){0};
+            continue;
+        }
+
+        // create texture and enable for drawing
+        mapRender->renderLayers[layer] = RenderLoadTarget(
+            mapRender->tileWidth * map->width, mapRender->tileHeight * map->height);
+        mapRender->dirtyCount[layer] = 0;
+
+        // the cache reads and writes real textures, recordings always bake
+        bool cached = mapRender->cacheDir != NULL && !RenderIsRecording();
+        if (cached && loadCachedLayer(mapRender, layer)) {
+            continue;
+        }
+
+        RenderBeginTarget(mapRender->renderLayers[layer]);
+        RenderClear();
+        drawMapTiles(mapRender, layer, (MapDirtyRect){0, 0, map->width, map->height});
+        RenderEndTarget();
+        if (cached) {
+            saveCachedLayer(mapRender, layer);
+        }
+    }
+
+    // every drawn texture is a fill of the whole map each frame
+    MapBakeStats stats = mapBakeStats(mapRender);
+    mapRender->bakeStats = stats;
+    TraceLog(LOG_INFO,
+             "MAP: %s draws %d layers as %d textures (%.0f%% less fill), "
+             "%d of %d tiles hidden",
+             map->name, stats.layersDrawn, stats.texturesDrawn,
+             stats.layersDrawn > 0
+                 ? 100.0 * (stats.layersDrawn - stats.texturesDrawn) / stats.layersDrawn
+                 : 0.0,
+             stats.tilesHidden, stats.tilesCount);
+}
+
+static int dirtyRectArea(MapDirtyRect r) {
+    return r.width * r.height;
+}
+
+static MapDirtyRect dirtyRectUnion(MapDirtyRect a, MapDirtyRect b) {
+    int x0 = a.x < b.x ? a.x : b.x;
+    int y0 = a.y < b.y ? a.y : b.y;
+    int x1 = (a.x + a.width) > (b.x + b.width) ? a.x + a.width : b.x + b.width;
+    int y1 = (a.y + a.height) > (b.y + b.height) ? a.y + a.height : b.y + b.height;
+    return (MapDirtyRect){x0, y0, x1 - x0, y1 - y0};
+}
+
+static int dirtyRectOverlap(MapDirtyRect a, MapDirtyRect b) {
+    int x0 = a.x > b.x ? a.x : b.x;
+    int y0 = a.y > b.y ? a.y : b.y;
+    int x1 = (a.x + a.width) < (b.x + b.width) ? a.x + a.width : b.x + b.width;
+    int y1 = (a.y + a.height) < (b.y + b.height) ? a.y + a.height : b.y + b.height;
+    return (x1 > x0 && y1 > y0) ? (x1 - x0) * (y1 - y0) : 0;
+}
+
+// Number of tiles that merging 'a' and 'b' would redraw without being dirty.
+static int dirtyRectWaste(MapDirtyRect a, MapDirtyRect b) {
+    int covered = dirtyRectArea(a) + dirtyRectArea(b) - dirtyRectOverlap(a, b);
+    return dirtyRectArea(dirtyRectUnion(a, b)) - covered;
+}
+
+static void addDirtyRect(MapRender *mapRender, int layer, MapDirtyRect rect) {
+    MapDirtyRect *rects = mapRender->dirtyRects[layer];
+    int *count = &mapRender->dirtyCount[layer];
+
+    // keep merging while the region grows without redrawing clean tiles,
+    // touching rectangles (e.g. a row of broken walls) become a single one
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < *count; ++i) {
+            if (dirtyRectWaste(rects[i], rect) == 0) {
+                rect = dirtyRectUnion(rects[i], rect);
+                rects[i] = rects[--(*count)];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (*count < MAX_MAP_DIRTY_RECTS) {
+        rects[(*count)++] = rect;
+        return;
+    }
+
+    // list is full, grow the rectangle that wastes the least
+    int best = 0;
+    for (int i = 1; i < *count; ++i) {
+        if (dirtyRectWaste(rects[i], rect) < dirtyRectWaste(rects[best], rect)) {
+            best = i;
+        }
+    }
+    rects[best] = dirtyRectUnion(rects[best], rect);
+}
+
+void MapSetTile(int mapEntity, int layer, int x, int y, int tileId) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    Map *map = &mapRender->map;
+    if (layer < 0 || layer >= map->layersCount || x < 0 || x >= map->width || y < 0 ||
+        y >= map->height) {
+        return;
+    }
+
+    uint16_t *tile = &map->tiles[layer][y * map->width + x];
+    if (*tile == tileId) {
+        return;
+    }
+
+    *tile = tileId;
+    if (layer >= mapRender->renderLayersCount || mapRender->stream != NULL) {
+        return;
+    }
+
+    // the tile may hide or uncover what the layers below have there
+    for (int below = 0; below <= layer; ++below) {
+        if (bakedLayer(mapRender, below) == below) {
+            addDirtyRect(mapRender, below, (MapDirtyRect){x, y, 1, 1});
+        }
+    }
+}
+
+int MapCollisionInit(int mapEntity, CollisionGrid *grid, Arena *arena) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP || compMapRender[mapRenderId].stream != NULL) {
+        return 1;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    Map *map = &mapRender->map;
+    if (CollisionGridInit(grid, arena, map->width, map->height,
+                          mapRender->tileWidth * mapRender->scale.x,
+                          mapRender->tileHeight * mapRender->scale.y) != 0) {
+        return 1;
+    }
+
+    // a cell is solid when any layer has a solid tile there
+    for (int layer = 0; layer < map->layersCount; ++layer) {
+        for (int y = 0; y < map->height; ++y) {
+            for (int x = 0; x < map->width; ++x) {
+                Tile tile = AssetsGetTile(map->tiles[layer][y * map->width + x]);
+                if (tile.solid) {
+                    CollisionGridSet(grid, x, y, true);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+void SystemMapRebake(int mapEntity) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    Map *map = &mapRender->map;
+
+    for (int layer = 0; layer < mapRender->renderLayersCount; ++layer) {
+        if (mapRender->dirtyCount[layer] == 0 || mapRender->stream != NULL) {
+            continue;
+        }
+
+        RenderBeginTarget(mapRender->renderLayers[layer]);
+        for (int i = 0; i < mapRender->dirtyCount[layer]; ++i) {
+            MapDirtyRect rect = mapRender->dirtyRects[layer][i];
+
+            // layer textures are stored upside down, same as drawMapTiles
+            int invY = map->height - (rect.y + rect.height);
+            RenderBeginClip((Rectangle){rect.x * mapRender->tileWidth,
+                                        invY * mapRender->tileHeight,
+                                        rect.width * mapRender->tileWidth,
+                                        rect.height * mapRender->tileHeight});
+            RenderClear();
+            drawMapTiles(mapRender, layer, rect);
+            RenderEndClip();
+        }
+        RenderEndTarget();
+
+        mapRender->dirtyCount[layer] = 0;
+    }
+}
+
+static bool hasParent(const TransformComp *transfComp) {
+    return transfComp->parent != NULL_ENTITY_COMP &&
+           compTransform[transfComp->parent].enabled;
+}
+
+static void buildTransformOrder(void) {
+    TempArena temp = TempArenaBegin(&worldArena);
+    int *childStart = ArenaAlloc(&worldArena, sizeof(int) * (MAX_TRANSFORM + 1));
+    int *children = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+    int *fill = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+    int *stack = ArenaAlloc(&worldArena, sizeof(int) * MAX_TRANSFORM);
+
+    // children grouped by parent: count, prefix sum, then fill. Children of
+    // removed parents become roots where they are
+    for (int i = 0; i < MAX_TRANSFORM; ++i) {
+        if (!compTransform[i].enabled) {
+            continue;
+        }
+        if (hasParent(&compTransform[i])) {
+            ++childStart[compTransform[i].parent + 1];
+        } else if (compTransform[i].parent != NULL_ENTITY_COMP) {
+            orphanTransform(&compTransform[i]);
+        }
+    }
+    for (int i = 0; i < MAX_TRANSFORM; ++i) {
+        childStart[i + 1] += childStart[i];
+    }
+    for (int i = 0; i < MAX_TRANSFORM; ++i) {
+        if (compTransform[i].enabled && hasParent(&compTransform[i])) {
+            int parent = compTransform[i].parent;
+            children[childStart[parent] + fill[parent]++] = i;
+        }
+    }
+
+    // depth first from every root
+    transformOrderCount = 0;
+    for (int root = 0; root < MAX_TRANSFORM; ++root) {
+        if (!compTransform[root].enabled || hasParent(&compTransform[root])) {
+            continue;
+        }
+
+        int top = 0;
+        stack[top++] = root;
+        while (top > 0) {
+            int node = stack[--top];
+            transformOrderIndex[node] = transformOrderCount;
+            transformSubtreeSize[node] = 1;
+            transformOrder[transformOrderCount++] = node;
+            for (int c = childStart[node + 1] - 1; c >= childStart[node]; --c) {
+                stack[top++] = children[c];
+            }
+        }
+    }
+    for (int k = transformOrderCount - 1; k >= 0; --k) {
+        TransformComp *transfComp = &compTransform[transformOrder[k]];
+        if (hasParent(transfComp)) {
+            transformSubtreeSize[transfComp->parent] +=
+                transformSubtreeSize[transformOrder[k]];
+        }
+    }
+
+    TempArenaEnd(temp);
+    transformOrderValid = true;
+    transformOrderVersion = compPools[COMP_TRANSFORM].version;
+}
+
+static void updateWorldTransform(TransformComp *transfComp) {
+    transfComp->dirty = false;
+    if (!hasParent(transfComp)) {
+        transfComp->worldPosition = transfComp->position;
+        transfComp->worldScale = transfComp->scale;
+        transfComp->worldRotation = transfComp->rotation;
+        return;
+    }
+
+    // parents are always updated before their children
+    TransformComp *parent = &compTransform[transfComp->parent];
+    Vector2 offset = Vector2Multiply(transfComp->position, parent->worldScale);
+    offset = Vector2Rotate(offset, parent->worldRotation * DEG2RAD);
+    transfComp->worldPosition = Vector2Add(parent->worldPosition, offset);
+    transfComp->worldScale = Vector2Multiply(parent->worldScale, transfComp->scale);
+    transfComp->worldRotation = parent->worldRotation + transfComp->rotation;
+}
+
+static int compareOrderIndex(const void *a, const void *b) {
+    return transformOrderIndex[*(const int *)a] - transformOrderIndex[*(const int *)b];
+}
+
+void SystemTransformUpdate(void) {
+    ++transformUpdates;
+    transformMovedCount = 0;
+    transformAllMoved = false;
+    if (!transformOrderValid ||
+        transformOrderVersion != compPools[COMP_TRANSFORM].version) {
+        // the hierarchy changed, everything is recomputed once
+        buildTransformOrder();
+        for (int k = 0; k < transformOrderCount; ++k) {
+            updateWorldTransform(&compTransform[transformOrder[k]]);
+        }
+        transformDirtyCount = 0;
+        transformAllMoved = true;
+        return;
+    }
+
+    // dirty subtrees in order, a subtree inside one already updated is skipped
+    qsort(transformDirty, transformDirtyCount, sizeof(int), compareOrderIndex);
+    int updatedEnd = 0;
+    for (int i = 0; i < transformDirtyCount; ++i) {
+        int start = transformOrderIndex[transformDirty[i]];
+        if (start < updatedEnd) {
+            continue;
+        }
+        updatedEnd = start + transformSubtreeSize[transformDirty[i]];
+        for (int k = start; k < updatedEnd; ++k) {
+            updateWorldTransform(&compTransform[transformOrder[k]]);
+            transformMoved[transformMovedCount++] = transformOrder[k];
+        }
+    }
+    transformDirtyCount = 0;
+}
+
+int VisibilityInit(Visibility *vis, Arena *arena, float worldWidth, float worldHeight,
+                   float cellSize) {
+    int width = (int)ceilf(worldWidth / cellSize);
+    int height = (int)ceilf(worldHeight / cellSize);
+
+    memset(vis, 0, sizeof(*vis));
+    if (SpatialGridInit(&vis->grid, arena, width > 0 ? width : 1,
+                        height > 0 ? height : 1, cellSize, cellSize,
+                        MAX_ENTITIES) != 0) {
+        return 1;
+    }
+    vis->members = ArenaAlloc(arena, sizeof(int) * MAX_ENTITIES);
+    vis->memberIndex = ArenaAlloc(arena, sizeof(int) * MAX_ENTITIES);
+    vis->drawIndex = ArenaAlloc(arena, sizeof(int) * MAX_ENTITIES);
+    vis->added = ArenaAlloc(arena, sizeof(int) * MAX_ENTITIES);
+    vis->transformMember = ArenaAlloc(arena, sizeof(int) * MAX_TRANSFORM);
+    vis->items = ArenaAlloc(arena, sizeof(int) * MAX_ENTITIES);
+    vis->sortKeys = ArenaAlloc(arena, sizeof(uint64_t) * MAX_ENTITIES);
+    for (int i = 0; i < MAX_ENTITIES; ++i) {
+        vis->memberIndex[i] = NULL_ENTITY_COMP;
+    }
+    for (int i = 0; i < MAX_TRANSFORM; ++i) {
+        vis->transformMember[i] = NULL_ENTITY_COMP;
+    }
+    AListInit(&vis->visible, arena);
+
+    return 0;
+}
+
+void VisibilityAdd(Visibility *vis, int entityId) {
+    if (vis->memberIndex[entityId] != NULL_ENTITY_COMP) {
+        return;
+    }
+
+    vis->memberIndex[entityId] = vis->membersCount;
+    vis->members[vis->membersCount++] = entityId;
+    vis->drawIndex[entityId] = vis->nextDrawIndex++;
+    if (vis->addedCount < MAX_ENTITIES) {
+        vis->added[vis->addedCount++] = entityId;
+    } else {
+        // added and removed over and over, every member is rebounded instead
+        vis->synced = false;
+    }
+}
+
+void VisibilityRemove(Visibility *vis, int entityId) {
+    int index = vis->memberIndex[entityId];
+    if (index == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    int last = vis->members[--vis->membersCount];
+    vis->members[index] = last;
+    vis->memberIndex[last] = index;
+    vis->memberIndex[entityId] = NULL_ENTITY_COMP;
+    SpatialGridRemove(&vis->grid, entityId);
+}
+
+static bool spriteBounds(int entityId, Rectangle *bounds) {
+    int compTransId = entities[entityId].components[COMP_TRANSFORM];
+    int compSRId = entities[entityId].components[COMP_SPRITERENDER];
+    if (!entities[entityId].enabled || compTransId == NULL_ENTITY_COMP ||
+        compSRId == NULL_ENTITY_COMP) {
+        return false;
+    }
+
+    // same rectangle SystemRenderEntities draws
+    TransformComp *transfComp = &compTransform[compTransId];
+    Rectangle src = AssetsGetSpriteSource(compSpriteRender[compSRId].sprite);
+    *bounds = (Rectangle){transfComp->worldPosition.x, transfComp->worldPosition.y,
+                          src.width * transfComp->worldScale.x,
+                          src.height * transfComp->worldScale.y};
+
+    if (transfComp->worldRotation != 0.0f) {
+        // rotated around the top left corner, stays within the diagonal
+        float diagonal = sqrtf(bounds->width * bounds->width +
+                               bounds->height * bounds->height);
+        *bounds = (Rectangle){bounds->x - diagonal, bounds->y - diagonal,
+                              2 * diagonal, 2 * diagonal};
+    }
+    return true;
+}
+
+static void updateBounds(Visibility *vis, int entityId) {
+    Rectangle bounds;
+    if (!spriteBounds(entityId, &bounds)) {
+        SpatialGridRemove(&vis->grid, entityId);
+        return;
+    }
+
+    // boxes are only relinked when they move to another cell
+    vis->transformMember[entities[entityId].components[COMP_TRANSFORM]] = entityId;
+    SpatialGridUpdate(&vis->grid, entityId, bounds.x, bounds.y,
+                      bounds.x + bounds.width, bounds.y + bounds.height);
+}
+
+static int compareSortKey(const void *a, const void *b) {
+    uint64_t keyA = *(const uint64_t *)a, keyB = *(const uint64_t *)b;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+int SystemVisibilityUpdate(int cameraEntity, Visibility *vis) {
+    int cameraCompId = entities[cameraEntity].components[COMP_CAMERA];
+    if (cameraCompId == NULL_ENTITY_COMP) {
+        return 0;
+    }
+
+    // A rebuilt hierarchy moved every transform, and an update this missed
+    // moved unknown ones. Removed entities are dropped then, their transforms
+    // are gone
+    if (!vis->synced || transformAllMoved ||
+        transformUpdates - vis->transformUpdates > 1) {
+        for (int i = vis->membersCount - 1; i >= 0; --i) {
+            int entityId = vis->members[i];
+            if (!entities[entityId].enabled) {
+                VisibilityRemove(vis, entityId);
+            } else {
+                updateBounds(vis, entityId);
+            }
+        }
+    } else {
+        for (int i = 0; i < transformMovedCount; ++i) {
+            int entityId = vis->transformMember[transformMoved[i]];
+            if (entityId != NULL_ENTITY_COMP &&
+                vis->memberIndex[entityId] != NULL_ENTITY_COMP &&
+                entities[entityId].components[COMP_TRANSFORM] == transformMoved[i]) {
+                updateBounds(vis, entityId);
+            }
+        }
+        for (int i = 0; i < vis->addedCount; ++i) {
+            if (vis->memberIndex[vis->added[i]] != NULL_ENTITY_COMP) {
+                updateBounds(vis, vis->added[i]);
+            }
+        }
+        // animation changes the sprites of what was seen, and their size
+        for (size_t i = 0; i < AListSize(&vis->visible); ++i) {
+            int entityId = AListGet(&vis->visible, i);
+            if (vis->memberIndex[entityId] != NULL_ENTITY_COMP) {
+                updateBounds(vis, entityId);
+            }
+        }
+    }
+    vis->addedCount = 0;
+    vis->synced = true;
+    vis->transformUpdates = transformUpdates;
+
+    Camera2D camera = compCamera[cameraCompId].camera;
+    Vector2 topLeft = GetScreenToWorld2D(Vector2Zero(), camera);
+    Vector2 bottomRight = GetScreenToWorld2D(
+        (Vector2){(float)GetScreenWidth(), (float)GetScreenHeight()}, camera);
+    int count = SpatialGridQuery(&vis->grid, topLeft.x, topLeft.y, bottomRight.x,
+                                 bottomRight.y, vis->items, MAX_ENTITIES);
+
+    // the grid keeps no order, only what it found is sorted into draw order
+    for (int i = 0; i < count; ++i) {
+        int entityId = vis->items[i];
+        vis->sortKeys[i] =
+            (uint64_t)vis->drawIndex[entityId] << 32 | (uint32_t)entityId;
+    }
+    qsort(vis->sortKeys, count, sizeof(uint64_t), compareSortKey);
+    AListReset(&vis->visible);
+    for (int i = 0; i < count; ++i) {
+        AListAppend(&vis->visible, (int)(uint32_t)vis->sortKeys[i]);
+    }
+    vis->visibleCount = count;
+    vis->totalCount = vis->membersCount;
+
+    return vis->visibleCount;
+}
+
+void SystemRenderEntities(AList *renderEntities) {
+    for (size_t i = 0; i < AListSize(renderEntities); ++i) {
+        int entityId = AListGet(renderEntities, i);
+        int compTransId = entities[entityId].components[COMP_TRANSFORM];
+        int compSRId = entities[entityId].components[COMP_SPRITERENDER];
+        if (compTransId == NULL_ENTITY_COMP || compSRId == NULL_ENTITY_COMP) {
+            continue;
+        }
+
+        TransformComp *transfComp = &compTransform[compTransId];
+        SpriteRender *spriteRender = &compSpriteRender[compSRId];
+        Sprite sprite = AssetsGetSprite(spriteRender->sprite);
+        Rectangle dest = {transfComp->worldPosition.x, transfComp->worldPosition.y,
+                          sprite.width * transfComp->worldScale.x,
+                          sprite.height * transfComp->worldScale.y};
+        RenderDrawSprite(spriteRender->sprite, dest, transfComp->worldRotation,
+                         spriteRender->tint, spriteRender->flipX, spriteRender->flipY);
+    }
+}
+
+void SystemAnimationUpdate(AList *animEntities, float dt) {
+    for (size_t i = 0; i < AListSize(animEntities); ++i) {
+        int entityId = AListGet(animEntities, i);
+        int compSRId = entities[entityId].components[COMP_SPRITERENDER];
+        int compARId = entities[entityId].components[COMP_ANIMRENDER];
+        if (compARId == NULL_ENTITY_COMP || compSRId == NULL_ENTITY_COMP) {
+            continue;
+        }
+
+        SpriteRender *spriteRender = &compSpriteRender[compSRId];
+        AnimRender *animRender = &compAnimRender[compARId];
+
+        int frameCount = animRender->anim.frameCount;
+        float frameDur = animRender->anim.frameDuration;
+        int currentFrame = (int)(animRender->frameTime / frameDur) % frameCount;
+        animRender->frameTime += dt;
+        spriteRender->sprite = animRender->anim.frames[currentFrame];
+    }
+}
+
+int SystemProjectileTargets(AList *targetEntities, ProjectileTarget *targets,
+                            int maxTargets) {
+    int targetsCount = 0;
+    for (size_t i = 0; i < AListSize(targetEntities); ++i) {
+        if (targetsCount >= maxTargets) {
+            break;
+        }
+        int entityId = AListGet(targetEntities, i);
+        int compTransId = entities[entityId].components[COMP_TRANSFORM];
+        int compSRId = entities[entityId].components[COMP_SPRITERENDER];
+        if (compTransId == NULL_ENTITY_COMP || compSRId == NULL_ENTITY_COMP) {
+            continue;
+        }
+
+        // same rectangle SystemRenderEntities draws
+        TransformComp *transfComp = &compTransform[compTransId];
+        Rectangle src = AssetsGetSpriteSource(compSpriteRender[compSRId].sprite);
+        Vector2 position = transfComp->worldPosition;
+        Vector2 scale = transfComp->worldScale;
+        targets[targetsCount++] =
+            (ProjectileTarget){.entity = entityId,
+                               .minX = position.x,
+                               .minY = position.y,
+                               .maxX = position.x + src.width * scale.x,
+                               .maxY = position.y + src.height * scale.y};
+    }
+
+    return targetsCount;
+}
+
+void SystemProjectilesRender(const ProjectilePool *pool, float trailTime) {
+    if (pool->count == 0 || RenderIsRecording()) {
+        return;
+    }
+    RenderCountDraw(rlGetTextureIdDefault(), RENDER_STATE_LINES, 0);
+
+    // tracers from where each projectile was trailTime seconds ago
+    rlBegin(RL_LINES);
+    rlColor4ub(255, 240, 180, 255);
+    for (int i = 0; i < pool->count; ++i) {
+        rlVertex2f(pool->x[i] - pool->vx[i] * trailTime,
+                   pool->y[i] - pool->vy[i] * trailTime);
+        rlVertex2f(pool->x[i], pool->y[i]);
+    }
+    rlEnd();
+}
+
+static unsigned char fadeChannel(uint32_t from, uint32_t to, int channel, float t) {
+    float a = (float)((from >> (8 * channel)) & 0xFF);
+    float b = (float)((to >> (8 * channel)) & 0xFF);
+    return (unsigned char)(b + (a - b) * t);
+}
+
+void SystemParticlesRender(const ParticlePool *pool) {
+    if (pool->count == 0 || RenderIsRecording()) {
+        return;
+    }
+    RenderCountDraw(rlGetTextureIdDefault(), RENDER_STATE_QUADS, pool->count);
+
+    // every particle is an untextured quad in one batch
+    rlSetTexture(rlGetTextureIdDefault());
+    for (int i = 0; i < pool->count; ++i) {
+        if (i % PARTICLE_BATCH_QUADS == 0) {
+            if (i > 0) {
+                rlEnd();
+            }
+            rlCheckRenderBatchLimit(4 * PARTICLE_BATCH_QUADS);
+            rlBegin(RL_QUADS);
+        }
+
+        // colors are stored as RGBA bytes, alpha goes from 1 to 0 over the life
+        uint32_t start = pool->colorStart[i];
+        uint32_t end = pool->colorEnd[i];
+        float t = pool->alpha[i];
+        rlColor4ub(fadeChannel(start, end, 0, t), fadeChannel(start, end, 1, t),
+                   fadeChannel(start, end, 2, t), fadeChannel(start, end, 3, t));
+
+        float half = pool->size[i] * 0.5f;
+        float x = pool->x[i], y = pool->y[i];
+        rlVertex2f(x - half, y - half);
+        rlVertex2f(x - half, y + half);
+        rlVertex2f(x + half, y + half);
+        rlVertex2f(x + half, y - half);
+    }
+    if (pool->count > 0) {
+        rlEnd();
+    }
+    rlSetTexture(0);
+}
+
+static void drawStreamTiles(MapRender *mapRender, int layer) {
+    MapDirtyRect view = mapRender->streamView;
+    float tileWidth = mapRender->tileWidth * mapRender->scale.x;
+    float tileHeight = mapRender->tileHeight * mapRender->scale.y;
+
+    for (int y = view.y; y < view.y + view.height; ++y) {
+        for (int x = view.x; x < view.x + view.width; ++x) {
+            uint16_t tileId = MapStreamGetTile(mapRender->stream, layer, x, y);
+            if (tileId == MAP_TILE_EMPTY) {
+                // not loaded yet or nothing there
+                continue;
+            }
+
+            Tile tile = AssetsGetTile(tileId);
+            Rectangle dest = {x * tileWidth, y * tileHeight, tileWidth, tileHeight};
+            RenderDrawSprite(tile.sprite, dest, 0, WHITE, false, false);
+        }
+    }
+}
+
+void SystemMapStreamUpdate(int mapEntity, int cameraEntity) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    int cameraCompId = entities[cameraEntity].components[COMP_CAMERA];
+    if (mapRenderId == NULL_ENTITY_COMP || cameraCompId == NULL_ENTITY_COMP ||
+        compMapRender[mapRenderId].stream == NULL) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    Camera2D camera = compCamera[cameraCompId].camera;
+    float tileWidth = mapRender->tileWidth * mapRender->scale.x;
+    float tileHeight = mapRender->tileHeight * mapRender->scale.y;
+
+    // world rectangle seen by the camera, in tiles
+    Vector2 topLeft = GetScreenToWorld2D(Vector2Zero(), camera);
+    Vector2 bottomRight = GetScreenToWorld2D(
+        (Vector2){(float)GetScreenWidth(), (float)GetScreenHeight()}, camera);
+    int x0 = (int)floorf(topLeft.x / tileWidth);
+    int y0 = (int)floorf(topLeft.y / tileHeight);
+    int x1 = (int)ceilf(bottomRight.x / tileWidth);
+    int y1 = (int)ceilf(bottomRight.y / tileHeight);
+    mapRender->streamView = (MapDirtyRect){x0, y0, x1 - x0, y1 - y0};
+
+    // prefetch one chunk around the view so walking doesn't show holes
+    MapStreamRequest(mapRender->stream, x0 - MAP_CHUNK_SIZE, y0 - MAP_CHUNK_SIZE,
+                     x1 + MAP_CHUNK_SIZE, y1 + MAP_CHUNK_SIZE);
+}
+
+void SystemMapRenderLayer(int mapEntity, int layer) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    if (mapRender->stream != NULL) {
+        drawStreamTiles(mapRender, layer);
+        return;
+    }
+
+    Texture2D layerTex = mapRender->renderLayers[layer].texture;
+    if (layerTex.id == 0) {
+        // merged into the first layer
+        return;
+    }
+
+    // draw map
+    Rectangle src = {0, 0, layerTex.width, layerTex.height};
+    Rectangle dest = {0, 0, layerTex.width * mapRender->scale.x,
+                      layerTex.height * mapRender->scale.y};
+    RenderDraw(layerTex, src, dest, 0, WHITE, false, false);
+}
+
+void SystemMapLightUpdate(int mapEntity) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP || compMapRender[mapRenderId].lights == NULL) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    LightGrid *lights = mapRender->lights;
+    LightGridUpdate(lights);
+
+    if (mapRender->lightTexture.id == 0) {
+        Image image = {.data = lights->pixels,
+                       .width = lights->width,
+                       .height = lights->height,
+                       .mipmaps = 1,
+                       .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        mapRender->lightTexture = LoadTextureFromImage(image);
+        // tiles blend into each other instead of showing hard edges
+        SetTextureFilter(mapRender->lightTexture, TEXTURE_FILTER_BILINEAR);
+    } else if (lights->dirty) {
+        // one texel per tile, a full upload stays small even on big maps
+        UpdateTexture(mapRender->lightTexture, lights->pixels);
+    }
+    lights->dirty = false;
+}
+
+void SystemMapRenderLight(int mapEntity) {
+    int mapRenderId = entities[mapEntity].components[COMP_MAPRENDER];
+    if (mapRenderId == NULL_ENTITY_COMP ||
+        compMapRender[mapRenderId].lightTexture.id == 0) {
+        return;
+    }
+
+    MapRender *mapRender = &compMapRender[mapRenderId];
+    Texture2D lightTex = mapRender->lightTexture;
+    Rectangle src = {0, 0, lightTex.width, lightTex.height};
+    Rectangle dest = {0, 0, lightTex.width * mapRender->tileWidth * mapRender->scale.x,
+                      lightTex.height * mapRender->tileHeight * mapRender->scale.y};
+
+    if (RenderIsRecording()) {
+        return;
+    }
+    BeginBlendMode(BLEND_MULTIPLIED);
+    RenderCountDraw(lightTex.id, RENDER_STATE_MULTIPLIED, 1);
+    DrawTexturePro(lightTex, src, dest, Vector2Zero(), 0, WHITE);
+    EndBlendMode();
+}
+
+void SystemCameraUpdate(int cameraEntity) {
+    int cameraCompId = entities[cameraEntity].components[COMP_CAMERA];
+    if (cameraCompId == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    CameraComp *cameraComp = &compCamera[cameraCompId];
+    if (cameraComp->targetTransf != NULL) {
+        cameraComp->camera.target = cameraComp->targetTransf->worldPosition;
+    }
+
+    cameraComp->camera.offset = cameraComp->offset;
+}
+
+void SystemPlayerUpdate(int playerEntity, Vector2 input, float dt) {
+    int transformCompId = entities[playerEntity].components[COMP_TRANSFORM];
+    int spriteCompId = entities[playerEntity].components[COMP_SPRITERENDER];
+    int animCompId = entities[playerEntity].components[COMP_ANIMRENDER];
+    int playerCompId = entities[playerEntity].components[COMP_PLAYER];
+    if (transformCompId == NULL_ENTITY_COMP || spriteCompId == NULL_ENTITY_COMP ||
+        animCompId == NULL_ENTITY_COMP || playerCompId == NULL_ENTITY_COMP) {
+        return;
+    }
+
+    TransformComp *transfComp = &compTransform[transformCompId];
+    SpriteRender *spriteComp = &compSpriteRender[spriteCompId];
+    AnimRender *animComp = &compAnimRender[animCompId];
+    PlayerComp *playerComp = &compPlayer[playerCompId];
+
+    Vector2 vel = Vector2Scale(input, dt * playerComp->speed);
+    transfComp->position = Vector2Add(transfComp->position, vel);
+    if (!Vector2Equals(vel, Vector2Zero())) {
+        TransformMarkDirty(playerEntity);
+    }
+
+    if (Vector2Equals(vel, Vector2Zero())) {
+        animComp->anim = playerComp->idleAnim;
+    } else {
+        animComp->anim = playerComp->runAnim;
+    }
+
+    if (vel.x > 0) {
+        spriteComp->flipX = false;
     } else if (vel.x < 0) {
         spriteComp->flipX = true;
     }
 }
+
+void SystemReplicationCapture(NetSnapshot *snapshot, int maxEntities) {
+    int count = maxEntities < MAX_ENTITIES ? maxEntities : MAX_ENTITIES;
+    for (int entityId = 0; entityId < count; ++entityId) {
+        Entity *entity = &entities[entityId];
+        int compTransId = entity->components[COMP_TRANSFORM];
+        if (!entity->enabled || compTransId == NULL_ENTITY_COMP) {
+            continue;
+        }
+
+        TransformComp *transfComp = &compTransform[compTransId];
+        NetEntityState *state = &snapshot->entities[entityId];
+        state->x = NetQuantize(transfComp->position.x);
+        state->y = NetQuantize(transfComp->position.y);
+        state->rotation = NetQuantizeAngle(transfComp->rotation);
+        state->flags = NET_ENTITY_ACTIVE;
+
+        int compSRId = entity->components[COMP_SPRITERENDER];
+        if (compSRId != NULL_ENTITY_COMP) {
+            state->flags |= compSpriteRender[compSRId].flipX ? NET_ENTITY_FLIP_X : 0;
+            state->flags |= compSpriteRender[compSRId].flipY ? NET_ENTITY_FLIP_Y : 0;
+        }
+
+        int compARId = entity->components[COMP_ANIMRENDER];
+        AnimRender *animRender =
+            compARId != NULL_ENTITY_COMP ? &compAnimRender[compARId] : NULL;
+        if (animRender != NULL && animRender->anim.frameCount > 0) {
+            int frame = (int)(animRender->frameTime / animRender->anim.frameDuration);
+            state->animFrame = frame % animRender->anim.frameCount;
+        }
+    }
+}
+
+void SystemReplicationApply(const NetClient *client, float t) {
+    // entity ids match the server's, both sides load the same level
+    int count = client->maxEntities < MAX_ENTITIES ? client->maxEntities : MAX_ENTITIES;
+    for (int entityId = 0; entityId < count; ++entityId) {
+        Entity *entity = &entities[entityId];
+        int compTransId = entity->components[COMP_TRANSFORM];
+        NetEntityState state;
+        if (!entity->enabled || compTransId == NULL_ENTITY_COMP ||
+            !NetClientInterpolate(client, entityId, t, &state)) {
+            continue;
+        }
+
+        TransformComp *transfComp = &compTransform[compTransId];
+        transfComp->position.x = NetDequantize(state.x);
+        transfComp->position.y = NetDequantize(state.y);
+        transfComp->rotation = NetDequantizeAngle(state.rotation);
+        TransformMarkDirty(entityId);
+
+        int compSRId = entity->components[COMP_SPRITERENDER];
+        if (compSRId == NULL_ENTITY_COMP) {
+            continue;
+        }
+        SpriteRender *spriteRender = &compSpriteRender[compSRId];
+        spriteRender->flipX = state.flags & NET_ENTITY_FLIP_X;
+        spriteRender->flipY = state.flags & NET_ENTITY_FLIP_Y;
+
+        int compARId = entity->components[COMP_ANIMRENDER];
+        if (compARId != NULL_ENTITY_COMP) {
+            Animation *anim = &compAnimRender[compARId].anim;
+            if (state.animFrame < anim->frameCount) {
+                spriteRender->sprite = anim->frames[state.animFrame];
+            }
+        }
+    }
+}
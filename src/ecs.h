@@ -2,10 +2,24 @@
 #define ECS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "raylib.h"
 #include "assets.h"
+#include "lightgrid.h"
+#include "mapstream.h"
+#include "net.h"
+#include "particles.h"
+#include "projectiles.h"
+#include "render.h"
+#include "spatial.h"
 #include "utils.h"
 
+#define MAX_MAP_DIRTY_RECTS 32
+
+#define NULL_ENTITY_COMP -1
+#define MAX_COMP_TYPES   16
+
+// Built-in component types, game code registers more with ComponentRegister
 typedef enum {
     COMP_TRANSFORM = 0,
     COMP_SPRITERENDER,
@@ -16,23 +30,43 @@ typedef enum {
     COMP_COUNT
 } CompType;
 
+typedef enum {
+    CMD_ENTITY_CREATE = 0,
+    CMD_COMPONENT_ADD,
+    CMD_COMPONENT_REMOVE,
+    CMD_ENTITY_REMOVE,
+    CMD_COUNT
+} CommandType;
+
 typedef struct Entity {
     bool enabled;
-    int components[COMP_COUNT];
+    int components[MAX_COMP_TYPES];
 } Entity;
 
+// Sets the defaults of a zeroed component, 'enabled' is already set
+typedef void (*ComponentInitFn)(void *component);
+
 typedef struct TransformComp {
     bool enabled;
 
+    // relative to the parent transform, or to the world without one. Call
+    // TransformMarkDirty after changing them
     Vector2 position;
     Vector2 scale;
     float rotation;
+    int parent;
+    bool dirty;
+
+    // cached by SystemTransformUpdate, what rendering reads
+    Vector2 worldPosition;
+    Vector2 worldScale;
+    float worldRotation;
 } TransformComp;
 
 typedef struct SpriteRender {
     bool enabled;
 
-    Sprite sprite;
+    SpriteId sprite;
     Color tint;
     bool flipX, flipY;
 } SpriteRender;
@@ -44,6 +78,20 @@ typedef struct AnimRender {
     float frameTime;
 } AnimRender;
 
+typedef struct MapDirtyRect {
+    int x, y;
+    int width, height;
+} MapDirtyRect;
+
+// What baking saves every frame. Hidden tiles are under an opaque tile of a
+// higher layer and left out of the bake
+typedef struct MapBakeStats {
+    int layersDrawn;
+    int texturesDrawn;
+    int tilesCount;
+    int tilesHidden;
+} MapBakeStats;
+
 typedef struct MapRender {
     bool enabled;
 
@@ -53,6 +101,27 @@ typedef struct MapRender {
     int renderLayersCount;
     RenderTexture2D renderLayers[MAX_MAP_LAYERS];
     Vector2 scale;
+
+    // layers below this one are never drawn between entities, they are baked
+    // together into renderLayers[0]. The other layers get a texture each
+    int mergedLayers;
+    MapBakeStats bakeStats;
+
+    // baked layers are saved to and loaded from this directory when set,
+    // until the map's content hash changes
+    const char *cacheDir;
+
+    // large maps are streamed instead of baked, drawn around the camera
+    MapStream *stream;
+    MapDirtyRect streamView;
+
+    // tile regions (in tiles) changed since the last rebake
+    int dirtyCount[MAX_MAP_LAYERS];
+    MapDirtyRect dirtyRects[MAX_MAP_LAYERS][MAX_MAP_DIRTY_RECTS];
+
+    // optional light map, one texel per tile multiplied over the layers
+    LightGrid *lights;
+    Texture2D lightTexture;
 } MapRender;
 
 typedef struct CameraComp {
@@ -71,25 +140,135 @@ typedef struct PlayerComp {
     Animation runAnim;
 } PlayerComp;
 
+typedef struct Command {
+    CommandType type;
+    CompType compType;
+    int entityId;
+    int dataOffset;
+} Command;
+
+// Structural changes recorded while systems iterate and applied later, at
+// a sync point. Each thread records into its own buffer. Playback creates
+// entities first, then plays component commands by type and entity, each
+// entity's in recorded order, and entity removes last.
+typedef struct CommandBuffer {
+    Command *commands;
+    int commandsCount, commandsCapacity;
+    unsigned char *data;
+    size_t dataSize, dataCapacity;
+    int *createdIds;
+    int createdCount;
+} CommandBuffer;
+
+// Render entities seen by the camera, rebuilt every tick after
+// SystemCameraUpdate and consumed by rendering and animation. Only entities
+// added, moved or last seen are rebounded, the camera's cells are queried
+typedef struct Visibility {
+    SpatialGrid grid;
+    // the render list, drawn in the order entities were added
+    int *members;
+    int *memberIndex;
+    int *drawIndex;
+    int membersCount, nextDrawIndex;
+    // added since the last update
+    int *added;
+    int addedCount;
+    // the member each transform was last seen on
+    int *transformMember;
+    uint32_t transformUpdates;
+    bool synced;
+    int *items;
+    uint64_t *sortKeys;
+    AList visible;
+    int visibleCount, totalCount;
+} Visibility;
+
+// Everything the entity and component functions work on. Each thread has its
+// own current world, so the next level can be built while this one runs
+typedef struct EcsWorld EcsWorld;
+
+EcsWorld *EcsWorldCreate(void);
+// only on the main thread, the world's render targets are unloaded with it
+void EcsWorldDestroy(EcsWorld *world);
+EcsWorld *EcsWorldGet(void);
+// makes world current on the calling thread, NULL leaves it without one
+void EcsWorldUse(EcsWorld *world);
+
+// create, use and destroy the current world
 int EntityCompInit(void);
 void EntityCompReset(void);
 void EntityCompDestroy(void);
 
 int EntityCreate(void);
+int EntityCreateBatch(int count);
 void EntityRemove(int entityId);
 
+// Component structs must start with their 'enabled' flag. Returns the new
+// type, valid in the current world
+CompType ComponentRegister(size_t size, size_t align, int capacity,
+                           ComponentInitFn initFn);
+
 void *ComponentCreate(int entityId, CompType type);
+void *ComponentCreateBatch(int firstEntity, int count, CompType type,
+                           const void *init);
+void *ComponentGet(int entityId, CompType type);
 void ComponentRemove(int entityId, CompType type);
 
+void CommandBufferInit(CommandBuffer *cmds, Arena *arena, int maxCommands,
+                       size_t maxDataBytes);
+void CommandBufferReset(CommandBuffer *cmds);
+int CmdEntityCreate(CommandBuffer *cmds);
+void CmdEntityRemove(CommandBuffer *cmds, int entityId);
+void CmdComponentAdd(CommandBuffer *cmds, int entityId, CompType type,
+                     const void *init);
+void CmdComponentRemove(CommandBuffer *cmds, int entityId, CompType type);
+void CommandBufferPlayback(CommandBuffer **buffers, int buffersCount);
+
+void TransformSetParent(int entityId, int parentEntity);
+void TransformMarkDirty(int entityId);
+
+int WorldSnapshotWrite(const char *filepath, const char *baseFilepath);
+int WorldSnapshotRead(const char *filepath, const char *baseFilepath);
+
+// Hash of the simulated state, equal for equal inputs
+uint64_t WorldStateHash(void);
+
+int VisibilityInit(Visibility *vis, Arena *arena, float worldWidth, float worldHeight,
+                   float cellSize);
+// adds an entity to the render list, drawn over the ones added before
+void VisibilityAdd(Visibility *vis, int entityId);
+void VisibilityRemove(Visibility *vis, int entityId);
+int SystemVisibilityUpdate(int cameraEntity, Visibility *vis);
+
+void SystemTransformUpdate(void);
+
 void SystemRenderEntities(AList *renderEntities);
 
 void SystemAnimationUpdate(AList *animEntities, float dt);
 
+void SystemParticlesRender(const ParticlePool *pool);
+
+int SystemProjectileTargets(AList *targetEntities, ProjectileTarget *targets,
+                            int maxTargets);
+void SystemProjectilesRender(const ProjectilePool *pool, float trailTime);
+
+void MapSetTile(int mapEntity, int layer, int x, int y, int tileId);
+int MapCollisionInit(int mapEntity, CollisionGrid *grid, Arena *arena);
+
 void SystemMapInit(int mapEntity);
+void SystemMapRebake(int mapEntity);
+void SystemMapStreamUpdate(int mapEntity, int cameraEntity);
 void SystemMapRenderLayer(int mapEntity, int layer);
+void SystemMapLightUpdate(int mapEntity);
+void SystemMapRenderLight(int mapEntity);
 
 void SystemCameraUpdate(int cameraEntity);
 
 void SystemPlayerUpdate(int playerEntity, Vector2 input, float dt);
 
+// Server side fills a snapshot, clients write the interpolated state back,
+// t blends from the previous (0) to the latest (1) received snapshot
+void SystemReplicationCapture(NetSnapshot *snapshot, int maxEntities);
+void SystemReplicationApply(const NetClient *client, float t);
+
 #endif // !ECS_H
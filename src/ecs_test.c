@@ -0,0 +1,736 @@
+// mkstemp and the fixture directory
+#define _POSIX_C_SOURCE 200809L
+// the game's modules without a window, draws are recorded
+#define RENDER_NO_RAYLIB
+
+#include "minunit.h"
+#include "headless.h"
+#include "assets.c"
+#include "collision.c"
+#include "ecs.c"
+#include "ecs.h"
+#include "lightgrid.c"
+#include "mapstream.c"
+#include "net.c"
+#include "parser.c"
+#include "particles.c"
+#include "projectiles.c"
+#include "render.c"
+#include "spatial.c"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testCommandOrder(void);
+static char *testCommandCreated(void);
+static char *testRenderSystems(void);
+static char *testMapBake(void);
+static char *testTransformOrder(void);
+static char *testTransformDirty(void);
+static char *testTransformRemovedParent(void);
+static char *testVisibility(void);
+static char *testSnapshotMap(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+// enabled slots of a component pool
+static int poolUsed(CompType type) {
+    int used = 0;
+    for (int compId = 0; compId < compPools[type].capacity; ++compId) {
+        used += *(bool *)compSlot(type, compId);
+    }
+    return used;
+}
+
+// A 64x16 spritesheet and a 4x3 map over it. Layer 1 is small keys with a
+// crate at 1,1, layer 2 crates at 0,0 and 1,0, so five tiles below are hidden
+static int writeTestAssets(void) {
+    static const char sprites[] = "hero 0 0 16 16\n"
+                                  "floor 16 0 16 16\n"
+                                  "crate 32 0 16 16\n"
+                                  "key 48 0 8 8\n";
+    static const char map[] = "3 3 4 3\n"
+                              "floor\ncrate\nkey\n"
+                              "0 0 0 0\n0 0 0 0\n0 0 0 0\n\n"
+                              "2 2 2 2\n2 1 2 2\n2 2 2 2\n\n"
+                              "1 1 2 2\n2 2 2 2\n2 2 2 2\n";
+
+    return FixtureDirCreate("ecs_test") != 0 || WriteFakePng("test.png", 64, 16) != 0 ||
+           WriteFile("test.sprite", sprites, strlen(sprites)) != 0 ||
+           WriteFile("test.map", map, strlen(map)) != 0;
+}
+
+static int loadTestAssets(void) {
+    if (AssetsInit() != 0) {
+        return 1;
+    }
+    AssetAdd(ASSET_LOADER_SPRITESHEET, "test");
+    AssetAdd(ASSET_LOADER_MAP, "test");
+    return AssetLoadSync();
+}
+
+// draws recorded into target
+static int countDraws(const RenderRecorder *recorder, unsigned int target) {
+    int draws = 0;
+    for (int i = 0; i < recorder->count; ++i) {
+        draws += recorder->cmds[i].target == target;
+    }
+    return draws;
+}
+
+// components of registered types, logging the order they're created in
+typedef struct LoggedComp {
+    bool enabled;
+} LoggedComp;
+
+static int initLog[8];
+static int initLogCount;
+
+static void initFirstLogged(void *component) {
+    (void)component;
+    initLog[initLogCount++] = 1;
+}
+
+static void initSecondLogged(void *component) {
+    (void)component;
+    initLog[initLogCount++] = 2;
+}
+
+static char *testCommandOrder(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    CommandBuffer cmds;
+    CommandBuffer *buffers[] = {&cmds};
+
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CommandBufferInit(&cmds, &arena, 16, Kilobyte(1));
+
+    int entity = EntityCreate();
+    TransformComp *transf = ComponentCreate(entity, COMP_TRANSFORM);
+    transf->position = (Vector2){1.0f, 2.0f};
+
+    // removed, then added back with a new value
+    TransformComp init = {
+        .position = {5.0f, 6.0f}, .scale = {1.0f, 1.0f}, .parent = NULL_ENTITY_COMP};
+    CmdComponentRemove(&cmds, entity, COMP_TRANSFORM);
+    CmdComponentAdd(&cmds, entity, COMP_TRANSFORM, &init);
+    CommandBufferPlayback(buffers, 1);
+
+    transf = ComponentGet(entity, COMP_TRANSFORM);
+    MU_ASSERT(transf != NULL, "Expected the component added back");
+    MU_ASSERT_FMT(transf->position.x == 5.0f && transf->position.y == 6.0f,
+                  "Expected the added value, but got %f, %f", transf->position.x,
+                  transf->position.y);
+    MU_ASSERT_FMT(poolUsed(COMP_TRANSFORM) == 1, "Expected 1 transform, but got %d",
+                  poolUsed(COMP_TRANSFORM));
+
+    // added, then removed, in another recording
+    CmdComponentAdd(&cmds, entity, COMP_SPRITERENDER, NULL);
+    CmdComponentRemove(&cmds, entity, COMP_SPRITERENDER);
+    CommandBufferPlayback(buffers, 1);
+    MU_ASSERT(ComponentGet(entity, COMP_SPRITERENDER) == NULL,
+              "Expected the component removed");
+    MU_ASSERT_FMT(poolUsed(COMP_SPRITERENDER) == 0, "Expected no sprites, but got %d",
+                  poolUsed(COMP_SPRITERENDER));
+
+    // added twice, the second value lands in the same slot
+    TransformComp other = init;
+    other.position = (Vector2){7.0f, 8.0f};
+    CmdComponentAdd(&cmds, entity, COMP_TRANSFORM, &init);
+    CmdComponentAdd(&cmds, entity, COMP_TRANSFORM, &other);
+    CommandBufferPlayback(buffers, 1);
+    MU_ASSERT(ComponentGet(entity, COMP_TRANSFORM) == transf,
+              "Expected the transform's slot reused");
+    MU_ASSERT_FMT(transf->position.x == 7.0f && transf->position.y == 8.0f,
+                  "Expected the second value, but got %f, %f", transf->position.x,
+                  transf->position.y);
+    MU_ASSERT_FMT(poolUsed(COMP_TRANSFORM) == 1, "Expected 1 transform, but got %d",
+                  poolUsed(COMP_TRANSFORM));
+
+    // adds are played type by type, whatever the recorded order
+    CompType first = ComponentRegister(sizeof(LoggedComp), _Alignof(LoggedComp), 4,
+                                       initFirstLogged);
+    CompType second = ComponentRegister(sizeof(LoggedComp), _Alignof(LoggedComp), 4,
+                                        initSecondLogged);
+    int others[3];
+    for (int i = 0; i < 3; ++i) {
+        others[i] = EntityCreate();
+    }
+    initLogCount = 0;
+    CmdComponentAdd(&cmds, others[0], second, NULL);
+    CmdComponentAdd(&cmds, others[1], first, NULL);
+    CmdComponentAdd(&cmds, others[2], second, NULL);
+    CommandBufferPlayback(buffers, 1);
+    MU_ASSERT_FMT(initLogCount == 3 && initLog[0] == 1 && initLog[1] == 2 &&
+                      initLog[2] == 2,
+                  "Expected the first type's add first, but got %d, %d, %d of %d",
+                  initLog[0], initLog[1], initLog[2], initLogCount);
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+static char *testCommandCreated(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    CommandBuffer first, second;
+    CommandBuffer *buffers[] = {&first, &second};
+
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CommandBufferInit(&first, &arena, 16, Kilobyte(1));
+    CommandBufferInit(&second, &arena, 16, Kilobyte(1));
+
+    int entity = EntityCreate();
+    ComponentCreate(entity, COMP_TRANSFORM);
+
+    // created entities resolve in their own buffer, later buffers come later
+    int created = CmdEntityCreate(&first);
+    CmdComponentAdd(&first, created, COMP_TRANSFORM, NULL);
+    CmdComponentAdd(&first, entity, COMP_SPRITERENDER, NULL);
+    CmdEntityRemove(&second, entity);
+    CommandBufferPlayback(buffers, 2);
+
+    MU_ASSERT(!entities[entity].enabled, "Expected the entity removed");
+    MU_ASSERT_FMT(poolUsed(COMP_SPRITERENDER) == 0 && poolUsed(COMP_TRANSFORM) == 1,
+                  "Expected only the created transform, but got %d sprites and %d "
+                  "transforms",
+                  poolUsed(COMP_SPRITERENDER), poolUsed(COMP_TRANSFORM));
+    MU_ASSERT(first.commandsCount == 0 && second.commandsCount == 0,
+              "Expected the buffers reset");
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+static char *testRenderSystems(void) {
+    unsigned char buffer[Kilobyte(8)];
+    Arena arena;
+    RenderRecorder recorder;
+    AList renderEntities;
+
+    MU_ASSERT(loadTestAssets() == 0, "Expected the test assets loaded");
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    RenderRecorderInit(&recorder, &arena, 64);
+    AListInit(&renderEntities, &arena);
+    RenderSetRecorder(&recorder);
+
+    SpriteId hero = AssetsGetSpriteId("hero");
+    SpriteUV uv = AssetsGetSpriteUV(AssetsGetSpriteId("crate"));
+    MU_ASSERT_FMT(uv.u0 == 0.5f && uv.v0 == 0.0f && uv.u1 == 0.75f && uv.v1 == 1.0f,
+                  "Wrong crate UVs %f, %f, %f, %f", uv.u0, uv.v0, uv.u1, uv.v1);
+
+    // a flipped sprite on a scaled parent, and one with no sprite
+    int parent = EntityCreate();
+    TransformComp *parentTransf = ComponentCreate(parent, COMP_TRANSFORM);
+    parentTransf->position = (Vector2){100.0f, 50.0f};
+    parentTransf->scale = (Vector2){2.0f, 2.0f};
+    int child = EntityCreate();
+    TransformComp *childTransf = ComponentCreate(child, COMP_TRANSFORM);
+    childTransf->position = (Vector2){10.0f, 0.0f};
+    TransformSetParent(child, parent);
+    SpriteRender *childSprite = ComponentCreate(child, COMP_SPRITERENDER);
+    *childSprite = (SpriteRender){
+        .enabled = true, .sprite = hero, .tint = {255, 0, 0, 128}, .flipX = true};
+    int blank = EntityCreate();
+    ComponentCreate(blank, COMP_TRANSFORM);
+    ComponentCreate(blank, COMP_SPRITERENDER);
+    AListAppend(&renderEntities, child);
+    AListAppend(&renderEntities, blank);
+
+    int mapEntity = EntityCreate();
+    MapRender *mapRender = ComponentCreate(mapEntity, COMP_MAPRENDER);
+    mapRender->map = AssetGetMap("test");
+    mapRender->tileWidth = 16;
+    mapRender->tileHeight = 16;
+    mapRender->scale = (Vector2){1.0f, 1.0f};
+    mapRender->renderLayersCount = 1;
+    SystemMapInit(mapEntity);
+    unsigned int layerTarget = mapRender->renderLayers[0].id;
+    MU_ASSERT_FMT(countDraws(&recorder, layerTarget) == 12,
+                  "Expected 12 tiles baked, but got %d",
+                  countDraws(&recorder, layerTarget));
+
+    // a frame: the map layer, then the entities over it
+    RenderRecorderReset(&recorder);
+    SystemTransformUpdate();
+    SystemMapRenderLayer(mapEntity, 0);
+    SystemRenderEntities(&renderEntities);
+
+    MU_ASSERT_FMT(recorder.count == 2, "Expected 2 draws, but got %d", recorder.count);
+    RenderCmd layer = recorder.cmds[0];
+    MU_ASSERT(layer.target == 0 && layer.texture == layerTarget,
+              "Expected the baked layer drawn to the screen");
+    MU_ASSERT(layer.dest.width == 64 && layer.dest.height == 48, "Wrong layer size");
+    RenderCmd sprite = recorder.cmds[1];
+    MU_ASSERT(sprite.texture == AssetsGetSpriteTexture(hero).id, "Wrong texture");
+    MU_ASSERT(sprite.src.x == 0 && sprite.src.width == 16, "Wrong source");
+    MU_ASSERT_FMT(sprite.dest.x == 120.0f && sprite.dest.y == 50.0f &&
+                      sprite.dest.width == 32.0f && sprite.dest.height == 32.0f,
+                  "Expected the child at 120, 50 scaled to 32, but got %f, %f, %f",
+                  sprite.dest.x, sprite.dest.y, sprite.dest.width);
+    MU_ASSERT(sprite.flipX && !sprite.flipY && sprite.tint.a == 128,
+              "Wrong flips or tint");
+
+    RenderSetRecorder(NULL);
+    EntityCompDestroy();
+    AssetSetDestroy(AssetSetGet());
+    MU_ASSERT_FMT(headlessTexturesLoaded == 0, "Expected no textures, but got %d",
+                  headlessTexturesLoaded);
+
+    MU_PASS;
+}
+
+// the test map drawn with its layers merged from the bottom
+static MapRender *createTestMap(int mapEntity, int mergedLayers) {
+    MapRender *mapRender = ComponentCreate(mapEntity, COMP_MAPRENDER);
+    mapRender->map = AssetGetMap("test");
+    mapRender->tileWidth = 16;
+    mapRender->tileHeight = 16;
+    mapRender->scale = (Vector2){1.0f, 1.0f};
+    mapRender->renderLayersCount = MAX_MAP_LAYERS;
+    mapRender->mergedLayers = mergedLayers;
+    return mapRender;
+}
+
+// draws into target at tile x, y of the test map, stored upside down
+static int countTileDraws(const RenderRecorder *recorder, unsigned int target, int x,
+                          int y) {
+    int draws = 0;
+    for (int i = 0; i < recorder->count; ++i) {
+        RenderCmd cmd = recorder->cmds[i];
+        draws += cmd.target == target && cmd.dest.x == x * 16 &&
+                 cmd.dest.y == (2 - y) * 16;
+    }
+    return draws;
+}
+
+static char *testMapBake(void) {
+    unsigned char buffer[Kilobyte(8)];
+    Arena arena;
+    RenderRecorder recorder;
+
+    MU_ASSERT(loadTestAssets() == 0, "Expected the test assets loaded");
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    RenderRecorderInit(&recorder, &arena, 128);
+    RenderSetRecorder(&recorder);
+
+    // every layer in one texture, without the tiles under crates
+    int merged = EntityCreate();
+    MapRender *mapRender = createTestMap(merged, MAX_MAP_LAYERS);
+    SystemMapInit(merged);
+    MapBakeStats stats = mapRender->bakeStats;
+    MU_ASSERT_FMT(stats.layersDrawn == 3 && stats.texturesDrawn == 1,
+                  "Expected 3 layers in 1 texture, but got %d in %d",
+                  stats.layersDrawn, stats.texturesDrawn);
+    MU_ASSERT_FMT(stats.tilesCount == 36 && stats.tilesHidden == 5,
+                  "Expected 5 of 36 tiles hidden, but got %d of %d", stats.tilesHidden,
+                  stats.tilesCount);
+
+    unsigned int target = mapRender->renderLayers[0].id;
+    MU_ASSERT(mapRender->renderLayers[1].id == 0 && mapRender->renderLayers[2].id == 0,
+              "Expected the upper layers merged into the first");
+    MU_ASSERT_FMT(countDraws(&recorder, target) == 31,
+                  "Expected 31 tiles baked, but got %d", countDraws(&recorder, target));
+    MU_ASSERT_FMT(countTileDraws(&recorder, target, 1, 1) == 2,
+                  "Expected the floor under the crate dropped, but got %d draws",
+                  countTileDraws(&recorder, target, 1, 1));
+    MU_ASSERT_FMT(countTileDraws(&recorder, target, 0, 0) == 1,
+                  "Expected only the top crate, but got %d draws",
+                  countTileDraws(&recorder, target, 0, 0));
+    MU_ASSERT_FMT(countTileDraws(&recorder, target, 3, 2) == 3,
+                  "Expected every layer under keys, but got %d draws",
+                  countTileDraws(&recorder, target, 3, 2));
+
+    // a frame draws the merged layers as one quad
+    RenderRecorderReset(&recorder);
+    for (int layer = 0; layer < MAX_MAP_LAYERS; ++layer) {
+        SystemMapRenderLayer(merged, layer);
+    }
+    MU_ASSERT_FMT(recorder.count == 1 && recorder.cmds[0].texture == target,
+                  "Expected one draw of the merged layers, but got %d",
+                  recorder.count);
+
+    // layers apart still leave hidden tiles out, but take a draw each
+    RenderRecorderReset(&recorder);
+    int apart = EntityCreate();
+    mapRender = createTestMap(apart, 0);
+    SystemMapInit(apart);
+    stats = mapRender->bakeStats;
+    MU_ASSERT_FMT(stats.texturesDrawn == 3 && stats.tilesHidden == 5,
+                  "Expected 3 textures and 5 hidden tiles, but got %d and %d",
+                  stats.texturesDrawn, stats.tilesHidden);
+    MU_ASSERT_FMT(recorder.count == 31, "Expected 31 tiles baked, but got %d",
+                  recorder.count);
+    MU_ASSERT_FMT(countDraws(&recorder, mapRender->renderLayers[0].id) == 9,
+                  "Expected 9 floor tiles baked, but got %d",
+                  countDraws(&recorder, mapRender->renderLayers[0].id));
+    RenderRecorderReset(&recorder);
+    for (int layer = 0; layer < MAX_MAP_LAYERS; ++layer) {
+        SystemMapRenderLayer(apart, layer);
+    }
+    MU_ASSERT_FMT(recorder.count == 3, "Expected a draw per layer, but got %d",
+                  recorder.count);
+
+    RenderSetRecorder(NULL);
+    EntityCompDestroy();
+    AssetSetDestroy(AssetSetGet());
+
+    MU_PASS;
+}
+
+// an entity with a transform at x, y
+static int createTransform(float x, float y) {
+    int entity = EntityCreate();
+    TransformComp *transf = ComponentCreate(entity, COMP_TRANSFORM);
+    transf->position = (Vector2){x, y};
+    return entity;
+}
+
+static TransformComp *getTransform(int entity) {
+    return ComponentGet(entity, COMP_TRANSFORM);
+}
+
+static int orderIndex(int entity) {
+    return transformOrderIndex[entities[entity].components[COMP_TRANSFORM]];
+}
+
+static int subtreeSize(int entity) {
+    return transformSubtreeSize[entities[entity].components[COMP_TRANSFORM]];
+}
+
+// whether entity is in the order range of root's subtree
+static bool inSubtree(int root, int entity) {
+    return orderIndex(root) <= orderIndex(entity) &&
+           orderIndex(entity) < orderIndex(root) + subtreeSize(root);
+}
+
+static char *testTransformOrder(void) {
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+
+    // children made before their parents, so their slots come first
+    int grandchild = createTransform(1.0f, 0.0f);
+    int child = createTransform(10.0f, 0.0f);
+    int other = createTransform(0.0f, 5.0f);
+    int root = createTransform(100.0f, 0.0f);
+    int otherRoot = createTransform(0.0f, 50.0f);
+    TransformSetParent(grandchild, child);
+    TransformSetParent(child, root);
+    TransformSetParent(other, otherRoot);
+    SystemTransformUpdate();
+
+    MU_ASSERT_FMT(transformOrderCount == 5, "Expected 5 transforms ordered, but got %d",
+                  transformOrderCount);
+    MU_ASSERT(orderIndex(root) < orderIndex(child) &&
+                  orderIndex(child) < orderIndex(grandchild) &&
+                  orderIndex(otherRoot) < orderIndex(other),
+              "Expected parents ordered before their children");
+    MU_ASSERT_FMT(subtreeSize(root) == 3 && subtreeSize(child) == 2 &&
+                      subtreeSize(grandchild) == 1 && subtreeSize(otherRoot) == 2,
+                  "Wrong subtree sizes %d, %d, %d, %d", subtreeSize(root),
+                  subtreeSize(child), subtreeSize(grandchild), subtreeSize(otherRoot));
+    MU_ASSERT(inSubtree(root, grandchild) && !inSubtree(root, other) &&
+                  !inSubtree(otherRoot, child),
+              "Expected subtrees to be contiguous ranges");
+    Vector2 world = getTransform(grandchild)->worldPosition;
+    MU_ASSERT_FMT(world.x == 111.0f && world.y == 0.0f,
+                  "Expected the grandchild at 111, 0, but got %f, %f", world.x,
+                  world.y);
+
+    // moving the child takes its subtree along
+    TransformSetParent(child, otherRoot);
+    SystemTransformUpdate();
+    MU_ASSERT_FMT(subtreeSize(root) == 1 && subtreeSize(otherRoot) == 4,
+                  "Expected subtrees of 1 and 4, but got %d and %d", subtreeSize(root),
+                  subtreeSize(otherRoot));
+    MU_ASSERT(inSubtree(otherRoot, child) && inSubtree(otherRoot, grandchild) &&
+                  inSubtree(otherRoot, other) && inSubtree(child, grandchild) &&
+                  !inSubtree(child, other),
+              "Expected the child's subtree inside the other root's");
+    world = getTransform(grandchild)->worldPosition;
+    MU_ASSERT_FMT(world.x == 11.0f && world.y == 50.0f,
+                  "Expected the grandchild at 11, 50, but got %f, %f", world.x,
+                  world.y);
+
+    // children of a removed parent become roots where they are
+    EntityRemove(child);
+    SystemTransformUpdate();
+    MU_ASSERT(getTransform(grandchild)->parent == NULL_ENTITY_COMP &&
+                  subtreeSize(otherRoot) == 2,
+              "Expected the grandchild a root");
+    world = getTransform(grandchild)->worldPosition;
+    MU_ASSERT_FMT(world.x == 11.0f && world.y == 50.0f,
+                  "Expected the grandchild to stay at 11, 50, but got %f, %f", world.x,
+                  world.y);
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+static char *testTransformDirty(void) {
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+
+    int root = createTransform(100.0f, 0.0f);
+    int child = createTransform(10.0f, 0.0f);
+    int grandchild = createTransform(1.0f, 0.0f);
+    int other = createTransform(0.0f, 50.0f);
+    TransformSetParent(child, root);
+    TransformSetParent(grandchild, child);
+    SystemTransformUpdate();
+
+    // a dirty parent updates every descendant, scaled and rotated
+    TransformComp *rootTransf = getTransform(root);
+    rootTransf->position = (Vector2){0.0f, 0.0f};
+    rootTransf->scale = (Vector2){2.0f, 2.0f};
+    rootTransf->rotation = 90.0f;
+    TransformMarkDirty(root);
+    // changed but not marked, left alone
+    getTransform(other)->position = (Vector2){0.0f, 60.0f};
+    SystemTransformUpdate();
+
+    Vector2 world = getTransform(grandchild)->worldPosition;
+    MU_ASSERT_FMT(fabsf(world.x) < 1e-4f && fabsf(world.y - 22.0f) < 1e-4f,
+                  "Expected the grandchild at 0, 22, but got %f, %f", world.x,
+                  world.y);
+    MU_ASSERT_FMT(getTransform(grandchild)->worldScale.x == 2.0f &&
+                      getTransform(grandchild)->worldRotation == 90.0f,
+                  "Expected the grandchild scaled and rotated, but got %f and %f",
+                  getTransform(grandchild)->worldScale.x,
+                  getTransform(grandchild)->worldRotation);
+    MU_ASSERT(!getTransform(child)->dirty && !getTransform(grandchild)->dirty,
+              "Expected the descendants clean");
+    MU_ASSERT(getTransform(other)->worldPosition.y == 50.0f,
+              "Expected the unmarked transform untouched");
+
+    // a dirty child inside a dirty subtree is updated once, after its parent
+    getTransform(child)->position = (Vector2){5.0f, 0.0f};
+    TransformMarkDirty(grandchild);
+    TransformMarkDirty(child);
+    TransformMarkDirty(root);
+    MU_ASSERT_FMT(transformDirtyCount == 3, "Expected 3 dirty, but got %d",
+                  transformDirtyCount);
+    SystemTransformUpdate();
+    world = getTransform(grandchild)->worldPosition;
+    MU_ASSERT_FMT(fabsf(world.x) < 1e-4f && fabsf(world.y - 12.0f) < 1e-4f,
+                  "Expected the grandchild at 0, 12, but got %f, %f", world.x,
+                  world.y);
+    MU_ASSERT(transformDirtyCount == 0, "Expected the dirty list emptied");
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+static char *testTransformRemovedParent(void) {
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+
+    int parent = createTransform(100.0f, 0.0f);
+    int child = createTransform(10.0f, 0.0f);
+    TransformSetParent(child, parent);
+    SystemTransformUpdate();
+
+    // the parent's slot goes to another entity within the same tick, the
+    // child stays where it was instead of following it
+    int parentSlot = entities[parent].components[COMP_TRANSFORM];
+    EntityRemove(parent);
+    int other = createTransform(500.0f, 500.0f);
+    MU_ASSERT(entities[other].components[COMP_TRANSFORM] == parentSlot,
+              "Expected the parent's slot reused");
+    MU_ASSERT(getTransform(child)->parent == NULL_ENTITY_COMP,
+              "Expected the child a root");
+    SystemTransformUpdate();
+    Vector2 world = getTransform(child)->worldPosition;
+    MU_ASSERT_FMT(world.x == 110.0f && world.y == 0.0f,
+                  "Expected the child to stay at 110, 0, but got %f, %f", world.x,
+                  world.y);
+
+    // parented since the last update, the same without a current order
+    int late = createTransform(1.0f, 1.0f);
+    TransformSetParent(late, other);
+    EntityRemove(other);
+    createTransform(0.0f, 0.0f);
+    MU_ASSERT(getTransform(late)->parent == NULL_ENTITY_COMP,
+              "Expected the late child a root");
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+// a hero sprite at x, y
+static int createSprite(float x, float y) {
+    int entity = createTransform(x, y);
+    SpriteRender *sprite = ComponentCreate(entity, COMP_SPRITERENDER);
+    *sprite = (SpriteRender){
+        .enabled = true, .sprite = AssetsGetSpriteId("hero"), .tint = WHITE};
+    return entity;
+}
+
+static char *testVisibility(void) {
+    static unsigned char buffer[Kilobyte(256)];
+    Arena arena;
+    Visibility vis;
+
+    MU_ASSERT(loadTestAssets() == 0, "Expected the test assets loaded");
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    MU_ASSERT(VisibilityInit(&vis, &arena, 2000.0f, 2000.0f, 64.0f) == 0,
+              "Expected the visibility grid");
+
+    // the camera sees 0, 0 to the 800x600 screen's size
+    int camera = EntityCreate();
+    ComponentCreate(camera, COMP_CAMERA);
+    int removed = createSprite(200.0f, 200.0f);
+    int kept = createSprite(10.0f, 10.0f);
+    int unlisted = createSprite(100.0f, 100.0f);
+    int both = createSprite(300.0f, 300.0f);
+    int offscreen = createSprite(1500.0f, 1500.0f);
+    int still = createSprite(1800.0f, 1800.0f);
+    int added[] = {kept, unlisted, removed, both, offscreen, still};
+    for (int i = 0; i < 6; ++i) {
+        VisibilityAdd(&vis, added[i]);
+    }
+    SystemTransformUpdate();
+    SystemVisibilityUpdate(camera, &vis);
+    MU_ASSERT_FMT(vis.visibleCount == 4 && vis.totalCount == 6,
+                  "Expected 4 of 6 visible, but got %d of %d", vis.visibleCount,
+                  vis.totalCount);
+    // in the order they were added, not by id
+    MU_ASSERT(AListGet(&vis.visible, 0) == kept && AListGet(&vis.visible, 2) == removed,
+              "Expected the visible entities in draw order");
+
+    // one leaves the render list, one is removed while still listed and one
+    // both, none of them stays in the grid
+    VisibilityRemove(&vis, unlisted);
+    EntityRemove(removed);
+    EntityRemove(both);
+    VisibilityRemove(&vis, both);
+    SystemTransformUpdate();
+    SystemVisibilityUpdate(camera, &vis);
+    MU_ASSERT(SpatialGridContains(&vis.grid, kept) &&
+                  SpatialGridContains(&vis.grid, offscreen),
+              "Expected the listed entities in the grid");
+    MU_ASSERT(!SpatialGridContains(&vis.grid, unlisted),
+              "Expected the unlisted entity out of the grid");
+    MU_ASSERT(!SpatialGridContains(&vis.grid, removed) &&
+                  !SpatialGridContains(&vis.grid, both),
+              "Expected the removed entities out of the grid");
+    MU_ASSERT_FMT(vis.visibleCount == 1 && AListGet(&vis.visible, 0) == kept,
+                  "Expected only the kept entity visible, but got %d",
+                  vis.visibleCount);
+    MU_ASSERT_FMT(vis.totalCount == 3, "Expected 3 listed, but got %d",
+                  vis.totalCount);
+
+    // only what moved is looked at again, a transform changed without being
+    // marked dirty keeps its old box
+    getTransform(offscreen)->position = (Vector2){400.0f, 400.0f};
+    TransformMarkDirty(offscreen);
+    getTransform(still)->worldPosition = (Vector2){500.0f, 500.0f};
+    SystemTransformUpdate();
+    SystemVisibilityUpdate(camera, &vis);
+    MU_ASSERT_FMT(vis.visibleCount == 2 && AListGet(&vis.visible, 1) == offscreen,
+                  "Expected the moved entity visible, but got %d", vis.visibleCount);
+    MU_ASSERT(vis.grid.minX[still] == 1800.0f, "Expected the still entity left alone");
+
+    // a new entity reusing a removed id is only drawn once added, over the rest
+    int reused = createSprite(50.0f, 50.0f);
+    MU_ASSERT(reused == removed, "Expected the removed id reused");
+    SystemTransformUpdate();
+    SystemVisibilityUpdate(camera, &vis);
+    MU_ASSERT(!SpatialGridContains(&vis.grid, reused),
+              "Expected the new entity unlisted");
+    VisibilityAdd(&vis, reused);
+    SystemTransformUpdate();
+    SystemVisibilityUpdate(camera, &vis);
+    MU_ASSERT_FMT(vis.visibleCount == 3 && AListGet(&vis.visible, 2) == reused,
+                  "Expected the new entity drawn last, but got %d", vis.visibleCount);
+
+    EntityCompDestroy();
+    AssetSetDestroy(AssetSetGet());
+
+    MU_PASS;
+}
+
+static char *testSnapshotMap(void) {
+    char path[] = "/tmp/ecs_testXXXXXX";
+    static const char savedDir[] = "saved_cache";
+    static const char liveDir[] = "live_cache";
+    MappedFile file;
+    SnapshotHeader header;
+
+    MU_ASSERT(loadTestAssets() == 0, "Expected the test assets loaded");
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    int mapEntity = EntityCreate();
+    MapRender *mapRender = createTestMap(mapEntity, 0);
+    mapRender->cacheDir = savedDir;
+    int fd = mkstemp(path);
+    MU_ASSERT(fd >= 0, "Expected a snapshot file");
+    close(fd);
+    MU_ASSERT(WorldSnapshotWrite(path, NULL) == 0, "Expected the snapshot written");
+
+    // the file holds no pointer into this process
+    MU_ASSERT(mapFile(path, &file) == 0, "Expected the snapshot mapped");
+    const unsigned char *payload = checkSnapshot(&file, &header);
+    MU_ASSERT(payload != NULL, "Expected a valid snapshot");
+    SnapshotBlock maps;
+    int mapsBlock = SNAPSHOT_COMPONENTS + COMP_MAPRENDER;
+    memcpy(&maps, payload + sizeof(SnapshotBlock) * mapsBlock, sizeof(maps));
+    const MapRender *stored = (const MapRender *)(payload + maps.offset);
+    int compId = entities[mapEntity].components[COMP_MAPRENDER];
+    MU_ASSERT(stored[compId].enabled && stored[compId].cacheDir == NULL &&
+                  stored[compId].map.tiles[0] == NULL,
+              "Expected the stored map without pointers");
+    unmapFile(&file);
+
+    // the live directory is kept, whatever it was when saved
+    mapRender->cacheDir = liveDir;
+    const uint16_t *tiles = mapRender->map.tiles[0];
+    MU_ASSERT(WorldSnapshotRead(path, NULL) == 0, "Expected the snapshot read");
+    MU_ASSERT(mapRender->cacheDir == liveDir, "Expected the live cache directory");
+    MU_ASSERT(mapRender->map.tiles[0] == tiles, "Expected the live tiles");
+
+    remove(path);
+    EntityCompDestroy();
+    AssetSetDestroy(AssetSetGet());
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_ASSERT(writeTestAssets() == 0, "Expected the test assets written");
+
+    MU_TEST(testCommandOrder);
+    MU_TEST(testCommandCreated);
+    MU_TEST(testRenderSystems);
+    MU_TEST(testMapBake);
+    MU_TEST(testTransformOrder);
+    MU_TEST(testTransformDirty);
+    MU_TEST(testTransformRemovedParent);
+    MU_TEST(testVisibility);
+    MU_TEST(testSnapshotMap);
+
+    FixtureDirRemove();
+    MU_PASS;
+}
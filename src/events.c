@@ -0,0 +1,178 @@
+#include "events.h"
+
+#include <assert.h>
+#include <string.h>
+
+int EventBusInit(EventBus *bus, Arena *arena, int batchCapacity) {
+    memset(bus, 0, sizeof(*bus));
+    bus->arena = arena;
+    bus->batchCapacity = batchCapacity;
+
+    for (int type = 0; type < EVENT_TYPES_COUNT; ++type) {
+        bus->batches[type] = ArenaAlloc(arena, sizeof(Event) * batchCapacity);
+    }
+
+    return bus->batches[EVENT_TYPES_COUNT - 1] == NULL;
+}
+
+EventRing *EventBusAddRing(EventBus *bus, int capacity, bool multiProducer) {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    assert(bus->ringsCount < MAX_EVENT_RINGS);
+    if (bus->ringsCount >= MAX_EVENT_RINGS) {
+        return NULL;
+    }
+
+    EventRing *ring = &bus->rings[bus->ringsCount++];
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->published, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->head, 0);
+    ring->highWater = 0;
+    ring->mask = capacity - 1;
+    ring->multiProducer = multiProducer;
+    ring->events = ArenaAlloc(bus->arena, sizeof(Event) * capacity);
+    ring->sequence = NULL;
+
+    if (multiProducer) {
+        ring->sequence = ArenaAlloc(bus->arena, sizeof(*ring->sequence) * capacity);
+        for (int i = 0; i < capacity; ++i) {
+            atomic_init(&ring->sequence[i], i);
+        }
+    }
+
+    return ring;
+}
+
+int EventBusSubscribe(EventBus *bus, EventType type, EventHandler handler, void *user) {
+    assert(bus->subscribersCount < MAX_EVENT_SUBSCRIBERS);
+    if (bus->subscribersCount >= MAX_EVENT_SUBSCRIBERS) {
+        return 1;
+    }
+
+    bus->subscribers[bus->subscribersCount++] =
+        (EventSubscriber){.type = type, .handler = handler, .user = user};
+    return 0;
+}
+
+static bool publishSingle(EventRing *ring, const Event *event) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head > ring->mask) {
+        return false;
+    }
+
+    ring->events[tail & ring->mask] = *event;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool publishMulti(EventRing *ring, const Event *event) {
+    // bounded MPMC queue by Dmitry Vyukov, with a single consumer
+    uint32_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        _Atomic uint32_t *sequence = &ring->sequence[pos & ring->mask];
+        uint32_t seq = atomic_load_explicit(sequence, memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                ring->events[pos & ring->mask] = *event;
+                atomic_store_explicit(sequence, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // the consumer hasn't freed this slot yet
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+}
+
+bool EventPublish(EventRing *ring, const Event *event) {
+    bool published = ring->multiProducer ? publishMulti(ring, event)
+                                         : publishSingle(ring, event);
+    atomic_fetch_add_explicit(published ? &ring->published : &ring->dropped, 1,
+                              memory_order_relaxed);
+    return published;
+}
+
+static bool batchEvent(EventBus *bus, const Event *event) {
+    int *count = &bus->batchCounts[event->type];
+    if (*count >= bus->batchCapacity) {
+        return false;
+    }
+    bus->batches[event->type][(*count)++] = *event;
+    return true;
+}
+
+static void drainRing(EventBus *bus, EventRing *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t capacity = ring->mask + 1;
+
+    if (!ring->multiProducer) {
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (tail - head > ring->highWater) {
+            ring->highWater = tail - head;
+        }
+        // a full batch leaves the rest in the ring, producers see it filling up
+        while (head != tail && batchEvent(bus, &ring->events[head & ring->mask])) {
+            ++head;
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        return;
+    }
+
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - head > ring->highWater) {
+        ring->highWater = tail - head;
+    }
+    for (;;) {
+        _Atomic uint32_t *sequence = &ring->sequence[head & ring->mask];
+        uint32_t seq = atomic_load_explicit(sequence, memory_order_acquire);
+        // claimed slots that are still being written end the drain
+        if (seq != head + 1 || !batchEvent(bus, &ring->events[head & ring->mask])) {
+            break;
+        }
+        atomic_store_explicit(sequence, head + capacity, memory_order_release);
+        ++head;
+    }
+    atomic_store_explicit(&ring->head, head, memory_order_relaxed);
+}
+
+int EventBusDispatch(EventBus *bus) {
+    int delivered = 0;
+
+    for (int r = 0; r < bus->ringsCount; ++r) {
+        drainRing(bus, &bus->rings[r]);
+    }
+
+    // subscribers get every event of their type in one call, in the order
+    // they subscribed. Events published by handlers go out next dispatch
+    for (int type = 0; type < EVENT_TYPES_COUNT; ++type) {
+        int count = bus->batchCounts[type];
+        if (count == 0) {
+            continue;
+        }
+        for (int s = 0; s < bus->subscribersCount; ++s) {
+            EventSubscriber *sub = &bus->subscribers[s];
+            if (sub->type == (EventType)type) {
+                sub->handler(bus->batches[type], count, sub->user);
+            }
+        }
+        delivered += count;
+        bus->batchCounts[type] = 0;
+    }
+
+    return delivered;
+}
+
+EventRingStats EventRingGetStats(const EventRing *ring) {
+    return (EventRingStats){
+        .capacity = ring->mask + 1,
+        .published = atomic_load_explicit(&ring->published, memory_order_relaxed),
+        .dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed),
+        .highWater = ring->highWater};
+}
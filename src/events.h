@@ -0,0 +1,102 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+#define MAX_EVENT_RINGS       8
+#define MAX_EVENT_SUBSCRIBERS 32
+
+typedef enum {
+    EVENT_HIT = 0,
+    EVENT_DIE,
+    EVENT_TYPES_COUNT
+} EventType;
+
+typedef struct HitEvent {
+    int target;
+    int source;
+    float x, y;
+    float dirX, dirY;
+} HitEvent;
+
+typedef struct DieEvent {
+    int entity;
+    int killer;
+    float x, y;
+} DieEvent;
+
+typedef struct Event {
+    EventType type;
+    union {
+        HitEvent hit;
+        DieEvent die;
+    };
+} Event;
+
+// Fixed size ring of events, written by one thread (SPSC) or by any
+// number of threads (MPSC) and read by the thread dispatching the bus.
+// Publishing into a full ring drops the event and counts it.
+typedef struct EventRing {
+    // producer and consumer indices on their own cache lines
+    _Alignas(64) _Atomic uint32_t tail;
+    _Atomic uint32_t published;
+    _Atomic uint32_t dropped;
+    _Alignas(64) _Atomic uint32_t head;
+    uint32_t highWater;
+
+    uint32_t mask;
+    bool multiProducer;
+    Event *events;
+    // multi producer slots are ready when their sequence is one past
+    // their position
+    _Atomic uint32_t *sequence;
+} EventRing;
+
+typedef struct EventRingStats {
+    uint32_t capacity;
+    uint32_t published;
+    uint32_t dropped;
+    uint32_t highWater;
+} EventRingStats;
+
+typedef void (*EventHandler)(const Event *events, int count, void *user);
+
+typedef struct EventSubscriber {
+    EventType type;
+    EventHandler handler;
+    void *user;
+} EventSubscriber;
+
+// Events of every ring are gathered per type and handed to subscribers in
+// batches, only when the bus is dispatched
+typedef struct EventBus {
+    EventRing rings[MAX_EVENT_RINGS];
+    int ringsCount;
+
+    EventSubscriber subscribers[MAX_EVENT_SUBSCRIBERS];
+    int subscribersCount;
+
+    Event *batches[EVENT_TYPES_COUNT];
+    int batchCounts[EVENT_TYPES_COUNT];
+    int batchCapacity;
+
+    Arena *arena;
+} EventBus;
+
+int EventBusInit(EventBus *bus, Arena *arena, int batchCapacity);
+// capacity must be a power of two
+EventRing *EventBusAddRing(EventBus *bus, int capacity, bool multiProducer);
+int EventBusSubscribe(EventBus *bus, EventType type, EventHandler handler, void *user);
+
+bool EventPublish(EventRing *ring, const Event *event);
+
+// delivers everything published so far, returns the number of events
+int EventBusDispatch(EventBus *bus);
+
+EventRingStats EventRingGetStats(const EventRing *ring);
+
+#endif // !EVENTS_H
@@ -0,0 +1,106 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "events.c"
+#include "events.h"
+#include "utils.c"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RING_CAPACITY   4096
+#define BATCH_CAPACITY  1024
+#define BENCH_EVENTS    (1 << 24)
+#define MAX_PRODUCERS   4
+
+typedef struct Producer {
+    EventRing *ring;
+    int events;
+} Producer;
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void *produce(void *arg) {
+    Producer *producer = arg;
+    for (int i = 0; i < producer->events; ++i) {
+        Event event = {.type = i & 1 ? EVENT_DIE : EVENT_HIT, .hit = {.target = i}};
+        // a full ring pushes back, retry until the consumer catches up
+        while (!EventPublish(producer->ring, &event)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void consume(const Event *events, int count, void *user) {
+    long *sum = user;
+    for (int i = 0; i < count; ++i) {
+        *sum += events[i].hit.target;
+    }
+}
+
+static void bench(int producers, bool multiProducer) {
+    Arena arena;
+    EventBus bus;
+    long sum = 0;
+    pthread_t threads[MAX_PRODUCERS];
+    Producer args[MAX_PRODUCERS];
+
+    ArenaInit(&arena, malloc(Megabyte(4)), Megabyte(4));
+    EventBusInit(&bus, &arena, BATCH_CAPACITY);
+    EventBusSubscribe(&bus, EVENT_HIT, consume, &sum);
+    EventBusSubscribe(&bus, EVENT_DIE, consume, &sum);
+
+    // one ring per producer thread, or a single ring shared by all of them
+    EventRing *shared =
+        multiProducer ? EventBusAddRing(&bus, RING_CAPACITY, true) : NULL;
+    double start = nowMs();
+    for (int t = 0; t < producers; ++t) {
+        args[t].ring = shared != NULL ? shared
+                                      : EventBusAddRing(&bus, RING_CAPACITY, false);
+        args[t].events = BENCH_EVENTS / producers;
+        pthread_create(&threads[t], NULL, produce, &args[t]);
+    }
+
+    long delivered = 0, dispatches = 0;
+    while (delivered < BENCH_EVENTS) {
+        int count = EventBusDispatch(&bus);
+        if (count == 0) {
+            sched_yield();
+            continue;
+        }
+        delivered += count;
+        ++dispatches;
+    }
+    for (int t = 0; t < producers; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = nowMs() - start;
+
+    uint32_t highWater = 0, dropped = 0;
+    for (int r = 0; r < bus.ringsCount; ++r) {
+        EventRingStats stats = EventRingGetStats(&bus.rings[r]);
+        highWater = stats.highWater > highWater ? stats.highWater : highWater;
+        dropped += stats.dropped;
+    }
+
+    printf("%d producer%s %s: %7.1f M events/s  %5.1f events/dispatch  high water "
+           "%u/%d  full %u\n",
+           producers, producers > 1 ? "s" : " ", multiProducer ? "MPSC" : "SPSC",
+           BENCH_EVENTS / elapsed / 1e3, (double)delivered / dispatches, highWater,
+           RING_CAPACITY, dropped);
+    free(arena.buff);
+}
+
+int main(void) {
+    bench(1, false);
+    bench(MAX_PRODUCERS, false);
+    bench(1, true);
+    bench(MAX_PRODUCERS, true);
+    return 0;
+}
@@ -0,0 +1,213 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "minunit.h"
+#include "events.c"
+#include "events.h"
+#include "utils.c"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define PRODUCERS          4
+#define EVENTS_PER_THREAD  20000
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testSingleProducer(void);
+static char *testMultiProducer(void);
+static char *testBatching(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+typedef struct Received {
+    int count;
+    int calls;
+    long sum;
+    int last;
+    bool ordered;
+} Received;
+
+static void onEvents(const Event *events, int count, void *user) {
+    Received *received = user;
+    received->calls++;
+    for (int i = 0; i < count; ++i) {
+        int value = events[i].type == EVENT_HIT ? events[i].hit.target
+                                                : events[i].die.entity;
+        if (value < received->last) {
+            received->ordered = false;
+        }
+        received->last = value;
+        received->sum += value;
+        received->count++;
+    }
+}
+
+static Event hitEvent(int target) {
+    return (Event){.type = EVENT_HIT, .hit = {.target = target}};
+}
+
+static char *testSingleProducer(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    EventBus bus;
+    Received received = {.ordered = true, .last = -1};
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    EventBusInit(&bus, &arena, 64);
+    EventRing *ring = EventBusAddRing(&bus, 8, false);
+    EventBusSubscribe(&bus, EVENT_HIT, onEvents, &received);
+
+    // the ninth event doesn't fit
+    for (int i = 0; i < 9; ++i) {
+        Event event = hitEvent(i);
+        bool published = EventPublish(ring, &event);
+        MU_ASSERT_FMT(published == (i < 8), "Expected publish %d to be %d", i, i < 8);
+    }
+
+    int delivered = EventBusDispatch(&bus);
+    MU_ASSERT_FMT(8 == delivered, "Expected %d delivered, but got %d", 8, delivered);
+    MU_ASSERT(received.ordered, "Expected events in publish order");
+    MU_ASSERT_FMT(1 == received.calls, "Expected %d batch, but got %d", 1,
+                  received.calls);
+
+    EventRingStats stats = EventRingGetStats(ring);
+    MU_ASSERT_FMT(8 == stats.published, "Expected %d published, but got %u", 8,
+                  stats.published);
+    MU_ASSERT_FMT(1 == stats.dropped, "Expected %d dropped, but got %u", 1,
+                  stats.dropped);
+    MU_ASSERT_FMT(8 == stats.highWater, "Expected high water %d, but got %u", 8,
+                  stats.highWater);
+
+    // room again after the dispatch, with wrapped indices
+    for (int i = 8; i < 14; ++i) {
+        Event event = hitEvent(i);
+        MU_ASSERT(EventPublish(ring, &event), "Expected room after dispatch");
+    }
+    delivered = EventBusDispatch(&bus);
+    MU_ASSERT_FMT(6 == delivered, "Expected %d delivered, but got %d", 6, delivered);
+    MU_ASSERT(received.ordered, "Expected events in publish order");
+
+    MU_PASS;
+}
+
+typedef struct Producer {
+    EventRing *ring;
+    int first;
+} Producer;
+
+static void *produce(void *arg) {
+    Producer *producer = arg;
+    for (int i = 0; i < EVENTS_PER_THREAD; ++i) {
+        Event event = hitEvent(producer->first + i);
+        // spin until the consumer makes room
+        while (!EventPublish(producer->ring, &event)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static char *testMultiProducer(void) {
+    static unsigned char buffer[Kilobyte(64)];
+    Arena arena;
+    EventBus bus;
+    Received received = {0};
+    pthread_t threads[PRODUCERS];
+    Producer producers[PRODUCERS];
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    EventBusInit(&bus, &arena, 256);
+    EventRing *ring = EventBusAddRing(&bus, 256, true);
+    EventBusSubscribe(&bus, EVENT_HIT, onEvents, &received);
+
+    for (int t = 0; t < PRODUCERS; ++t) {
+        producers[t] = (Producer){.ring = ring, .first = t * EVENTS_PER_THREAD};
+        pthread_create(&threads[t], NULL, produce, &producers[t]);
+    }
+    while (received.count < PRODUCERS * EVENTS_PER_THREAD) {
+        if (EventBusDispatch(&bus) == 0) {
+            sched_yield();
+        }
+    }
+    for (int t = 0; t < PRODUCERS; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+
+    long total = PRODUCERS * EVENTS_PER_THREAD;
+    long expected = total * (total - 1) / 2;
+    MU_ASSERT_FMT(expected == received.sum, "Expected sum %ld, but got %ld", expected,
+                  received.sum);
+    EventRingStats stats = EventRingGetStats(ring);
+    MU_ASSERT_FMT(total == stats.published, "Expected %ld published, but got %u",
+                  total, stats.published);
+    MU_ASSERT(stats.highWater <= stats.capacity, "Expected high water within ring");
+
+    MU_PASS;
+}
+
+static char *testBatching(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    EventBus bus;
+    Received hits = {.ordered = true, .last = -1};
+    Received dies = {.ordered = true, .last = -1};
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    EventBusInit(&bus, &arena, 4);
+    EventRing *first = EventBusAddRing(&bus, 16, false);
+    EventRing *second = EventBusAddRing(&bus, 16, true);
+    EventBusSubscribe(&bus, EVENT_HIT, onEvents, &hits);
+    EventBusSubscribe(&bus, EVENT_DIE, onEvents, &dies);
+
+    for (int i = 0; i < 3; ++i) {
+        Event event = hitEvent(i);
+        EventPublish(first, &event);
+    }
+    for (int i = 0; i < 3; ++i) {
+        Event event = {.type = EVENT_DIE, .die = {.entity = i}};
+        EventPublish(second, &event);
+        event = hitEvent(10 + i);
+        EventPublish(second, &event);
+    }
+
+    // four hits fit in the batch, the rest wait in the ring
+    int delivered = EventBusDispatch(&bus);
+    MU_ASSERT_FMT(6 == delivered, "Expected %d delivered, but got %d", 6, delivered);
+    MU_ASSERT_FMT(4 == hits.count, "Expected %d hits, but got %d", 4, hits.count);
+    MU_ASSERT_FMT(2 == dies.count, "Expected %d dies, but got %d", 2, dies.count);
+    MU_ASSERT_FMT(1 == hits.calls, "Expected %d hit batch, but got %d", 1, hits.calls);
+
+    delivered = EventBusDispatch(&bus);
+    MU_ASSERT_FMT(3 == delivered, "Expected %d delivered, but got %d", 3, delivered);
+    MU_ASSERT_FMT(6 == hits.count, "Expected %d hits, but got %d", 6, hits.count);
+    MU_ASSERT_FMT(3 == dies.count, "Expected %d dies, but got %d", 3, dies.count);
+    MU_ASSERT(hits.ordered && dies.ordered, "Expected events in publish order");
+
+    delivered = EventBusDispatch(&bus);
+    MU_ASSERT_FMT(0 == delivered, "Expected %d delivered, but got %d", 0, delivered);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testSingleProducer);
+    MU_TEST(testMultiProducer);
+    MU_TEST(testBatching);
+
+    MU_PASS;
+}
@@ -0,0 +1,292 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// The parts of raylib the game's modules call, for tests that run them
+// without a window or GPU. Include it once, before any of those modules,
+// with RENDER_NO_RAYLIB defined so every draw is recorded.
+//
+// Images are never decoded: a PNG's size is read from its header and every
+// pixel is headlessImageColor. Textures are only ids, counted while loaded.
+//
+// Tests write the assets they load into a directory of their own, made with
+// mkdtemp, so they define _POSIX_C_SOURCE 200809L before any include.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// assets are loaded from the working directory, the fixture one
+#ifndef ASSETS_PATH
+#define ASSETS_PATH "."
+#endif
+
+// raymath's functions are defined in the header itself, not in a library
+#define RAYMATH_STATIC_INLINE
+
+#include "raylib.h"
+#include "rlgl.h"
+
+static int headlessScreenWidth = 800;
+static int headlessScreenHeight = 600;
+static Color headlessImageColor = {255, 255, 255, 255};
+static int headlessTexturesLoaded;
+static unsigned int headlessNextTexture = 1;
+
+// messages at this level and up are printed
+static int headlessLogLevel = LOG_NONE;
+
+void TraceLog(int logLevel, const char *text, ...) {
+    if (logLevel < headlessLogLevel) {
+        return;
+    }
+    va_list args;
+    va_start(args, text);
+    vfprintf(stderr, text, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+double GetTime(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+bool ChangeDirectory(const char *dir) {
+    return chdir(dir) == 0;
+}
+
+char *LoadFileText(const char *fileName) {
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = malloc(size + 1);
+    if (text != NULL && fread(text, 1, size, file) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text != NULL) {
+        text[size] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+int GetPixelDataSize(int width, int height, int format) {
+    (void)format;
+    return width * height * 4;
+}
+
+static Image headlessImage(int width, int height) {
+    Color *pixels = malloc(sizeof(Color) * width * height);
+    for (int i = 0; pixels != NULL && i < width * height; ++i) {
+        pixels[i] = headlessImageColor;
+    }
+    return (Image){.data = pixels,
+                   .width = width,
+                   .height = height,
+                   .mipmaps = 1,
+                   .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+}
+
+// the size is the first thing in a PNG's IHDR chunk, big endian
+Image LoadImage(const char *fileName) {
+    unsigned char header[24];
+    FILE *file = fopen(fileName, "rb");
+    bool ok = file != NULL && fread(header, sizeof(header), 1, file) == 1 &&
+              memcmp(header + 1, "PNG", 3) == 0;
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (!ok) {
+        return (Image){0};
+    }
+
+    int width = header[16] << 24 | header[17] << 16 | header[18] << 8 | header[19];
+    int height = header[20] << 24 | header[21] << 16 | header[22] << 8 | header[23];
+    return headlessImage(width, height);
+}
+
+Image LoadImageFromTexture(Texture2D texture) {
+    return headlessImage(texture.width, texture.height);
+}
+
+void UnloadImage(Image image) {
+    free(image.data);
+}
+
+Color *LoadImageColors(Image image) {
+    size_t size = sizeof(Color) * image.width * image.height;
+    Color *colors = malloc(size);
+    if (colors != NULL) {
+        memcpy(colors, image.data, size);
+    }
+    return colors;
+}
+
+void UnloadImageColors(Color *colors) {
+    free(colors);
+}
+
+Texture2D LoadTextureFromImage(Image image) {
+    ++headlessTexturesLoaded;
+    return (Texture2D){.id = headlessNextTexture++,
+                       .width = image.width,
+                       .height = image.height,
+                       .mipmaps = 1,
+                       .format = image.format};
+}
+
+void UnloadTexture(Texture2D texture) {
+    if (texture.id != 0) {
+        --headlessTexturesLoaded;
+    }
+}
+
+void UpdateTexture(Texture2D texture, const void *pixels) {
+    (void)texture;
+    (void)pixels;
+}
+
+void SetTextureFilter(Texture2D texture, int filter) {
+    (void)texture;
+    (void)filter;
+}
+
+void BeginBlendMode(int mode) {
+    (void)mode;
+}
+
+void EndBlendMode(void) {
+}
+
+void DrawTexturePro(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin,
+                    float rotation, Color tint) {
+    (void)texture;
+    (void)source;
+    (void)dest;
+    (void)origin;
+    (void)rotation;
+    (void)tint;
+}
+
+int GetScreenWidth(void) {
+    return headlessScreenWidth;
+}
+
+int GetScreenHeight(void) {
+    return headlessScreenHeight;
+}
+
+// the inverse of BeginMode2D's transform
+Vector2 GetScreenToWorld2D(Vector2 position, Camera2D camera) {
+    float x = (position.x - camera.offset.x) / camera.zoom;
+    float y = (position.y - camera.offset.y) / camera.zoom;
+    float c = cosf(-camera.rotation * DEG2RAD), s = sinf(-camera.rotation * DEG2RAD);
+    return (Vector2){x * c - y * s + camera.target.x, x * s + y * c + camera.target.y};
+}
+
+// immediate mode drawing goes nowhere
+void rlBegin(int mode) {
+    (void)mode;
+}
+
+void rlEnd(void) {
+}
+
+void rlSetTexture(unsigned int id) {
+    (void)id;
+}
+
+void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    (void)r;
+    (void)g;
+    (void)b;
+    (void)a;
+}
+
+void rlTexCoord2f(float x, float y) {
+    (void)x;
+    (void)y;
+}
+
+void rlVertex2f(float x, float y) {
+    (void)x;
+    (void)y;
+}
+
+void rlNormal3f(float x, float y, float z) {
+    (void)x;
+    (void)y;
+    (void)z;
+}
+
+bool rlCheckRenderBatchLimit(int vCount) {
+    (void)vCount;
+    return false;
+}
+
+unsigned int rlGetTextureIdDefault(void) {
+    return 1;
+}
+
+// Fixtures, the files a test writes are removed with the directory
+#define FIXTURE_PATH_MAX  64
+#define FIXTURE_FILES_MAX 16
+
+static char fixtureDir[FIXTURE_PATH_MAX];
+static char fixtureFiles[FIXTURE_FILES_MAX][FIXTURE_PATH_MAX];
+static int fixtureFilesCount;
+
+// makes /tmp/<name>XXXXXX and moves into it, returns 1 on failure
+int FixtureDirCreate(const char *name) {
+    snprintf(fixtureDir, sizeof(fixtureDir), "/tmp/%sXXXXXX", name);
+    fixtureFilesCount = 0;
+    return mkdtemp(fixtureDir) == NULL || chdir(fixtureDir) != 0;
+}
+
+void FixtureDirRemove(void) {
+    for (int i = 0; i < fixtureFilesCount; ++i) {
+        remove(fixtureFiles[i]);
+    }
+    fixtureFilesCount = 0;
+    rmdir(fixtureDir);
+}
+
+// relative to the fixture directory, returns 1 on failure
+int WriteFile(const char *path, const void *content, size_t size) {
+    if (fixtureFilesCount >= FIXTURE_FILES_MAX) {
+        return 1;
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return 1;
+    }
+    snprintf(fixtureFiles[fixtureFilesCount++], FIXTURE_PATH_MAX, "%s", path);
+    size_t written = fwrite(content, 1, size, file);
+    fclose(file);
+    return written != size;
+}
+
+// the signature and the size in IHDR, all LoadImage reads of a PNG
+int WriteFakePng(const char *path, int width, int height) {
+    unsigned char png[24] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n',
+                             0,    0,   0,   13,  'I',  'H',  'D',  'R'};
+    for (int i = 0; i < 4; ++i) {
+        png[16 + i] = (unsigned char)(width >> (24 - 8 * i));
+        png[20 + i] = (unsigned char)(height >> (24 - 8 * i));
+    }
+    return WriteFile(path, png, sizeof(png));
+}
+
+#endif // HEADLESS_H
@@ -0,0 +1,137 @@
+#include "input.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+#include "raymath.h"
+
+#define INPUT_MAGIC   "PAIR"
+#define INPUT_VERSION 1
+
+// one record per tick, actions then dt
+#define INPUT_RECORD_LEN (sizeof(uint8_t) + sizeof(float))
+
+typedef struct InputHeader {
+    char magic[4];
+    uint32_t version;
+} InputHeader;
+
+static InputMode inputMode;
+static FILE *inputFile;
+static unsigned long inputTick;
+
+int InputInit(InputMode mode, const char *filepath) {
+    InputHeader header;
+
+    inputMode = mode;
+    inputFile = NULL;
+    inputTick = 0;
+
+    if (mode == INPUT_RECORD) {
+        inputFile = fopen(filepath, "wb");
+        if (inputFile == NULL) {
+            TraceLog(LOG_ERROR, "Failed to open %s for recording", filepath);
+            return 1;
+        }
+        memcpy(header.magic, INPUT_MAGIC, sizeof(header.magic));
+        header.version = INPUT_VERSION;
+        fwrite(&header, sizeof(header), 1, inputFile);
+    } else if (mode == INPUT_REPLAY) {
+        inputFile = fopen(filepath, "rb");
+        if (inputFile == NULL) {
+            TraceLog(LOG_ERROR, "Failed to open recording %s", filepath);
+            return 1;
+        }
+        if (fread(&header, sizeof(header), 1, inputFile) != 1 ||
+            memcmp(header.magic, INPUT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != INPUT_VERSION) {
+            TraceLog(LOG_ERROR, "Invalid recording %s", filepath);
+            fclose(inputFile);
+            inputFile = NULL;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void InputDestroy(void) {
+    if (inputFile != NULL) {
+        fclose(inputFile);
+        inputFile = NULL;
+    }
+}
+
+static uint8_t readActions(void) {
+    uint8_t actions = 0;
+
+    if (IsKeyDown(KEY_W)) {
+        actions |= INPUT_UP;
+    }
+    if (IsKeyDown(KEY_D)) {
+        actions |= INPUT_RIGHT;
+    }
+    if (IsKeyDown(KEY_S)) {
+        actions |= INPUT_DOWN;
+    }
+    if (IsKeyDown(KEY_A)) {
+        actions |= INPUT_LEFT;
+    }
+    if (IsKeyPressed(KEY_R)) {
+        actions |= INPUT_RESTART;
+    }
+    if (IsKeyDown(KEY_SPACE)) {
+        actions |= INPUT_FIRE;
+    }
+
+    return actions;
+}
+
+bool InputPoll(InputFrame *frame) {
+    unsigned char record[INPUT_RECORD_LEN];
+
+    if (inputMode == INPUT_REPLAY) {
+        if (fread(record, INPUT_RECORD_LEN, 1, inputFile) != 1) {
+            // end of the recording
+            return false;
+        }
+        frame->actions = record[0];
+        memcpy(&frame->dt, &record[1], sizeof(frame->dt));
+    } else {
+        frame->actions = readActions();
+        frame->dt = GetFrameTime();
+
+        if (inputMode == INPUT_RECORD) {
+            record[0] = frame->actions;
+            memcpy(&record[1], &frame->dt, sizeof(frame->dt));
+            fwrite(record, INPUT_RECORD_LEN, 1, inputFile);
+        }
+    }
+
+    ++inputTick;
+    return true;
+}
+
+Vector2 InputMoveDirection(InputFrame frame) {
+    Vector2 input = Vector2Zero();
+
+    if (frame.actions & INPUT_UP) {
+        input.y -= 1;
+    }
+    if (frame.actions & INPUT_RIGHT) {
+        input.x += 1;
+    }
+    if (frame.actions & INPUT_DOWN) {
+        input.y += 1;
+    }
+    if (frame.actions & INPUT_LEFT) {
+        input.x -= 1;
+    }
+
+    return Vector2Normalize(input);
+}
+
+unsigned long InputTick(void) {
+    return inputTick;
+}
@@ -0,0 +1,36 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "raylib.h"
+
+typedef enum {
+    INPUT_LIVE = 0,
+    INPUT_RECORD,
+    INPUT_REPLAY
+} InputMode;
+
+typedef enum {
+    INPUT_UP = 1 << 0,
+    INPUT_DOWN = 1 << 1,
+    INPUT_LEFT = 1 << 2,
+    INPUT_RIGHT = 1 << 3,
+    INPUT_RESTART = 1 << 4,
+    INPUT_FIRE = 1 << 5
+} InputAction;
+
+// Everything the simulation reads in one tick
+typedef struct InputFrame {
+    uint8_t actions;
+    float dt;
+} InputFrame;
+
+int InputInit(InputMode mode, const char *filepath);
+void InputDestroy(void);
+
+bool InputPoll(InputFrame *frame);
+Vector2 InputMoveDirection(InputFrame frame);
+unsigned long InputTick(void);
+
+#endif // !INPUT_H
@@ -0,0 +1,165 @@
+#include "level.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+
+void LevelStreamInit(LevelStream *stream) {
+    memset(stream, 0, sizeof(*stream));
+    for (int i = 0; i < LEVEL_SLOTS; ++i) {
+        stream->slots[i].index = i;
+    }
+    stream->active = -1;
+    atomic_init(&stream->state, LEVEL_IDLE);
+
+    // textures loaded by any other thread wait for this one
+    AssetsSetGpuThread();
+}
+
+// Uses the slot's assets, world and prefabs on the calling thread, or none
+static void useSlot(LevelSlot *slot) {
+    AssetSetUse(slot != NULL ? slot->assets : NULL);
+    EcsWorldUse(slot != NULL ? slot->world : NULL);
+    PrefabsUse(slot != NULL ? &slot->prefabs : NULL);
+}
+
+// on the main thread, both own GPU resources
+static void clearSlot(LevelSlot *slot) {
+    if (slot->world != NULL) {
+        EcsWorldDestroy(slot->world);
+    }
+    if (slot->assets != NULL) {
+        AssetSetDestroy(slot->assets);
+    }
+    slot->world = NULL;
+    slot->assets = NULL;
+    memset(&slot->prefabs, 0, sizeof(slot->prefabs));
+}
+
+static void joinLoader(LevelStream *stream) {
+    if (stream->loaderRunning) {
+        pthread_join(stream->thread, NULL);
+        stream->loaderRunning = false;
+    }
+}
+
+static LevelSlot *nextSlot(LevelStream *stream) {
+    return &stream->slots[(stream->active + 1) % LEVEL_SLOTS];
+}
+
+static void *levelLoaderThread(void *arg) {
+    LevelStream *stream = arg;
+    LevelSlot *slot = nextSlot(stream);
+
+    // the loader's own views of the slot, written back by useSlot(NULL)
+    slot->assets = AssetSetCreate();
+    slot->world = EcsWorldCreate();
+    bool ok = slot->assets != NULL && slot->world != NULL;
+    if (ok) {
+        useSlot(slot);
+        ok = stream->build(slot, stream->user);
+        useSlot(NULL);
+    }
+
+    atomic_store_explicit(&stream->state, ok ? LEVEL_UPLOADING : LEVEL_FAILED,
+                          memory_order_release);
+    return NULL;
+}
+
+bool LevelStreamRequest(LevelStream *stream, const char *name, LevelStepFn build,
+                        LevelStepFn prepare, void *user) {
+    if (LevelStreamBusy(stream)) {
+        return false;
+    }
+
+    LevelSlot *slot = nextSlot(stream);
+    assert(slot->world == NULL && slot->assets == NULL);
+    snprintf(slot->name, sizeof(slot->name), "%s", name);
+    stream->build = build;
+    stream->prepare = prepare;
+    stream->user = user;
+
+    atomic_store_explicit(&stream->state, LEVEL_LOADING, memory_order_relaxed);
+    if (pthread_create(&stream->thread, NULL, levelLoaderThread, stream) != 0) {
+        TraceLog(LOG_ERROR, "LEVEL: Failed to start loading %s", name);
+        atomic_store_explicit(&stream->state, LEVEL_IDLE, memory_order_relaxed);
+        return false;
+    }
+    stream->loaderRunning = true;
+    TraceLog(LOG_INFO, "LEVEL: Loading %s in the background", name);
+    return true;
+}
+
+bool LevelStreamUpdate(LevelStream *stream) {
+    LevelSlot *slot = nextSlot(stream);
+    LevelSlot *active = LevelStreamActive(stream);
+
+    switch (atomic_load_explicit(&stream->state, memory_order_acquire)) {
+    case LEVEL_UPLOADING:
+        // the loader is done with the slot, it's all ours now
+        joinLoader(stream);
+        if (AssetsUploadPending(LEVEL_UPLOADS_PER_TICK) == 0) {
+            atomic_store_explicit(&stream->state, LEVEL_PREPARING,
+                                  memory_order_relaxed);
+        }
+        return false;
+
+    case LEVEL_PREPARING: {
+        // GPU side setup, render targets and such, with the level current.
+        // It all happens in this tick, so how long it took is reported
+        double start = GetTime();
+        useSlot(slot);
+        bool ok = stream->prepare == NULL || stream->prepare(slot, stream->user);
+        useSlot(active);
+        stream->prepareMs = (GetTime() - start) * 1000.0;
+        TraceLog(LOG_INFO, "LEVEL: Prepared %s in %.2f ms", slot->name,
+                 stream->prepareMs);
+        atomic_store_explicit(&stream->state, ok ? LEVEL_READY : LEVEL_FAILED,
+                              memory_order_relaxed);
+        return false;
+    }
+
+    case LEVEL_READY:
+        // the switch itself, the old level isn't needed past this point
+        stream->active = slot->index;
+        useSlot(slot);
+        if (active != NULL) {
+            clearSlot(active);
+        }
+        atomic_store_explicit(&stream->state, LEVEL_IDLE, memory_order_relaxed);
+        TraceLog(LOG_INFO, "LEVEL: Switched to %s", slot->name);
+        return true;
+
+    case LEVEL_FAILED:
+        joinLoader(stream);
+        TraceLog(LOG_ERROR, "LEVEL: Failed to load %s", slot->name);
+        clearSlot(slot);
+        atomic_store_explicit(&stream->state, LEVEL_IDLE, memory_order_relaxed);
+        return false;
+
+    default:
+        return false;
+    }
+}
+
+bool LevelStreamBusy(LevelStream *stream) {
+    return atomic_load_explicit(&stream->state, memory_order_acquire) != LEVEL_IDLE;
+}
+
+LevelSlot *LevelStreamActive(LevelStream *stream) {
+    return stream->active >= 0 ? &stream->slots[stream->active] : NULL;
+}
+
+void LevelStreamDestroy(LevelStream *stream) {
+    // a level still loading is finished and thrown away
+    joinLoader(stream);
+
+    useSlot(NULL);
+    for (int i = 0; i < LEVEL_SLOTS; ++i) {
+        clearSlot(&stream->slots[i]);
+    }
+    stream->active = -1;
+    atomic_store_explicit(&stream->state, LEVEL_IDLE, memory_order_relaxed);
+}
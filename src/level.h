@@ -0,0 +1,75 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "assets.h"
+#include "ecs.h"
+#include "prefab.h"
+
+#define LEVEL_NAME_MAX 32
+#define LEVEL_SLOTS    2
+
+// textures uploaded per LevelStreamUpdate, each one is a stall on the GPU
+#define LEVEL_UPLOADS_PER_TICK 1
+
+typedef enum {
+    LEVEL_IDLE = 0,
+    LEVEL_LOADING,
+    LEVEL_UPLOADING,
+    LEVEL_PREPARING,
+    LEVEL_READY,
+    LEVEL_FAILED
+} LevelState;
+
+// Assets, entities and prefabs of one level. Current on the main thread while
+// the level is active, on the loader thread while it's built
+typedef struct LevelSlot {
+    int index;
+    char name[LEVEL_NAME_MAX];
+    AssetSet *assets;
+    EcsWorld *world;
+    PrefabTable prefabs;
+} LevelSlot;
+
+// Returns false if the level can't be played
+typedef bool (*LevelStepFn)(LevelSlot *slot, void *user);
+
+// Double buffered levels, the next one is built in the other slot while the
+// active one runs and swapped in at a tick boundary
+typedef struct LevelStream {
+    LevelSlot slots[LEVEL_SLOTS];
+    int active;
+    _Atomic int state;
+
+    // build runs on the loader thread, prepare on the main thread once the
+    // textures are uploaded
+    pthread_t thread;
+    bool loaderRunning;
+    LevelStepFn build, prepare;
+    void *user;
+
+    // main thread time of the last prepare, a stall of the tick it ran on
+    double prepareMs;
+} LevelStream;
+
+// on the thread owning the GL context, the only one that switches levels
+void LevelStreamInit(LevelStream *stream);
+void LevelStreamDestroy(LevelStream *stream);
+
+// Starts building the level in the free slot, false while another one is
+// still on its way
+bool LevelStreamRequest(LevelStream *stream, const char *name, LevelStepFn build,
+                        LevelStepFn prepare, void *user);
+
+// Takes the next level one bounded step further, once per tick. Returns true
+// on the tick its slot became the active one
+bool LevelStreamUpdate(LevelStream *stream);
+bool LevelStreamBusy(LevelStream *stream);
+
+// NULL until the first level is in
+LevelSlot *LevelStreamActive(LevelStream *stream);
+
+#endif // !LEVEL_H
@@ -0,0 +1,269 @@
+// nanosleep and the fixture directory
+#define _POSIX_C_SOURCE 200809L
+// the game's modules without a window, draws are recorded
+#define RENDER_NO_RAYLIB
+
+#include "minunit.h"
+#include "headless.h"
+#include "assets.c"
+#include "collision.c"
+#include "ecs.c"
+#include "level.c"
+#include "level.h"
+#include "lightgrid.c"
+#include "mapstream.c"
+#include "net.c"
+#include "parser.c"
+#include "particles.c"
+#include "prefab.c"
+#include "projectiles.c"
+#include "render.c"
+#include "spatial.c"
+#include "utils.c"
+#include <sched.h>
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+// what a request builds: the shared spritesheet, its own and a map
+typedef struct TestLevel {
+    const char *sheet;
+    bool buildOk, prepareOk;
+    int delayMs;
+    atomic_bool started;
+    int map;
+} TestLevel;
+
+static char *testStreamWhileActive(void);
+static char *testFailed(void);
+static char *testDestroyWhileLoading(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+// a 32x16 spritesheet both levels use, one 16x16 each of their own and a
+// 2x2 map over the shared one
+static int writeTestAssets(void) {
+    static const char shared[] = "floor 0 0 16 16\nwall 16 0 16 16\n";
+    static const char map[] = "2 1 2 2\nfloor\nwall\n0 1\n1 0\n";
+
+    return FixtureDirCreate("level_test") || WriteFakePng("shared.png", 32, 16) ||
+           WriteFile("shared.sprite", shared, strlen(shared)) ||
+           WriteFakePng("first.png", 16, 16) ||
+           WriteFile("first.sprite", "first 0 0 16 16\n", 16) ||
+           WriteFakePng("second.png", 16, 16) ||
+           WriteFile("second.sprite", "second 0 0 16 16\n", 17) ||
+           WriteFile("level.map", map, strlen(map));
+}
+
+static bool buildLevel(LevelSlot *slot, void *user) {
+    TestLevel *level = user;
+    (void)slot;
+    atomic_store(&level->started, true);
+    if (level->delayMs > 0) {
+        struct timespec delay = {0, level->delayMs * 1000000L};
+        nanosleep(&delay, NULL);
+    }
+
+    AssetAdd(ASSET_LOADER_SPRITESHEET, "shared");
+    AssetAdd(ASSET_LOADER_SPRITESHEET, level->sheet);
+    AssetAdd(ASSET_LOADER_MAP, "level");
+    if (AssetLoadSync() != 0) {
+        return false;
+    }
+
+    level->map = EntityCreate();
+    MapRender *mapRender = ComponentCreate(level->map, COMP_MAPRENDER);
+    mapRender->map = AssetGetMap("level");
+    mapRender->tileWidth = 16;
+    mapRender->tileHeight = 16;
+    mapRender->scale = (Vector2){1.0f, 1.0f};
+    mapRender->renderLayersCount = 1;
+    return level->buildOk;
+}
+
+static bool prepareLevel(LevelSlot *slot, void *user) {
+    TestLevel *level = user;
+    (void)slot;
+    SystemMapInit(level->map);
+    return level->prepareOk;
+}
+
+// ticks until the stream is idle again, true if a level was switched to
+static bool finishLevel(LevelStream *stream) {
+    bool switched = false;
+    while (LevelStreamBusy(stream)) {
+        switched = LevelStreamUpdate(stream) || switched;
+        sched_yield();
+    }
+    return switched;
+}
+
+static char *testStreamWhileActive(void) {
+    LevelStream stream;
+    TestLevel first = {.sheet = "first", .buildOk = true, .prepareOk = true};
+    TestLevel second = {.sheet = "second", .buildOk = true, .prepareOk = true};
+
+    LevelStreamInit(&stream);
+    MU_ASSERT(LevelStreamRequest(&stream, "first", buildLevel, prepareLevel, &first),
+              "Expected the first level requested");
+    MU_ASSERT(!LevelStreamRequest(&stream, "second", buildLevel, prepareLevel, &second),
+              "Expected no second request while the first loads");
+    MU_ASSERT(finishLevel(&stream), "Expected the first level switched to");
+    LevelSlot *active = LevelStreamActive(&stream);
+    MU_ASSERT(active != NULL && strcmp(active->name, "first") == 0,
+              "Expected the first level active");
+    MU_ASSERT_FMT(headlessTexturesLoaded == 2, "Expected 2 textures, but got %d",
+                  headlessTexturesLoaded);
+    MU_ASSERT(ComponentGet(first.map, COMP_MAPRENDER) != NULL,
+              "Expected the first level's world current");
+    Texture2D sharedTexture = AssetsGetSpriteTexture(AssetsGetSpriteId("floor"));
+
+    // the active level keeps running while the next one is built
+    MU_ASSERT(LevelStreamRequest(&stream, "second", buildLevel, prepareLevel, &second),
+              "Expected the second level requested");
+    bool switched = false;
+    while (!switched) {
+        MU_ASSERT(LevelStreamActive(&stream) == active,
+                  "Expected the first level active until the switch");
+        MU_ASSERT(AssetsGetSpriteId("first") != NULL_SPRITE &&
+                      AssetsGetSpriteId("second") == NULL_SPRITE,
+                  "Expected the first level's assets until the switch");
+        switched = LevelStreamUpdate(&stream);
+        sched_yield();
+    }
+    active = LevelStreamActive(&stream);
+    MU_ASSERT(strcmp(active->name, "second") == 0, "Expected the second level active");
+    MU_ASSERT(AssetsGetSpriteId("first") == NULL_SPRITE &&
+                  AssetsGetSpriteId("second") != NULL_SPRITE,
+              "Expected the second level's assets");
+    MU_ASSERT(stream.slots[0].assets == NULL && stream.slots[0].world == NULL,
+              "Expected the first level's slot cleared");
+
+    // the shared texture was loaded once and outlived the first level's set
+    MU_ASSERT_FMT(headlessTexturesLoaded == 2, "Expected 2 textures, but got %d",
+                  headlessTexturesLoaded);
+    Texture2D texture = AssetsGetSpriteTexture(AssetsGetSpriteId("floor"));
+    MU_ASSERT_FMT(texture.id == sharedTexture.id,
+                  "Expected the shared texture %u, but got %u", sharedTexture.id,
+                  texture.id);
+
+    LevelStreamDestroy(&stream);
+    MU_ASSERT_FMT(headlessTexturesLoaded == 0, "Expected no textures, but got %d",
+                  headlessTexturesLoaded);
+
+    MU_PASS;
+}
+
+static char *testFailed(void) {
+    LevelStream stream;
+    TestLevel first = {.sheet = "first", .buildOk = true, .prepareOk = true};
+    TestLevel broken = {.sheet = "missing", .buildOk = true, .prepareOk = true};
+    TestLevel unprepared = {.sheet = "second", .buildOk = true, .prepareOk = false};
+    TestLevel second = {.sheet = "second", .buildOk = true, .prepareOk = true};
+
+    LevelStreamInit(&stream);
+    MU_ASSERT(LevelStreamRequest(&stream, "first", buildLevel, prepareLevel, &first),
+              "Expected the first level requested");
+    MU_ASSERT(finishLevel(&stream), "Expected the first level switched to");
+    LevelSlot *active = LevelStreamActive(&stream);
+
+    // a level whose assets are missing, and one failing on the main thread,
+    // are thrown away and the active one goes on
+    MU_ASSERT(LevelStreamRequest(&stream, "broken", buildLevel, prepareLevel, &broken),
+              "Expected the broken level requested");
+    MU_ASSERT(!finishLevel(&stream), "Expected no switch to the broken level");
+    MU_ASSERT(LevelStreamRequest(&stream, "unprepared", buildLevel, prepareLevel,
+                                 &unprepared),
+              "Expected the unprepared level requested");
+    MU_ASSERT(!finishLevel(&stream), "Expected no switch to the unprepared level");
+
+    MU_ASSERT(LevelStreamActive(&stream) == active, "Expected the first level active");
+    MU_ASSERT(AssetsGetSpriteId("first") != NULL_SPRITE &&
+                  ComponentGet(first.map, COMP_MAPRENDER) != NULL,
+              "Expected the first level's assets and world current");
+    LevelSlot *next = &stream.slots[1 - active->index];
+    MU_ASSERT(next->assets == NULL && next->world == NULL,
+              "Expected the failed level's slot cleared");
+    MU_ASSERT_FMT(headlessTexturesLoaded == 2, "Expected 2 textures, but got %d",
+                  headlessTexturesLoaded);
+
+    // the slot is free for the next request
+    MU_ASSERT(LevelStreamRequest(&stream, "second", buildLevel, prepareLevel, &second),
+              "Expected the second level requested");
+    MU_ASSERT(finishLevel(&stream), "Expected the second level switched to");
+
+    LevelStreamDestroy(&stream);
+    MU_ASSERT_FMT(headlessTexturesLoaded == 0, "Expected no textures, but got %d",
+                  headlessTexturesLoaded);
+
+    MU_PASS;
+}
+
+static char *testDestroyWhileLoading(void) {
+    LevelStream stream;
+    TestLevel first = {.sheet = "first", .buildOk = true, .prepareOk = true};
+    TestLevel second = {
+        .sheet = "second", .buildOk = true, .prepareOk = true, .delayMs = 20};
+
+    LevelStreamInit(&stream);
+    MU_ASSERT(LevelStreamRequest(&stream, "first", buildLevel, prepareLevel, &first),
+              "Expected the first level requested");
+    MU_ASSERT(finishLevel(&stream), "Expected the first level switched to");
+
+    // the loader is still building when the stream goes away, it's waited for
+    // and both levels are released
+    MU_ASSERT(LevelStreamRequest(&stream, "second", buildLevel, prepareLevel, &second),
+              "Expected the second level requested");
+    while (!atomic_load(&second.started)) {
+        sched_yield();
+    }
+    LevelStreamDestroy(&stream);
+
+    MU_ASSERT(!stream.loaderRunning && !LevelStreamBusy(&stream),
+              "Expected the loader joined");
+    MU_ASSERT(LevelStreamActive(&stream) == NULL, "Expected no level active");
+    for (int i = 0; i < LEVEL_SLOTS; ++i) {
+        MU_ASSERT_FMT(stream.slots[i].assets == NULL && stream.slots[i].world == NULL,
+                      "Expected slot %d cleared", i);
+    }
+    MU_ASSERT(AssetSetGet() == NULL && EcsWorldGet() == NULL,
+              "Expected no set or world current");
+    MU_ASSERT_FMT(headlessTexturesLoaded == 0, "Expected no textures, but got %d",
+                  headlessTexturesLoaded);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    RenderRecorder recorder;
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+
+    MU_ASSERT(writeTestAssets() == 0, "Expected the test assets written");
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    RenderRecorderInit(&recorder, &arena, 64);
+    RenderSetRecorder(&recorder);
+
+    MU_TEST(testStreamWhileActive);
+    MU_TEST(testFailed);
+    MU_TEST(testDestroyWhileLoading);
+
+    RenderSetRecorder(NULL);
+    FixtureDirRemove();
+    MU_PASS;
+}
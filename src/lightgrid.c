@@ -0,0 +1,288 @@
+#include "lightgrid.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+int LightGridInit(LightGrid *grid, Arena *arena, const CollisionGrid *walls,
+                  int maxLights, int maxRadius) {
+    int pad = 2 * maxRadius + 3;
+
+    memset(grid, 0, sizeof(*grid));
+    grid->width = walls->width;
+    grid->height = walls->height;
+    grid->walls = walls;
+    grid->maxLights = maxLights;
+    grid->maxRadius = maxRadius;
+
+    grid->lights = ArenaAlloc(arena, sizeof(Light) * maxLights);
+    for (int i = 0; i < maxLights; ++i) {
+        grid->lights[i].levels = ArenaAlloc(arena, (size_t)pad * pad);
+    }
+    grid->pixels = ArenaAlloc(arena, (size_t)grid->width * grid->height * 4);
+    grid->window = ArenaAlloc(arena, (size_t)pad * pad);
+    grid->queue = ArenaAlloc(arena, sizeof(int) * pad * pad);
+
+    // distance of every window tile to the light in the middle
+    grid->distance = ArenaAlloc(arena, sizeof(float) * pad * pad);
+    for (int y = 0; y < pad; ++y) {
+        for (int x = 0; x < pad; ++x) {
+            int dx = x - maxRadius - 1, dy = y - maxRadius - 1;
+            grid->distance[y * pad + x] = sqrtf((float)(dx * dx + dy * dy));
+        }
+    }
+
+    // everything starts dark, the first update paints the ambient light
+    grid->dirty = true;
+    grid->dirtyX0 = 0;
+    grid->dirtyY0 = 0;
+    grid->dirtyX1 = grid->width - 1;
+    grid->dirtyY1 = grid->height - 1;
+
+    return grid->distance == NULL;
+}
+
+void LightGridSetAmbient(LightGrid *grid, uint8_t r, uint8_t g, uint8_t b) {
+    grid->ambient[0] = r;
+    grid->ambient[1] = g;
+    grid->ambient[2] = b;
+    grid->dirty = true;
+    grid->dirtyX0 = 0;
+    grid->dirtyY0 = 0;
+    grid->dirtyX1 = grid->width - 1;
+    grid->dirtyY1 = grid->height - 1;
+}
+
+static void markDirty(LightGrid *grid, int x, int y) {
+    int r = grid->maxRadius;
+    int x0 = x - r < 0 ? 0 : x - r;
+    int y0 = y - r < 0 ? 0 : y - r;
+    int x1 = x + r >= grid->width ? grid->width - 1 : x + r;
+    int y1 = y + r >= grid->height ? grid->height - 1 : y + r;
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    if (!grid->dirty) {
+        grid->dirty = true;
+        grid->dirtyX0 = x0;
+        grid->dirtyY0 = y0;
+        grid->dirtyX1 = x1;
+        grid->dirtyY1 = y1;
+        return;
+    }
+    grid->dirtyX0 = x0 < grid->dirtyX0 ? x0 : grid->dirtyX0;
+    grid->dirtyY0 = y0 < grid->dirtyY0 ? y0 : grid->dirtyY0;
+    grid->dirtyX1 = x1 > grid->dirtyX1 ? x1 : grid->dirtyX1;
+    grid->dirtyY1 = y1 > grid->dirtyY1 ? y1 : grid->dirtyY1;
+}
+
+int LightAdd(LightGrid *grid, int x, int y, int radius, uint8_t r, uint8_t g,
+             uint8_t b) {
+    assert(radius <= grid->maxRadius);
+
+    int light;
+    for (light = 0; light < grid->maxLights; ++light) {
+        if (!grid->lights[light].enabled)
+            break;
+    }
+    if (light >= grid->maxLights) {
+        return NULL_LIGHT;
+    }
+
+    Light *l = &grid->lights[light];
+    l->enabled = true;
+    l->changed = true;
+    l->lit = false;
+    l->x = x;
+    l->y = y;
+    l->radius = radius;
+    l->color[0] = r;
+    l->color[1] = g;
+    l->color[2] = b;
+
+    if (light >= grid->lightsCount) {
+        grid->lightsCount = light + 1;
+    }
+    return light;
+}
+
+void LightMove(LightGrid *grid, int light, int x, int y) {
+    Light *l = &grid->lights[light];
+    if (l->x == x && l->y == y) {
+        return;
+    }
+    l->x = x;
+    l->y = y;
+    l->changed = true;
+}
+
+void LightSetColor(LightGrid *grid, int light, uint8_t r, uint8_t g, uint8_t b) {
+    Light *l = &grid->lights[light];
+    l->color[0] = r;
+    l->color[1] = g;
+    l->color[2] = b;
+
+    // same tiles, only the mix changes
+    if (l->lit) {
+        markDirty(grid, l->litX, l->litY);
+    }
+}
+
+void LightRemove(LightGrid *grid, int light) {
+    Light *l = &grid->lights[light];
+    if (l->lit) {
+        markDirty(grid, l->litX, l->litY);
+    }
+    l->enabled = false;
+    l->lit = false;
+}
+
+// window around the light with a one tile border, what each tile does to light
+enum { TILE_OUTSIDE, TILE_WALL, TILE_OPEN };
+
+static void loadWindow(LightGrid *grid, const Light *light) {
+    int r = grid->maxRadius;
+    int pad = 2 * r + 3;
+
+    for (int ly = 0; ly < pad; ++ly) {
+        for (int lx = 0; lx < pad; ++lx) {
+            int wx = light->x + lx - r - 1, wy = light->y + ly - r - 1;
+            uint8_t tile = TILE_OUTSIDE;
+            if (lx > 0 && ly > 0 && lx < pad - 1 && ly < pad - 1 && wx >= 0 &&
+                wy >= 0 && wx < grid->width && wy < grid->height) {
+                tile = CollisionGridSolid(grid->walls, wx, wy) ? TILE_WALL : TILE_OPEN;
+            }
+            grid->window[ly * pad + lx] = tile;
+        }
+    }
+}
+
+static void floodLight(LightGrid *grid, Light *light) {
+    int r = grid->maxRadius;
+    int pad = 2 * r + 3;
+    float radius = (float)light->radius;
+    float falloff = 255.0f / (light->radius + 1);
+    uint8_t *levels = light->levels;
+    const uint8_t *window = grid->window;
+    int head = 0, tail = 0;
+
+    memset(levels, 0, (size_t)pad * pad);
+    loadWindow(grid, light);
+
+    // every lit tile has a level above zero, which doubles as the visited mark
+    int origin = (r + 1) * pad + r + 1;
+    levels[origin] = 255;
+    if (window[origin] == TILE_OPEN) {
+        grid->queue[tail++] = origin;
+    }
+
+    const int offsets[8] = {-pad - 1, -pad, -pad + 1, -1, 1, pad - 1, pad, pad + 1};
+    const int stepX[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    const int stepY[8] = {-pad, -pad, -pad, 0, 0, pad, pad, pad};
+    while (head < tail) {
+        int cell = grid->queue[head++];
+
+        for (int n = 0; n < 8; ++n) {
+            int next = cell + offsets[n];
+            if (window[next] == TILE_OUTSIDE || levels[next] != 0) {
+                continue;
+            }
+
+            // no squeezing diagonally between two walls
+            if (stepX[n] != 0 && stepY[n] != 0 &&
+                (window[cell + stepX[n]] != TILE_OPEN ||
+                 window[cell + stepY[n]] != TILE_OPEN)) {
+                continue;
+            }
+
+            float dist = grid->distance[next];
+            if (dist > radius) {
+                continue;
+            }
+            levels[next] = (uint8_t)(255.0f - dist * falloff);
+
+            // walls are lit but stop the light
+            if (window[next] == TILE_OPEN) {
+                grid->queue[tail++] = next;
+            }
+        }
+    }
+}
+
+static uint8_t addSaturate(uint8_t a, int b) {
+    int sum = a + b;
+    return sum > 255 ? 255 : (uint8_t)sum;
+}
+
+static void combineLights(LightGrid *grid) {
+    int x0 = grid->dirtyX0, y0 = grid->dirtyY0;
+    int x1 = grid->dirtyX1, y1 = grid->dirtyY1;
+    int r = grid->maxRadius;
+    int pad = 2 * r + 3;
+
+    for (int y = y0; y <= y1; ++y) {
+        uint8_t *pixel = &grid->pixels[((size_t)y * grid->width + x0) * 4];
+        for (int x = x0; x <= x1; ++x, pixel += 4) {
+            pixel[0] = grid->ambient[0];
+            pixel[1] = grid->ambient[1];
+            pixel[2] = grid->ambient[2];
+            pixel[3] = 255;
+        }
+    }
+
+    for (int i = 0; i < grid->lightsCount; ++i) {
+        Light *light = &grid->lights[i];
+        if (!light->enabled || !light->lit) {
+            continue;
+        }
+
+        // overlap of the light's square with the dirty rectangle
+        int lx0 = light->litX - r > x0 ? light->litX - r : x0;
+        int ly0 = light->litY - r > y0 ? light->litY - r : y0;
+        int lx1 = light->litX + r < x1 ? light->litX + r : x1;
+        int ly1 = light->litY + r < y1 ? light->litY + r : y1;
+
+        for (int y = ly0; y <= ly1; ++y) {
+            int row = (y - light->litY + r + 1) * pad;
+            const uint8_t *level = &light->levels[row + lx0 - light->litX + r + 1];
+            uint8_t *pixel = &grid->pixels[((size_t)y * grid->width + lx0) * 4];
+            for (int x = lx0; x <= lx1; ++x, ++level, pixel += 4) {
+                if (*level == 0) {
+                    continue;
+                }
+                pixel[0] = addSaturate(pixel[0], light->color[0] * *level / 255);
+                pixel[1] = addSaturate(pixel[1], light->color[1] * *level / 255);
+                pixel[2] = addSaturate(pixel[2], light->color[2] * *level / 255);
+            }
+        }
+    }
+}
+
+int LightGridUpdate(LightGrid *grid) {
+    int recomputed = 0;
+
+    for (int i = 0; i < grid->lightsCount; ++i) {
+        Light *light = &grid->lights[i];
+        if (!light->enabled || !light->changed) {
+            continue;
+        }
+
+        // both where the light was and where it is now need repainting
+        if (light->lit) {
+            markDirty(grid, light->litX, light->litY);
+        }
+        floodLight(grid, light);
+        light->lit = true;
+        light->litX = light->x;
+        light->litY = light->y;
+        light->changed = false;
+        markDirty(grid, light->x, light->y);
+        ++recomputed;
+    }
+
+    if (grid->dirty) {
+        combineLights(grid);
+    }
+    return recomputed;
+}
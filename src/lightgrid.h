@@ -0,0 +1,62 @@
+#ifndef LIGHTGRID_H
+#define LIGHTGRID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "collision.h"
+#include "utils.h"
+
+#define NULL_LIGHT -1
+
+typedef struct Light {
+    bool enabled;
+    bool changed;
+    int x, y;
+    int radius;
+    uint8_t color[3];
+
+    // tiles reached by the flood fill, (2 * maxRadius + 3)^2 levels with a
+    // one tile border, centered on where the light was last computed
+    bool lit;
+    int litX, litY;
+    uint8_t *levels;
+} Light;
+
+// Tile resolution light map, walls stop the light from spreading
+typedef struct LightGrid {
+    int width, height;
+    const CollisionGrid *walls;
+    uint8_t ambient[3];
+
+    Light *lights;
+    int lightsCount, maxLights;
+    int maxRadius;
+
+    // RGBA per tile, rewritten only inside the dirty rectangle. Whoever
+    // uploads the pixels clears dirty
+    uint8_t *pixels;
+    bool dirty;
+    int dirtyX0, dirtyY0, dirtyX1, dirtyY1;
+
+    // flood fill scratch
+    float *distance;
+    uint8_t *window;
+    int *queue;
+} LightGrid;
+
+int LightGridInit(LightGrid *grid, Arena *arena, const CollisionGrid *walls,
+                  int maxLights, int maxRadius);
+void LightGridSetAmbient(LightGrid *grid, uint8_t r, uint8_t g, uint8_t b);
+
+int LightAdd(LightGrid *grid, int x, int y, int radius, uint8_t r, uint8_t g,
+             uint8_t b);
+void LightMove(LightGrid *grid, int light, int x, int y);
+void LightSetColor(LightGrid *grid, int light, uint8_t r, uint8_t g, uint8_t b);
+void LightRemove(LightGrid *grid, int light);
+
+// recomputes the lights that moved and repaints the tiles they touched,
+// returns the number of lights recomputed
+int LightGridUpdate(LightGrid *grid);
+
+#endif // !LIGHTGRID_H
@@ -0,0 +1,84 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "collision.c"
+#include "lightgrid.c"
+#include "lightgrid.h"
+#include "utils.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAP_SIZE     256
+#define LIGHTS       200
+#define LIGHT_RADIUS 12
+#define BENCH_TICKS  600
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void bench(LightGrid *grid, int moving) {
+    double total = 0.0, worst = 0.0;
+    long recomputed = 0;
+
+    for (int tick = 0; tick < BENCH_TICKS; ++tick) {
+        // wander one tile per tick, bouncing off the map border
+        for (int i = 0; i < moving; ++i) {
+            Light *light = &grid->lights[i];
+            int x = light->x + rand() % 3 - 1;
+            int y = light->y + rand() % 3 - 1;
+            x = x < 0 ? 0 : x >= MAP_SIZE ? MAP_SIZE - 1 : x;
+            y = y < 0 ? 0 : y >= MAP_SIZE ? MAP_SIZE - 1 : y;
+            LightMove(grid, i, x, y);
+        }
+
+        double start = nowMs();
+        recomputed += LightGridUpdate(grid);
+        double elapsed = nowMs() - start;
+        grid->dirty = false;
+
+        total += elapsed;
+        worst = elapsed > worst ? elapsed : worst;
+    }
+
+    printf("%3d/%d moving: %6.1f recomputed/tick  mean %7.3f ms  worst %7.3f ms\n",
+           moving, LIGHTS, (double)recomputed / BENCH_TICKS, total / BENCH_TICKS,
+           worst);
+}
+
+int main(void) {
+    Arena arena;
+    CollisionGrid walls;
+    LightGrid grid;
+
+    ArenaInit(&arena, malloc(Megabyte(4)), Megabyte(4));
+    CollisionGridInit(&walls, &arena, MAP_SIZE, MAP_SIZE, 32.0f, 32.0f);
+    srand(42);
+    for (int y = 0; y < MAP_SIZE; ++y) {
+        for (int x = 0; x < MAP_SIZE; ++x) {
+            CollisionGridSet(&walls, x, y, rand() % 100 < 15);
+        }
+    }
+
+    LightGridInit(&grid, &arena, &walls, LIGHTS, LIGHT_RADIUS);
+    LightGridSetAmbient(&grid, 20, 20, 30);
+    for (int i = 0; i < LIGHTS; ++i) {
+        LightAdd(&grid, rand() % MAP_SIZE, rand() % MAP_SIZE, LIGHT_RADIUS,
+                 rand() % 256, rand() % 256, rand() % 256);
+    }
+
+    double start = nowMs();
+    LightGridUpdate(&grid);
+    printf("Light grid %dx%d, %d lights of radius %d, first update %.3f ms\n",
+           MAP_SIZE, MAP_SIZE, LIGHTS, LIGHT_RADIUS, nowMs() - start);
+    grid.dirty = false;
+
+    bench(&grid, LIGHTS);
+    bench(&grid, LIGHTS / 10);
+    bench(&grid, 0);
+
+    free(arena.buff);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "minunit.h"
+#include "collision.c"
+#include "lightgrid.c"
+#include "lightgrid.h"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testWallShadow(void);
+static char *testIncremental(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static uint8_t red(const LightGrid *grid, int x, int y) {
+    return grid->pixels[(y * grid->width + x) * 4];
+}
+
+static char *testWallShadow(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    CollisionGrid walls;
+    LightGrid grid;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&walls, &arena, 16, 16, 32.0f, 32.0f);
+    for (int y = 0; y < 16; ++y) {
+        CollisionGridSet(&walls, 5, y, true);
+    }
+    LightGridInit(&grid, &arena, &walls, 4, 6);
+    LightGridSetAmbient(&grid, 10, 10, 10);
+    LightAdd(&grid, 2, 4, 6, 200, 0, 0);
+    LightGridUpdate(&grid);
+
+    MU_ASSERT_FMT(210 == red(&grid, 2, 4), "Expected light center %d, but got %d", 210,
+                  red(&grid, 2, 4));
+    MU_ASSERT(red(&grid, 4, 4) > 10, "Expected the tile before the wall to be lit");
+    MU_ASSERT(red(&grid, 5, 4) > 10, "Expected the wall itself to be lit");
+    MU_ASSERT_FMT(10 == red(&grid, 7, 4), "Expected shadow %d, but got %d", 10,
+                  red(&grid, 7, 4));
+    MU_ASSERT_FMT(10 == red(&grid, 2, 12), "Expected out of range %d, but got %d", 10,
+                  red(&grid, 2, 12));
+
+    MU_PASS;
+}
+
+static char *testIncremental(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    CollisionGrid walls;
+    LightGrid grid;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&walls, &arena, 32, 16, 32.0f, 32.0f);
+    LightGridInit(&grid, &arena, &walls, 4, 4);
+    int a = LightAdd(&grid, 3, 3, 4, 100, 100, 100);
+    LightAdd(&grid, 20, 10, 4, 100, 100, 100);
+
+    int recomputed = LightGridUpdate(&grid);
+    MU_ASSERT_FMT(2 == recomputed, "Expected %d recomputed, but got %d", 2, recomputed);
+    grid.dirty = false;
+
+    // moving within the same tile changes nothing
+    LightMove(&grid, a, 3, 3);
+    recomputed = LightGridUpdate(&grid);
+    MU_ASSERT_FMT(0 == recomputed, "Expected %d recomputed, but got %d", 0, recomputed);
+    MU_ASSERT(!grid.dirty, "Expected nothing to repaint");
+
+    // only the old and new squares of the moved light are repainted
+    LightMove(&grid, a, 5, 3);
+    recomputed = LightGridUpdate(&grid);
+    MU_ASSERT_FMT(1 == recomputed, "Expected %d recomputed, but got %d", 1, recomputed);
+    MU_ASSERT_FMT(9 == grid.dirtyX1, "Expected dirty right edge %d, but got %d", 9,
+                  grid.dirtyX1);
+    MU_ASSERT_FMT(0 == red(&grid, 0, 3), "Expected dark tile %d, but got %d", 0,
+                  red(&grid, 0, 3));
+    MU_ASSERT_FMT(100 == red(&grid, 5, 3), "Expected light center %d, but got %d", 100,
+                  red(&grid, 5, 3));
+
+    LightRemove(&grid, a);
+    LightGridUpdate(&grid);
+    MU_ASSERT_FMT(0 == red(&grid, 5, 3), "Expected removed light %d, but got %d", 0,
+                  red(&grid, 5, 3));
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testWallShadow);
+    MU_TEST(testIncremental);
+
+    MU_PASS;
+}
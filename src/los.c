@@ -0,0 +1,166 @@
+#include "los.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORD_BITS 64
+
+int LosGridInit(LosGrid *los, Arena *arena, const CollisionGrid *walls, int cacheBits) {
+    assert(0 <= cacheBits && cacheBits < 32);
+
+    size_t words = ((size_t)walls->width * walls->height + WORD_BITS - 1) / WORD_BITS;
+    memset(los, 0, sizeof(*los));
+    los->walls = walls;
+    los->width = walls->width;
+    los->height = walls->height;
+    los->cacheBits = cacheBits;
+    los->columns = ArenaAlloc(arena, sizeof(uint64_t) * words);
+    if (cacheBits > 0) {
+        los->cache = ArenaAlloc(arena, sizeof(uint64_t) << cacheBits);
+        if (los->cache == NULL) {
+            return 1;
+        }
+    }
+    if (los->columns == NULL) {
+        return 1;
+    }
+
+    LosGridUpdate(los);
+    return 0;
+}
+
+void LosGridUpdate(LosGrid *los) {
+    size_t words = ((size_t)los->width * los->height + WORD_BITS - 1) / WORD_BITS;
+    memset(los->columns, 0, sizeof(uint64_t) * words);
+    if (los->cache != NULL) {
+        memset(los->cache, 0, sizeof(uint64_t) << los->cacheBits);
+    }
+
+    // column x is bits x * height to x * height + height - 1
+    for (int y = 0; y < los->height; ++y) {
+        for (int x = 0; x < los->width; ++x) {
+            if (CollisionGridSolid(los->walls, x, y)) {
+                size_t bit = (size_t)x * los->height + y;
+                los->columns[bit / WORD_BITS] |= (uint64_t)1 << (bit % WORD_BITS);
+            }
+        }
+    }
+}
+
+// any bit set in [first, last]
+static bool spanSolid(const uint64_t *words, size_t first, size_t last) {
+    size_t w0 = first / WORD_BITS, w1 = last / WORD_BITS;
+    uint64_t lowMask = ~(uint64_t)0 << (first % WORD_BITS);
+    uint64_t highMask = ~(uint64_t)0 >> (WORD_BITS - 1 - last % WORD_BITS);
+
+    if (w0 == w1) {
+        return (words[w0] & lowMask & highMask) != 0;
+    }
+    if (words[w0] & lowMask) {
+        return true;
+    }
+    for (size_t w = w0 + 1; w < w1; ++w) {
+        if (words[w] != 0) {
+            return true;
+        }
+    }
+    return (words[w1] & highMask) != 0;
+}
+
+// The DDA one row at a time, for lines at most 45 degrees off the rows. In
+// units of 1 / (2 * dy) the line crosses row boundary Y at
+// (2 * ax + 1) * dy + (2 * (Y - ay) - 1) * dx, so each row's span of tiles is
+// exact. A span ending on a tile border takes the tile past it too
+static bool walkRows(const uint64_t *bits, int stride, int ax, int ay, int bx,
+                     int by) {
+    if (ay > by) {
+        int swap = ax;
+        ax = bx;
+        bx = swap;
+        swap = ay;
+        ay = by;
+        by = swap;
+    }
+
+    int dx = bx - ax, dy = by - ay;
+    if (dy == 0) {
+        int x0 = ax < bx ? ax : bx, x1 = ax < bx ? bx : ax;
+        return !spanSolid(bits, (size_t)ay * stride + x0, (size_t)ay * stride + x1);
+    }
+
+    int den = 2 * dy;
+    int from = (2 * ax + 1) * dy;
+    int to = from + dx;
+    for (int y = ay; y <= by; ++y) {
+        if (y == by) {
+            to = (2 * bx + 1) * dy;
+        }
+
+        int lo = from < to ? from : to, hi = from < to ? to : from;
+        int x0 = lo % den == 0 ? lo / den - 1 : lo / den;
+        int x1 = hi / den;
+        if (spanSolid(bits, (size_t)y * stride + x0, (size_t)y * stride + x1)) {
+            return false;
+        }
+
+        from = to;
+        to += 2 * dx;
+    }
+    return true;
+}
+
+static bool walk(const LosGrid *los, int ax, int ay, int bx, int by) {
+    if (abs(bx - ax) >= abs(by - ay)) {
+        return walkRows(los->walls->solid, los->width, ax, ay, bx, by);
+    }
+    // steep lines are shallow ones in the transposed grid
+    return walkRows(los->columns, los->height, ay, ax, by, bx);
+}
+
+bool LosVisible(LosGrid *los, int ax, int ay, int bx, int by) {
+    assert(0 <= ax && ax < los->width && 0 <= ay && ay < los->height);
+    assert(0 <= bx && bx < los->width && 0 <= by && by < los->height);
+
+    int dx = abs(bx - ax), dy = abs(by - ay);
+    int spans = (dx < dy ? dx : dy) + 1;
+    if (los->cache == NULL || spans < LOS_CACHE_MIN_SPANS) {
+        ++los->walks;
+        return walk(los, ax, ay, bx, by);
+    }
+
+    // the same tiles either way, so both directions share an entry. Keys
+    // are stored plus one, zero is an empty entry
+    uint64_t a = (uint64_t)ay * los->width + ax;
+    uint64_t b = (uint64_t)by * los->width + bx;
+    uint64_t tiles = (uint64_t)los->width * los->height;
+    uint64_t key = a < b ? a * tiles + b : b * tiles + a;
+    uint64_t slot = (key * 0x9E3779B97F4A7C15ull) >> (64 - los->cacheBits);
+    uint64_t *entry = &los->cache[slot];
+    if (*entry >> 1 == key + 1) {
+        ++los->cacheHits;
+        return *entry & 1;
+    }
+
+    ++los->walks;
+    bool visible = walk(los, ax, ay, bx, by);
+    *entry = (key + 1) << 1 | visible;
+    return visible;
+}
+
+int LosQueryBatch(LosGrid *los, const LosQuery *queries, int count, uint64_t *visible) {
+    int visibleCount = 0;
+
+    for (int first = 0; first < count; first += WORD_BITS) {
+        int last = first + WORD_BITS < count ? first + WORD_BITS : count;
+        uint64_t word = 0;
+        for (int i = first; i < last; ++i) {
+            const LosQuery *q = &queries[i];
+            uint64_t seen = LosVisible(los, q->ax, q->ay, q->bx, q->by);
+            word |= seen << (i - first);
+        }
+        visible[first / WORD_BITS] = word;
+        visibleCount += __builtin_popcountll(word);
+    }
+    return visibleCount;
+}
@@ -0,0 +1,50 @@
+#ifndef LOS_H
+#define LOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "collision.h"
+#include "utils.h"
+
+// lines crossing fewer rows or columns than this are walked, cheaper than
+// a cache lookup
+#define LOS_CACHE_MIN_SPANS 4
+
+// Line of sight between tile centers over the solid cells of a collision
+// grid. A copy of its bitset is transposed so steep lines walk columns, every
+// line is walked as spans of its shorter axis tested a word at a time
+typedef struct LosGrid {
+    const CollisionGrid *walls;
+    int width, height;
+    uint64_t *columns;
+
+    // results of long lines by tile pair, direct mapped. Thrown away with
+    // LosGridUpdate, the walls are taken as static until then
+    uint64_t *cache;
+    int cacheBits;
+
+    long walks, cacheHits;
+} LosGrid;
+
+typedef struct LosQuery {
+    int ax, ay;
+    int bx, by;
+} LosQuery;
+
+// 1 << cacheBits cached pairs, none with cacheBits 0
+int LosGridInit(LosGrid *los, Arena *arena, const CollisionGrid *walls, int cacheBits);
+
+// after the walls changed
+void LosGridUpdate(LosGrid *los);
+
+// Tiles see each other when no solid tile touches the line between their
+// centers, the two tiles included. Passing exactly through a corner needs
+// both tiles beside it open
+bool LosVisible(LosGrid *los, int ax, int ay, int bx, int by);
+
+// Sets bit i of visible, (count + 63) / 64 words, when query i is visible.
+// Returns how many are
+int LosQueryBatch(LosGrid *los, const LosQuery *queries, int count, uint64_t *visible);
+
+#endif // !LOS_H
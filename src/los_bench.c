@@ -0,0 +1,101 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "collision.c"
+#include "los.c"
+#include "los.h"
+#include "utils.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAP_SIZE    256
+#define QUERIES     100000
+#define SIGHT_RANGE 24
+#define CACHE_BITS  18
+#define BENCH_TICKS 100
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int clampTile(int v) {
+    return v < 0 ? 0 : v >= MAP_SIZE ? MAP_SIZE - 1 : v;
+}
+
+// watchers and what they look at, within sight range of each other
+static void makeQueries(LosQuery *queries) {
+    for (int i = 0; i < QUERIES; ++i) {
+        int ax = rand() % MAP_SIZE, ay = rand() % MAP_SIZE;
+        int bx = ax + rand() % (2 * SIGHT_RANGE + 1) - SIGHT_RANGE;
+        int by = ay + rand() % (2 * SIGHT_RANGE + 1) - SIGHT_RANGE;
+        queries[i] = (LosQuery){ax, ay, clampTile(bx), clampTile(by)};
+    }
+}
+
+static void bench(const char *name, LosGrid *los, LosQuery *queries, bool moving,
+                  uint64_t *visible) {
+    double total = 0.0, worst = 0.0;
+    long seen = 0;
+    los->walks = 0;
+    los->cacheHits = 0;
+
+    for (int tick = 0; tick < BENCH_TICKS; ++tick) {
+        // a tenth of the watchers take a step every tick
+        for (int i = 0; moving && i < QUERIES / 10; ++i) {
+            LosQuery *q = &queries[rand() % QUERIES];
+            q->ax = clampTile(q->ax + rand() % 3 - 1);
+            q->ay = clampTile(q->ay + rand() % 3 - 1);
+        }
+
+        double start = nowMs();
+        seen += LosQueryBatch(los, queries, QUERIES, visible);
+        double elapsed = nowMs() - start;
+
+        total += elapsed;
+        worst = elapsed > worst ? elapsed : worst;
+    }
+
+    long queried = (long)QUERIES * BENCH_TICKS;
+    printf("%-22s mean %7.3f ms  worst %7.3f ms  %5.1f ns/query  %4.1f%% visible  "
+           "%4.1f%% cached\n",
+           name, total / BENCH_TICKS, worst, total * 1e6 / queried,
+           100.0 * seen / queried, 100.0 * los->cacheHits / queried);
+}
+
+int main(void) {
+    Arena arena;
+    CollisionGrid walls;
+    LosGrid los, cached;
+
+    ArenaInit(&arena, malloc(Megabyte(4)), Megabyte(4));
+    CollisionGridInit(&walls, &arena, MAP_SIZE, MAP_SIZE, 32.0f, 32.0f);
+    srand(42);
+    for (int y = 0; y < MAP_SIZE; ++y) {
+        for (int x = 0; x < MAP_SIZE; ++x) {
+            CollisionGridSet(&walls, x, y, rand() % 100 < 15);
+        }
+    }
+    LosGridInit(&los, &arena, &walls, 0);
+    LosGridInit(&cached, &arena, &walls, CACHE_BITS);
+
+    LosQuery *queries = malloc(sizeof(LosQuery) * QUERIES);
+    uint64_t *visible = malloc(sizeof(uint64_t) * (QUERIES + 63) / 64);
+    printf("Line of sight %dx%d, %d queries per tick up to %d tiles apart\n",
+           MAP_SIZE, MAP_SIZE, QUERIES, SIGHT_RANGE);
+
+    srand(7);
+    makeQueries(queries);
+    bench("walked, still", &los, queries, false, visible);
+    bench("walked, moving", &los, queries, true, visible);
+    srand(7);
+    makeQueries(queries);
+    bench("cached, still", &cached, queries, false, visible);
+    bench("cached, moving", &cached, queries, true, visible);
+
+    free(visible);
+    free(queries);
+    free(arena.buff);
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include "minunit.h"
+#include "collision.c"
+#include "los.c"
+#include "los.h"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testWalls(void);
+static char *testCorners(void);
+static char *testBruteForce(void);
+static char *testBatchAndCache(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static char *testWalls(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    CollisionGrid walls;
+    LosGrid los;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&walls, &arena, 16, 8, 32.0f, 32.0f);
+    for (int y = 0; y < 6; ++y) {
+        CollisionGridSet(&walls, 8, y, true);
+    }
+    LosGridInit(&los, &arena, &walls, 0);
+
+    MU_ASSERT(LosVisible(&los, 2, 3, 2, 3), "Expected a tile to see itself");
+    MU_ASSERT(LosVisible(&los, 0, 0, 7, 5), "Expected open tiles to see each other");
+    MU_ASSERT(!LosVisible(&los, 2, 3, 12, 3), "Expected the wall to block");
+    MU_ASSERT(!LosVisible(&los, 12, 0, 2, 5), "Expected the wall to block");
+    MU_ASSERT(LosVisible(&los, 2, 7, 14, 6), "Expected to see below the wall");
+    MU_ASSERT(!LosVisible(&los, 8, 2, 8, 7), "Expected nothing to see out of a wall");
+
+    // steep lines walk the transposed grid
+    CollisionGridSet(&walls, 3, 4, true);
+    LosGridUpdate(&los);
+    MU_ASSERT(!LosVisible(&los, 3, 0, 4, 7), "Expected the steep line to be blocked");
+    MU_ASSERT(LosVisible(&los, 2, 0, 2, 7), "Expected the column beside it open");
+
+    MU_PASS;
+}
+
+static char *testCorners(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    CollisionGrid walls;
+    LosGrid los;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&walls, &arena, 8, 8, 32.0f, 32.0f);
+    LosGridInit(&los, &arena, &walls, 0);
+
+    // the diagonal from 1,1 to 3,3 goes through the corners at 2,2 and 3,3
+    CollisionGridSet(&walls, 2, 1, true);
+    LosGridUpdate(&los);
+    MU_ASSERT(!LosVisible(&los, 1, 1, 3, 3),
+              "Expected one wall beside a corner to block");
+    MU_ASSERT(!LosVisible(&los, 3, 3, 1, 1), "Expected the same both ways");
+    MU_ASSERT(LosVisible(&los, 1, 2, 3, 4), "Expected the diagonal below to be open");
+
+    MU_PASS;
+}
+
+// Whether the segment between the tile centers touches tile x, y, in twice
+// the tile coordinates so every point is an integer
+static bool touches(int ax, int ay, int bx, int by, int x, int y) {
+    int px = 2 * ax + 1, py = 2 * ay + 1, qx = 2 * bx + 1, qy = 2 * by + 1;
+    int x0 = 2 * x, y0 = 2 * y, x1 = x0 + 2, y1 = y0 + 2;
+    if ((px < x0 && qx < x0) || (px > x1 && qx > x1) || (py < y0 && qy < y0) ||
+        (py > y1 && qy > y1)) {
+        return false;
+    }
+
+    // the tile's corners all strictly on one side of the line miss it
+    int cornersX[4] = {x0, x1, x0, x1}, cornersY[4] = {y0, y0, y1, y1};
+    int above = 0, below = 0;
+    for (int i = 0; i < 4; ++i) {
+        int cross = (qx - px) * (cornersY[i] - py) - (qy - py) * (cornersX[i] - px);
+        above += cross > 0;
+        below += cross < 0;
+    }
+    return above < 4 && below < 4;
+}
+
+static char *testBruteForce(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    CollisionGrid walls;
+    LosGrid los;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&walls, &arena, 24, 20, 32.0f, 32.0f);
+    srand(7);
+    for (int y = 0; y < 20; ++y) {
+        for (int x = 0; x < 24; ++x) {
+            CollisionGridSet(&walls, x, y, rand() % 100 < 12);
+        }
+    }
+    LosGridInit(&los, &arena, &walls, 0);
+
+    for (int i = 0; i < 4000; ++i) {
+        int ax = rand() % 24, ay = rand() % 20, bx = rand() % 24, by = rand() % 20;
+        bool expected = true;
+        for (int y = 0; y < 20 && expected; ++y) {
+            for (int x = 0; x < 24 && expected; ++x) {
+                expected = !(CollisionGridSolid(&walls, x, y) &&
+                             touches(ax, ay, bx, by, x, y));
+            }
+        }
+        bool visible = LosVisible(&los, ax, ay, bx, by);
+        MU_ASSERT_FMT(expected == visible,
+                      "Expected %d from %d,%d to %d,%d, but got %d", expected, ax, ay,
+                      bx, by, visible);
+    }
+
+    MU_PASS;
+}
+
+static char *testBatchAndCache(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    CollisionGrid walls;
+    LosGrid los, cached;
+    LosQuery queries[100];
+    uint64_t visible[2], visibleCached[2];
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&walls, &arena, 32, 32, 32.0f, 32.0f);
+    srand(11);
+    for (int y = 0; y < 32; ++y) {
+        for (int x = 0; x < 32; ++x) {
+            CollisionGridSet(&walls, x, y, rand() % 100 < 10);
+        }
+    }
+    LosGridInit(&los, &arena, &walls, 0);
+    LosGridInit(&cached, &arena, &walls, 10);
+    for (int i = 0; i < 100; ++i) {
+        queries[i] = (LosQuery){rand() % 32, rand() % 32, rand() % 32, rand() % 32};
+    }
+
+    int count = LosQueryBatch(&los, queries, 100, visible);
+    int expected = 0;
+    for (int i = 0; i < 100; ++i) {
+        bool bit = (visible[i / 64] >> (i % 64)) & 1;
+        MU_ASSERT_FMT(bit == LosVisible(&los, queries[i].ax, queries[i].ay,
+                                        queries[i].bx, queries[i].by),
+                      "Wrong bit for query %d", i);
+        expected += bit;
+    }
+    MU_ASSERT_FMT(expected == count, "Expected %d visible, but got %d", expected,
+                  count);
+    MU_ASSERT(visible[1] >> 36 == 0, "Expected no bits past the last query");
+
+    // the second batch is answered from the cache, with the same results
+    LosQueryBatch(&cached, queries, 100, visibleCached);
+    long walks = cached.walks;
+    LosQueryBatch(&cached, queries, 100, visibleCached);
+    MU_ASSERT(visible[0] == visibleCached[0] && visible[1] == visibleCached[1],
+              "Expected the cache to give the same results");
+    MU_ASSERT(cached.cacheHits > 0, "Expected cache hits");
+    MU_ASSERT(cached.walks - walks < 100, "Expected fewer walks the second time");
+
+    // reversed pairs share their entries, changed walls clear them
+    LosQuery reversed = {queries[0].bx, queries[0].by, queries[0].ax, queries[0].ay};
+    LosQueryBatch(&cached, &reversed, 1, visibleCached);
+    MU_ASSERT((visibleCached[0] & 1) == (visible[0] & 1), "Expected the same reversed");
+    LosGridUpdate(&cached);
+    long hits = cached.cacheHits;
+    LosQueryBatch(&cached, queries, 100, visibleCached);
+    MU_ASSERT_FMT(hits == cached.cacheHits, "Expected no hits after an update, got %ld",
+                  cached.cacheHits - hits);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testWalls);
+    MU_TEST(testCorners);
+    MU_TEST(testBruteForce);
+    MU_TEST(testBatchAndCache);
+
+    MU_PASS;
+}
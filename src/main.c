@@ -1,138 +1,662 @@
+#include <sched.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "assets.h"
 #include "ecs.h"
+#include "events.h"
+#include "input.h"
+#include "level.h"
+#include "los.h"
+#include "prefab.h"
 #include "utils.h"
 #include "raylib.h"
 #include "raymath.h"
 
+#define MAX_PROJECTILES  2048
+#define MAX_TARGETS      64
+#define FIRE_INTERVAL    0.1f
+#define BULLET_SPEED     900.0f
+#define BULLET_LIFETIME  1.5f
+#define MAX_LIGHTS       32
+#define LIGHT_RADIUS     8
+#define VISIBILITY_CELL  256.0f
+#define ZOMBIE_HEALTH    5
+#define EVENT_RING_SIZE  1024
+#define LEVEL_ARENA_SIZE Kilobyte(768)
+#define LOS_CACHE_BITS   12
+
+// --bench measures this many frames, after warming caches and drivers up
+#define BENCH_FRAMES      1800
+#define BENCH_WARMUP      120
+#define BENCH_MAX_SPRITES 3000
+
+// Game side component, registered at startup
+typedef struct HealthComp {
+    bool enabled;
+
+    int hitPoints;
+} HealthComp;
+
+// What the gameplay event handlers work on
+typedef struct GameplayEvents {
+    EventRing *ring;
+    CommandBuffer *commands;
+    CompType compHealth;
+    ParticlePool *particles;
+    ParticleEmitter *dust;
+    ParticleEmitter *blood;
+
+    // published before the level switched, about entities that are gone
+    bool stale;
+} GameplayEvents;
+
+// What the game keeps of one level, next to the level's world
+typedef struct GameLevel {
+    Arena arena;
+    CompType compHealth;
+    int player, gun, map, camera;
+    int benchRig;
+    AList targetEntities;
+    Visibility visibility;
+    CollisionGrid collision;
+    LightGrid lights;
+    int flashlight;
+    LosGrid los;
+    float worldWidth, worldHeight;
+} GameLevel;
+
+// Read by the level callbacks, on the loader thread too
+typedef struct GameSetup {
+    GameLevel levels[LEVEL_SLOTS];
+    int screenWidth, screenHeight;
+    int benchSprites;
+    const char *mapCacheDir;
+} GameSetup;
+
+// Every drain leads down to the next one. The cell block is the only map so
+// far, so it leads back into a fresh copy of itself
+static const char *levelNames[] = {"prison"};
+
+static void onHit(const Event *events, int count, void *user) {
+    GameplayEvents *game = user;
+    if (game->stale) {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const HitEvent *hit = &events[i].hit;
+        float angle = atan2f(hit->dirY, hit->dirX) * RAD2DEG;
+        if (hit->target == PROJECTILE_NO_TARGET) {
+            // bounces off the wall
+            ParticlesEmit(game->particles, game->dust, hit->x, hit->y, angle + 180.0f);
+            continue;
+        }
+
+        ParticlesEmit(game->particles, game->blood, hit->x, hit->y, angle);
+        HealthComp *health = ComponentGet(hit->target, game->compHealth);
+        if (health != NULL && health->hitPoints > 0 && --health->hitPoints == 0) {
+            Event die = {.type = EVENT_DIE,
+                         .die = {.entity = hit->target,
+                                 .killer = hit->source,
+                                 .x = hit->x,
+                                 .y = hit->y}};
+            EventPublish(game->ring, &die);
+        }
+    }
+}
+
+static void onDie(const Event *events, int count, void *user) {
+    GameplayEvents *game = user;
+    if (game->stale) {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const DieEvent *die = &events[i].die;
+        // removed at the end of the tick
+        CmdEntityRemove(game->commands, die->entity);
+        for (float angle = 0.0f; angle < 360.0f; angle += 90.0f) {
+            ParticlesEmit(game->particles, game->blood, die->x, die->y, angle);
+        }
+    }
+}
+
+// Same sequence every run, so every benchmark draws the same crowd
+static float benchRandom(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / (float)(1u << 24);
+}
+
+// On the loader thread, with the level's assets, world and prefabs current.
+// Each level is a map and the spritesheet of its tiles, under its name
+static bool buildLevel(LevelSlot *slot, void *user) {
+    GameSetup *setup = user;
+    GameLevel *level = &setup->levels[slot->index];
+    ArenaReset(&level->arena);
+
+    AssetAdd(ASSET_LOADER_SPRITESHEET, "entities");
+    AssetAdd(ASSET_LOADER_ANIMATION, "entities");
+    AssetAdd(ASSET_LOADER_SPRITESHEET, slot->name);
+    AssetAdd(ASSET_LOADER_MAP, slot->name);
+    AssetAdd(ASSET_LOADER_EMITTER, "effects");
+    if (AssetLoadSync() != 0 || PrefabsLoad("entities") != 0) {
+        return false;
+    }
+
+    level->compHealth =
+        ComponentRegister(sizeof(HealthComp), _Alignof(HealthComp), 256, NULL);
+    AListInit(&level->targetEntities, &level->arena);
+
+    level->player = PrefabSpawn(PrefabGet("policeman"), (Vector2) {100, 100});
+    TransformComp *playerTransf = ComponentGet(level->player, COMP_TRANSFORM);
+
+    // held in the player's hands, in the player's sprite pixels
+    level->gun = PrefabSpawn(PrefabGet("rifle"), (Vector2) {4, 10});
+    TransformComp *gunTransf = ComponentGet(level->gun, COMP_TRANSFORM);
+    gunTransf->scale = Vector2One();
+    TransformSetParent(level->gun, level->player);
+
+    Vector2 zombiePositions[] = {{400, 180}, {560, 300}, {760, 200}};
+    int zombies = PrefabSpawnBatch(PrefabGet("zombie"), 3, zombiePositions);
+    for (int i = 0; zombies != NULL_ENTITY_COMP && i < 3; ++i) {
+        AListAppend(&level->targetEntities, zombies + i);
+        HealthComp *health = ComponentCreate(zombies + i, level->compHealth);
+        health->hitPoints = ZOMBIE_HEALTH;
+    }
+
+    level->map = EntityCreate();
+
+    MapRender *mapRender = ComponentCreate(level->map, COMP_MAPRENDER);
+    mapRender->map = AssetGetMap(slot->name);
+    mapRender->tileWidth = 32;
+    mapRender->tileHeight = 32;
+    mapRender->scale = (Vector2) {2, 2};
+    // every layer is under the entities, baked into a single texture
+    mapRender->renderLayersCount = MAX_MAP_LAYERS;
+    mapRender->mergedLayers = MAX_MAP_LAYERS;
+
+    // baked layers survive restarts until the map or its spritesheets change
+    mapRender->cacheDir = setup->mapCacheDir;
+
+    level->camera = EntityCreate();
+
+    CameraComp *cameraComp = ComponentCreate(level->camera, COMP_CAMERA);
+    cameraComp->targetTransf = playerTransf;
+    cameraComp->offset =
+        (Vector2) {setup->screenWidth / 2.0f, setup->screenHeight / 2.0f};
+
+    // benchmarks fly the camera over the map instead of following the player
+    level->benchRig = NULL_ENTITY_COMP;
+    if (setup->benchSprites >= 0) {
+        level->benchRig = EntityCreate();
+        cameraComp->targetTransf = ComponentCreate(level->benchRig, COMP_TRANSFORM);
+    }
+
+    CollisionGrid *collision = &level->collision;
+    if (MapCollisionInit(level->map, collision, &level->arena) != 0) {
+        return false;
+    }
+    level->worldWidth = collision->width * collision->cellWidth;
+    level->worldHeight = collision->height * collision->cellHeight;
+    VisibilityInit(&level->visibility, &level->arena, level->worldWidth,
+                   level->worldHeight, VISIBILITY_CELL);
+    VisibilityAdd(&level->visibility, level->player);
+    VisibilityAdd(&level->visibility, level->gun);
+    for (int i = 0; zombies != NULL_ENTITY_COMP && i < 3; ++i) {
+        VisibilityAdd(&level->visibility, zombies + i);
+    }
+
+    int benchSprites = setup->benchSprites;
+    if (benchSprites > 0) {
+        Vector2 *crowdPositions = malloc(sizeof(Vector2) * benchSprites);
+        uint32_t seed = 1;
+        for (int i = 0; i < benchSprites; ++i) {
+            crowdPositions[i] = (Vector2){benchRandom(&seed) * level->worldWidth,
+                                          benchRandom(&seed) * level->worldHeight};
+        }
+        int crowd = PrefabSpawnBatch(PrefabGet("zombie"), benchSprites, crowdPositions);
+        for (int i = 0; crowd != NULL_ENTITY_COMP && i < benchSprites; ++i) {
+            VisibilityAdd(&level->visibility, crowd + i);
+        }
+        free(crowdPositions);
+    }
+
+    LightGridInit(&level->lights, &level->arena, collision, MAX_LIGHTS, LIGHT_RADIUS);
+    LightGridSetAmbient(&level->lights, 70, 70, 90);
+    level->flashlight = LightAdd(&level->lights, 0, 0, LIGHT_RADIUS, 255, 230, 180);
+    LightAdd(&level->lights, 15, 5, 5, 200, 40, 40);
+    mapRender->lights = &level->lights;
+
+    // the walls never change, so every pair of tiles is walked once
+    return LosGridInit(&level->los, &level->arena, collision, LOS_CACHE_BITS) == 0;
+}
+
+// On the main thread, render targets need the GL context
+static bool prepareLevel(LevelSlot *slot, void *user) {
+    GameSetup *setup = user;
+    SystemMapInit(setup->levels[slot->index].map);
+    return true;
+}
+
+// True on the tick the next level came in. The wait is for replays, which
+// have to switch on the same tick they were recorded on
+static bool levelSwitched(LevelStream *stream, bool wait) {
+    bool switched = LevelStreamUpdate(stream);
+    while (wait && !switched && LevelStreamBusy(stream)) {
+        sched_yield();
+        switched = LevelStreamUpdate(stream);
+    }
+    return switched;
+}
+
+// Standing on a drain tile of any layer
+static bool onExitTile(int mapEntity, int x, int y) {
+    MapRender *mapRender = ComponentGet(mapEntity, COMP_MAPRENDER);
+    const Map *map = &mapRender->map;
+    if (x < 0 || y < 0 || x >= map->width || y >= map->height) {
+        return false;
+    }
+
+    for (int layer = 0; layer < map->layersCount; ++layer) {
+        int tileId = map->tiles[layer][y * map->width + x];
+        if (tileId != MAP_TILE_EMPTY && AssetsGetTile(tileId).exit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void benchReport(double *frameTimes, const int *drawCalls, int frames,
+                        int sprites) {
+    if (frames <= 0) {
+        printf("bench: stopped before any frame was measured\n");
+        return;
+    }
+
+    long totalDraws = 0;
+    int maxDraws = 0;
+    for (int i = 0; i < frames; ++i) {
+        totalDraws += drawCalls[i];
+        maxDraws = drawCalls[i] > maxDraws ? drawCalls[i] : maxDraws;
+    }
+
+    qsort(frameTimes, frames, sizeof(double), compareDouble);
+    printf("bench: %d sprites, %d frames\n", sprites, frames);
+    printf("frame ms: p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+           frameTimes[frames / 2] * 1000.0, frameTimes[frames * 95 / 100] * 1000.0,
+           frameTimes[frames * 99 / 100] * 1000.0, frameTimes[frames - 1] * 1000.0);
+    printf("draw calls per frame: avg %.1f  max %d\n", (double)totalDraws / frames,
+           maxDraws);
+}
+
 //--------------------------------------------------------------------------------------
 // Program main entry point
 //--------------------------------------------------------------------------------------
-int main(void) {
+int main(int argc, char **argv) {
     // Initialization
     //----------------------------------------------------------------------------------
     const int screenWidth = 800;
     const int screenHeight = 450;
 
+    // --record <file> / --replay <file> drive input, --headless skips drawing.
+    // --bench <sprites> flies the camera over a crowd and times the frames
+    InputMode inputMode = INPUT_LIVE;
+    const char *inputFilepath = NULL;
+    bool headless = false;
+    int benchSprites = -1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            inputMode = INPUT_RECORD;
+            inputFilepath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            inputMode = INPUT_REPLAY;
+            inputFilepath = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchSprites = atoi(argv[++i]);
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--record file | --replay file] [--headless]\n"
+                    "       %s --bench sprites\n",
+                    argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (headless && inputMode != INPUT_REPLAY) {
+        // nothing polls the keyboard or the clock without a frame being drawn
+        fprintf(stderr, "--headless needs --replay\n");
+        return 1;
+    }
+    if (benchSprites >= 0 && (headless || inputMode != INPUT_LIVE)) {
+        fprintf(stderr, "--bench can't be combined with other options\n");
+        return 1;
+    }
+    if (benchSprites > BENCH_MAX_SPRITES) {
+        fprintf(stderr, "--bench draws at most %d sprites\n", BENCH_MAX_SPRITES);
+        return 1;
+    }
+    if (headless) {
+        // raylib still needs a GL context for render textures
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    }
     InitWindow(screenWidth, screenHeight, "Prison Apocalypse");
 
-    SetTargetFPS(60);
+    // replays run as fast as possible, the recorded dt drives the simulation.
+    // Benchmarks are uncapped too, and vsync is never requested
+    if (inputMode != INPUT_REPLAY && benchSprites < 0) {
+        SetTargetFPS(60);
+    }
     SetTraceLogLevel(LOG_DEBUG);
 
-    AssetsInit();
-    
-    // init assets
-    AssetAdd(ASSET_LOADER_SPRITESHEET, "entities");
-    AssetAdd(ASSET_LOADER_ANIMATION, "entities");
-    AssetAdd(ASSET_LOADER_SPRITESHEET, "prison");
-    AssetAdd(ASSET_LOADER_MAP, "prison");
+    // baked layers survive restarts until the map or its spritesheets change
+    char mapCacheDir[512];
+    snprintf(mapCacheDir, sizeof(mapCacheDir), "%scache", GetApplicationDirectory());
 
-    int err = AssetLoadSync();
-    if (err != 0) {
+    // levels are built on a loader thread, each into its own slot
+    GameSetup setup = {.screenWidth = screenWidth,
+                       .screenHeight = screenHeight,
+                       .benchSprites = benchSprites,
+                       .mapCacheDir = mapCacheDir};
+    for (int i = 0; i < LEVEL_SLOTS; ++i) {
+        Arena *levelArena = &setup.levels[i].arena;
+        ArenaInit(levelArena, malloc(LEVEL_ARENA_SIZE), LEVEL_ARENA_SIZE);
+    }
+    LevelStream stream;
+    LevelStreamInit(&stream);
+    int levelIndex = 0;
+    LevelStreamRequest(&stream, levelNames[levelIndex], buildLevel, prepareLevel,
+                       &setup);
+
+    // the first level is waited for
+    if (!levelSwitched(&stream, true)) {
         TraceLog(LOG_ERROR, "Failed to load assets");
         return 1;
     }
-
-    // init ecs
-    EntityCompInit();
+    GameLevel *level = &setup.levels[LevelStreamActive(&stream)->index];
 
     Arena arena = {0};
-    AList renderEntities = {0};
-    AList animEntities = {0};
-
-    ArenaInit(&arena, malloc(Kilobyte(100)), Kilobyte(100));
-    AListInit(&renderEntities, &arena);
-    AListInit(&animEntities, &arena);
-
-    int player = EntityCreate();
-
-    TransformComp *playerTransf = ComponentCreate(player, COMP_TRANSFORM);
-    playerTransf->position = (Vector2) {100, 100};
-    playerTransf->scale = (Vector2) {2, 2};
-
-    ComponentCreate(player, COMP_SPRITERENDER);
-    AListAppend(&renderEntities, player);
+    ArenaInit(&arena, malloc(Kilobyte(128)), Kilobyte(128));
 
-    AnimRender *playerAR = ComponentCreate(player, COMP_ANIMRENDER);
-    playerAR->anim = AssetsGetAnimation("policeman_idle");
-    AListAppend(&animEntities, player);
+    // short lived effects live outside of the ECS
+    Arena particleArena = {0};
+    ParticlePool particles = {0};
+    ArenaInit(&particleArena, malloc(Kilobyte(512)), Kilobyte(512));
+    ParticlePoolInit(&particles, &particleArena, 8192);
+    ParticleEmitter dust = AssetsGetEmitter("dust");
+    ParticleEmitter muzzleFlash = AssetsGetEmitter("muzzle_flash");
+    ParticleEmitter blood = AssetsGetEmitter("blood");
 
-    PlayerComp *playerComp = ComponentCreate(player, COMP_PLAYER);
-    playerComp->speed = 150.0f;
-    playerComp->idleAnim = AssetsGetAnimation("policeman_idle");
-    playerComp->runAnim = AssetsGetAnimation("policeman_run");
+    // bullets, and the walls and bodies they can hit
+    Arena projectileArena = {0};
+    ProjectilePool projectiles = {0};
+    ProjectileTarget targets[MAX_TARGETS];
+    float fireCooldown = 0.0f;
+    ArenaInit(&projectileArena, malloc(Kilobyte(256)), Kilobyte(256));
+    ProjectilePoolInit(&projectiles, &projectileArena, MAX_PROJECTILES);
 
-    int gun = EntityCreate();
-    
-    TransformComp *gunTransf = ComponentCreate(gun, COMP_TRANSFORM);
-    gunTransf->position = (Vector2) {100, 100};
-    gunTransf->scale = (Vector2) {2, 2};
+    // structural changes requested by systems, applied at the end of the tick
+    CommandBuffer commands = {0};
+    CommandBuffer *commandBuffers[] = {&commands};
+    CommandBufferInit(&commands, &arena, 1024, Kilobyte(32));
 
-    SpriteRender *gunSR = ComponentCreate(gun, COMP_SPRITERENDER);
-    gunSR->sprite = AssetsGetSprite("rifle");
-    AListAppend(&renderEntities, gun);
+    // gameplay events are handed to their subscribers once per tick
+    Arena eventArena = {0};
+    EventBus events = {0};
+    ArenaInit(&eventArena, malloc(Kilobyte(128)), Kilobyte(128));
+    EventBusInit(&events, &eventArena, EVENT_RING_SIZE);
+    GameplayEvents gameplay = {.ring = EventBusAddRing(&events, EVENT_RING_SIZE, false),
+                               .commands = &commands,
+                               .compHealth = level->compHealth,
+                               .particles = &particles,
+                               .dust = &dust,
+                               .blood = &blood};
+    EventBusSubscribe(&events, EVENT_HIT, onHit, &gameplay);
+    EventBusSubscribe(&events, EVENT_DIE, onDie, &gameplay);
 
-    int map = EntityCreate();
+    // frame times and draw calls of every measured frame
+    int benchFrame = 0;
+    double benchLastTime = 0.0;
+    double *benchFrameTimes = NULL;
+    int *benchDrawCalls = NULL;
+    if (benchSprites >= 0) {
+        benchFrameTimes = malloc(sizeof(double) * BENCH_FRAMES);
+        benchDrawCalls = malloc(sizeof(int) * BENCH_FRAMES);
+    }
 
-    MapRender *mapRender = ComponentCreate(map, COMP_MAPRENDER);
-    mapRender->map = AssetGetMap("prison");
-    mapRender->tileWidth = 32;
-    mapRender->tileHeight = 32;
-    mapRender->scale = (Vector2) {2, 2};
-    mapRender->renderLayersCount = 1;
+    // restarting is loading the world as it was at this point
+    char restartSnapshot[512];
+    snprintf(restartSnapshot, sizeof(restartSnapshot), "%srestart.snap",
+             GetApplicationDirectory());
+    WorldSnapshotWrite(restartSnapshot, NULL);
 
-    int camera = EntityCreate();
-    
-    CameraComp *cameraComp = ComponentCreate(camera, COMP_CAMERA);
-    cameraComp->targetTransf = playerTransf;
-    cameraComp->offset = (Vector2) {screenWidth/2.0f, screenHeight/2.0f};
+    // the player has to step off the drain they arrived on first
+    bool exitArmed = false;
 
-    SystemMapInit(map);
+    int err = InputInit(inputMode, inputFilepath);
+    if (err != 0) {
+        TraceLog(LOG_ERROR, "Failed to init input");
+        return 1;
+    }
 
     //----------------------------------------------------------------------------------
 
     // Main game loop
-    while (!WindowShouldClose()) {
+    InputFrame input;
+    while (!WindowShouldClose() && InputPoll(&input)) {
         // Update
         //------------------------------------------------------------------------------
-        Vector2 input = Vector2Zero();
-        if (IsKeyDown(KEY_W)) {
-            input.y -= 1;
+        // levels switch between ticks. Recordings and replays wait for the
+        // whole load, so they switch on the same tick
+        if (levelSwitched(&stream, inputMode != INPUT_LIVE)) {
+            level = &setup.levels[LevelStreamActive(&stream)->index];
+            gameplay.compHealth = level->compHealth;
+            dust = AssetsGetEmitter("dust");
+            muzzleFlash = AssetsGetEmitter("muzzle_flash");
+            blood = AssetsGetEmitter("blood");
+
+            // nothing in flight carries over into the next level
+            gameplay.stale = true;
+            EventBusDispatch(&events);
+            gameplay.stale = false;
+            ProjectilePoolReset(&projectiles);
+            ParticlePoolReset(&particles);
+            CommandBufferReset(&commands);
+            exitArmed = false;
+            WorldSnapshotWrite(restartSnapshot, NULL);
+        }
+        int player = level->player;
+        TransformComp *playerTransf = ComponentGet(player, COMP_TRANSFORM);
+
+        if (input.actions & INPUT_RESTART) {
+            WorldSnapshotRead(restartSnapshot, NULL);
+        }
+
+        // the simulation only reads the input frame, never the clock or keyboard
+        Vector2 move = InputMoveDirection(input);
+        SystemPlayerUpdate(player, move, input.dt);
+
+        if (!Vector2Equals(move, Vector2Zero())) {
+            // kicked up behind the player's feet
+            SpriteRender *playerSprite = ComponentGet(player, COMP_SPRITERENDER);
+            Rectangle source = AssetsGetSpriteSource(playerSprite->sprite);
+            Vector2 feet = {
+                playerTransf->position.x + source.width * playerTransf->scale.x / 2,
+                playerTransf->position.y + source.height * playerTransf->scale.y};
+            ParticlesEmit(&particles, &dust, feet.x, feet.y,
+                          atan2f(-move.y, -move.x) * RAD2DEG);
+        }
+
+        // fires the way the player is facing
+        fireCooldown -= input.dt;
+        if ((input.actions & INPUT_FIRE) && fireCooldown <= 0.0f) {
+            SpriteRender *playerSprite = ComponentGet(player, COMP_SPRITERENDER);
+            float dirX = playerSprite->flipX ? -1.0f : 1.0f;
+            Rectangle source = AssetsGetSpriteSource(playerSprite->sprite);
+            Vector2 muzzle = {
+                playerTransf->position.x + source.width * playerTransf->scale.x / 2,
+                playerTransf->position.y + source.height * playerTransf->scale.y / 2};
+            ProjectileFire(&projectiles, player, muzzle.x, muzzle.y, dirX, 0.0f,
+                           BULLET_SPEED, BULLET_LIFETIME);
+            ParticlesEmit(&particles, &muzzleFlash, muzzle.x, muzzle.y,
+                          dirX > 0 ? 0.0f : 180.0f);
+            fireCooldown = FIRE_INTERVAL;
         }
-        if (IsKeyDown(KEY_D)) {
-            input.x += 1;
+
+        int targetsCount =
+            SystemProjectileTargets(&level->targetEntities, targets, MAX_TARGETS);
+        int hits = ProjectilesUpdate(&projectiles, &level->collision, targets,
+                                     targetsCount, input.dt);
+        for (int i = 0; i < hits; ++i) {
+            ProjectileHit *hit = &projectiles.hits[i];
+            Event event = {.type = EVENT_HIT,
+                           .hit = {.target = hit->target,
+                                   .source = hit->owner,
+                                   .x = hit->x,
+                                   .y = hit->y,
+                                   .dirX = hit->dirX,
+                                   .dirY = hit->dirY}};
+            EventPublish(gameplay.ring, &event);
+        }
+        // deaths caused by this tick's hits are delivered on the next dispatch
+        EventBusDispatch(&events);
+        ParticlesUpdate(&particles, input.dt);
+        CommandBufferPlayback(commandBuffers, 1);
+
+        if (level->benchRig != NULL_ENTITY_COMP) {
+            // a Lissajous curve over most of the map, the frame number and not
+            // the clock moves it so every run draws the same frames
+            float t = 2.0f * PI * benchFrame / (BENCH_FRAMES + BENCH_WARMUP);
+            TransformComp *rigTransf = ComponentGet(level->benchRig, COMP_TRANSFORM);
+            rigTransf->position.x = level->worldWidth * (0.5f + 0.4f * sinf(2.0f * t));
+            rigTransf->position.y = level->worldHeight * (0.5f + 0.4f * sinf(3.0f * t));
+            TransformMarkDirty(level->benchRig);
         }
-        if (IsKeyDown(KEY_S)) {
-            input.y += 1;
+
+        // world transforms of whatever moved, children follow their parents
+        SystemTransformUpdate();
+        SystemCameraUpdate(level->camera);
+        SystemVisibilityUpdate(level->camera, &level->visibility);
+        SystemAnimationUpdate(&level->visibility.visible, input.dt);
+        SystemMapRebake(level->map);
+
+        // only recomputed when the player crosses into another tile
+        SpriteRender *playerSprite = ComponentGet(player, COMP_SPRITERENDER);
+        Rectangle playerSource = AssetsGetSpriteSource(playerSprite->sprite);
+        Vector2 playerCenter = {
+            playerTransf->position.x + playerSource.width * playerTransf->scale.x / 2,
+            playerTransf->position.y + playerSource.height * playerTransf->scale.y / 2};
+        int playerTileX = (int)(playerCenter.x / level->collision.cellWidth);
+        int playerTileY = (int)(playerCenter.y / level->collision.cellHeight);
+        LightMove(&level->lights, level->flashlight, playerTileX, playerTileY);
+        SystemMapLightUpdate(level->map);
+
+        // zombies with the player in sight, asked all at once
+        LosQuery sightLines[MAX_TARGETS];
+        uint64_t seenBy[(MAX_TARGETS + 63) / 64];
+        int watchers = 0;
+        for (size_t i = 0; i < level->targetEntities.size && watchers < MAX_TARGETS;
+             ++i) {
+            int zombie = level->targetEntities.elmnts[i];
+            TransformComp *transf = ComponentGet(zombie, COMP_TRANSFORM);
+            if (transf == NULL) {
+                continue;
+            }
+            int x = (int)(transf->position.x / level->collision.cellWidth);
+            int y = (int)(transf->position.y / level->collision.cellHeight);
+            if (CollisionGridSolid(&level->collision, x, y)) {
+                // nothing sees out of a wall, or from off the map
+                continue;
+            }
+            sightLines[watchers++] = (LosQuery){x, y, playerTileX, playerTileY};
         }
-        if (IsKeyDown(KEY_A)) {
-            input.x -= 1;
+        int seen = 0;
+        if (!CollisionGridSolid(&level->collision, playerTileX, playerTileY)) {
+            seen = LosQueryBatch(&level->los, sightLines, watchers, seenBy);
         }
 
-        SystemPlayerUpdate(player, Vector2Normalize(input), GetFrameTime());
-        SystemAnimationUpdate(&animEntities, GetFrameTime());
-        SystemCameraUpdate(camera);
+        // a drain leads down to the next block, loaded while this one runs
+        bool onExit = onExitTile(level->map, playerTileX, playerTileY);
+        if (!onExit) {
+            exitArmed = true;
+        } else if (exitArmed && !LevelStreamBusy(&stream)) {
+            int levelsCount = sizeof(levelNames) / sizeof(levelNames[0]);
+            levelIndex = (levelIndex + 1) % levelsCount;
+            exitArmed = !LevelStreamRequest(&stream, levelNames[levelIndex],
+                                            buildLevel, prepareLevel, &setup);
+        }
         //------------------------------------------------------------------------------
 
         // Draw
         //------------------------------------------------------------------------------
+        if (headless) {
+            continue;
+        }
+
         BeginDrawing();
         ClearBackground(BLACK);
 
+        RenderStatsReset();
+        CameraComp *cameraComp = ComponentGet(level->camera, COMP_CAMERA);
         BeginMode2D(cameraComp->camera);
-        SystemMapRenderLayer(map, 0);
-        SystemRenderEntities(&renderEntities);
+        SystemMapRenderLayer(level->map, 0);
+        SystemRenderEntities(&level->visibility.visible);
+        SystemMapRenderLight(level->map);
+        SystemProjectilesRender(&projectiles, 0.02f);
+        SystemParticlesRender(&particles);
         EndMode2D();
 
+        DrawText(TextFormat("visible %d / %d, seen by %d",
+                            level->visibility.visibleCount,
+                            level->visibility.totalCount, seen),
+                 10, 10, 20, RAYWHITE);
+
         EndDrawing();
+
+        if (benchSprites >= 0) {
+            // the time between two presented frames, whatever it was spent on
+            double now = GetTime();
+            int measured = benchFrame - BENCH_WARMUP;
+            if (measured >= 0) {
+                benchFrameTimes[measured] = now - benchLastTime;
+                benchDrawCalls[measured] = RenderStatsGet().drawCalls;
+            }
+            benchLastTime = now;
+            if (++benchFrame == BENCH_FRAMES + BENCH_WARMUP) {
+                break;
+            }
+        }
         //------------------------------------------------------------------------------
     }
 
     // De-Initialization
     //----------------------------------------------------------------------------------
-    AssetsDestroy();
-    EntityCompDestroy();
+    TraceLog(LOG_INFO, "World state after %lu ticks: %016llx", InputTick(),
+             (unsigned long long)WorldStateHash());
+
+    if (benchSprites >= 0) {
+        benchReport(benchFrameTimes, benchDrawCalls, benchFrame - BENCH_WARMUP,
+                    benchSprites);
+        free(benchFrameTimes);
+        free(benchDrawCalls);
+    }
+
+    InputDestroy();
+    LevelStreamDestroy(&stream);
+    for (int i = 0; i < LEVEL_SLOTS; ++i) {
+        free(setup.levels[i].arena.buff);
+    }
     free(arena.buff);
+    free(particleArena.buff);
+    free(projectileArena.buff);
+    free(eventArena.buff);
     CloseWindow(); // Close window and OpenGL context
     //----------------------------------------------------------------------------------
 
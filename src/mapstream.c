@@ -0,0 +1,346 @@
+#include "mapstream.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assets.h"
+#include "raylib.h"
+#include "utils.h"
+
+#define MAPSTREAM_MAGIC   "PAMC"
+#define MAPSTREAM_VERSION 1
+
+// smallest number of resident chunks that still covers a screen
+#define MIN_CHUNK_SLOTS 16
+
+typedef struct MapStreamHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t layersCount;
+    uint32_t chunkSize;
+} MapStreamHeader;
+
+static size_t chunkBytes(int layersCount) {
+    return sizeof(uint16_t) * MAP_CHUNK_TILES * layersCount;
+}
+
+int MapStreamWrite(const char *filepath, const Map *map) {
+    FILE *file = fopen(filepath, "wb");
+    if (file == NULL) {
+        TraceLog(LOG_ERROR, "Failed to open %s for writing", filepath);
+        return 1;
+    }
+
+    MapStreamHeader header = {.version = MAPSTREAM_VERSION,
+                              .width = map->width,
+                              .height = map->height,
+                              .layersCount = map->layersCount,
+                              .chunkSize = MAP_CHUNK_SIZE};
+    memcpy(header.magic, MAPSTREAM_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, file);
+
+    int chunksWide = (map->width + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    int chunksHigh = (map->height + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    uint16_t *chunk = malloc(chunkBytes(map->layersCount));
+    if (chunk == NULL) {
+        fclose(file);
+        return 1;
+    }
+
+    for (int cy = 0; cy < chunksHigh; ++cy) {
+        for (int cx = 0; cx < chunksWide; ++cx) {
+            // tiles outside the map stay empty
+            memset(chunk, 0xFF, chunkBytes(map->layersCount));
+
+            for (int layer = 0; layer < map->layersCount; ++layer) {
+                uint16_t *chunkLayer = &chunk[layer * MAP_CHUNK_TILES];
+                for (int y = 0; y < MAP_CHUNK_SIZE; ++y) {
+                    int mapY = cy * MAP_CHUNK_SIZE + y;
+                    for (int x = 0; x < MAP_CHUNK_SIZE; ++x) {
+                        int mapX = cx * MAP_CHUNK_SIZE + x;
+                        if (mapX >= map->width || mapY >= map->height) {
+                            continue;
+                        }
+                        // stored relative to the tileset so it can be loaded
+                        // after any number of other tilesets
+                        uint16_t tile = map->tiles[layer][mapY * map->width + mapX];
+                        chunkLayer[y * MAP_CHUNK_SIZE + x] =
+                            tile == MAP_TILE_EMPTY ? tile : tile - map->firstTile;
+                    }
+                }
+            }
+
+            fwrite(chunk, chunkBytes(map->layersCount), 1, file);
+        }
+    }
+
+    free(chunk);
+    int err = ferror(file);
+    fclose(file);
+    return err != 0;
+}
+
+static void loadChunk(MapStream *stream, MapChunkSlot *slot) {
+    size_t size = chunkBytes(stream->layersCount);
+    long offset = sizeof(MapStreamHeader) + (long)slot->chunk * size;
+
+    if (fseek(stream->file, offset, SEEK_SET) != 0 ||
+        fread(slot->tiles, size, 1, stream->file) != 1) {
+        // keep it resident as empty, otherwise it would be requested forever
+        TraceLog(LOG_WARNING, "Failed to read map chunk %d", slot->chunk);
+        memset(slot->tiles, 0xFF, size);
+    }
+}
+
+static void *loaderThread(void *arg) {
+    MapStream *stream = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&stream->lock);
+        while (!stream->quit && stream->requestsCount == 0) {
+            pthread_cond_wait(&stream->wake, &stream->lock);
+        }
+        if (stream->quit) {
+            pthread_mutex_unlock(&stream->lock);
+            break;
+        }
+        int slotId = stream->requests[stream->requestsHead];
+        stream->requestsHead = (stream->requestsHead + 1) % MAX_MAPSTREAM_REQUESTS;
+        --stream->requestsCount;
+        pthread_mutex_unlock(&stream->lock);
+
+        // main thread doesn't touch a slot while it's loading
+        MapChunkSlot *slot = &stream->slots[slotId];
+        loadChunk(stream, slot);
+        atomic_store_explicit(&slot->state, CHUNK_READY, memory_order_release);
+
+        pthread_mutex_lock(&stream->lock);
+        if (--stream->loading == 0) {
+            pthread_cond_broadcast(&stream->idle);
+        }
+        pthread_mutex_unlock(&stream->lock);
+    }
+
+    return NULL;
+}
+
+int MapStreamOpen(MapStream *stream, const char *filepath, int firstTile,
+                  size_t memoryBudget) {
+    MapStreamHeader header;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->file = fopen(filepath, "rb");
+    if (stream->file == NULL) {
+        TraceLog(LOG_ERROR, "Failed to open map stream %s", filepath);
+        return 1;
+    }
+
+    if (fread(&header, sizeof(header), 1, stream->file) != 1 ||
+        memcmp(header.magic, MAPSTREAM_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MAPSTREAM_VERSION || header.chunkSize != MAP_CHUNK_SIZE ||
+        header.layersCount == 0 || header.layersCount > MAX_MAP_LAYERS) {
+        TraceLog(LOG_ERROR, "Invalid map stream %s", filepath);
+        fclose(stream->file);
+        return 1;
+    }
+
+    stream->width = header.width;
+    stream->height = header.height;
+    stream->layersCount = header.layersCount;
+    stream->chunksWide = (stream->width + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    stream->chunksHigh = (stream->height + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    stream->firstTile = firstTile;
+
+    // the chunk index is the only part that grows with the map size,
+    // 64KB for a 4096x4096 map
+    size_t chunksCount = (size_t)stream->chunksWide * stream->chunksHigh;
+    size_t indexBytes = sizeof(int) * chunksCount + DEFAULT_ALIGNMENT;
+    size_t slotBytes =
+        chunkBytes(stream->layersCount) + sizeof(MapChunkSlot) + DEFAULT_ALIGNMENT;
+    if (memoryBudget <= indexBytes ||
+        (memoryBudget - indexBytes) / slotBytes < MIN_CHUNK_SLOTS) {
+        TraceLog(LOG_ERROR, "Map stream budget of %lu bytes is too small", memoryBudget);
+        fclose(stream->file);
+        return 1;
+    }
+    stream->slotsCount = (memoryBudget - indexBytes) / slotBytes;
+
+    void *backingBuffer = malloc(memoryBudget);
+    if (backingBuffer == NULL) {
+        TraceLog(LOG_ERROR, "Failed to allocate memory for Arena");
+        fclose(stream->file);
+        return 1;
+    }
+    ArenaInit(&stream->arena, backingBuffer, memoryBudget);
+
+    stream->chunkSlots = ArenaAlloc(&stream->arena, sizeof(int) * chunksCount);
+    for (size_t i = 0; i < chunksCount; ++i) {
+        stream->chunkSlots[i] = -1;
+    }
+
+    stream->slots = ArenaAlloc(&stream->arena, sizeof(MapChunkSlot) * stream->slotsCount);
+    for (int i = 0; i < stream->slotsCount; ++i) {
+        stream->slots[i].chunk = -1;
+        stream->slots[i].tiles = ArenaAlloc(&stream->arena, chunkBytes(stream->layersCount));
+        atomic_init(&stream->slots[i].state, CHUNK_EMPTY);
+    }
+
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->wake, NULL);
+    pthread_cond_init(&stream->idle, NULL);
+    if (pthread_create(&stream->thread, NULL, loaderThread, stream) != 0) {
+        TraceLog(LOG_ERROR, "Failed to start map stream loader");
+        pthread_mutex_destroy(&stream->lock);
+        pthread_cond_destroy(&stream->wake);
+        pthread_cond_destroy(&stream->idle);
+        free(stream->arena.buff);
+        fclose(stream->file);
+        return 1;
+    }
+
+    TraceLog(LOG_DEBUG, "Map stream %dx%d, %d of %lu chunks resident (%lu bytes)",
+             stream->width, stream->height, stream->slotsCount, chunksCount,
+             memoryBudget);
+    return 0;
+}
+
+void MapStreamClose(MapStream *stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->quit = true;
+    pthread_cond_signal(&stream->wake);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->wake);
+    pthread_cond_destroy(&stream->idle);
+    fclose(stream->file);
+
+    // free all arena at once
+    ArenaReset(&stream->arena);
+    free(stream->arena.buff);
+}
+
+// Least recently used slot that isn't needed this frame, -1 if none.
+static int evictSlot(MapStream *stream) {
+    int victim = -1;
+
+    for (int i = 0; i < stream->slotsCount; ++i) {
+        MapChunkSlot *slot = &stream->slots[i];
+        int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        if (state == CHUNK_EMPTY) {
+            return i;
+        }
+        if (state == CHUNK_LOADING || slot->lastUsed == stream->frame) {
+            continue;
+        }
+        if (victim < 0 || slot->lastUsed < stream->slots[victim].lastUsed) {
+            victim = i;
+        }
+    }
+
+    if (victim >= 0) {
+        stream->chunkSlots[stream->slots[victim].chunk] = -1;
+    }
+    return victim;
+}
+
+// Gives chunk a slot and queues it, with the lock held. False when nothing
+// more can be queued this frame
+static bool requestChunk(MapStream *stream, int chunk) {
+    int slotId = stream->chunkSlots[chunk];
+    if (slotId >= 0) {
+        stream->slots[slotId].lastUsed = stream->frame;
+        return true;
+    }
+
+    if (stream->requestsCount >= MAX_MAPSTREAM_REQUESTS) {
+        // loader is behind, ask again next frame
+        return false;
+    }
+
+    slotId = evictSlot(stream);
+    if (slotId < 0) {
+        // budget can't hold this region, draw what is resident
+        return false;
+    }
+
+    MapChunkSlot *slot = &stream->slots[slotId];
+    slot->chunk = chunk;
+    slot->lastUsed = stream->frame;
+    atomic_store_explicit(&slot->state, CHUNK_LOADING, memory_order_relaxed);
+    stream->chunkSlots[chunk] = slotId;
+
+    int tail = (stream->requestsHead + stream->requestsCount) % MAX_MAPSTREAM_REQUESTS;
+    stream->requests[tail] = slotId;
+    ++stream->requestsCount;
+    ++stream->loading;
+    return true;
+}
+
+void MapStreamRequest(MapStream *stream, int x0, int y0, int x1, int y1) {
+    int cx0 = x0 < 0 ? 0 : x0 / MAP_CHUNK_SIZE;
+    int cy0 = y0 < 0 ? 0 : y0 / MAP_CHUNK_SIZE;
+    int cx1 = x1 < 0 ? -1 : (x1 - 1) / MAP_CHUNK_SIZE;
+    int cy1 = y1 < 0 ? -1 : (y1 - 1) / MAP_CHUNK_SIZE;
+    cx1 = cx1 < stream->chunksWide ? cx1 : stream->chunksWide - 1;
+    cy1 = cy1 < stream->chunksHigh ? cy1 : stream->chunksHigh - 1;
+
+    ++stream->frame;
+
+    // the loader takes from the queue at any time, so it's locked for the
+    // whole region and woken once
+    pthread_mutex_lock(&stream->lock);
+    int queued = stream->requestsCount;
+    bool more = true;
+    for (int cy = cy0; more && cy <= cy1; ++cy) {
+        for (int cx = cx0; more && cx <= cx1; ++cx) {
+            more = requestChunk(stream, cy * stream->chunksWide + cx);
+        }
+    }
+    if (stream->requestsCount > queued) {
+        pthread_cond_signal(&stream->wake);
+    }
+    pthread_mutex_unlock(&stream->lock);
+}
+
+void MapStreamWait(MapStream *stream) {
+    pthread_mutex_lock(&stream->lock);
+    while (stream->loading > 0) {
+        pthread_cond_wait(&stream->idle, &stream->lock);
+    }
+    pthread_mutex_unlock(&stream->lock);
+}
+
+int MapStreamResident(MapStream *stream) {
+    int resident = 0;
+    for (int i = 0; i < stream->slotsCount; ++i) {
+        resident += atomic_load_explicit(&stream->slots[i].state,
+                                         memory_order_relaxed) != CHUNK_EMPTY;
+    }
+    return resident;
+}
+
+uint16_t MapStreamGetTile(MapStream *stream, int layer, int x, int y) {
+    if (layer < 0 || layer >= stream->layersCount || x < 0 || x >= stream->width ||
+        y < 0 || y >= stream->height) {
+        return MAP_TILE_EMPTY;
+    }
+
+    int chunk = (y / MAP_CHUNK_SIZE) * stream->chunksWide + x / MAP_CHUNK_SIZE;
+    int slotId = stream->chunkSlots[chunk];
+    if (slotId < 0) {
+        return MAP_TILE_EMPTY;
+    }
+
+    MapChunkSlot *slot = &stream->slots[slotId];
+    if (atomic_load_explicit(&slot->state, memory_order_acquire) != CHUNK_READY) {
+        return MAP_TILE_EMPTY;
+    }
+
+    int local = (y % MAP_CHUNK_SIZE) * MAP_CHUNK_SIZE + x % MAP_CHUNK_SIZE;
+    uint16_t tile = slot->tiles[layer * MAP_CHUNK_TILES + local];
+    return tile == MAP_TILE_EMPTY ? tile : stream->firstTile + tile;
+}
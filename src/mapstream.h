@@ -0,0 +1,73 @@
+#ifndef MAPSTREAM_H
+#define MAPSTREAM_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "assets.h"
+#include "utils.h"
+
+#define MAP_CHUNK_SIZE  32
+#define MAP_CHUNK_TILES (MAP_CHUNK_SIZE * MAP_CHUNK_SIZE)
+
+#define MAX_MAPSTREAM_REQUESTS 256
+
+typedef enum {
+    CHUNK_EMPTY = 0,
+    CHUNK_LOADING,
+    CHUNK_READY
+} ChunkState;
+
+typedef struct MapChunkSlot {
+    _Atomic int state;
+    int chunk;
+    unsigned int lastUsed;
+
+    // layersCount * MAP_CHUNK_TILES tile ids, relative to the tileset
+    uint16_t *tiles;
+} MapChunkSlot;
+
+typedef struct MapStream {
+    int width, height;
+    int layersCount;
+    int chunksWide, chunksHigh;
+    int firstTile;
+
+    // all memory used by the stream comes from here
+    Arena arena;
+    MapChunkSlot *slots;
+    int slotsCount;
+    int *chunkSlots;
+    unsigned int frame;
+
+    // loader thread, only it touches the file after opening. The queue and
+    // the count of chunks still loading are guarded by lock
+    FILE *file;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake, idle;
+    int requests[MAX_MAPSTREAM_REQUESTS];
+    int requestsHead, requestsCount;
+    int loading;
+    bool quit;
+} MapStream;
+
+int MapStreamWrite(const char *filepath, const Map *map);
+
+int MapStreamOpen(MapStream *stream, const char *filepath, int firstTile,
+                  size_t memoryBudget);
+void MapStreamClose(MapStream *stream);
+
+void MapStreamRequest(MapStream *stream, int x0, int y0, int x1, int y1);
+uint16_t MapStreamGetTile(MapStream *stream, int layer, int x, int y);
+
+// blocks until every requested chunk is loaded
+void MapStreamWait(MapStream *stream);
+// chunks holding a slot, loaded or loading
+int MapStreamResident(MapStream *stream);
+
+#endif // !MAPSTREAM_H
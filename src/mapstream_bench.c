@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "headless.h"
+#include "mapstream.c"
+#include "mapstream.h"
+#include "utils.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAP_SIZE     4096
+#define MAP_LAYERS   3
+#define FIRST_TILE   1
+#define BUDGET       Megabyte(4)
+#define VIEW_WIDTH   60
+#define VIEW_HEIGHT  34
+#define PAN_SPEED    4
+#define BENCH_FRAMES 4000
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// cell blocks of a prison: floor everywhere, walls around 16 tile cells with a
+// door each, furniture here and there
+static void makeMap(Map *map) {
+    map->width = MAP_SIZE;
+    map->height = MAP_SIZE;
+    map->layersCount = MAP_LAYERS;
+    map->firstTile = FIRST_TILE;
+    for (int layer = 0; layer < MAP_LAYERS; ++layer) {
+        map->tiles[layer] = malloc(sizeof(uint16_t) * MAP_SIZE * MAP_SIZE);
+    }
+
+    srand(42);
+    for (int y = 0; y < MAP_SIZE; ++y) {
+        for (int x = 0; x < MAP_SIZE; ++x) {
+            int i = y * MAP_SIZE + x;
+            bool wall = (x % 16 == 0 || y % 16 == 0) && !(x % 16 == 8 && y % 16 != 0);
+            map->tiles[0][i] = rand() % 4;
+            map->tiles[1][i] = wall ? 4 + (x + y) % 2 : MAP_TILE_EMPTY;
+            bool furniture = !wall && rand() % 100 < 3;
+            map->tiles[2][i] = furniture ? 6 + rand() % 8 : MAP_TILE_EMPTY;
+        }
+    }
+}
+
+// chunks of the region with no slot, the ones a request loads
+static int missingChunks(MapStream *stream, int x0, int y0, int x1, int y1) {
+    int missing = 0;
+    for (int cy = y0 / MAP_CHUNK_SIZE; cy <= (y1 - 1) / MAP_CHUNK_SIZE; ++cy) {
+        for (int cx = x0 / MAP_CHUNK_SIZE; cx <= (x1 - 1) / MAP_CHUNK_SIZE; ++cx) {
+            bool inside = cx >= 0 && cy >= 0 && cx < stream->chunksWide &&
+                          cy < stream->chunksHigh;
+            missing += inside && stream->chunkSlots[cy * stream->chunksWide + cx] < 0;
+        }
+    }
+    return missing;
+}
+
+// Writes the generated map as a stream file. Given a path it's kept there,
+// make bench-mapstream only measures a temporary one
+int main(int argc, char **argv) {
+    char tempPath[] = "/tmp/mapstream_benchXXXXXX";
+    const char *path = argc > 1 ? argv[1] : tempPath;
+    Map map;
+    MapStream stream;
+
+    makeMap(&map);
+    if (argc <= 1) {
+        int fd = mkstemp(tempPath);
+        if (fd < 0) {
+            return 1;
+        }
+        close(fd);
+    }
+    double start = nowMs();
+    if (MapStreamWrite(path, &map) != 0) {
+        printf("Failed to write %s\n", path);
+        return 1;
+    }
+    printf("Map %dx%d, %d layers written in %.1f ms\n", MAP_SIZE, MAP_SIZE, MAP_LAYERS,
+           nowMs() - start);
+    for (int layer = 0; layer < MAP_LAYERS; ++layer) {
+        free(map.tiles[layer]);
+    }
+
+    if (MapStreamOpen(&stream, path, FIRST_TILE, BUDGET) != 0) {
+        return 1;
+    }
+
+    // a camera sized view panning diagonally and bouncing off the edges, with a
+    // chunk of prefetch around it
+    double total = 0.0, worst = 0.0, waited = 0.0;
+    int x = 0, y = 0, dx = PAN_SPEED, dy = PAN_SPEED / 2, maxResident = 0;
+    long loads = 0, checksum = 0;
+    for (int frame = 0; frame < BENCH_FRAMES; ++frame) {
+        if (x + dx < 0 || x + dx + VIEW_WIDTH > MAP_SIZE) {
+            dx = -dx;
+        }
+        if (y + dy < 0 || y + dy + VIEW_HEIGHT > MAP_SIZE) {
+            dy = -dy;
+        }
+        x += dx;
+        y += dy;
+
+        int x0 = x - MAP_CHUNK_SIZE, y0 = y - MAP_CHUNK_SIZE;
+        int x1 = x + VIEW_WIDTH + MAP_CHUNK_SIZE, y1 = y + VIEW_HEIGHT + MAP_CHUNK_SIZE;
+        loads += missingChunks(&stream, x0, y0, x1, y1);
+
+        double requestStart = nowMs();
+        MapStreamRequest(&stream, x0, y0, x1, y1);
+        double elapsed = nowMs() - requestStart;
+        total += elapsed;
+        worst = elapsed > worst ? elapsed : worst;
+
+        double waitStart = nowMs();
+        MapStreamWait(&stream);
+        waited += nowMs() - waitStart;
+
+        for (int ty = y; ty < y + VIEW_HEIGHT; ++ty) {
+            for (int tx = x; tx < x + VIEW_WIDTH; ++tx) {
+                checksum += MapStreamGetTile(&stream, 1, tx, ty);
+            }
+        }
+        int resident = MapStreamResident(&stream);
+        maxResident = resident > maxResident ? resident : maxResident;
+    }
+
+    printf("%d frames, view %dx%d panning %d tiles a frame\n", BENCH_FRAMES, VIEW_WIDTH,
+           VIEW_HEIGHT, PAN_SPEED);
+    printf("request mean %7.4f ms  worst %7.4f ms  wait mean %7.4f ms\n",
+           total / BENCH_FRAMES, worst, waited / BENCH_FRAMES);
+    printf("%ld chunk loads, %d of %d chunks resident at most, %d slots\n", loads,
+           maxResident, stream.chunksWide * stream.chunksHigh, stream.slotsCount);
+    printf("%zu of %d bytes used, checksum %ld\n", stream.arena.currOffset, BUDGET,
+           checksum);
+
+    MapStreamClose(&stream);
+    if (argc <= 1) {
+        remove(path);
+    }
+    return 0;
+}
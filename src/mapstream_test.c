@@ -0,0 +1,180 @@
+// mkstemp
+#define _POSIX_C_SOURCE 200809L
+
+#include "minunit.h"
+#include "headless.h"
+#include "mapstream.c"
+#include "mapstream.h"
+#include "utils.c"
+#include <stdio.h>
+#include <unistd.h>
+
+#define TEST_WIDTH      320
+#define TEST_HEIGHT     200
+#define TEST_FIRST_TILE 5
+#define TEST_VIEW       64
+#define TEST_BUDGET     Kilobyte(80)
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testRoundTrip(void);
+static char *testPanResidency(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+// ground everywhere, a wall every seventh column on top
+static uint16_t expectedTile(int layer, int x, int y) {
+    if (layer == 0) {
+        return TEST_FIRST_TILE + (x + y * 3) % 100;
+    }
+    return x % 7 == 0 ? TEST_FIRST_TILE + 100 + y % 4 : MAP_TILE_EMPTY;
+}
+
+// writes the test map to a temporary file, returns 1 on failure
+static int writeTestStream(char *path) {
+    static uint16_t layers[2][TEST_WIDTH * TEST_HEIGHT];
+    Map map = {.width = TEST_WIDTH,
+               .height = TEST_HEIGHT,
+               .layersCount = 2,
+               .firstTile = TEST_FIRST_TILE,
+               .tiles = {layers[0], layers[1]}};
+    for (int layer = 0; layer < 2; ++layer) {
+        for (int y = 0; y < TEST_HEIGHT; ++y) {
+            for (int x = 0; x < TEST_WIDTH; ++x) {
+                layers[layer][y * TEST_WIDTH + x] = expectedTile(layer, x, y);
+            }
+        }
+    }
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+    return MapStreamWrite(path, &map);
+}
+
+static char *testRoundTrip(void) {
+    char path[] = "/tmp/mapstream_testXXXXXX";
+    MapStream stream;
+
+    MU_ASSERT(writeTestStream(path) == 0, "Expected the stream written");
+    MU_ASSERT(MapStreamOpen(&stream, path, TEST_FIRST_TILE, TEST_BUDGET) == 0,
+              "Expected the stream opened");
+    MU_ASSERT_FMT(stream.chunksWide == 10 && stream.chunksHigh == 7,
+                  "Expected 10x7 chunks, but got %dx%d", stream.chunksWide,
+                  stream.chunksHigh);
+
+    // nothing is there before it's requested
+    MU_ASSERT(MapStreamGetTile(&stream, 0, 10, 10) == MAP_TILE_EMPTY,
+              "Expected no tile before a request");
+
+    // the partial chunks of the last row and column too
+    MapStreamRequest(&stream, TEST_WIDTH - 40, TEST_HEIGHT - 40, TEST_WIDTH,
+                     TEST_HEIGHT);
+    MapStreamWait(&stream);
+    for (int layer = 0; layer < 2; ++layer) {
+        for (int y = TEST_HEIGHT - 40; y < TEST_HEIGHT; ++y) {
+            for (int x = TEST_WIDTH - 40; x < TEST_WIDTH; ++x) {
+                uint16_t tile = MapStreamGetTile(&stream, layer, x, y);
+                MU_ASSERT_FMT(tile == expectedTile(layer, x, y),
+                              "Layer %d at %d, %d: expected %u, but got %u", layer, x,
+                              y, expectedTile(layer, x, y), tile);
+            }
+        }
+    }
+    MU_ASSERT(MapStreamGetTile(&stream, 0, TEST_WIDTH, 0) == MAP_TILE_EMPTY,
+              "Expected no tile past the map");
+
+    MapStreamClose(&stream);
+    remove(path);
+
+    MU_PASS;
+}
+
+static char *testPanResidency(void) {
+    char path[] = "/tmp/mapstream_testXXXXXX";
+    MapStream stream;
+
+    MU_ASSERT(writeTestStream(path) == 0, "Expected the stream written");
+    MU_ASSERT(MapStreamOpen(&stream, path, TEST_FIRST_TILE, TEST_BUDGET) == 0,
+              "Expected the stream opened");
+    int chunksCount = stream.chunksWide * stream.chunksHigh;
+    MU_ASSERT_FMT(stream.slotsCount < chunksCount,
+                  "Expected fewer slots than the %d chunks, but got %d", chunksCount,
+                  stream.slotsCount);
+
+    // across every row of the map and back, a view that isn't chunk aligned
+    int maxResident = 0, lastX = 0, lastY = 0;
+    for (int y = 0; y + TEST_VIEW <= TEST_HEIGHT; y += 24) {
+        for (int step = 0; step <= 2 * (TEST_WIDTH - TEST_VIEW) / 16; ++step) {
+            int x = step * 16;
+            x = x <= TEST_WIDTH - TEST_VIEW ? x : 2 * (TEST_WIDTH - TEST_VIEW) - x;
+            MapStreamRequest(&stream, x, y, x + TEST_VIEW, y + TEST_VIEW);
+            MapStreamWait(&stream);
+            lastX = x;
+            lastY = y;
+
+            for (int ty = y; ty < y + TEST_VIEW; ty += 5) {
+                for (int tx = x; tx < x + TEST_VIEW; tx += 5) {
+                    uint16_t tile = MapStreamGetTile(&stream, 1, tx, ty);
+                    MU_ASSERT_FMT(tile == expectedTile(1, tx, ty),
+                                  "At %d, %d: expected %u, but got %u", tx, ty,
+                                  expectedTile(1, tx, ty), tile);
+                }
+            }
+
+            int resident = MapStreamResident(&stream);
+            maxResident = resident > maxResident ? resident : maxResident;
+            MU_ASSERT_FMT(resident <= stream.slotsCount,
+                          "Expected at most %d chunks resident, but got %d",
+                          stream.slotsCount, resident);
+        }
+    }
+    MU_ASSERT_FMT(maxResident == stream.slotsCount,
+                  "Expected every slot used, but got %d of %d", maxResident,
+                  stream.slotsCount);
+    MU_ASSERT_FMT(stream.arena.currOffset <= TEST_BUDGET,
+                  "Expected at most %d bytes, but got %lu", TEST_BUDGET,
+                  stream.arena.currOffset);
+
+    // the first chunks were the least recently used, long evicted
+    MU_ASSERT(stream.chunkSlots[0] < 0, "Expected the first chunk evicted");
+    MU_ASSERT(MapStreamGetTile(&stream, 0, 0, 0) == MAP_TILE_EMPTY,
+              "Expected no tile from an evicted chunk");
+
+    // a resident view is only touched, nothing is loaded again
+    MapStreamRequest(&stream, lastX, lastY, lastX + TEST_VIEW, lastY + TEST_VIEW);
+    pthread_mutex_lock(&stream.lock);
+    int loading = stream.loading;
+    pthread_mutex_unlock(&stream.lock);
+    MU_ASSERT_FMT(loading == 0, "Expected nothing to load, but got %d chunks",
+                  loading);
+
+    MapStreamClose(&stream);
+    remove(path);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testRoundTrip);
+    MU_TEST(testPanResidency);
+
+    MU_PASS;
+}
@@ -0,0 +1,583 @@
+// sockets and inet_pton
+#define _POSIX_C_SOURCE 200809L
+
+#include "net.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NET_PACKET_SNAPSHOT 1
+#define NET_PACKET_ACK      2
+
+// type, sequence, base sequence, fragment index, fragments count
+#define NET_FRAGMENT_HEADER  13
+#define NET_FRAGMENT_PAYLOAD (NET_MAX_PACKET - NET_FRAGMENT_HEADER)
+#define NET_ACK_SIZE         5
+
+// queued fragments are prefixed with the peer index and their length
+#define NET_QUEUED_HEADER (3 + NET_FRAGMENT_HEADER)
+
+// id gap, field mask, x, y, rotation, frame, flags
+#define NET_MAX_RECORD 20
+
+typedef enum {
+    FIELD_X = 1 << 0,
+    FIELD_Y = 1 << 1,
+    FIELD_ROTATION = 1 << 2,
+    FIELD_ANIM_FRAME = 1 << 3,
+    FIELD_FLAGS = 1 << 4
+} NetField;
+
+int32_t NetQuantize(float value) {
+    return (int32_t)lroundf(value * NET_POSITION_SCALE);
+}
+
+float NetDequantize(int32_t value) {
+    return (float)value / NET_POSITION_SCALE;
+}
+
+uint16_t NetQuantizeAngle(float degrees) {
+    float turns = degrees / 360.0f;
+    turns -= floorf(turns);
+    return (uint16_t)lroundf(turns * 65536.0f);
+}
+
+float NetDequantizeAngle(uint16_t angle) {
+    return angle * (360.0f / 65536.0f);
+}
+
+// Byte writers, the wire format is little endian
+//
+static unsigned char *writeU16(unsigned char *out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static unsigned char *writeU32(unsigned char *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+    return out + 4;
+}
+
+static uint16_t readU16(const unsigned char *in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t readU32(const unsigned char *in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+static unsigned char *writeVarint(unsigned char *out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+    return out;
+}
+
+static const unsigned char *readVarint(const unsigned char *in,
+                                       const unsigned char *end, uint32_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 35 && in < end; shift += 7) {
+        unsigned char byte = *in++;
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return in;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Snapshot deltas
+//
+size_t NetSnapshotEncode(const NetSnapshot *base, const NetSnapshot *current,
+                         int maxEntities, unsigned char *out, size_t outCapacity) {
+    static const NetEntityState empty = {0};
+    unsigned char *cursor = out;
+    int lastId = -1;
+
+    assert(outCapacity >= (size_t)maxEntities * NET_MAX_RECORD);
+
+    for (int id = 0; id < maxEntities; ++id) {
+        const NetEntityState *from = base != NULL ? &base->entities[id] : &empty;
+        const NetEntityState *to = &current->entities[id];
+
+        uint8_t mask = 0;
+        mask |= from->x != to->x ? FIELD_X : 0;
+        mask |= from->y != to->y ? FIELD_Y : 0;
+        mask |= from->rotation != to->rotation ? FIELD_ROTATION : 0;
+        mask |= from->animFrame != to->animFrame ? FIELD_ANIM_FRAME : 0;
+        mask |= from->flags != to->flags ? FIELD_FLAGS : 0;
+        if (mask == 0) {
+            continue;
+        }
+
+        cursor = writeVarint(cursor, (uint32_t)(id - lastId - 1));
+        *cursor++ = mask;
+        if (mask & FIELD_X) {
+            cursor = writeVarint(cursor, zigzag(to->x - from->x));
+        }
+        if (mask & FIELD_Y) {
+            cursor = writeVarint(cursor, zigzag(to->y - from->y));
+        }
+        if (mask & FIELD_ROTATION) {
+            cursor = writeU16(cursor, to->rotation);
+        }
+        if (mask & FIELD_ANIM_FRAME) {
+            *cursor++ = to->animFrame;
+        }
+        if (mask & FIELD_FLAGS) {
+            *cursor++ = to->flags;
+        }
+        lastId = id;
+    }
+
+    return (size_t)(cursor - out);
+}
+
+int NetSnapshotDecode(const NetSnapshot *base, const unsigned char *data, size_t size,
+                      int maxEntities, NetSnapshot *out) {
+    const unsigned char *cursor = data;
+    const unsigned char *end = data + size;
+    int lastId = -1;
+
+    if (base != NULL) {
+        memcpy(out->entities, base->entities, sizeof(NetEntityState) * maxEntities);
+    } else {
+        memset(out->entities, 0, sizeof(NetEntityState) * maxEntities);
+    }
+
+    while (cursor < end) {
+        uint32_t gap, delta;
+
+        cursor = readVarint(cursor, end, &gap);
+        if (cursor == NULL || cursor >= end || gap >= (uint32_t)maxEntities) {
+            return 1;
+        }
+        int id = lastId + 1 + (int)gap;
+        if (id >= maxEntities) {
+            return 1;
+        }
+
+        NetEntityState *state = &out->entities[id];
+        uint8_t mask = *cursor++;
+        if (mask & FIELD_X) {
+            cursor = readVarint(cursor, end, &delta);
+            if (cursor == NULL) {
+                return 1;
+            }
+            state->x += unzigzag(delta);
+        }
+        if (mask & FIELD_Y) {
+            cursor = readVarint(cursor, end, &delta);
+            if (cursor == NULL) {
+                return 1;
+            }
+            state->y += unzigzag(delta);
+        }
+        if (mask & FIELD_ROTATION) {
+            if (end - cursor < 2) {
+                return 1;
+            }
+            state->rotation = readU16(cursor);
+            cursor += 2;
+        }
+        if (mask & FIELD_ANIM_FRAME) {
+            if (cursor >= end) {
+                return 1;
+            }
+            state->animFrame = *cursor++;
+        }
+        if (mask & FIELD_FLAGS) {
+            if (cursor >= end) {
+                return 1;
+            }
+            state->flags = *cursor++;
+        }
+        lastId = id;
+    }
+
+    return 0;
+}
+
+// Sockets
+//
+static int openSocket(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // a full snapshot is hundreds of datagrams, let them queue up
+    int bufSize = NET_SOCKET_BUF_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void sendPacket(int fd, const struct sockaddr_in *to, const unsigned char *data,
+                       size_t size, NetStats *stats) {
+    ssize_t sent = sendto(fd, data, size, 0, (const struct sockaddr *)to, sizeof(*to));
+    if (sent == (ssize_t)size) {
+        stats->bytesSent += size;
+        ++stats->packetsSent;
+    }
+}
+
+static void allocSnapshots(NetSnapshot *history, Arena *arena, int maxEntities) {
+    for (int i = 0; i < NET_HISTORY; ++i) {
+        history[i].sequence = NET_NO_SEQUENCE;
+        history[i].entities = ArenaAlloc(arena, sizeof(NetEntityState) * maxEntities);
+    }
+}
+
+// Server
+//
+int NetServerInit(NetServer *server, Arena *arena, int maxEntities, uint16_t port) {
+    memset(server, 0, sizeof(*server));
+    server->maxEntities = maxEntities;
+    server->socket = openSocket(port);
+    if (server->socket < 0) {
+        return 1;
+    }
+
+    struct sockaddr_in address;
+    socklen_t addressLen = sizeof(address);
+    getsockname(server->socket, (struct sockaddr *)&address, &addressLen);
+    server->port = ntohs(address.sin_port);
+
+    allocSnapshots(server->history, arena, maxEntities);
+
+    // every client may need a full snapshot in the same tick
+    size_t fragments = (size_t)maxEntities * NET_MAX_RECORD / NET_FRAGMENT_PAYLOAD + 1;
+    server->payloadCapacity = (size_t)maxEntities * NET_MAX_RECORD;
+    server->payload = ArenaAlloc(arena, server->payloadCapacity);
+    server->outgoingCapacity =
+        NET_MAX_CLIENTS * (server->payloadCapacity + fragments * NET_QUEUED_HEADER);
+    server->outgoing = ArenaAlloc(arena, server->outgoingCapacity);
+
+    return server->payload == NULL || server->outgoing == NULL;
+}
+
+void NetServerClose(NetServer *server) {
+    if (server->socket >= 0) {
+        close(server->socket);
+        server->socket = -1;
+    }
+}
+
+NetSnapshot *NetServerNextSnapshot(NetServer *server) {
+    ++server->sequence;
+    NetSnapshot *snapshot = &server->history[server->sequence % NET_HISTORY];
+    snapshot->sequence = server->sequence;
+    memset(snapshot->entities, 0, sizeof(NetEntityState) * server->maxEntities);
+    return snapshot;
+}
+
+static const NetSnapshot *findSnapshot(const NetSnapshot *history, uint32_t sequence) {
+    const NetSnapshot *snapshot = &history[sequence % NET_HISTORY];
+    if (sequence == NET_NO_SEQUENCE || snapshot->sequence != sequence) {
+        return NULL;
+    }
+    return snapshot;
+}
+
+void NetServerSend(NetServer *server) {
+    const NetSnapshot *current = &server->history[server->sequence % NET_HISTORY];
+
+    for (int peerIdx = 0; peerIdx < NET_MAX_CLIENTS; ++peerIdx) {
+        NetPeer *peer = &server->peers[peerIdx];
+        if (!peer->connected) {
+            continue;
+        }
+
+        // acks older than the history fall back to a full snapshot
+        const NetSnapshot *base = findSnapshot(server->history, peer->ackedSequence);
+        uint32_t baseSequence = base != NULL ? base->sequence : NET_NO_SEQUENCE;
+        size_t size = NetSnapshotEncode(base, current, server->maxEntities,
+                                        server->payload, server->payloadCapacity);
+
+        size_t fragmentsCount = size / NET_FRAGMENT_PAYLOAD + 1;
+        size_t needed = size + fragmentsCount * NET_QUEUED_HEADER;
+        if (server->outgoingSize + needed > server->outgoingCapacity) {
+            ++server->stats.snapshotsDropped;
+            continue;
+        }
+
+        // queued as [peer][length][packet]
+        for (size_t i = 0; i < fragmentsCount; ++i) {
+            size_t offset = i * NET_FRAGMENT_PAYLOAD;
+            size_t length = size - offset;
+            length = length < NET_FRAGMENT_PAYLOAD ? length : NET_FRAGMENT_PAYLOAD;
+            unsigned char *out = server->outgoing + server->outgoingSize;
+
+            *out++ = (unsigned char)peerIdx;
+            out = writeU16(out, (uint16_t)(NET_FRAGMENT_HEADER + length));
+            *out++ = NET_PACKET_SNAPSHOT;
+            out = writeU32(out, current->sequence);
+            out = writeU32(out, baseSequence);
+            out = writeU16(out, (uint16_t)i);
+            out = writeU16(out, (uint16_t)fragmentsCount);
+            memcpy(out, server->payload + offset, length);
+
+            server->outgoingSize += NET_QUEUED_HEADER + length;
+        }
+    }
+}
+
+size_t NetServerFlush(NetServer *server, int maxPackets) {
+    for (int sent = 0; server->outgoingSent < server->outgoingSize; ++sent) {
+        if (maxPackets > 0 && sent >= maxPackets) {
+            return server->outgoingSize - server->outgoingSent;
+        }
+
+        unsigned char *packet = server->outgoing + server->outgoingSent;
+        NetPeer *peer = &server->peers[packet[0]];
+        uint16_t length = readU16(packet + 1);
+
+        sendPacket(server->socket, &peer->address, packet + 3, length, &server->stats);
+        server->outgoingSent += 3 + length;
+    }
+
+    server->outgoingSize = 0;
+    server->outgoingSent = 0;
+    return 0;
+}
+
+static NetPeer *findPeer(NetServer *server, const struct sockaddr_in *address) {
+    NetPeer *freePeer = NULL;
+    for (int i = 0; i < NET_MAX_CLIENTS; ++i) {
+        NetPeer *peer = &server->peers[i];
+        if (!peer->connected) {
+            freePeer = freePeer == NULL ? peer : freePeer;
+        } else if (peer->address.sin_addr.s_addr == address->sin_addr.s_addr &&
+                   peer->address.sin_port == address->sin_port) {
+            return peer;
+        }
+    }
+
+    // first packet of a new client
+    if (freePeer != NULL) {
+        freePeer->connected = true;
+        freePeer->address = *address;
+        freePeer->ackedSequence = NET_NO_SEQUENCE;
+    }
+    return freePeer;
+}
+
+void NetServerReceive(NetServer *server) {
+    unsigned char packet[NET_MAX_PACKET];
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t size;
+
+    while ((size = recvfrom(server->socket, packet, sizeof(packet), 0,
+                            (struct sockaddr *)&from, &fromLen)) >= 0) {
+        server->stats.bytesReceived += (size_t)size;
+        ++server->stats.packetsReceived;
+
+        if (size != NET_ACK_SIZE || packet[0] != NET_PACKET_ACK) {
+            continue;
+        }
+
+        NetPeer *peer = findPeer(server, &from);
+        uint32_t acked = readU32(packet + 1);
+        if (peer != NULL && acked > peer->ackedSequence && acked <= server->sequence) {
+            peer->ackedSequence = acked;
+        }
+        fromLen = sizeof(from);
+    }
+}
+
+// Client
+//
+static void sendAck(NetClient *client, uint32_t sequence) {
+    unsigned char packet[NET_ACK_SIZE];
+    packet[0] = NET_PACKET_ACK;
+    writeU32(packet + 1, sequence);
+    sendPacket(client->socket, &client->server, packet, sizeof(packet), &client->stats);
+}
+
+int NetClientInit(NetClient *client, Arena *arena, int maxEntities,
+                  const char *serverHost, uint16_t serverPort) {
+    memset(client, 0, sizeof(*client));
+    client->maxEntities = maxEntities;
+    client->server.sin_family = AF_INET;
+    client->server.sin_port = htons(serverPort);
+    if (inet_pton(AF_INET, serverHost, &client->server.sin_addr) != 1) {
+        return 1;
+    }
+
+    client->socket = openSocket(0);
+    if (client->socket < 0) {
+        return 1;
+    }
+
+    allocSnapshots(client->history, arena, maxEntities);
+
+    size_t fragments = (size_t)maxEntities * NET_MAX_RECORD / NET_FRAGMENT_PAYLOAD + 1;
+    client->payloadCapacity = fragments * NET_FRAGMENT_PAYLOAD;
+    client->fragmentsCapacity = (int)fragments;
+    client->payload = ArenaAlloc(arena, client->payloadCapacity);
+    client->fragmentReceived = ArenaAlloc(arena, sizeof(bool) * fragments);
+    if (client->payload == NULL || client->fragmentReceived == NULL) {
+        return 1;
+    }
+
+    // says hello, the server starts sending full snapshots
+    sendAck(client, NET_NO_SEQUENCE);
+    return 0;
+}
+
+void NetClientClose(NetClient *client) {
+    if (client->socket >= 0) {
+        close(client->socket);
+        client->socket = -1;
+    }
+}
+
+static bool completeSnapshot(NetClient *client) {
+    uint32_t sequence = client->assemblySequence;
+    const NetSnapshot *base = findSnapshot(client->history, client->assemblyBase);
+    if (client->assemblyBase != NET_NO_SEQUENCE && base == NULL) {
+        // the base is gone, wait for a snapshot against a newer ack
+        ++client->stats.snapshotsDropped;
+        return false;
+    }
+
+    NetSnapshot *snapshot = &client->history[sequence % NET_HISTORY];
+    snapshot->sequence = NET_NO_SEQUENCE;
+    if (NetSnapshotDecode(base, client->payload, client->payloadSize,
+                          client->maxEntities, snapshot) != 0) {
+        ++client->stats.snapshotsDropped;
+        return false;
+    }
+    snapshot->sequence = sequence;
+
+    client->previous = client->latest;
+    client->latest = sequence;
+    sendAck(client, sequence);
+    return true;
+}
+
+static bool receiveFragment(NetClient *client, const unsigned char *packet,
+                            size_t size) {
+    if (size < NET_FRAGMENT_HEADER || packet[0] != NET_PACKET_SNAPSHOT) {
+        return false;
+    }
+
+    uint32_t sequence = readU32(packet + 1);
+    uint32_t baseSequence = readU32(packet + 5);
+    int fragment = readU16(packet + 9);
+    int fragmentsCount = readU16(packet + 11);
+    size_t length = size - NET_FRAGMENT_HEADER;
+    size_t offset = (size_t)fragment * NET_FRAGMENT_PAYLOAD;
+
+    // the count comes from the packet, it's checked before indexing with it
+    if (fragmentsCount == 0 || fragmentsCount > client->fragmentsCapacity) {
+        return false;
+    }
+    if (sequence <= client->latest || sequence < client->assemblySequence ||
+        fragment >= fragmentsCount || offset + length > client->payloadCapacity) {
+        return false;
+    }
+    if (sequence == client->assemblySequence &&
+        fragmentsCount != client->fragmentsCount) {
+        return false;
+    }
+
+    if (sequence != client->assemblySequence) {
+        // a newer snapshot replaces any unfinished one
+        if (client->fragmentsReceived < client->fragmentsCount) {
+            client->stats.snapshotsDropped += client->assemblySequence != 0;
+        }
+        client->assemblySequence = sequence;
+        client->assemblyBase = baseSequence;
+        client->fragmentsCount = fragmentsCount;
+        client->fragmentsReceived = 0;
+        memset(client->fragmentReceived, 0, sizeof(bool) * fragmentsCount);
+    }
+
+    if (client->fragmentReceived[fragment]) {
+        return false;
+    }
+    client->fragmentReceived[fragment] = true;
+    ++client->fragmentsReceived;
+
+    memcpy(client->payload + offset, packet + NET_FRAGMENT_HEADER, length);
+    if (fragment == fragmentsCount - 1) {
+        client->payloadSize = offset + length;
+    }
+
+    return client->fragmentsReceived == client->fragmentsCount &&
+           completeSnapshot(client);
+}
+
+int NetClientReceive(NetClient *client) {
+    unsigned char packet[NET_MAX_PACKET];
+    int completed = 0;
+    ssize_t size;
+
+    while ((size = recv(client->socket, packet, sizeof(packet), 0)) >= 0) {
+        client->stats.bytesReceived += (size_t)size;
+        ++client->stats.packetsReceived;
+        completed += receiveFragment(client, packet, (size_t)size);
+    }
+
+    return completed;
+}
+
+bool NetClientInterpolate(const NetClient *client, int entityId, float t,
+                          NetEntityState *out) {
+    const NetSnapshot *to = findSnapshot(client->history, client->latest);
+    const NetSnapshot *from = findSnapshot(client->history, client->previous);
+    if (to == NULL || entityId < 0 || entityId >= client->maxEntities) {
+        return false;
+    }
+
+    *out = to->entities[entityId];
+    if (from == NULL || !(from->entities[entityId].flags & NET_ENTITY_ACTIVE)) {
+        // just appeared, nothing to blend with
+        return out->flags & NET_ENTITY_ACTIVE;
+    }
+
+    const NetEntityState *a = &from->entities[entityId];
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    out->x = a->x + (int32_t)lroundf((float)(out->x - a->x) * t);
+    out->y = a->y + (int32_t)lroundf((float)(out->y - a->y) * t);
+
+    // shortest way around the circle
+    int16_t turn = (int16_t)(out->rotation - a->rotation);
+    out->rotation = (uint16_t)(a->rotation + (int)lroundf(turn * t));
+
+    return out->flags & NET_ENTITY_ACTIVE;
+}
@@ -0,0 +1,118 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+#include "utils.h"
+
+// positions travel as fixed point with 1/16 pixel precision
+#define NET_POSITION_SCALE 16.0f
+
+#define NET_MAX_PACKET      1200
+#define NET_MAX_CLIENTS     4
+#define NET_HISTORY         8
+#define NET_SOCKET_BUF_SIZE Megabyte(4)
+
+// no snapshot acknowledged yet, deltas are taken against an empty world
+#define NET_NO_SEQUENCE 0
+
+typedef enum {
+    NET_ENTITY_ACTIVE = 1 << 0,
+    NET_ENTITY_FLIP_X = 1 << 1,
+    NET_ENTITY_FLIP_Y = 1 << 2
+} NetEntityFlags;
+
+// Replicated state of one entity, indexed by entity id
+typedef struct NetEntityState {
+    int32_t x, y;
+    uint16_t rotation;
+    uint8_t animFrame;
+    uint8_t flags;
+} NetEntityState;
+
+typedef struct NetSnapshot {
+    uint32_t sequence;
+    NetEntityState *entities;
+} NetSnapshot;
+
+typedef struct NetStats {
+    size_t bytesSent, packetsSent;
+    size_t bytesReceived, packetsReceived;
+    size_t snapshotsDropped;
+} NetStats;
+
+typedef struct NetPeer {
+    bool connected;
+    struct sockaddr_in address;
+    uint32_t ackedSequence;
+} NetPeer;
+
+typedef struct NetServer {
+    int socket;
+    uint16_t port;
+    int maxEntities;
+
+    // snapshots sent recently, any of them can be a client's delta base
+    NetSnapshot history[NET_HISTORY];
+    uint32_t sequence;
+
+    NetPeer peers[NET_MAX_CLIENTS];
+
+    // encoded snapshots waiting to be sent, see NetServerFlush
+    unsigned char *payload;
+    size_t payloadCapacity;
+    unsigned char *outgoing;
+    size_t outgoingSize, outgoingCapacity, outgoingSent;
+
+    NetStats stats;
+} NetServer;
+
+typedef struct NetClient {
+    int socket;
+    int maxEntities;
+    struct sockaddr_in server;
+
+    // decoded snapshots, the newest two are interpolated
+    NetSnapshot history[NET_HISTORY];
+    uint32_t latest, previous;
+
+    // fragments of the snapshot being received
+    unsigned char *payload;
+    size_t payloadCapacity;
+    size_t payloadSize;
+    uint32_t assemblySequence, assemblyBase;
+    int fragmentsCount, fragmentsReceived;
+    int fragmentsCapacity;
+    bool *fragmentReceived;
+
+    NetStats stats;
+} NetClient;
+
+int32_t NetQuantize(float value);
+float NetDequantize(int32_t value);
+uint16_t NetQuantizeAngle(float degrees);
+float NetDequantizeAngle(uint16_t angle);
+
+size_t NetSnapshotEncode(const NetSnapshot *base, const NetSnapshot *current,
+                         int maxEntities, unsigned char *out, size_t outCapacity);
+int NetSnapshotDecode(const NetSnapshot *base, const unsigned char *data, size_t size,
+                      int maxEntities, NetSnapshot *out);
+
+int NetServerInit(NetServer *server, Arena *arena, int maxEntities, uint16_t port);
+void NetServerClose(NetServer *server);
+NetSnapshot *NetServerNextSnapshot(NetServer *server);
+void NetServerSend(NetServer *server);
+size_t NetServerFlush(NetServer *server, int maxPackets);
+void NetServerReceive(NetServer *server);
+
+int NetClientInit(NetClient *client, Arena *arena, int maxEntities,
+                  const char *serverHost, uint16_t serverPort);
+void NetClientClose(NetClient *client);
+int NetClientReceive(NetClient *client);
+bool NetClientInterpolate(const NetClient *client, int entityId, float t,
+                          NetEntityState *out);
+
+#endif // !NET_H
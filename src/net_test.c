@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "minunit.h"
+#include "net.c"
+#include "net.h"
+#include "utils.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOOPBACK_TICKS 30
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testQuantize(void);
+static char *testSnapshotDelta(void);
+static char *testForgedFragments(void);
+static char *testLoopback(void);
+static char *testLoopbackCost(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static uint32_t nextRandom(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void fillWorld(NetSnapshot *snapshot, int count) {
+    for (int id = 0; id < count; ++id) {
+        NetEntityState *state = &snapshot->entities[id];
+        state->x = NetQuantize((float)(id % 256) * 32.0f);
+        state->y = NetQuantize((float)(id / 256) * 32.0f);
+        state->flags = NET_ENTITY_ACTIVE;
+    }
+}
+
+// a tenth of the world walks around every tick, the rest stands still
+static void stepWorld(const NetSnapshot *prev, NetSnapshot *next, int count,
+                      uint32_t *seed) {
+    memcpy(next->entities, prev->entities, sizeof(NetEntityState) * count);
+    for (int i = 0; i < count / 10; ++i) {
+        NetEntityState *state = &next->entities[nextRandom(seed) % count];
+        state->x += (int32_t)(nextRandom(seed) % 64) - 32;
+        state->y += (int32_t)(nextRandom(seed) % 64) - 32;
+        state->animFrame = (state->animFrame + 1) % 4;
+    }
+}
+
+static void pump(NetServer *server, NetClient *client) {
+    // keep the client's socket buffer from overflowing on full snapshots
+    while (NetServerFlush(server, 64) > 0) {
+        NetClientReceive(client);
+    }
+    NetClientReceive(client);
+    NetServerReceive(server);
+}
+
+static double elapsedUs(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static char *testQuantize(void) {
+    float values[] = {0.0f, 1.0f / 16.0f, -3.3f, 1234.567f, -98765.4f};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        float back = NetDequantize(NetQuantize(values[i]));
+        MU_ASSERT_FMT(fabsf(back - values[i]) <= 0.5f / NET_POSITION_SCALE,
+                      "Expected %f, but got %f", values[i], back);
+    }
+
+    MU_ASSERT_FMT(NetQuantizeAngle(-90.0f) == NetQuantizeAngle(270.0f),
+                  "Expected %u, but got %u", NetQuantizeAngle(270.0f),
+                  NetQuantizeAngle(-90.0f));
+    MU_ASSERT_FMT(fabsf(NetDequantizeAngle(NetQuantizeAngle(45.0f)) - 45.0f) < 0.01f,
+                  "Expected %f, but got %f", 45.0f,
+                  NetDequantizeAngle(NetQuantizeAngle(45.0f)));
+
+    MU_PASS;
+}
+
+static char *testSnapshotDelta(void) {
+    enum { count = 1000 };
+    static NetEntityState baseStates[count], currStates[count], outStates[count];
+    static unsigned char buffer[count * NET_MAX_RECORD];
+    NetSnapshot base = {.sequence = 1, .entities = baseStates};
+    NetSnapshot current = {.sequence = 2, .entities = currStates};
+    NetSnapshot out = {.entities = outStates};
+    uint32_t seed = 1;
+
+    fillWorld(&base, count);
+    stepWorld(&base, &current, count, &seed);
+    current.entities[count - 1].flags = 0;
+    current.entities[7].rotation = NetQuantizeAngle(200.0f);
+
+    size_t size = NetSnapshotEncode(&base, &current, count, buffer, sizeof(buffer));
+    MU_ASSERT(size > 0 && size < count, "Expected a small delta");
+    MU_ASSERT(NetSnapshotDecode(&base, buffer, size, count, &out) == 0,
+              "Expected the delta to decode");
+    MU_ASSERT(memcmp(outStates, currStates, sizeof(currStates)) == 0,
+              "Expected the decoded snapshot to match");
+
+    size = NetSnapshotEncode(NULL, &current, count, buffer, sizeof(buffer));
+    MU_ASSERT(NetSnapshotDecode(NULL, buffer, size, count, &out) == 0,
+              "Expected the full snapshot to decode");
+    MU_ASSERT(memcmp(outStates, currStates, sizeof(currStates)) == 0,
+              "Expected the full snapshot to match");
+
+    size = NetSnapshotEncode(&current, &current, count, buffer, sizeof(buffer));
+    MU_ASSERT_FMT(size == 0, "Expected an empty delta, but got %lu bytes", size);
+
+    // an id gap without its field mask
+    unsigned char truncated[] = {0x00};
+    MU_ASSERT(NetSnapshotDecode(&base, truncated, 1, count, &out) != 0,
+              "Expected a truncated delta to fail");
+
+    MU_PASS;
+}
+
+// a snapshot fragment header followed by a few payload bytes
+static size_t forgeFragment(unsigned char *packet, uint32_t sequence, int fragment,
+                            int fragmentsCount) {
+    unsigned char *out = packet;
+    *out++ = NET_PACKET_SNAPSHOT;
+    out = writeU32(out, sequence);
+    out = writeU32(out, NET_NO_SEQUENCE);
+    out = writeU16(out, (uint16_t)fragment);
+    out = writeU16(out, (uint16_t)fragmentsCount);
+    memset(out, 0, 8);
+    return (size_t)(out - packet) + 8;
+}
+
+static char *testForgedFragments(void) {
+    enum { count = 1000 };
+    Arena arena;
+    NetClient client;
+    unsigned char packet[NET_MAX_PACKET];
+
+    ArenaInit(&arena, malloc(Megabyte(1)), Megabyte(1));
+    MU_ASSERT(NetClientInit(&client, &arena, count, "127.0.0.1", 9) == 0,
+              "Expected a client");
+    MU_ASSERT(2 < client.fragmentsCapacity && client.fragmentsCapacity < 0xffff,
+              "Expected a forgeable count");
+
+    // counts past what was allocated, or none at all, touch nothing
+    size_t size = forgeFragment(packet, 5, 0, 0xffff);
+    MU_ASSERT(!receiveFragment(&client, packet, size), "Expected a huge count dropped");
+    size = forgeFragment(packet, 5, 0, client.fragmentsCapacity + 1);
+    MU_ASSERT(!receiveFragment(&client, packet, size), "Expected a big count dropped");
+    size = forgeFragment(packet, 5, 0, 0);
+    MU_ASSERT(!receiveFragment(&client, packet, size), "Expected no count dropped");
+    MU_ASSERT_FMT(client.assemblySequence == 0 && client.fragmentsCount == 0,
+                  "Expected no assembly, but got sequence %u with %d fragments",
+                  client.assemblySequence, client.fragmentsCount);
+
+    // a real one starts assembling, a later count for it that differs is dropped
+    size = forgeFragment(packet, 5, 0, 2);
+    MU_ASSERT(!receiveFragment(&client, packet, size), "Expected one of two fragments");
+    MU_ASSERT(client.assemblySequence == 5 && client.fragmentsReceived == 1,
+              "Expected the fragment kept");
+    size = forgeFragment(packet, 5, 1, 3);
+    MU_ASSERT(!receiveFragment(&client, packet, size), "Expected a new count dropped");
+    MU_ASSERT_FMT(client.fragmentsCount == 2 && client.fragmentsReceived == 1,
+                  "Expected 1 of 2 fragments, but got %d of %d",
+                  client.fragmentsReceived, client.fragmentsCount);
+
+    NetClientClose(&client);
+    free(arena.buff);
+
+    MU_PASS;
+}
+
+static char *testLoopback(void) {
+    enum { count = 1000 };
+    Arena arena;
+    NetServer server;
+    NetClient client;
+    uint32_t seed = 7;
+
+    ArenaInit(&arena, malloc(Megabyte(4)), Megabyte(4));
+    MU_ASSERT(NetServerInit(&server, &arena, count, 0) == 0, "Expected a server");
+    MU_ASSERT(NetClientInit(&client, &arena, count, "127.0.0.1", server.port) == 0,
+              "Expected a client");
+    NetServerReceive(&server);
+
+    NetSnapshot *prev = NetServerNextSnapshot(&server);
+    fillWorld(prev, count);
+    NetServerSend(&server);
+    pump(&server, &client);
+
+    for (int tick = 1; tick < LOOPBACK_TICKS; ++tick) {
+        NetSnapshot *next = NetServerNextSnapshot(&server);
+        stepWorld(prev, next, count, &seed);
+        NetServerSend(&server);
+        pump(&server, &client);
+        prev = next;
+    }
+
+    MU_ASSERT_FMT(client.latest == server.sequence, "Expected sequence %u, but got %u",
+                  server.sequence, client.latest);
+    MU_ASSERT_FMT(server.peers[0].ackedSequence == server.sequence,
+                  "Expected ack %u, but got %u", server.sequence,
+                  server.peers[0].ackedSequence);
+    const NetSnapshot *received = findSnapshot(client.history, client.latest);
+    MU_ASSERT(memcmp(received->entities, prev->entities,
+                     sizeof(NetEntityState) * count) == 0,
+              "Expected the client to match the server");
+
+    // halfway between the last two snapshots
+    const NetSnapshot *older = findSnapshot(client.history, client.previous);
+    for (int id = 0; id < count; ++id) {
+        NetEntityState state;
+        MU_ASSERT(NetClientInterpolate(&client, id, 0.5f, &state),
+                  "Expected an active entity");
+        int32_t lo = older->entities[id].x < received->entities[id].x
+                         ? older->entities[id].x
+                         : received->entities[id].x;
+        int32_t hi = older->entities[id].x ^ received->entities[id].x ^ lo;
+        MU_ASSERT_FMT(lo <= state.x && state.x <= hi,
+                      "Entity %d: expected x in [%d, %d], but got %d", id, lo, hi,
+                      state.x);
+    }
+
+    NetClientClose(&client);
+    NetServerClose(&server);
+    free(arena.buff);
+
+    MU_PASS;
+}
+
+static char *testLoopbackCost(void) {
+    const int counts[] = {1000, 10000, 50000};
+
+    printf("%8s %12s %12s %14s %14s\n", "entities", "full bytes", "bytes/tick",
+           "server us/tick", "client us/tick");
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        int count = counts[c];
+        Arena arena;
+        NetServer server;
+        NetClient client;
+        uint32_t seed = 42;
+
+        ArenaInit(&arena, malloc(Megabyte(32)), Megabyte(32));
+        MU_ASSERT(NetServerInit(&server, &arena, count, 0) == 0, "Expected a server");
+        MU_ASSERT(NetClientInit(&client, &arena, count, "127.0.0.1", server.port) == 0,
+                  "Expected a client");
+        NetServerReceive(&server);
+
+        NetSnapshot *prev = NetServerNextSnapshot(&server);
+        fillWorld(prev, count);
+        NetServerSend(&server);
+        pump(&server, &client);
+        size_t fullBytes = server.stats.bytesSent;
+
+        double serverUs = 0.0, clientUs = 0.0;
+        for (int tick = 1; tick < LOOPBACK_TICKS; ++tick) {
+            struct timespec t0, t1, t2;
+            NetSnapshot *next = NetServerNextSnapshot(&server);
+            stepWorld(prev, next, count, &seed);
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            NetServerSend(&server);
+            NetServerFlush(&server, 0);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            NetClientReceive(&client);
+            NetServerReceive(&server);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+
+            serverUs += elapsedUs(t0, t1);
+            clientUs += elapsedUs(t1, t2);
+            prev = next;
+        }
+
+        int ticks = LOOPBACK_TICKS - 1;
+        printf("%8d %12lu %12lu %14.1f %14.1f\n", count, fullBytes,
+               (server.stats.bytesSent - fullBytes) / ticks, serverUs / ticks,
+               clientUs / ticks);
+
+        MU_ASSERT_FMT(client.latest == server.sequence,
+                      "%d entities: expected sequence %u, but got %u", count,
+                      server.sequence, client.latest);
+        MU_ASSERT_FMT(client.stats.snapshotsDropped == 0,
+                      "%d entities: expected no dropped snapshots, but got %lu", count,
+                      client.stats.snapshotsDropped);
+
+        NetClientClose(&client);
+        NetServerClose(&server);
+        free(arena.buff);
+    }
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testQuantize);
+    MU_TEST(testSnapshotDelta);
+    MU_TEST(testForgedFragments);
+    MU_TEST(testLoopback);
+    MU_TEST(testLoopbackCost);
+
+    MU_PASS;
+}
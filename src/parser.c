@@ -0,0 +1,220 @@
+#include "parser.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool isDelimiter(char c) {
+    return c == '\0' || c == '\n' || isBlank(c);
+}
+
+static void skipBlanks(Scanner *s) {
+    while (isBlank(*s->cursor)) {
+        ++s->cursor;
+    }
+}
+
+void ScannerInit(Scanner *s, const char *filename, const char *text) {
+    s->filename = filename;
+    s->cursor = text;
+    s->lineStart = text;
+    s->line = 1;
+    s->error[0] = '\0';
+}
+
+int ScannerColumn(const Scanner *s) {
+    return (int)(s->cursor - s->lineStart) + 1;
+}
+
+bool ScannerFail(Scanner *s, const char *format, ...) {
+    va_list args;
+    int len = snprintf(s->error, SCANNER_ERROR_LEN, "%s:%d:%d: ", s->filename, s->line,
+                       ScannerColumn(s));
+
+    va_start(args, format);
+    if (len >= 0 && len < SCANNER_ERROR_LEN) {
+        vsnprintf(s->error + len, SCANNER_ERROR_LEN - len, format, args);
+    }
+    va_end(args);
+
+    return false;
+}
+
+bool ScannerAtEnd(Scanner *s) {
+    return *s->cursor == '\0';
+}
+
+void ScanSkipBlankLines(Scanner *s) {
+    for (;;) {
+        const char *p = s->cursor;
+        while (isBlank(*p)) {
+            ++p;
+        }
+        if (*p != '\n') {
+            // stop at the start of a line with content, or at the end
+            if (*p == '\0') {
+                s->cursor = p;
+            }
+            return;
+        }
+        s->cursor = p + 1;
+        s->lineStart = s->cursor;
+        ++s->line;
+    }
+}
+
+bool ScanWord(Scanner *s, Token *token) {
+    skipBlanks(s);
+    if (isDelimiter(*s->cursor)) {
+        return ScannerFail(s, "expected a name");
+    }
+
+    token->start = s->cursor;
+    while (!isDelimiter(*s->cursor)) {
+        ++s->cursor;
+    }
+    token->length = (int)(s->cursor - token->start);
+    return true;
+}
+
+bool ScanInt(Scanner *s, int *value) {
+    skipBlanks(s);
+
+    const char *p = s->cursor;
+    bool negative = *p == '-';
+    if (negative) {
+        ++p;
+    }
+    if (!isDigit(*p)) {
+        return ScannerFail(s, "expected an integer");
+    }
+
+    long long accum = 0;
+    while (isDigit(*p)) {
+        accum = accum * 10 + (*p++ - '0');
+        if (accum > INT_MAX) {
+            return ScannerFail(s, "integer out of range");
+        }
+    }
+    if (!isDelimiter(*p)) {
+        return ScannerFail(s, "expected an integer");
+    }
+
+    *value = negative ? (int)-accum : (int)accum;
+    s->cursor = p;
+    return true;
+}
+
+bool ScanFloat(Scanner *s, float *value) {
+    skipBlanks(s);
+
+    const char *p = s->cursor;
+    bool negative = *p == '-';
+    if (negative) {
+        ++p;
+    }
+    if (!isDigit(*p) && !(*p == '.' && isDigit(p[1]))) {
+        return ScannerFail(s, "expected a number");
+    }
+
+    double accum = 0.0;
+    while (isDigit(*p)) {
+        accum = accum * 10.0 + (*p++ - '0');
+    }
+    if (*p == '.') {
+        double scale = 0.1;
+        for (++p; isDigit(*p); ++p) {
+            accum += (*p - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    if (!isDelimiter(*p)) {
+        return ScannerFail(s, "expected a number");
+    }
+
+    *value = (float)(negative ? -accum : accum);
+    s->cursor = p;
+    return true;
+}
+
+bool ScanEndLine(Scanner *s) {
+    skipBlanks(s);
+    if (*s->cursor == '\0') {
+        return true;
+    }
+    if (*s->cursor != '\n') {
+        return ScannerFail(s, "expected end of line");
+    }
+
+    ++s->cursor;
+    s->lineStart = s->cursor;
+    ++s->line;
+    return true;
+}
+
+bool ScanTileGrid(Scanner *s, int width, int height, int firstTile, int tilesCount,
+                  uint16_t *tiles) {
+    for (int y = 0; y < height; ++y) {
+        if (*s->cursor == '\0') {
+            return ScannerFail(s, "expected %d rows, got %d", height, y);
+        }
+
+        for (int x = 0; x < width; ++x) {
+            skipBlanks(s);
+
+            const char *p = s->cursor;
+            if (!isDigit(*p)) {
+                if (*p == '\n' || *p == '\0') {
+                    return ScannerFail(s, "expected %d columns, got %d", width, x);
+                }
+                return ScannerFail(s, "expected a tile id");
+            }
+
+            // ids are small, stop before they could overflow
+            int tile = 0;
+            while (isDigit(*p) && tile < tilesCount) {
+                tile = tile * 10 + (*p++ - '0');
+            }
+            if (tile >= tilesCount || isDigit(*p)) {
+                return ScannerFail(s, "tile id out of range [0, %d)", tilesCount);
+            }
+            if (!isDelimiter(*p)) {
+                return ScannerFail(s, "expected a tile id");
+            }
+
+            *tiles++ = (uint16_t)(firstTile + tile);
+            s->cursor = p;
+        }
+
+        skipBlanks(s);
+        if (*s->cursor != '\n' && *s->cursor != '\0') {
+            return ScannerFail(s, "expected %d columns, got more", width);
+        }
+        ScanEndLine(s);
+    }
+
+    return true;
+}
+
+bool TokenEquals(Token token, const char *str) {
+    return strncmp(token.start, str, token.length) == 0 && str[token.length] == '\0';
+}
+
+bool TokenCopy(Token token, char *buffer, size_t bufferLen) {
+    if ((size_t)token.length >= bufferLen) {
+        return false;
+    }
+
+    memcpy(buffer, token.start, token.length);
+    buffer[token.length] = '\0';
+    return true;
+}
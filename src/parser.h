@@ -0,0 +1,44 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCANNER_ERROR_LEN 256
+
+typedef struct Token {
+    const char *start;
+    int length;
+} Token;
+
+// Reads text files in place, one token at a time. Nothing is allocated,
+// tokens point into the scanned buffer.
+typedef struct Scanner {
+    const char *filename;
+    const char *cursor;
+    const char *lineStart;
+    int line;
+    char error[SCANNER_ERROR_LEN];
+} Scanner;
+
+void ScannerInit(Scanner *s, const char *filename, const char *text);
+bool ScannerFail(Scanner *s, const char *format, ...);
+bool ScannerAtEnd(Scanner *s);
+int ScannerColumn(const Scanner *s);
+
+void ScanSkipBlankLines(Scanner *s);
+bool ScanWord(Scanner *s, Token *token);
+bool ScanInt(Scanner *s, int *value);
+bool ScanFloat(Scanner *s, float *value);
+bool ScanEndLine(Scanner *s);
+
+// Reads 'height' lines of 'width' tile ids in [0, tilesCount) and stores
+// them offset by 'firstTile'.
+bool ScanTileGrid(Scanner *s, int width, int height, int firstTile, int tilesCount,
+                  uint16_t *tiles);
+
+bool TokenEquals(Token token, const char *str);
+bool TokenCopy(Token token, char *buffer, size_t bufferLen);
+
+#endif // !PARSER_H
@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parser.c"
+#include "parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAP_SIDE     1024
+#define MAP_LAYERS   3
+#define MAP_TILESET  89
+#define BENCH_ROUNDS 5
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *generateMap(size_t *len) {
+    // at most 3 chars per tile, including the separator
+    size_t cap = (size_t)MAP_LAYERS * MAP_SIDE * (MAP_SIDE * 3 + 1) + MAP_LAYERS + 1;
+    char *text = malloc(cap);
+    char *p = text;
+    unsigned int seed = 42;
+
+    for (int layer = 0; layer < MAP_LAYERS; ++layer) {
+        for (int y = 0; y < MAP_SIDE; ++y) {
+            for (int x = 0; x < MAP_SIDE; ++x) {
+                seed = seed * 1103515245u + 12345u;
+                int tile = (seed >> 16) % MAP_TILESET;
+                p += sprintf(p, x + 1 < MAP_SIDE ? "%d " : "%d\n", tile);
+            }
+        }
+        *p++ = '\n';
+    }
+    *p = '\0';
+
+    *len = p - text;
+    return text;
+}
+
+// What loadMap used to do before the scanner
+static int parseStrtok(char *text, uint16_t *tiles) {
+    char *endLine;
+    int tileAccum = 0;
+    char *lineToken = strtok_r(text, "\n", &endLine);
+
+    while (lineToken != NULL) {
+        char *endColumn;
+        char *columnToken = strtok_r(lineToken, " ", &endColumn);
+        while (columnToken != NULL) {
+            int tile;
+            sscanf(columnToken, "%d", &tile);
+            tiles[tileAccum++] = tile;
+            columnToken = strtok_r(NULL, " ", &endColumn);
+        }
+        lineToken = strtok_r(NULL, "\n", &endLine);
+    }
+
+    return tileAccum;
+}
+
+static int parseScanner(const char *text, uint16_t *tiles) {
+    Scanner s;
+    int tileAccum = 0;
+
+    ScannerInit(&s, "bench.map", text);
+    for (int layer = 0; layer < MAP_LAYERS; ++layer) {
+        ScanSkipBlankLines(&s);
+        if (!ScanTileGrid(&s, MAP_SIDE, MAP_SIDE, 0, MAP_TILESET, &tiles[tileAccum])) {
+            printf("%s\n", s.error);
+            return -1;
+        }
+        tileAccum += MAP_SIDE * MAP_SIDE;
+    }
+
+    return tileAccum;
+}
+
+static void report(const char *name, double bestMs, size_t len) {
+    printf("%-10s %9.2f ms %9.1f MB/s\n", name, bestMs, len / (bestMs * 1e3));
+}
+
+int main(void) {
+    size_t len;
+    char *text = generateMap(&len);
+    char *scratch = malloc(len + 1);
+    uint16_t *tiles = malloc(sizeof(uint16_t) * MAP_LAYERS * MAP_SIDE * MAP_SIDE);
+    uint16_t *expected = malloc(sizeof(uint16_t) * MAP_LAYERS * MAP_SIDE * MAP_SIDE);
+    double bestStrtok = 1e9, bestScanner = 1e9;
+
+    printf("Parsing a %dx%d map with %d layers (%.1f MB), best of %d\n", MAP_SIDE,
+           MAP_SIDE, MAP_LAYERS, len / 1e6, BENCH_ROUNDS);
+
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        // strtok writes into the buffer, give it a fresh copy
+        memcpy(scratch, text, len + 1);
+        double start = nowMs();
+        int count = parseStrtok(scratch, expected);
+        double elapsed = nowMs() - start;
+        bestStrtok = elapsed < bestStrtok ? elapsed : bestStrtok;
+        if (count != MAP_LAYERS * MAP_SIDE * MAP_SIDE) {
+            printf("strtok parsed %d tiles\n", count);
+            return 1;
+        }
+
+        start = nowMs();
+        count = parseScanner(text, tiles);
+        elapsed = nowMs() - start;
+        bestScanner = elapsed < bestScanner ? elapsed : bestScanner;
+        if (count != MAP_LAYERS * MAP_SIDE * MAP_SIDE ||
+            memcmp(tiles, expected, sizeof(uint16_t) * count) != 0) {
+            printf("scanner result doesn't match strtok\n");
+            return 1;
+        }
+    }
+
+    report("strtok", bestStrtok, len);
+    report("scanner", bestScanner, len);
+    printf("speedup    %9.1fx\n", bestStrtok / bestScanner);
+
+    free(text);
+    free(scratch);
+    free(tiles);
+    free(expected);
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "minunit.h"
+#include "parser.c"
+#include "parser.h"
+#include <stdio.h>
+#include <string.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testScanLine(void);
+static char *testScanErrorPosition(void);
+static char *testScanTileGrid(void);
+static char *testScanTileGridColumns(void);
+static char *testScanTileGridRange(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static char *testScanLine(void) {
+    Scanner s;
+    Token name;
+    int frames;
+    float duration;
+
+    ScannerInit(&s, "test.anim", "\n  \npoliceman_run 4 0.125\r\n\n");
+    ScanSkipBlankLines(&s);
+
+    MU_ASSERT(ScanWord(&s, &name), "Expected a name");
+    MU_ASSERT(TokenEquals(name, "policeman_run"), "Expected policeman_run");
+    MU_ASSERT(ScanInt(&s, &frames), "Expected an integer");
+    MU_ASSERT_FMT(4 == frames, "Expected %d, but got %d", 4, frames);
+    MU_ASSERT(ScanFloat(&s, &duration), "Expected a number");
+    MU_ASSERT_FMT(0.125f == duration, "Expected %f, but got %f", 0.125f, duration);
+    MU_ASSERT(ScanEndLine(&s), "Expected end of line");
+
+    ScanSkipBlankLines(&s);
+    MU_ASSERT(ScannerAtEnd(&s), "Expected end of text");
+    MU_ASSERT_FMT(5 == s.line, "Expected line %d, but got %d", 5, s.line);
+
+    MU_PASS;
+}
+
+static char *testScanErrorPosition(void) {
+    Scanner s;
+    Token name;
+    int x, y;
+
+    ScannerInit(&s, "test.sprite", "rifle 32 0\nammo 1x 0\n");
+    MU_ASSERT(ScanWord(&s, &name) && ScanInt(&s, &x) && ScanInt(&s, &y) &&
+                  ScanEndLine(&s),
+              "Expected first line to be valid");
+
+    MU_ASSERT(ScanWord(&s, &name), "Expected a name");
+    MU_ASSERT(!ScanInt(&s, &x), "Expected invalid integer");
+    MU_ASSERT_FMT(strcmp("test.sprite:2:6: expected an integer", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    ScannerInit(&s, "test.sprite", "rifle 32 0 7");
+    MU_ASSERT(ScanWord(&s, &name) && ScanInt(&s, &x) && ScanInt(&s, &y),
+              "Expected valid tokens");
+    MU_ASSERT(!ScanEndLine(&s), "Expected trailing token to fail");
+    MU_ASSERT_FMT(strcmp("test.sprite:1:12: expected end of line", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    MU_PASS;
+}
+
+static char *testScanTileGrid(void) {
+    Scanner s;
+    uint16_t tiles[6];
+    uint16_t expected[] = {10, 11, 12, 15, 14, 13};
+
+    ScannerInit(&s, "test.map", "0 1 2 \n5 4 3\n");
+    MU_ASSERT_FMT(ScanTileGrid(&s, 3, 2, 10, 6, tiles), "Unexpected error '%s'",
+                  s.error);
+    for (int i = 0; i < 6; ++i) {
+        MU_ASSERT_FMT(expected[i] == tiles[i], "At index %d, expected %d, but got %d",
+                      i, expected[i], tiles[i]);
+    }
+    MU_ASSERT(ScannerAtEnd(&s), "Expected end of text");
+
+    MU_PASS;
+}
+
+static char *testScanTileGridColumns(void) {
+    Scanner s;
+    uint16_t tiles[6];
+
+    ScannerInit(&s, "test.map", "0 1 2\n5 4\n");
+    MU_ASSERT(!ScanTileGrid(&s, 3, 2, 0, 6, tiles), "Expected missing column");
+    MU_ASSERT_FMT(strcmp("test.map:2:4: expected 3 columns, got 2", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    ScannerInit(&s, "test.map", "0 1 2 3\n");
+    MU_ASSERT(!ScanTileGrid(&s, 3, 1, 0, 6, tiles), "Expected extra column");
+    MU_ASSERT_FMT(strcmp("test.map:1:7: expected 3 columns, got more", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    ScannerInit(&s, "test.map", "0 1 2\n");
+    MU_ASSERT(!ScanTileGrid(&s, 3, 2, 0, 6, tiles), "Expected missing row");
+    MU_ASSERT_FMT(strcmp("test.map:2:1: expected 2 rows, got 1", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    MU_PASS;
+}
+
+static char *testScanTileGridRange(void) {
+    Scanner s;
+    uint16_t tiles[3];
+
+    ScannerInit(&s, "test.map", "0 6 2\n");
+    MU_ASSERT(!ScanTileGrid(&s, 3, 1, 0, 6, tiles), "Expected out of range");
+    MU_ASSERT_FMT(strcmp("test.map:1:3: tile id out of range [0, 6)", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    ScannerInit(&s, "test.map", "0 -1 2\n");
+    MU_ASSERT(!ScanTileGrid(&s, 3, 1, 0, 6, tiles), "Expected negative id");
+    MU_ASSERT_FMT(strcmp("test.map:1:3: expected a tile id", s.error) == 0,
+                  "Unexpected error '%s'", s.error);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testScanLine);
+    MU_TEST(testScanErrorPosition);
+    MU_TEST(testScanTileGrid);
+    MU_TEST(testScanTileGridColumns);
+    MU_TEST(testScanTileGridRange);
+    MU_PASS;
+}
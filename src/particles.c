@@ -0,0 +1,151 @@
+#include "particles.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define DEG2RADF (3.14159265f / 180.0f)
+
+int ParticlePoolInit(ParticlePool *pool, Arena *arena, int capacity) {
+    // room for a full vector past the last particle
+    capacity = (capacity + PARTICLE_LANES - 1) & ~(PARTICLE_LANES - 1);
+    size_t floats = sizeof(float) * capacity;
+    size_t align = sizeof(float) * PARTICLE_LANES;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->capacity = capacity;
+    pool->seed = 0x9E3779B9u;
+
+    pool->x = ArenaAllocAligned(arena, floats, align);
+    pool->y = ArenaAllocAligned(arena, floats, align);
+    pool->vx = ArenaAllocAligned(arena, floats, align);
+    pool->vy = ArenaAllocAligned(arena, floats, align);
+    pool->gravity = ArenaAllocAligned(arena, floats, align);
+    pool->life = ArenaAllocAligned(arena, floats, align);
+    pool->alpha = ArenaAllocAligned(arena, floats, align);
+    pool->fade = ArenaAllocAligned(arena, floats, align);
+    pool->size = ArenaAllocAligned(arena, floats, align);
+    pool->colorStart = ArenaAllocAligned(arena, sizeof(uint32_t) * capacity, align);
+    pool->colorEnd = ArenaAllocAligned(arena, sizeof(uint32_t) * capacity, align);
+
+    return pool->colorEnd == NULL;
+}
+
+void ParticlePoolReset(ParticlePool *pool) {
+    pool->count = 0;
+}
+
+static float randomRange(uint32_t *seed, float min, float max) {
+    // xorshift32
+    uint32_t s = *seed;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    *seed = s;
+    return min + (max - min) * (float)(s >> 8) * (1.0f / 16777216.0f);
+}
+
+int ParticlesEmit(ParticlePool *pool, const ParticleEmitter *emitter, float x, float y,
+                  float angle) {
+    int count = emitter->burst;
+    if (count > pool->capacity - pool->count) {
+        count = pool->capacity - pool->count;
+    }
+
+    uint32_t colorStart, colorEnd;
+    memcpy(&colorStart, emitter->colorStart, sizeof(colorStart));
+    memcpy(&colorEnd, emitter->colorEnd, sizeof(colorEnd));
+
+    for (int i = pool->count; i < pool->count + count; ++i) {
+        float life = randomRange(&pool->seed, emitter->lifeMin, emitter->lifeMax);
+        float speed = randomRange(&pool->seed, emitter->speedMin, emitter->speedMax);
+        float spread = randomRange(&pool->seed, -emitter->spread, emitter->spread);
+        float dir = (angle + spread) * DEG2RADF;
+
+        pool->x[i] = x;
+        pool->y[i] = y;
+        pool->vx[i] = cosf(dir) * speed;
+        pool->vy[i] = sinf(dir) * speed;
+        pool->gravity[i] = emitter->gravity;
+        pool->life[i] = life;
+        pool->alpha[i] = 1.0f;
+        pool->fade[i] = life > 0.0f ? 1.0f / life : 1.0f;
+        pool->size[i] = randomRange(&pool->seed, emitter->sizeMin, emitter->sizeMax);
+        pool->colorStart[i] = colorStart;
+        pool->colorEnd[i] = colorEnd;
+    }
+
+    pool->count += count;
+    return count;
+}
+
+static void integrate(ParticlePool *pool, float dt) {
+    // padding lanes past count are integrated too, they are never read
+    int count = (pool->count + PARTICLE_LANES - 1) & ~(PARTICLE_LANES - 1);
+
+#ifdef __SSE2__
+    __m128 vdt = _mm_set1_ps(dt);
+    __m128 zero = _mm_setzero_ps();
+    for (int i = 0; i < count; i += PARTICLE_LANES) {
+        __m128 vy = _mm_load_ps(&pool->vy[i]);
+        vy = _mm_add_ps(vy, _mm_mul_ps(_mm_load_ps(&pool->gravity[i]), vdt));
+        _mm_store_ps(&pool->vy[i], vy);
+
+        __m128 x = _mm_load_ps(&pool->x[i]);
+        __m128 y = _mm_load_ps(&pool->y[i]);
+        x = _mm_add_ps(x, _mm_mul_ps(_mm_load_ps(&pool->vx[i]), vdt));
+        y = _mm_add_ps(y, _mm_mul_ps(vy, vdt));
+        _mm_store_ps(&pool->x[i], x);
+        _mm_store_ps(&pool->y[i], y);
+
+        __m128 life = _mm_sub_ps(_mm_load_ps(&pool->life[i]), vdt);
+        _mm_store_ps(&pool->life[i], life);
+
+        __m128 alpha = _mm_load_ps(&pool->alpha[i]);
+        alpha = _mm_sub_ps(alpha, _mm_mul_ps(_mm_load_ps(&pool->fade[i]), vdt));
+        _mm_store_ps(&pool->alpha[i], _mm_max_ps(alpha, zero));
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        pool->vy[i] += pool->gravity[i] * dt;
+        pool->x[i] += pool->vx[i] * dt;
+        pool->y[i] += pool->vy[i] * dt;
+        pool->life[i] -= dt;
+        pool->alpha[i] = fmaxf(pool->alpha[i] - pool->fade[i] * dt, 0.0f);
+    }
+#endif
+}
+
+static void moveParticle(ParticlePool *pool, int from, int to) {
+    pool->x[to] = pool->x[from];
+    pool->y[to] = pool->y[from];
+    pool->vx[to] = pool->vx[from];
+    pool->vy[to] = pool->vy[from];
+    pool->gravity[to] = pool->gravity[from];
+    pool->life[to] = pool->life[from];
+    pool->alpha[to] = pool->alpha[from];
+    pool->fade[to] = pool->fade[from];
+    pool->size[to] = pool->size[from];
+    pool->colorStart[to] = pool->colorStart[from];
+    pool->colorEnd[to] = pool->colorEnd[from];
+}
+
+void ParticlesUpdate(ParticlePool *pool, float dt) {
+    assert(pool->count <= pool->capacity);
+
+    integrate(pool, dt);
+
+    // swap-remove the dead, the moved particle is checked again
+    for (int i = 0; i < pool->count;) {
+        if (pool->life[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+        --pool->count;
+        moveParticle(pool, pool->count, i);
+    }
+}
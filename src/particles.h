@@ -0,0 +1,48 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdint.h>
+
+#include "utils.h"
+
+// particles are updated this many at a time, pools are padded to it
+#define PARTICLE_LANES 4
+
+// Emitter definition, loaded from .emitter asset files
+typedef struct ParticleEmitter {
+    int burst;
+    float lifeMin, lifeMax;
+    float speedMin, speedMax;
+    float spread;
+    float sizeMin, sizeMax;
+    float gravity;
+
+    // RGBA, faded from colorStart to colorEnd over the particle lifetime
+    uint8_t colorStart[4];
+    uint8_t colorEnd[4];
+} ParticleEmitter;
+
+// Live particles are packed at the front of every array, a dead particle
+// is replaced by the last one
+typedef struct ParticlePool {
+    int count, capacity;
+
+    float *x, *y;
+    float *vx, *vy;
+    float *gravity;
+    float *life;
+    float *alpha, *fade;
+    float *size;
+    uint32_t *colorStart, *colorEnd;
+
+    uint32_t seed;
+} ParticlePool;
+
+int ParticlePoolInit(ParticlePool *pool, Arena *arena, int capacity);
+void ParticlePoolReset(ParticlePool *pool);
+
+int ParticlesEmit(ParticlePool *pool, const ParticleEmitter *emitter, float x, float y,
+                  float angle);
+void ParticlesUpdate(ParticlePool *pool, float dt);
+
+#endif // !PARTICLES_H
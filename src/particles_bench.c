@@ -0,0 +1,68 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "particles.c"
+#include "particles.h"
+#include "utils.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LIVE_PARTICLES 100000
+#define BENCH_TICKS    600
+#define TICK_DT        (1.0f / 60.0f)
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(void) {
+    Arena arena;
+    ParticlePool pool;
+
+    // lives long enough that a few percent die and respawn every tick
+    ParticleEmitter emitter = {.burst = 100,
+                               .lifeMin = 0.5f,
+                               .lifeMax = 3.0f,
+                               .speedMin = 10.0f,
+                               .speedMax = 200.0f,
+                               .spread = 180.0f,
+                               .sizeMin = 1.0f,
+                               .sizeMax = 4.0f,
+                               .gravity = 98.0f,
+                               .colorStart = {255, 255, 255, 255}};
+
+    ArenaInit(&arena, malloc(Megabyte(8)), Megabyte(8));
+    ParticlePoolInit(&pool, &arena, LIVE_PARTICLES);
+
+    double total = 0.0, best = 1e9, worst = 0.0;
+    int died = 0;
+    for (int tick = 0; tick < BENCH_TICKS; ++tick) {
+        while (pool.count < LIVE_PARTICLES) {
+            ParticlesEmit(&pool, &emitter, 0.0f, 0.0f, -90.0f);
+        }
+
+        double start = nowMs();
+        ParticlesUpdate(&pool, TICK_DT);
+        double elapsed = nowMs() - start;
+
+        died += LIVE_PARTICLES - pool.count;
+        total += elapsed;
+        best = elapsed < best ? elapsed : best;
+        worst = elapsed > worst ? elapsed : worst;
+    }
+
+#ifdef __SSE2__
+    const char *path = "sse2";
+#else
+    const char *path = "scalar";
+#endif
+    printf("Updating %d particles (%s), %d ticks, %.0f deaths per tick\n",
+           LIVE_PARTICLES, path, BENCH_TICKS, (double)died / BENCH_TICKS);
+    printf("best %7.3f ms  mean %7.3f ms  worst %7.3f ms\n", best, total / BENCH_TICKS,
+           worst);
+
+    free(arena.buff);
+    return 0;
+}
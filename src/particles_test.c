@@ -0,0 +1,91 @@
+#include "minunit.h"
+#include "particles.c"
+#include "particles.h"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testEmitCapacity(void);
+static char *testUpdateRemovesDead(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static char *testEmitCapacity(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    ParticlePool pool;
+    ParticleEmitter emitter = {.burst = 40, .lifeMin = 1.0f, .lifeMax = 1.0f};
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    ParticlePoolInit(&pool, &arena, 50);
+    MU_ASSERT_FMT(52 == pool.capacity, "Expected capacity %d, but got %d", 52,
+                  pool.capacity);
+
+    int emitted = ParticlesEmit(&pool, &emitter, 0.0f, 0.0f, 0.0f);
+    MU_ASSERT_FMT(40 == emitted, "Expected %d particles, but got %d", 40, emitted);
+    emitted = ParticlesEmit(&pool, &emitter, 0.0f, 0.0f, 0.0f);
+    MU_ASSERT_FMT(12 == emitted, "Expected %d particles, but got %d", 12, emitted);
+    MU_ASSERT_FMT(pool.capacity == pool.count, "Expected %d live, but got %d",
+                  pool.capacity, pool.count);
+
+    MU_PASS;
+}
+
+static char *testUpdateRemovesDead(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    ParticlePool pool;
+    ParticleEmitter shortLived = {.burst = 5, .lifeMin = 0.1f, .lifeMax = 0.1f};
+    ParticleEmitter longLived = {
+        .burst = 3, .lifeMin = 2.0f, .lifeMax = 2.0f, .speedMin = 10.0f,
+        .speedMax = 10.0f, .gravity = 5.0f};
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    ParticlePoolInit(&pool, &arena, 16);
+
+    // dead ones interleaved with live ones
+    ParticlesEmit(&pool, &shortLived, 0.0f, 0.0f, 0.0f);
+    ParticlesEmit(&pool, &longLived, 0.0f, 0.0f, 0.0f);
+    ParticlesEmit(&pool, &shortLived, 0.0f, 0.0f, 0.0f);
+
+    ParticlesUpdate(&pool, 0.5f);
+    MU_ASSERT_FMT(3 == pool.count, "Expected %d live, but got %d", 3, pool.count);
+    for (int i = 0; i < pool.count; ++i) {
+        MU_ASSERT_FMT(fabsf(pool.life[i] - 1.5f) < 1e-5f,
+                      "Expected life %f, but got %f", 1.5f, pool.life[i]);
+        MU_ASSERT_FMT(fabsf(pool.alpha[i] - 0.75f) < 1e-5f,
+                      "Expected alpha %f, but got %f", 0.75f, pool.alpha[i]);
+        MU_ASSERT_FMT(fabsf(pool.x[i] - 5.0f) < 1e-4f, "Expected x %f, but got %f",
+                      5.0f, pool.x[i]);
+        MU_ASSERT_FMT(fabsf(pool.vy[i] - 2.5f) < 1e-4f, "Expected vy %f, but got %f",
+                      2.5f, pool.vy[i]);
+    }
+
+    ParticlesUpdate(&pool, 2.0f);
+    MU_ASSERT_FMT(0 == pool.count, "Expected %d live, but got %d", 0, pool.count);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testEmitCapacity);
+    MU_TEST(testUpdateRemovesDead);
+
+    MU_PASS;
+}
@@ -0,0 +1,220 @@
+#include "prefab.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assets.h"
+#include "ecs.h"
+#include "parser.h"
+#include "raylib.h"
+#include "raymath.h"
+
+#define PREFAB_FILEPATH_MAX 64
+
+static PrefabTable defaultTable;
+static _Thread_local PrefabTable *table = &defaultTable;
+
+static bool scanName(Scanner *scanner, char *name, size_t nameLen) {
+    Token token;
+    if (!ScanWord(scanner, &token)) {
+        return false;
+    }
+    if (!TokenCopy(token, name, nameLen)) {
+        return ScannerFail(scanner, "name is too long");
+    }
+    return true;
+}
+
+static bool scanAnimation(Scanner *scanner, Animation *anim) {
+    char animName[PREFAB_NAME_MAX];
+    if (!scanName(scanner, animName, sizeof(animName))) {
+        return false;
+    }
+
+    *anim = AssetsGetAnimation(animName);
+    if (anim->frameCount == 0) {
+        return ScannerFail(scanner, "missing animation %s", animName);
+    }
+    return true;
+}
+
+static bool parseComponent(Scanner *scanner, Token keyword, Prefab *prefab) {
+    if (TokenEquals(keyword, "transform")) {
+        TransformComp *transform = &prefab->transform;
+        if (!ScanFloat(scanner, &transform->scale.x) ||
+            !ScanFloat(scanner, &transform->scale.y) ||
+            !ScanFloat(scanner, &transform->rotation)) {
+            return false;
+        }
+        prefab->hasComponent[COMP_TRANSFORM] = true;
+    } else if (TokenEquals(keyword, "sprite")) {
+        char spriteName[PREFAB_NAME_MAX];
+        if (!scanName(scanner, spriteName, sizeof(spriteName))) {
+            return false;
+        }
+        prefab->spriteRender.sprite = AssetsGetSpriteId(spriteName);
+        if (prefab->spriteRender.sprite == NULL_SPRITE) {
+            return ScannerFail(scanner, "missing sprite %s", spriteName);
+        }
+        prefab->hasComponent[COMP_SPRITERENDER] = true;
+    } else if (TokenEquals(keyword, "anim")) {
+        if (!scanAnimation(scanner, &prefab->animRender.anim)) {
+            return false;
+        }
+        prefab->hasComponent[COMP_ANIMRENDER] = true;
+    } else if (TokenEquals(keyword, "player")) {
+        PlayerComp *player = &prefab->player;
+        if (!ScanFloat(scanner, &player->speed) ||
+            !scanAnimation(scanner, &player->idleAnim) ||
+            !scanAnimation(scanner, &player->runAnim)) {
+            return false;
+        }
+        prefab->hasComponent[COMP_PLAYER] = true;
+    } else {
+        return ScannerFail(scanner, "unknown component %.*s", keyword.length,
+                           keyword.start);
+    }
+
+    return ScanEndLine(scanner);
+}
+
+static bool parsePrefabs(Scanner *scanner) {
+    ScanSkipBlankLines(scanner);
+    while (!ScannerAtEnd(scanner)) {
+        Token keyword;
+
+        if (!ScanWord(scanner, &keyword)) {
+            return false;
+        }
+        if (!TokenEquals(keyword, "prefab")) {
+            return ScannerFail(scanner, "expected prefab");
+        }
+        if (table->count >= MAX_PREFABS) {
+            return ScannerFail(scanner, "more than %d prefabs", MAX_PREFABS);
+        }
+
+        Prefab *prefab = &table->prefabs[table->count];
+        memset(prefab, 0, sizeof(*prefab));
+        if (!scanName(scanner, prefab->name, sizeof(prefab->name)) ||
+            !ScanEndLine(scanner)) {
+            return false;
+        }
+
+        // same defaults as ComponentCreate
+        prefab->transform = (TransformComp){.enabled = true,
+                                            .position = Vector2Zero(),
+                                            .scale = Vector2One(),
+                                            .rotation = 0,
+                                            .parent = NULL_ENTITY_COMP};
+        prefab->spriteRender = (SpriteRender){.enabled = true, .tint = WHITE};
+        prefab->animRender = (AnimRender){.enabled = true, .frameTime = 0.0f};
+        prefab->player = (PlayerComp){.enabled = true};
+
+        for (;;) {
+            ScanSkipBlankLines(scanner);
+            if (ScannerAtEnd(scanner)) {
+                return ScannerFail(scanner, "prefab %s is missing its end", prefab->name);
+            }
+            if (!ScanWord(scanner, &keyword)) {
+                return false;
+            }
+            if (TokenEquals(keyword, "end")) {
+                break;
+            }
+            if (!parseComponent(scanner, keyword, prefab)) {
+                return false;
+            }
+        }
+        if (!ScanEndLine(scanner)) {
+            return false;
+        }
+
+        ++table->count;
+        ScanSkipBlankLines(scanner);
+    }
+
+    return true;
+}
+
+void PrefabsUse(PrefabTable *next) {
+    table = next != NULL ? next : &defaultTable;
+}
+
+int PrefabsLoad(const char *name) {
+    char prefabFilepath[PREFAB_FILEPATH_MAX];
+    Scanner scanner;
+
+    snprintf(prefabFilepath, PREFAB_FILEPATH_MAX, "%s.prefab", name);
+
+    char *prefabContent = LoadFileText(prefabFilepath);
+    if (prefabContent == NULL) {
+        // failed to load file
+        return 1;
+    }
+
+    ScannerInit(&scanner, prefabFilepath, prefabContent);
+    bool ok = parsePrefabs(&scanner);
+    if (!ok) {
+        TraceLog(LOG_ERROR, "%s", scanner.error);
+    }
+
+    // cleanup
+    free(prefabContent);
+    return ok ? 0 : 1;
+}
+
+const Prefab *PrefabGet(const char *name) {
+    for (int i = 0; i < table->count; ++i) {
+        if (strcmp(table->prefabs[i].name, name) == 0) {
+            return &table->prefabs[i];
+        }
+    }
+    return NULL;
+}
+
+int PrefabSpawn(const Prefab *prefab, Vector2 position) {
+    return PrefabSpawnBatch(prefab, 1, &position);
+}
+
+int PrefabSpawnBatch(const Prefab *prefab, int count, const Vector2 *positions) {
+    assert(prefab != NULL);
+
+    int firstEntity = EntityCreateBatch(count);
+    if (firstEntity == NULL_ENTITY_COMP) {
+        return NULL_ENTITY_COMP;
+    }
+
+    // one contiguous block per component type, filled front to back
+    bool ok = true;
+    if (prefab->hasComponent[COMP_TRANSFORM]) {
+        TransformComp *transforms = ComponentCreateBatch(firstEntity, count, COMP_TRANSFORM,
+                                                         &prefab->transform);
+        ok = ok && transforms != NULL;
+        for (int i = 0; transforms != NULL && positions != NULL && i < count; ++i) {
+            transforms[i].position = positions[i];
+        }
+    }
+    if (ok && prefab->hasComponent[COMP_SPRITERENDER]) {
+        ok = ComponentCreateBatch(firstEntity, count, COMP_SPRITERENDER,
+                                  &prefab->spriteRender) != NULL;
+    }
+    if (ok && prefab->hasComponent[COMP_ANIMRENDER]) {
+        ok = ComponentCreateBatch(firstEntity, count, COMP_ANIMRENDER,
+                                  &prefab->animRender) != NULL;
+    }
+    if (ok && prefab->hasComponent[COMP_PLAYER]) {
+        ok = ComponentCreateBatch(firstEntity, count, COMP_PLAYER, &prefab->player) !=
+             NULL;
+    }
+
+    if (!ok) {
+        for (int i = 0; i < count; ++i) {
+            EntityRemove(firstEntity + i);
+        }
+        return NULL_ENTITY_COMP;
+    }
+
+    return firstEntity;
+}
@@ -0,0 +1,39 @@
+#ifndef PREFAB_H
+#define PREFAB_H
+
+#include <stdbool.h>
+#include "raylib.h"
+#include "ecs.h"
+
+#define PREFAB_NAME_MAX 32
+#define MAX_PREFABS     32
+
+typedef struct Prefab {
+    char name[PREFAB_NAME_MAX];
+    bool hasComponent[COMP_COUNT];
+
+    // default values copied into every spawned entity
+    TransformComp transform;
+    SpriteRender spriteRender;
+    AnimRender animRender;
+    PlayerComp player;
+} Prefab;
+
+// Prefabs of one asset set, their sprites and animations come from it
+typedef struct PrefabTable {
+    Prefab prefabs[MAX_PREFABS];
+    int count;
+} PrefabTable;
+
+// Each thread loads and spawns from its current table, one shared default
+// until the thread picks its own. NULL goes back to the default
+void PrefabsUse(PrefabTable *table);
+
+int PrefabsLoad(const char *name);
+
+const Prefab *PrefabGet(const char *name);
+
+int PrefabSpawn(const Prefab *prefab, Vector2 position);
+int PrefabSpawnBatch(const Prefab *prefab, int count, const Vector2 *positions);
+
+#endif // !PREFAB_H
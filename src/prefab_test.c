@@ -0,0 +1,200 @@
+// the fixture directory
+#define _POSIX_C_SOURCE 200809L
+// the game's modules without a window, draws are recorded
+#define RENDER_NO_RAYLIB
+
+#include "minunit.h"
+#include "headless.h"
+#include "assets.c"
+#include "collision.c"
+#include "ecs.c"
+#include "lightgrid.c"
+#include "mapstream.c"
+#include "net.c"
+#include "parser.c"
+#include "particles.c"
+#include "prefab.c"
+#include "prefab.h"
+#include "projectiles.c"
+#include "render.c"
+#include "spatial.c"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testLoad(void);
+static char *testSpawn(void);
+static char *testSpawnBatch(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+// Sprites and animations the prefabs use, then the prefabs themselves
+static int loadTestAssets(void) {
+    static const char sprites[] = "hero_idle_0 0 0 16 16\n"
+                                  "hero_idle_1 16 0 16 16\n"
+                                  "hero_run_0 32 0 16 16\n"
+                                  "crate 48 0 16 16\n";
+    static const char anims[] = "hero_idle 2 0.2\n"
+                                "hero_run 1 0.1\n";
+    static const char prefabs[] = "prefab hero\n"
+                                  "transform 2 2 0\n"
+                                  "sprite hero_idle_0\n"
+                                  "anim hero_idle\n"
+                                  "player 150 hero_idle hero_run\n"
+                                  "end\n"
+                                  "\n"
+                                  "prefab crate\n"
+                                  "transform 1 3 45\n"
+                                  "sprite crate\n"
+                                  "end\n";
+    static const char broken[] = "prefab ghost\n"
+                                 "sprite missing\n"
+                                 "end\n";
+
+    if (FixtureDirCreate("prefab_test") != 0 || WriteFakePng("test.png", 64, 16) != 0 ||
+        WriteFile("test.sprite", sprites, strlen(sprites)) != 0 ||
+        WriteFile("test.anim", anims, strlen(anims)) != 0 ||
+        WriteFile("test.prefab", prefabs, strlen(prefabs)) != 0 ||
+        WriteFile("broken.prefab", broken, strlen(broken)) != 0) {
+        return 1;
+    }
+    if (AssetsInit() != 0) {
+        return 1;
+    }
+    AssetAdd(ASSET_LOADER_SPRITESHEET, "test");
+    AssetAdd(ASSET_LOADER_ANIMATION, "test");
+    return AssetLoadSync() != 0 || PrefabsLoad("test") != 0;
+}
+
+static char *testLoad(void) {
+    const Prefab *hero = PrefabGet("hero");
+    const Prefab *crate = PrefabGet("crate");
+    MU_ASSERT(hero != NULL && crate != NULL, "Expected both prefabs loaded");
+    MU_ASSERT(PrefabGet("ghost") == NULL, "Expected no unknown prefab");
+
+    const bool *has = hero->hasComponent;
+    MU_ASSERT(has[COMP_TRANSFORM] && has[COMP_SPRITERENDER] && has[COMP_ANIMRENDER] &&
+                  has[COMP_PLAYER],
+              "Expected every component of the hero");
+    has = crate->hasComponent;
+    MU_ASSERT(has[COMP_TRANSFORM] && has[COMP_SPRITERENDER] && !has[COMP_ANIMRENDER] &&
+                  !has[COMP_PLAYER],
+              "Expected only a transform and a sprite on the crate");
+    MU_ASSERT_FMT(hero->player.speed == 150.0f &&
+                      hero->player.idleAnim.frameCount == 2 &&
+                      hero->player.runAnim.frameCount == 1,
+                  "Wrong player, speed %f with %d and %d frames", hero->player.speed,
+                  hero->player.idleAnim.frameCount, hero->player.runAnim.frameCount);
+
+    // a prefab naming a sprite that isn't loaded fails, the others stay
+    MU_ASSERT(PrefabsLoad("broken") != 0, "Expected the broken prefab to fail");
+    MU_ASSERT(PrefabGet("ghost") == NULL && PrefabGet("hero") == hero,
+              "Expected only the loaded prefabs");
+
+    MU_PASS;
+}
+
+static char *testSpawn(void) {
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+
+    int crate = PrefabSpawn(PrefabGet("crate"), (Vector2){30.0f, 40.0f});
+    MU_ASSERT(crate != NULL_ENTITY_COMP, "Expected the crate spawned");
+
+    TransformComp *transf = ComponentGet(crate, COMP_TRANSFORM);
+    MU_ASSERT(transf != NULL, "Expected a transform");
+    MU_ASSERT_FMT(transf->position.x == 30.0f && transf->position.y == 40.0f,
+                  "Expected the crate at 30, 40, but got %f, %f", transf->position.x,
+                  transf->position.y);
+    MU_ASSERT_FMT(transf->scale.x == 1.0f && transf->scale.y == 3.0f &&
+                      transf->rotation == 45.0f,
+                  "Expected scale 1, 3 and rotation 45, but got %f, %f and %f",
+                  transf->scale.x, transf->scale.y, transf->rotation);
+    MU_ASSERT(transf->parent == NULL_ENTITY_COMP, "Expected no parent");
+
+    SpriteRender *sprite = ComponentGet(crate, COMP_SPRITERENDER);
+    MU_ASSERT(sprite != NULL && sprite->sprite == AssetsGetSpriteId("crate"),
+              "Expected the crate sprite");
+    MU_ASSERT(sprite->tint.r == 255 && sprite->tint.a == 255, "Expected a white tint");
+    MU_ASSERT(ComponentGet(crate, COMP_ANIMRENDER) == NULL &&
+                  ComponentGet(crate, COMP_PLAYER) == NULL,
+              "Expected no other components");
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+static char *testSpawnBatch(void) {
+    Vector2 positions[3] = {{0.0f, 0.0f}, {10.0f, 0.0f}, {20.0f, 5.0f}};
+
+    MU_ASSERT(EntityCompInit() == 0, "Expected a world");
+    PrefabSpawn(PrefabGet("crate"), Vector2Zero());
+
+    int first = PrefabSpawnBatch(PrefabGet("hero"), 3, positions);
+    MU_ASSERT(first != NULL_ENTITY_COMP, "Expected the heroes spawned");
+    TransformComp *firstTransf = ComponentGet(first, COMP_TRANSFORM);
+    for (int i = 0; i < 3; ++i) {
+        int entity = first + i;
+        TransformComp *transf = ComponentGet(entity, COMP_TRANSFORM);
+        MU_ASSERT_FMT(transf == firstTransf + i, "Expected hero %d's transform next",
+                      i);
+        MU_ASSERT_FMT(transf->position.x == positions[i].x &&
+                          transf->position.y == positions[i].y &&
+                          transf->scale.x == 2.0f,
+                      "Hero %d: expected %f, %f scaled 2, but got %f, %f scaled %f", i,
+                      positions[i].x, positions[i].y, transf->position.x,
+                      transf->position.y, transf->scale.x);
+
+        SpriteRender *sprite = ComponentGet(entity, COMP_SPRITERENDER);
+        AnimRender *anim = ComponentGet(entity, COMP_ANIMRENDER);
+        PlayerComp *player = ComponentGet(entity, COMP_PLAYER);
+        SpriteId idle = AssetsGetSpriteId("hero_idle_0");
+        MU_ASSERT_FMT(sprite != NULL && sprite->sprite == idle,
+                      "Expected hero %d's sprite", i);
+        MU_ASSERT_FMT(anim != NULL && anim->anim.frameCount == 2 &&
+                          anim->anim.frames[1] == AssetsGetSpriteId("hero_idle_1"),
+                      "Expected hero %d's idle animation", i);
+        MU_ASSERT_FMT(player != NULL && player->speed == 150.0f,
+                      "Expected hero %d's player", i);
+    }
+
+    // without positions they're all at the origin
+    int more = PrefabSpawnBatch(PrefabGet("crate"), 2, NULL);
+    MU_ASSERT(more != NULL_ENTITY_COMP, "Expected the crates spawned");
+    TransformComp *transf = ComponentGet(more + 1, COMP_TRANSFORM);
+    MU_ASSERT(transf->position.x == 0.0f && transf->position.y == 0.0f &&
+                  transf->rotation == 45.0f,
+              "Expected the crate at the origin");
+
+    EntityCompDestroy();
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_ASSERT(loadTestAssets() == 0, "Expected the test assets loaded");
+
+    MU_TEST(testLoad);
+    MU_TEST(testSpawn);
+    MU_TEST(testSpawnBatch);
+
+    AssetSetDestroy(AssetSetGet());
+    FixtureDirRemove();
+    MU_PASS;
+}
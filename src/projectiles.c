@@ -0,0 +1,221 @@
+#include "projectiles.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+int ProjectilePoolInit(ProjectilePool *pool, Arena *arena, int capacity) {
+    memset(pool, 0, sizeof(*pool));
+    pool->capacity = capacity;
+    pool->scratch = arena;
+
+    pool->x = ArenaAlloc(arena, sizeof(float) * capacity);
+    pool->y = ArenaAlloc(arena, sizeof(float) * capacity);
+    pool->vx = ArenaAlloc(arena, sizeof(float) * capacity);
+    pool->vy = ArenaAlloc(arena, sizeof(float) * capacity);
+    pool->life = ArenaAlloc(arena, sizeof(float) * capacity);
+    pool->owner = ArenaAlloc(arena, sizeof(int) * capacity);
+    pool->hits = ArenaAlloc(arena, sizeof(ProjectileHit) * capacity);
+
+    return pool->hits == NULL;
+}
+
+void ProjectilePoolReset(ProjectilePool *pool) {
+    pool->count = 0;
+    pool->hitsCount = 0;
+}
+
+bool ProjectileFire(ProjectilePool *pool, int owner, float x, float y, float dirX,
+                    float dirY, float speed, float lifetime) {
+    if (pool->count >= pool->capacity) {
+        return false;
+    }
+
+    float len = sqrtf(dirX * dirX + dirY * dirY);
+    if (len == 0.0f || speed <= 0.0f) {
+        return false;
+    }
+
+    int i = pool->count++;
+    pool->x[i] = x;
+    pool->y[i] = y;
+    pool->vx[i] = dirX / len * speed;
+    pool->vy[i] = dirY / len * speed;
+    pool->life[i] = lifetime;
+    pool->owner[i] = owner;
+    return true;
+}
+
+static void removeProjectile(ProjectilePool *pool, int i) {
+    int last = --pool->count;
+    pool->x[i] = pool->x[last];
+    pool->y[i] = pool->y[last];
+    pool->vx[i] = pool->vx[last];
+    pool->vy[i] = pool->vy[last];
+    pool->life[i] = pool->life[last];
+    pool->owner[i] = pool->owner[last];
+}
+
+// Targets listed per grid cell, a target is listed in every cell it overlaps
+typedef struct TargetCells {
+    int *cellStart;
+    int *targets;
+} TargetCells;
+
+static bool targetCellRange(const CollisionGrid *grid, const ProjectileTarget *target,
+                            int *x0, int *y0, int *x1, int *y1) {
+    *x0 = (int)floorf(target->minX / grid->cellWidth);
+    *y0 = (int)floorf(target->minY / grid->cellHeight);
+    *x1 = (int)floorf(target->maxX / grid->cellWidth);
+    *y1 = (int)floorf(target->maxY / grid->cellHeight);
+    if (*x1 < 0 || *y1 < 0 || *x0 >= grid->width || *y0 >= grid->height) {
+        return false;
+    }
+
+    *x0 = *x0 < 0 ? 0 : *x0;
+    *y0 = *y0 < 0 ? 0 : *y0;
+    *x1 = *x1 >= grid->width ? grid->width - 1 : *x1;
+    *y1 = *y1 >= grid->height ? grid->height - 1 : *y1;
+    return true;
+}
+
+static TargetCells bucketTargets(Arena *arena, const CollisionGrid *grid,
+                                 const ProjectileTarget *targets, int targetsCount) {
+    TargetCells cells;
+    int cellsCount = grid->width * grid->height;
+    int x0, y0, x1, y1;
+
+    // counting sort: count per cell, prefix sum, then fill
+    cells.cellStart = ArenaAlloc(arena, sizeof(int) * (cellsCount + 1));
+    int entries = 0;
+    for (int i = 0; i < targetsCount; ++i) {
+        if (!targetCellRange(grid, &targets[i], &x0, &y0, &x1, &y1)) {
+            continue;
+        }
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                ++cells.cellStart[y * grid->width + x + 1];
+                ++entries;
+            }
+        }
+    }
+    for (int c = 0; c < cellsCount; ++c) {
+        cells.cellStart[c + 1] += cells.cellStart[c];
+    }
+
+    cells.targets = ArenaAlloc(arena, sizeof(int) * (entries + 1));
+    int *fill = ArenaAlloc(arena, sizeof(int) * cellsCount);
+    for (int i = 0; i < targetsCount; ++i) {
+        if (!targetCellRange(grid, &targets[i], &x0, &y0, &x1, &y1)) {
+            continue;
+        }
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                int c = y * grid->width + x;
+                cells.targets[cells.cellStart[c] + fill[c]++] = i;
+            }
+        }
+    }
+
+    return cells;
+}
+
+static bool segmentHitsBox(float x0, float y0, float dx, float dy,
+                           const ProjectileTarget *box, float *tEnter) {
+    // slab test on both axes
+    float tMin = 0.0f, tMax = 1.0f;
+    float origin[2] = {x0, y0};
+    float delta[2] = {dx, dy};
+    float lo[2] = {box->minX, box->minY};
+    float hi[2] = {box->maxX, box->maxY};
+
+    for (int axis = 0; axis < 2; ++axis) {
+        if (delta[axis] == 0.0f) {
+            if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float t1 = (lo[axis] - origin[axis]) / delta[axis];
+        float t2 = (hi[axis] - origin[axis]) / delta[axis];
+        if (t1 > t2) {
+            float swap = t1;
+            t1 = t2;
+            t2 = swap;
+        }
+        tMin = t1 > tMin ? t1 : tMin;
+        tMax = t2 < tMax ? t2 : tMax;
+        if (tMin > tMax) {
+            return false;
+        }
+    }
+
+    *tEnter = tMin;
+    return true;
+}
+
+int ProjectilesUpdate(ProjectilePool *pool, const CollisionGrid *grid,
+                      const ProjectileTarget *targets, int targetsCount, float dt) {
+    TempArena temp = TempArenaBegin(pool->scratch);
+    TargetCells cells = bucketTargets(pool->scratch, grid, targets, targetsCount);
+
+    pool->hitsCount = 0;
+    for (int i = 0; i < pool->count;) {
+        float x0 = pool->x[i], y0 = pool->y[i];
+        float dx = pool->vx[i] * dt, dy = pool->vy[i] * dt;
+        float hitT = 2.0f;
+        int hitTarget = PROJECTILE_NO_TARGET;
+        GridWalk walk;
+
+        // the whole path of this tick is tested, fast bullets can't skip a wall
+        GridWalkBegin(&walk, grid, x0, y0, x0 + dx, y0 + dy);
+        do {
+            if (walk.t > hitT) {
+                // everything further away is behind the target already hit
+                break;
+            }
+            if (CollisionGridSolid(grid, walk.x, walk.y)) {
+                hitT = walk.t;
+                hitTarget = PROJECTILE_NO_TARGET;
+                break;
+            }
+
+            int c = walk.y * grid->width + walk.x;
+            for (int k = cells.cellStart[c]; k < cells.cellStart[c + 1]; ++k) {
+                const ProjectileTarget *target = &targets[cells.targets[k]];
+                float t;
+                if (target->entity != pool->owner[i] &&
+                    segmentHitsBox(x0, y0, dx, dy, target, &t) && t < hitT) {
+                    hitT = t;
+                    hitTarget = target->entity;
+                }
+            }
+        } while (GridWalkNext(&walk));
+
+        if (hitT <= 1.0f) {
+            assert(pool->hitsCount < pool->capacity);
+            float speed = sqrtf(pool->vx[i] * pool->vx[i] + pool->vy[i] * pool->vy[i]);
+            pool->hits[pool->hitsCount++] =
+                (ProjectileHit){.owner = pool->owner[i],
+                                .target = hitTarget,
+                                .x = x0 + dx * hitT,
+                                .y = y0 + dy * hitT,
+                                .dirX = pool->vx[i] / speed,
+                                .dirY = pool->vy[i] / speed};
+            removeProjectile(pool, i);
+            continue;
+        }
+
+        pool->life[i] -= dt;
+        if (pool->life[i] <= 0.0f) {
+            removeProjectile(pool, i);
+            continue;
+        }
+        pool->x[i] = x0 + dx;
+        pool->y[i] = y0 + dy;
+        ++i;
+    }
+
+    TempArenaEnd(temp);
+    return pool->hitsCount;
+}
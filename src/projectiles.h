@@ -0,0 +1,51 @@
+#ifndef PROJECTILES_H
+#define PROJECTILES_H
+
+#include <stdbool.h>
+
+#include "collision.h"
+#include "utils.h"
+
+// hit events for walls and the map border have no target entity
+#define PROJECTILE_NO_TARGET -1
+
+// Entity bounds projectiles can hit, gathered every tick
+typedef struct ProjectileTarget {
+    int entity;
+    float minX, minY;
+    float maxX, maxY;
+} ProjectileTarget;
+
+typedef struct ProjectileHit {
+    int owner;
+    int target;
+    float x, y;
+    float dirX, dirY;
+} ProjectileHit;
+
+// In-flight projectiles packed at the front of every array, removed by
+// swapping in the last one
+typedef struct ProjectilePool {
+    int count, capacity;
+    float *x, *y;
+    float *vx, *vy;
+    float *life;
+    int *owner;
+
+    // hits of the last update, at most one per projectile
+    ProjectileHit *hits;
+    int hitsCount;
+
+    // targets bucketed by grid cell, rebuilt every update
+    Arena *scratch;
+} ProjectilePool;
+
+int ProjectilePoolInit(ProjectilePool *pool, Arena *arena, int capacity);
+void ProjectilePoolReset(ProjectilePool *pool);
+
+bool ProjectileFire(ProjectilePool *pool, int owner, float x, float y, float dirX,
+                    float dirY, float speed, float lifetime);
+int ProjectilesUpdate(ProjectilePool *pool, const CollisionGrid *grid,
+                      const ProjectileTarget *targets, int targetsCount, float dt);
+
+#endif // !PROJECTILES_H
@@ -0,0 +1,151 @@
+#include "minunit.h"
+#include "collision.c"
+#include "projectiles.c"
+#include "projectiles.h"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testRaycast(void);
+static char *testNoTunneling(void);
+static char *testNearestTarget(void);
+static char *testLifetime(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static char *testRaycast(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    CollisionGrid grid;
+    float t;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&grid, &arena, 16, 16, 32.0f, 32.0f);
+    CollisionGridSet(&grid, 5, 3, true);
+
+    MU_ASSERT(CollisionGridRaycast(&grid, 16.0f, 112.0f, 496.0f, 112.0f, &t),
+              "Expected the wall to be hit");
+    MU_ASSERT_FMT(fabsf(t * 480.0f - 144.0f) < 1e-3f, "Expected %f, but got %f",
+                  144.0f, t * 480.0f);
+    MU_ASSERT(!CollisionGridRaycast(&grid, 16.0f, 80.0f, 496.0f, 80.0f, &t),
+              "Expected the row above to be clear");
+
+    // diagonals step through both axes
+    MU_ASSERT(!CollisionGridRaycast(&grid, 16.0f, 16.0f, 496.0f, 496.0f, &t),
+              "Expected the diagonal to be clear");
+    MU_ASSERT(CollisionGridRaycast(&grid, 16.0f, 16.0f, 336.0f, 176.0f, &t),
+              "Expected the wall to be hit diagonally");
+    MU_ASSERT_FMT(fabsf(t - 0.5f) < 1e-5f, "Expected %f, but got %f", 0.5f, t);
+    MU_ASSERT(CollisionGridRaycast(&grid, 16.0f, 16.0f, -16.0f, 16.0f, &t),
+              "Expected the map border to be solid");
+
+    MU_PASS;
+}
+
+static char *testNoTunneling(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    CollisionGrid grid;
+    ProjectilePool pool;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&grid, &arena, 64, 4, 32.0f, 32.0f);
+    ProjectilePoolInit(&pool, &arena, 8);
+    CollisionGridSet(&grid, 40, 1, true);
+
+    // moves 50 cells in one tick, the wall is one cell thick
+    ProjectileFire(&pool, 0, 16.0f, 48.0f, 1.0f, 0.0f, 1600.0f * 60.0f, 1.0f);
+    int hits = ProjectilesUpdate(&pool, &grid, NULL, 0, 1.0f / 60.0f);
+
+    MU_ASSERT_FMT(1 == hits, "Expected %d hit, but got %d", 1, hits);
+    MU_ASSERT_FMT(PROJECTILE_NO_TARGET == pool.hits[0].target,
+                  "Expected a wall hit, but got target %d", pool.hits[0].target);
+    MU_ASSERT_FMT(fabsf(pool.hits[0].x - 1280.0f) < 0.5f, "Expected x %f, but got %f",
+                  1280.0f, pool.hits[0].x);
+    MU_ASSERT_FMT(0 == pool.count, "Expected %d projectiles, but got %d", 0,
+                  pool.count);
+
+    MU_PASS;
+}
+
+static char *testNearestTarget(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    CollisionGrid grid;
+    ProjectilePool pool;
+    ProjectileTarget targets[] = {
+        {.entity = 1, .minX = 0.0f, .minY = 0.0f, .maxX = 40.0f, .maxY = 64.0f},
+        {.entity = 2, .minX = 300.0f, .minY = 32.0f, .maxX = 340.0f, .maxY = 96.0f},
+        {.entity = 3, .minX = 200.0f, .minY = 40.0f, .maxX = 230.0f, .maxY = 90.0f},
+    };
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&grid, &arena, 16, 4, 32.0f, 32.0f);
+    ProjectilePoolInit(&pool, &arena, 8);
+
+    // fired from inside its owner, passes by nothing but targets 3 then 2
+    ProjectileFire(&pool, 1, 20.0f, 48.0f, 1.0f, 0.0f, 600.0f, 1.0f);
+    ProjectileFire(&pool, 1, 20.0f, 20.0f, 1.0f, 0.0f, 600.0f, 1.0f);
+    int hits = ProjectilesUpdate(&pool, &grid, targets, 3, 0.5f);
+
+    MU_ASSERT_FMT(1 == hits, "Expected %d hit, but got %d", 1, hits);
+    MU_ASSERT_FMT(3 == pool.hits[0].target, "Expected target %d, but got %d", 3,
+                  pool.hits[0].target);
+    MU_ASSERT_FMT(fabsf(pool.hits[0].x - 200.0f) < 1e-3f, "Expected x %f, but got %f",
+                  200.0f, pool.hits[0].x);
+    MU_ASSERT_FMT(1 == pool.count, "Expected %d projectile, but got %d", 1, pool.count);
+
+    MU_PASS;
+}
+
+static char *testLifetime(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    CollisionGrid grid;
+    ProjectilePool pool;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    CollisionGridInit(&grid, &arena, 16, 16, 32.0f, 32.0f);
+    ProjectilePoolInit(&pool, &arena, 4);
+
+    for (int i = 0; i < 6; ++i) {
+        ProjectileFire(&pool, 0, 100.0f, 100.0f, 0.0f, 1.0f, 10.0f, 0.25f);
+    }
+    MU_ASSERT_FMT(4 == pool.count, "Expected %d projectiles, but got %d", 4,
+                  pool.count);
+
+    ProjectilesUpdate(&pool, &grid, NULL, 0, 0.2f);
+    MU_ASSERT_FMT(4 == pool.count, "Expected %d projectiles, but got %d", 4,
+                  pool.count);
+    int hits = ProjectilesUpdate(&pool, &grid, NULL, 0, 0.2f);
+    MU_ASSERT_FMT(0 == hits, "Expected %d hits, but got %d", 0, hits);
+    MU_ASSERT_FMT(0 == pool.count, "Expected %d projectiles, but got %d", 0,
+                  pool.count);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testRaycast);
+    MU_TEST(testNoTunneling);
+    MU_TEST(testNearestTarget);
+    MU_TEST(testLifetime);
+
+    MU_PASS;
+}
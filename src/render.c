@@ -0,0 +1,278 @@
+#include "render.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef RENDER_NO_RAYLIB
+#include "rlgl.h"
+#endif
+
+static RenderRecorder *recorder;
+static unsigned int currentTarget;
+
+// texture and state of the last draw, a change starts a new draw call
+static RenderStats stats;
+static unsigned int statsTexture;
+static int statsState = -1;
+
+static void countDraw(unsigned int texture, int state, int quads) {
+    if (texture != statsTexture || state != statsState) {
+        ++stats.drawCalls;
+        statsTexture = texture;
+        statsState = state;
+    }
+    stats.quads += quads;
+}
+
+#ifndef RENDER_NO_RAYLIB
+static void raylibDraw(Texture2D texture, Rectangle src, SpriteUV uv, Rectangle dest,
+                       float rotation, Color tint, bool flipX, bool flipY) {
+    if (rotation != 0.0f) {
+        src.width = flipX ? -src.width : src.width;
+        src.height = flipY ? -src.height : src.height;
+        DrawTexturePro(texture, src, dest, (Vector2){0.0f, 0.0f}, rotation, tint);
+        return;
+    }
+
+    // the same quad DrawTexturePro makes, without the rotation math. Flipping
+    // swaps the coordinates
+    float u0 = flipX ? uv.u1 : uv.u0, u1 = flipX ? uv.u0 : uv.u1;
+    float v0 = flipY ? uv.v1 : uv.v0, v1 = flipY ? uv.v0 : uv.v1;
+
+    rlCheckRenderBatchLimit(4);
+    rlSetTexture(texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    rlTexCoord2f(u0, v0);
+    rlVertex2f(dest.x, dest.y);
+    rlTexCoord2f(u0, v1);
+    rlVertex2f(dest.x, dest.y + dest.height);
+    rlTexCoord2f(u1, v1);
+    rlVertex2f(dest.x + dest.width, dest.y + dest.height);
+    rlTexCoord2f(u1, v0);
+    rlVertex2f(dest.x + dest.width, dest.y);
+    rlEnd();
+    rlSetTexture(0);
+}
+#else
+// test builds have no raylib, only the recording backend can be used
+#define LoadRenderTexture(width, height) (assert(false), (RenderTexture2D){0})
+#define UnloadRenderTexture(target)      assert(false)
+#define BeginTextureMode(target)         assert(false)
+#define EndTextureMode()                 assert(false)
+#define BeginScissorMode(x, y, w, h)     ((void)(x), assert(false))
+#define EndScissorMode()                 assert(false)
+#define ClearBackground(color)           assert(false)
+#define raylibDraw(tex, src, uv, ...)    ((void)(uv), assert(false))
+#endif
+
+int RenderRecorderInit(RenderRecorder *rec, Arena *arena, int capacity) {
+    memset(rec, 0, sizeof(*rec));
+    rec->capacity = capacity;
+    rec->nextTarget = RENDER_FAKE_TARGET_ID;
+    rec->cmds = ArenaAlloc(arena, sizeof(RenderCmd) * capacity);
+
+    return rec->cmds == NULL;
+}
+
+void RenderRecorderReset(RenderRecorder *rec) {
+    rec->count = 0;
+    rec->dropped = 0;
+}
+
+void RenderSetRecorder(RenderRecorder *rec) {
+    recorder = rec;
+    currentTarget = 0;
+}
+
+bool RenderIsRecording(void) {
+    return recorder != NULL;
+}
+
+RenderTexture2D RenderLoadTarget(int width, int height) {
+    if (recorder == NULL) {
+        return LoadRenderTexture(width, height);
+    }
+
+    // nothing to allocate, the id only tells the targets apart
+    unsigned int id = recorder->nextTarget++;
+    return (RenderTexture2D){
+        .id = id,
+        .texture = {.id = id, .width = width, .height = height, .mipmaps = 1}};
+}
+
+void RenderUnloadTarget(RenderTexture2D target) {
+    // recorded targets are only ids, made up ones never reach raylib
+    if (target.id < RENDER_FAKE_TARGET_ID) {
+        UnloadRenderTexture(target);
+    }
+}
+
+void RenderBeginTarget(RenderTexture2D target) {
+    // switching targets flushes the batch
+    currentTarget = target.id;
+    statsTexture = 0;
+    if (recorder == NULL) {
+        BeginTextureMode(target);
+    }
+}
+
+void RenderEndTarget(void) {
+    currentTarget = 0;
+    statsTexture = 0;
+    if (recorder == NULL) {
+        EndTextureMode();
+    }
+}
+
+void RenderBeginClip(Rectangle area) {
+    statsTexture = 0;
+    if (recorder == NULL) {
+        BeginScissorMode((int)area.x, (int)area.y, (int)area.width, (int)area.height);
+    }
+}
+
+void RenderEndClip(void) {
+    statsTexture = 0;
+    if (recorder == NULL) {
+        EndScissorMode();
+    }
+}
+
+void RenderClear(void) {
+    if (recorder == NULL) {
+        ClearBackground(BLANK);
+    }
+}
+
+// uv is src in texture coordinates, only the raylib backend needs it
+static void draw(Texture2D texture, Rectangle src, SpriteUV uv, Rectangle dest,
+                 float rotation, Color tint, bool flipX, bool flipY) {
+    if (texture.id == 0) {
+        // nothing to sample, raylib skips it too
+        return;
+    }
+
+    countDraw(texture.id, RENDER_STATE_QUADS, 1);
+    if (recorder == NULL) {
+        raylibDraw(texture, src, uv, dest, rotation, tint, flipX, flipY);
+        return;
+    }
+
+    if (recorder->count >= recorder->capacity) {
+        ++recorder->dropped;
+        return;
+    }
+    recorder->cmds[recorder->count++] = (RenderCmd){.target = currentTarget,
+                                                    .texture = texture.id,
+                                                    .src = src,
+                                                    .dest = dest,
+                                                    .rotation = rotation,
+                                                    .tint = tint,
+                                                    .flipX = flipX,
+                                                    .flipY = flipY};
+}
+
+void RenderDraw(Texture2D texture, Rectangle src, Rectangle dest, float rotation,
+                Color tint, bool flipX, bool flipY) {
+    SpriteUV uv = {0};
+    if (recorder == NULL && texture.id != 0) {
+        uv = (SpriteUV){src.x / texture.width, src.y / texture.height,
+                        (src.x + src.width) / texture.width,
+                        (src.y + src.height) / texture.height};
+    }
+    draw(texture, src, uv, dest, rotation, tint, flipX, flipY);
+}
+
+void RenderDrawSprite(SpriteId sprite, Rectangle dest, float rotation, Color tint,
+                      bool flipX, bool flipY) {
+    draw(AssetsGetSpriteTexture(sprite), AssetsGetSpriteSource(sprite),
+         AssetsGetSpriteUV(sprite), dest, rotation, tint, flipX, flipY);
+}
+
+void RenderCountDraw(unsigned int texture, RenderState state, int quads) {
+    countDraw(texture, state, quads);
+}
+
+void RenderStatsReset(void) {
+    stats = (RenderStats){0};
+    statsTexture = 0;
+    statsState = -1;
+}
+
+RenderStats RenderStatsGet(void) {
+    return stats;
+}
+
+static Rectangle commandBounds(const RenderCmd *cmd) {
+    if (cmd->rotation == 0.0f) {
+        return cmd->dest;
+    }
+
+    // rotated around the top left corner, the box around the four corners
+    float c = cosf(cmd->rotation * DEG2RAD);
+    float s = sinf(cmd->rotation * DEG2RAD);
+    float w = cmd->dest.width, h = cmd->dest.height;
+    float xs[4] = {0.0f, w * c, -h * s, w * c - h * s};
+    float ys[4] = {0.0f, w * s, h * c, w * s + h * c};
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+    for (int i = 1; i < 4; ++i) {
+        minX = xs[i] < minX ? xs[i] : minX;
+        minY = ys[i] < minY ? ys[i] : minY;
+        maxX = xs[i] > maxX ? xs[i] : maxX;
+        maxY = ys[i] > maxY ? ys[i] : maxY;
+    }
+    return (Rectangle){cmd->dest.x + minX, cmd->dest.y + minY, maxX - minX,
+                       maxY - minY};
+}
+
+// pixels whose center is inside [from, to), clamped to [0, size)
+static void pixelSpan(float from, float to, int size, int *first, int *last) {
+    *first = (int)ceilf(from - 0.5f);
+    *last = (int)ceilf(to - 0.5f);
+    *first = *first < 0 ? 0 : *first;
+    *last = *last > size ? size : *last;
+}
+
+RenderAnalysis RenderRecorderAnalyze(const RenderRecorder *rec, unsigned int target,
+                                     Rectangle bounds, Arena *scratch) {
+    RenderAnalysis analysis = {0};
+    int width = (int)ceilf(bounds.width), height = (int)ceilf(bounds.height);
+    TempArena temp = TempArenaBegin(scratch);
+    uint8_t *covered = ArenaAlloc(scratch, (size_t)width * height);
+
+    for (int i = 0; i < rec->count; ++i) {
+        const RenderCmd *cmd = &rec->cmds[i];
+        if (cmd->target != target) {
+            continue;
+        }
+
+        // a draw to another target in between flushes the batch too
+        const RenderCmd *prev = i > 0 ? &rec->cmds[i - 1] : NULL;
+        if (prev == NULL || prev->target != target || prev->texture != cmd->texture) {
+            ++analysis.batches;
+        }
+        ++analysis.draws;
+
+        Rectangle box = commandBounds(cmd);
+        int x0, x1, y0, y1;
+        pixelSpan(box.x - bounds.x, box.x + box.width - bounds.x, width, &x0, &x1);
+        pixelSpan(box.y - bounds.y, box.y + box.height - bounds.y, height, &y0, &y1);
+        for (int y = y0; y < y1; ++y) {
+            uint8_t *pixel = &covered[(size_t)y * width + x0];
+            for (int x = x0; x < x1; ++x, ++pixel) {
+                analysis.pixelsCovered += *pixel == 0;
+                *pixel = 1;
+            }
+        }
+        if (x1 > x0 && y1 > y0) {
+            analysis.pixelsDrawn += (long)(x1 - x0) * (y1 - y0);
+        }
+    }
+
+    TempArenaEnd(temp);
+    return analysis;
+}
@@ -0,0 +1,92 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+
+#include "assets.h"
+#include "raylib.h"
+#include "utils.h"
+
+// render targets made while recording get ids from here up, far from any real
+// texture id
+#define RENDER_FAKE_TARGET_ID 0x1000000u
+
+// Besides the texture, what makes rlgl start a new draw call
+typedef enum {
+    RENDER_STATE_QUADS = 0,
+    RENDER_STATE_LINES,
+    RENDER_STATE_MULTIPLIED
+} RenderState;
+
+// One textured quad, as drawn or recorded. src is never negative, flipping is
+// done with the flags
+typedef struct RenderCmd {
+    unsigned int target;
+    unsigned int texture;
+    Rectangle src;
+    Rectangle dest;
+    float rotation;
+    Color tint;
+    bool flipX, flipY;
+} RenderCmd;
+
+// While set, draws are appended here instead of reaching raylib. Commands
+// that don't fit are counted in dropped
+typedef struct RenderRecorder {
+    RenderCmd *cmds;
+    int count, capacity;
+    int dropped;
+    unsigned int nextTarget;
+} RenderRecorder;
+
+// What was submitted since RenderStatsReset, by either backend
+typedef struct RenderStats {
+    int drawCalls;
+    int quads;
+} RenderStats;
+
+// One target of a recording. Pixels are counted in the commands' own space
+// (world units for the screen) over the analyzed bounds
+typedef struct RenderAnalysis {
+    int draws;
+    int batches;
+    long pixelsDrawn;
+    long pixelsCovered;
+} RenderAnalysis;
+
+int RenderRecorderInit(RenderRecorder *recorder, Arena *arena, int capacity);
+void RenderRecorderReset(RenderRecorder *recorder);
+
+// NULL goes back to drawing with raylib
+void RenderSetRecorder(RenderRecorder *recorder);
+bool RenderIsRecording(void);
+
+RenderTexture2D RenderLoadTarget(int width, int height);
+void RenderUnloadTarget(RenderTexture2D target);
+void RenderBeginTarget(RenderTexture2D target);
+void RenderEndTarget(void);
+void RenderBeginClip(Rectangle area);
+void RenderEndClip(void);
+
+// clears the target, or only the clip area, to transparent
+void RenderClear(void);
+
+void RenderDraw(Texture2D texture, Rectangle src, Rectangle dest, float rotation,
+                Color tint, bool flipX, bool flipY);
+// the whole sprite, with the texture coordinates computed when it was loaded
+void RenderDrawSprite(SpriteId sprite, Rectangle dest, float rotation, Color tint,
+                      bool flipX, bool flipY);
+
+// for draws made straight with rlgl, which are never recorded
+void RenderCountDraw(unsigned int texture, RenderState state, int quads);
+
+void RenderStatsReset(void);
+RenderStats RenderStatsGet(void);
+
+// batches are the draw calls the commands to target would take, overdraw is
+// pixelsDrawn / pixelsCovered
+RenderAnalysis RenderRecorderAnalyze(const RenderRecorder *recorder,
+                                     unsigned int target, Rectangle bounds,
+                                     Arena *scratch);
+
+#endif // !RENDER_H
@@ -0,0 +1,189 @@
+// the fixture directory headless.h makes
+#define _POSIX_C_SOURCE 200809L
+// only the recording backend, the tests link no raylib
+#define RENDER_NO_RAYLIB
+
+#include "minunit.h"
+#include "headless.h"
+#include "assets.c"
+#include "parser.c"
+#include "particles.c"
+#include "render.c"
+#include "render.h"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testRecord(void);
+static char *testBatches(void);
+static char *testOverdraw(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static void drawQuad(unsigned int texture, float x, float y, float size) {
+    Texture2D tex = {.id = texture, .width = 64, .height = 64};
+    RenderDraw(tex, (Rectangle){0, 0, 16, 16}, (Rectangle){x, y, size, size}, 0, WHITE,
+               false, false);
+}
+
+static char *testRecord(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    RenderRecorder recorder;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    RenderRecorderInit(&recorder, &arena, 2);
+    RenderSetRecorder(&recorder);
+
+    Texture2D tex = {.id = 3, .width = 64, .height = 64};
+    Color tint = {255, 0, 0, 128};
+    RenderDraw(tex, (Rectangle){16, 32, 16, 8}, (Rectangle){100, 50, 32, 16}, 0, tint,
+               true, false);
+    drawQuad(3, 0, 0, 16);
+    drawQuad(3, 0, 0, 16);
+
+    MU_ASSERT_FMT(2 == recorder.count, "Expected %d commands, but got %d", 2,
+                  recorder.count);
+    MU_ASSERT_FMT(1 == recorder.dropped, "Expected %d dropped, but got %d", 1,
+                  recorder.dropped);
+    RenderCmd cmd = recorder.cmds[0];
+    MU_ASSERT(cmd.texture == 3 && cmd.target == 0, "Wrong texture or target");
+    MU_ASSERT(cmd.src.x == 16 && cmd.src.y == 32 && cmd.dest.width == 32,
+              "Wrong rectangles");
+    MU_ASSERT(cmd.tint.r == 255 && cmd.tint.a == 128, "Wrong tint");
+    MU_ASSERT(cmd.flipX && !cmd.flipY, "Wrong flips");
+
+    // targets are made up, draws into them are tagged with their id
+    RenderRecorderReset(&recorder);
+    RenderTexture2D target = RenderLoadTarget(128, 64);
+    MU_ASSERT(target.id != 0 && target.texture.width == 128, "Wrong target");
+    RenderBeginTarget(target);
+    RenderClear();
+    drawQuad(3, 0, 0, 16);
+    RenderEndTarget();
+    MU_ASSERT_FMT(target.id == recorder.cmds[0].target,
+                  "Expected target %u, but got %u", target.id,
+                  recorder.cmds[0].target);
+
+    RenderSetRecorder(NULL);
+
+    MU_PASS;
+}
+
+static char *testBatches(void) {
+    unsigned char buffer[Kilobyte(8)];
+    Arena arena;
+    RenderRecorder recorder;
+    Rectangle bounds = {0, 0, 64, 64};
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    RenderRecorderInit(&recorder, &arena, 16);
+    RenderSetRecorder(&recorder);
+
+    // every texture change breaks the batch
+    RenderStatsReset();
+    drawQuad(1, 0, 0, 8);
+    drawQuad(2, 0, 0, 8);
+    drawQuad(1, 0, 0, 8);
+    drawQuad(2, 0, 0, 8);
+    RenderAnalysis analysis = RenderRecorderAnalyze(&recorder, 0, bounds, &arena);
+    MU_ASSERT_FMT(4 == analysis.draws, "Expected %d draws, but got %d", 4,
+                  analysis.draws);
+    MU_ASSERT_FMT(4 == analysis.batches, "Expected %d batches, but got %d", 4,
+                  analysis.batches);
+    MU_ASSERT_FMT(4 == RenderStatsGet().drawCalls,
+                  "Expected %d draw calls counted, but got %d", 4,
+                  RenderStatsGet().drawCalls);
+
+    // sorted by texture they batch
+    RenderRecorderReset(&recorder);
+    drawQuad(1, 0, 0, 8);
+    drawQuad(1, 0, 0, 8);
+    drawQuad(2, 0, 0, 8);
+    drawQuad(2, 0, 0, 8);
+    analysis = RenderRecorderAnalyze(&recorder, 0, bounds, &arena);
+    MU_ASSERT_FMT(2 == analysis.batches, "Expected %d batches, but got %d", 2,
+                  analysis.batches);
+
+    // so does drawing into another target in between
+    RenderRecorderReset(&recorder);
+    RenderTexture2D target = RenderLoadTarget(64, 64);
+    drawQuad(1, 0, 0, 8);
+    RenderBeginTarget(target);
+    drawQuad(1, 0, 0, 8);
+    RenderEndTarget();
+    drawQuad(1, 0, 0, 8);
+    analysis = RenderRecorderAnalyze(&recorder, 0, bounds, &arena);
+    MU_ASSERT_FMT(2 == analysis.batches, "Expected %d batches, but got %d", 2,
+                  analysis.batches);
+    analysis = RenderRecorderAnalyze(&recorder, target.id, bounds, &arena);
+    MU_ASSERT_FMT(1 == analysis.draws, "Expected %d draws, but got %d", 1,
+                  analysis.draws);
+
+    RenderSetRecorder(NULL);
+
+    MU_PASS;
+}
+
+static char *testOverdraw(void) {
+    unsigned char buffer[Kilobyte(16)];
+    Arena arena;
+    RenderRecorder recorder;
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    RenderRecorderInit(&recorder, &arena, 16);
+    RenderSetRecorder(&recorder);
+
+    // two 10x10 quads overlapping by half, and one mostly outside the bounds
+    drawQuad(1, 10, 10, 10);
+    drawQuad(1, 15, 10, 10);
+    drawQuad(1, 60, 60, 10);
+    size_t used = arena.currOffset;
+    RenderAnalysis analysis =
+        RenderRecorderAnalyze(&recorder, 0, (Rectangle){0, 0, 64, 64}, &arena);
+    MU_ASSERT_FMT(216 == analysis.pixelsDrawn, "Expected %d pixels drawn, but got %ld",
+                  216, analysis.pixelsDrawn);
+    MU_ASSERT_FMT(166 == analysis.pixelsCovered,
+                  "Expected %d pixels covered, but got %ld", 166,
+                  analysis.pixelsCovered);
+    MU_ASSERT(used == arena.currOffset, "Analysis kept scratch memory");
+
+    // bounds move the pixel grid, rotated quads count their bounding box
+    RenderRecorderReset(&recorder);
+    Texture2D tex = {.id = 1, .width = 64, .height = 64};
+    RenderDraw(tex, (Rectangle){0, 0, 16, 16}, (Rectangle){110, 100, 10, 10}, 90,
+               WHITE, false, false);
+    analysis =
+        RenderRecorderAnalyze(&recorder, 0, (Rectangle){100, 100, 20, 20}, &arena);
+    MU_ASSERT_FMT(100 == analysis.pixelsCovered,
+                  "Expected %d pixels covered, but got %ld", 100,
+                  analysis.pixelsCovered);
+
+    RenderSetRecorder(NULL);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testRecord);
+    MU_TEST(testBatches);
+    MU_TEST(testOverdraw);
+
+    MU_PASS;
+}
@@ -0,0 +1,121 @@
+#include "spatial.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+int SpatialGridInit(SpatialGrid *grid, Arena *arena, int width, int height,
+                    float cellWidth, float cellHeight, int capacity) {
+    assert(width > 0 && height > 0 && cellWidth > 0.0f && cellHeight > 0.0f);
+
+    memset(grid, 0, sizeof(*grid));
+    grid->width = width;
+    grid->height = height;
+    grid->cellWidth = cellWidth;
+    grid->cellHeight = cellHeight;
+    grid->capacity = capacity;
+
+    grid->cellHead = ArenaAlloc(arena, sizeof(int) * width * height);
+    grid->next = ArenaAlloc(arena, sizeof(int) * capacity);
+    grid->prev = ArenaAlloc(arena, sizeof(int) * capacity);
+    grid->cell = ArenaAlloc(arena, sizeof(int) * capacity);
+    grid->minX = ArenaAlloc(arena, sizeof(float) * capacity);
+    grid->minY = ArenaAlloc(arena, sizeof(float) * capacity);
+    grid->maxX = ArenaAlloc(arena, sizeof(float) * capacity);
+    grid->maxY = ArenaAlloc(arena, sizeof(float) * capacity);
+
+    for (int c = 0; c < width * height; ++c) {
+        grid->cellHead[c] = -1;
+    }
+    for (int i = 0; i < capacity; ++i) {
+        grid->cell[i] = SPATIAL_NO_CELL;
+    }
+
+    return grid->maxY == NULL;
+}
+
+static int clampCell(float coord, float cellSize, int cells) {
+    int cell = (int)floorf(coord / cellSize);
+    return cell < 0 ? 0 : cell >= cells ? cells - 1 : cell;
+}
+
+static void unlinkItem(SpatialGrid *grid, int item) {
+    int c = grid->cell[item];
+    if (grid->prev[item] >= 0) {
+        grid->next[grid->prev[item]] = grid->next[item];
+    } else {
+        grid->cellHead[c] = grid->next[item];
+    }
+    if (grid->next[item] >= 0) {
+        grid->prev[grid->next[item]] = grid->prev[item];
+    }
+    grid->cell[item] = SPATIAL_NO_CELL;
+}
+
+void SpatialGridUpdate(SpatialGrid *grid, int item, float minX, float minY, float maxX,
+                       float maxY) {
+    assert(0 <= item && item < grid->capacity);
+
+    grid->minX[item] = minX;
+    grid->minY[item] = minY;
+    grid->maxX[item] = maxX;
+    grid->maxY[item] = maxY;
+    grid->maxBoxWidth = fmaxf(grid->maxBoxWidth, maxX - minX);
+    grid->maxBoxHeight = fmaxf(grid->maxBoxHeight, maxY - minY);
+
+    int c = clampCell(minY, grid->cellHeight, grid->height) * grid->width +
+            clampCell(minX, grid->cellWidth, grid->width);
+    if (c == grid->cell[item]) {
+        return;
+    }
+
+    if (grid->cell[item] != SPATIAL_NO_CELL) {
+        unlinkItem(grid, item);
+    }
+    grid->cell[item] = c;
+    grid->prev[item] = -1;
+    grid->next[item] = grid->cellHead[c];
+    if (grid->cellHead[c] >= 0) {
+        grid->prev[grid->cellHead[c]] = item;
+    }
+    grid->cellHead[c] = item;
+}
+
+void SpatialGridRemove(SpatialGrid *grid, int item) {
+    if (grid->cell[item] != SPATIAL_NO_CELL) {
+        unlinkItem(grid, item);
+    }
+}
+
+bool SpatialGridContains(const SpatialGrid *grid, int item) {
+    return grid->cell[item] != SPATIAL_NO_CELL;
+}
+
+int SpatialGridQuery(const SpatialGrid *grid, float minX, float minY, float maxX,
+                     float maxY, int *items, int maxItems) {
+    // a box overlapping the rectangle has its corner at most one box size
+    // above and left of it
+    int x0 = clampCell(minX - grid->maxBoxWidth, grid->cellWidth, grid->width);
+    int y0 = clampCell(minY - grid->maxBoxHeight, grid->cellHeight, grid->height);
+    int x1 = clampCell(maxX, grid->cellWidth, grid->width);
+    int y1 = clampCell(maxY, grid->cellHeight, grid->height);
+    int count = 0;
+
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            int i = grid->cellHead[y * grid->width + x];
+            for (; i >= 0; i = grid->next[i]) {
+                if (grid->maxX[i] < minX || grid->minX[i] > maxX ||
+                    grid->maxY[i] < minY || grid->minY[i] > maxY) {
+                    continue;
+                }
+                if (count >= maxItems) {
+                    return count;
+                }
+                items[count++] = i;
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,37 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+
+#define SPATIAL_NO_CELL -1
+
+// Uniform grid of boxes, each box is linked into the cell holding its top
+// left corner and only relinked when that cell changes. Queries widen the
+// rectangle by the largest box instead of listing a box in every cell.
+// Boxes outside of the grid are kept in the border cells.
+typedef struct SpatialGrid {
+    int width, height;
+    float cellWidth, cellHeight;
+    int *cellHead;
+
+    int capacity;
+    int *next, *prev;
+    int *cell;
+    float *minX, *minY, *maxX, *maxY;
+    float maxBoxWidth, maxBoxHeight;
+} SpatialGrid;
+
+int SpatialGridInit(SpatialGrid *grid, Arena *arena, int width, int height,
+                    float cellWidth, float cellHeight, int capacity);
+void SpatialGridUpdate(SpatialGrid *grid, int item, float minX, float minY, float maxX,
+                       float maxY);
+void SpatialGridRemove(SpatialGrid *grid, int item);
+bool SpatialGridContains(const SpatialGrid *grid, int item);
+
+// items whose box overlaps the rectangle, at most maxItems
+int SpatialGridQuery(const SpatialGrid *grid, float minX, float minY, float maxX,
+                     float maxY, int *items, int maxItems);
+
+#endif // !SPATIAL_H
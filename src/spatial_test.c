@@ -0,0 +1,93 @@
+#include "minunit.h"
+#include "spatial.c"
+#include "spatial.h"
+#include "utils.c"
+#include <stdio.h>
+
+char g_assertMsg[MU_MSGBUF_LEN];
+int g_testsRun = 0;
+
+static char *testQuery(void);
+static char *testMove(void);
+static char *allTests(void);
+
+int main(void) {
+    // run tests and exit
+    char *testsResults = allTests();
+    printf("Test count: %d\n", g_testsRun);
+
+    if (testsResults != 0) {
+        printf("Test failed\n");
+        printf("%s\n", testsResults);
+        return 1;
+    }
+    printf("All tests passed.\n");
+
+    return 0;
+}
+
+static char *testQuery(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    SpatialGrid grid;
+    int items[8];
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    SpatialGridInit(&grid, &arena, 8, 8, 100.0f, 100.0f, 8);
+    SpatialGridUpdate(&grid, 0, 10.0f, 10.0f, 40.0f, 40.0f);
+    SpatialGridUpdate(&grid, 1, 390.0f, 390.0f, 450.0f, 450.0f);
+    SpatialGridUpdate(&grid, 2, 700.0f, 100.0f, 730.0f, 130.0f);
+    // off the map, kept in a border cell
+    SpatialGridUpdate(&grid, 3, -60.0f, 200.0f, -30.0f, 230.0f);
+
+    int count = SpatialGridQuery(&grid, 400.0f, 400.0f, 600.0f, 600.0f, items, 8);
+    MU_ASSERT_FMT(1 == count, "Expected %d items, but got %d", 1, count);
+    MU_ASSERT_FMT(1 == items[0], "Expected item %d, but got %d", 1, items[0]);
+
+    // overlaps from a cell left of the query
+    count = SpatialGridQuery(&grid, 420.0f, 420.0f, 500.0f, 500.0f, items, 8);
+    MU_ASSERT_FMT(1 == count, "Expected %d items, but got %d", 1, count);
+
+    count = SpatialGridQuery(&grid, -100.0f, 0.0f, 50.0f, 300.0f, items, 8);
+    MU_ASSERT_FMT(2 == count, "Expected %d items, but got %d", 2, count);
+
+    count = SpatialGridQuery(&grid, 0.0f, 0.0f, 800.0f, 800.0f, items, 8);
+    MU_ASSERT_FMT(3 == count, "Expected %d items, but got %d", 3, count);
+
+    MU_PASS;
+}
+
+static char *testMove(void) {
+    unsigned char buffer[Kilobyte(4)];
+    Arena arena;
+    SpatialGrid grid;
+    int items[8];
+
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    SpatialGridInit(&grid, &arena, 8, 8, 100.0f, 100.0f, 8);
+    SpatialGridUpdate(&grid, 0, 10.0f, 10.0f, 20.0f, 20.0f);
+    SpatialGridUpdate(&grid, 1, 15.0f, 15.0f, 25.0f, 25.0f);
+    SpatialGridUpdate(&grid, 2, 50.0f, 50.0f, 60.0f, 60.0f);
+
+    SpatialGridUpdate(&grid, 1, 615.0f, 615.0f, 625.0f, 625.0f);
+    int count = SpatialGridQuery(&grid, 0.0f, 0.0f, 99.0f, 99.0f, items, 8);
+    MU_ASSERT_FMT(2 == count, "Expected %d items, but got %d", 2, count);
+    count = SpatialGridQuery(&grid, 600.0f, 600.0f, 700.0f, 700.0f, items, 8);
+    MU_ASSERT_FMT(1 == count, "Expected %d items, but got %d", 1, count);
+
+    SpatialGridRemove(&grid, 0);
+    SpatialGridRemove(&grid, 0);
+    MU_ASSERT(!SpatialGridContains(&grid, 0), "Expected item 0 to be removed");
+    count = SpatialGridQuery(&grid, 0.0f, 0.0f, 99.0f, 99.0f, items, 8);
+    MU_ASSERT_FMT(1 == count, "Expected %d items, but got %d", 1, count);
+    MU_ASSERT_FMT(2 == items[0], "Expected item %d, but got %d", 2, items[0]);
+
+    MU_PASS;
+}
+
+static char *allTests(void) {
+    MU_TEST(testQuery);
+    MU_TEST(testMove);
+
+    MU_PASS;
+}
@@ -4,12 +4,18 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define ALIST_INITIAL_CAP  16
 #define HTABLE_INITIAL_CAP 16
-#define FNV_OFFSET         14695981039346656037UL
 #define FNV_PRIME          1099511628211UL
 
+// hash table control bytes, full slots hold the 7 low bits of their hash
+#define CTRL_EMPTY   ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+
 void ArenaInit(Arena *arena, void *backingBuffer, size_t capacity) {
     arena->buff = (unsigned char *)backingBuffer;
     arena->buffLen = capacity;
@@ -17,7 +23,7 @@ void ArenaInit(Arena *arena, void *backingBuffer, size_t capacity) {
     arena->prevOffset = 0;
 }
 
-static bool isPowerOfTwo(uintptr_t x) {
+static inline bool isPowerOfTwo(uintptr_t x) {
     return (x & (x - 1)) == 0;
 }
 
@@ -38,7 +44,7 @@ static uintptr_t alignForward(uintptr_t ptr, size_t align) {
     return p;
 }
 
-void *ArenaAllocAligned(Arena *arena, size_t size, size_t align) {
+void *ArenaAllocAlignedNoZero(Arena *arena, size_t size, size_t align) {
     uintptr_t currPtr = (uintptr_t)arena->buff + (uintptr_t)arena->currOffset;
     uintptr_t offset = alignForward(currPtr, align);
     offset -= (uintptr_t)arena->buff;
@@ -47,15 +53,21 @@ void *ArenaAllocAligned(Arena *arena, size_t size, size_t align) {
         void *ptr = &arena->buff[offset];
         arena->prevOffset = offset;
         arena->currOffset = offset + size;
-
-        memset(ptr, 0, size);
         return ptr;
     }
 
-    assert(0 && "Out of memory in this arena");
+    // the caller decides whether running out is fatal
     return NULL;
 }
 
+void *ArenaAllocAligned(Arena *arena, size_t size, size_t align) {
+    void *ptr = ArenaAllocAlignedNoZero(arena, size, align);
+    if (ptr != NULL) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
 void *ArenaAlloc(Arena *arena, size_t size) {
     return ArenaAllocAligned(arena, size, DEFAULT_ALIGNMENT);
 }
@@ -67,24 +79,30 @@ void *ArenaReallocAligned(Arena *a, void *oldMemory, size_t oldSize, size_t newS
     assert(isPowerOfTwo(align));
 
     if (oldMem == NULL || oldSize == 0) {
-        return ArenaAllocAligned(a, newSize, DEFAULT_ALIGNMENT);
+        return ArenaAllocAligned(a, newSize, align);
     } else if (a->buff <= oldMem && oldMem < a->buff + a->buffLen) {
-        if (a->buff + a->prevOffset == oldMem) {
-            // reuse the same block that was previously allocated
+        bool aligned = ((uintptr_t)oldMem & (align - 1)) == 0;
+        if (a->buff + a->prevOffset == oldMem && aligned &&
+            a->prevOffset + newSize <= a->buffLen) {
+            // reuse the same block that was previously allocated, only the
+            // grown tail is cleared
             a->currOffset = a->prevOffset + newSize;
             if (newSize > oldSize) {
-                memset(&a->buff[a->currOffset], 0, newSize - oldSize);
+                memset(&a->buff[a->prevOffset + oldSize], 0, newSize - oldSize);
             }
             return oldMem;
         } else {
             void *newMemory = ArenaAllocAligned(a, newSize, align);
+            if (newMemory == NULL) {
+                return NULL;
+            }
             size_t copySize = oldSize < newSize ? oldSize : newSize;
             memmove(newMemory, oldMemory, copySize);
             return newMemory;
         }
     }
 
-    assert(0 && "Out of memory in this arena");
+    assert(0 && "Memory is out of bounds of this arena");
     return NULL;
 }
 
@@ -124,9 +142,11 @@ void AListReset(AList *list) {
 void AListAppend(AList *list, int elmnt) {
     if (list->size >= list->capacity) {
         size_t newCapacity = list->capacity << 1;
-        list->elmnts =
+        int *elmnts =
             ArenaRealloc(list->arena, list->elmnts, list->capacity * sizeof(int),
                          newCapacity * sizeof(int));
+        assert(elmnts != NULL && "Out of memory in this arena");
+        list->elmnts = elmnts;
         list->capacity = newCapacity;
     }
     list->elmnts[list->size++] = elmnt;
@@ -134,88 +154,285 @@ void AListAppend(AList *list, int elmnt) {
 
 static uint64_t hashKey(const char *key) {
     // https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
-    uint64_t hash = FNV_OFFSET;
+    uint64_t hash = HASH_SEED;
     for (const char *p = key; *p; p++) {
         hash ^= (uint64_t)(unsigned char)(*p);
         hash *= FNV_PRIME;
     }
 
+    // the table probes with the low bits, which FNV barely mixes
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdUL;
+    hash ^= hash >> 33;
     return hash;
 }
 
+// bit i set when slot i of the group holds ctrl
+static uint32_t groupMatch(const uint8_t *group, uint8_t ctrl) {
+#ifdef __SSE2__
+    __m128i slots = _mm_load_si128((const __m128i *)group);
+    __m128i match = _mm_cmpeq_epi8(slots, _mm_set1_epi8((char)ctrl));
+    return (uint32_t)_mm_movemask_epi8(match);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HTABLE_GROUP_WIDTH; ++i) {
+        mask |= (uint32_t)(group[i] == ctrl) << i;
+    }
+    return mask;
+#endif
+}
+
+// bit i set when slot i of the group is empty or deleted
+static uint32_t groupMatchFree(const uint8_t *group) {
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HTABLE_GROUP_WIDTH; ++i) {
+        mask |= (uint32_t)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+static int lowestBit(uint32_t mask) {
+    return __builtin_ctz(mask);
+}
+
+static void allocSlots(HTable *table, size_t capacity) {
+    assert(capacity >= HTABLE_GROUP_WIDTH && isPowerOfTwo(capacity));
+
+    // one block, control bytes first so both stay aligned
+    // entries are only read where the control byte says full, no zeroing
+    unsigned char *block = ArenaAllocAlignedNoZero(
+        table->arena, capacity + capacity * sizeof(HTableEntry), HTABLE_GROUP_WIDTH);
+    table->ctrl = block;
+    table->entries = (HTableEntry *)(block + capacity);
+    table->capacity = capacity;
+    table->size = 0;
+    table->tombstones = 0;
+    memset(table->ctrl, CTRL_EMPTY, capacity);
+}
+
 void HTableInit(HTable *table, Arena *arena) {
+    memset(table, 0, sizeof(*table));
     table->arena = arena;
-    table->entries = ArenaAlloc(arena, HTABLE_INITIAL_CAP * sizeof(HTableEntry));
-    table->capacity = HTABLE_INITIAL_CAP;
-    table->size = 0;
+    allocSlots(table, HTABLE_INITIAL_CAP);
 }
 
 void HTableReset(HTable *table) {
-    memset(table->entries, 0, sizeof(HTableEntry) * table->capacity);
+    memset(table->ctrl, CTRL_EMPTY, table->capacity);
     table->size = 0;
+    table->tombstones = 0;
 }
 
-static void HTableSetEntry(Arena *arena, HTableEntry *entries, size_t capacity,
-                           const char *key, int elmnt, size_t *pSize) {
-    uint64_t hash = hashKey(key);
-    size_t index = (hash & (capacity - 1));
-    char *dupKey;
+static HTableEntry *findEntry(const HTable *table, const char *key, uint64_t hash) {
+    size_t groupMask = table->capacity / HTABLE_GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & groupMask;
+    uint8_t h2 = hash & 0x7F;
+
+    // triangular probing over groups visits every group once
+    for (size_t step = 1;; ++step) {
+        const uint8_t *ctrl = &table->ctrl[group * HTABLE_GROUP_WIDTH];
+        for (uint32_t match = groupMatch(ctrl, h2); match != 0; match &= match - 1) {
+            HTableEntry *entry =
+                &table->entries[group * HTABLE_GROUP_WIDTH + lowestBit(match)];
+            if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+                return entry;
+            }
+        }
 
-    while (entries[index].key != NULL) {
-        if (strcmp(key, entries[index].key) == 0) {
-            // replace key
-            entries[index].value = elmnt;
+        // keys are never placed past a group with an empty slot
+        if (groupMatch(ctrl, CTRL_EMPTY) != 0 || step > groupMask) {
+            return NULL;
         }
-        index = (index + 1) % capacity;
+        group = (group + step) & groupMask;
     }
+}
 
-    // duplicate string
-    if (pSize != NULL) {
-        dupKey = ArenaAlloc(arena, strlen(key) + 1);
-        strncpy(dupKey, key, strlen(key) + 1);
-        (*pSize)++;
+static size_t findFreeSlot(const HTable *table, uint64_t hash) {
+    size_t groupMask = table->capacity / HTABLE_GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & groupMask;
+
+    for (size_t step = 1;; ++step) {
+        uint32_t slots = groupMatchFree(&table->ctrl[group * HTABLE_GROUP_WIDTH]);
+        if (slots != 0) {
+            return group * HTABLE_GROUP_WIDTH + lowestBit(slots);
+        }
+        assert(step <= groupMask && "Hash table is full");
+        group = (group + step) & groupMask;
     }
+}
 
-    // adding new entry
-    key = (pSize == NULL) ? key : dupKey;
-    entries[index].key = key;
-    entries[index].value = elmnt;
+static void insertEntry(HTable *table, const char *key, uint64_t hash, int elmnt) {
+    size_t slot = findFreeSlot(table, hash);
+    if (table->ctrl[slot] == CTRL_DELETED) {
+        --table->tombstones;
+    }
+    table->ctrl[slot] = hash & 0x7F;
+    table->entries[slot] = (HTableEntry){.key = key, .hash = hash, .value = elmnt};
+    ++table->size;
 }
 
-void HTableExpand(HTable *table, size_t newCapacity) {
-    HTableEntry *newEntries = ArenaAlloc(table->arena, newCapacity * sizeof(HTableEntry));
+static const char *copyKey(HTable *table, const char *key) {
+    size_t len = strlen(key) + 1;
+    char *copy;
 
-    for (size_t i = 0; i < table->capacity; ++i) {
-        HTableEntry entry = table->entries[i];
-        if (entry.key != NULL) {
-            HTableSetEntry(table->arena, newEntries, newCapacity, entry.key,
-                           entry.value, NULL);
+    if (len <= table->keyPoolLen) {
+        copy = table->keyPool;
+        table->keyPool += len;
+        table->keyPoolLen -= len;
+    } else {
+        copy = ArenaAllocAlignedNoZero(table->arena, len, 1);
+    }
+    memcpy(copy, key, len);
+    return copy;
+}
+
+static void rehash(HTable *table, size_t newCapacity) {
+    uint8_t *oldCtrl = table->ctrl;
+    HTableEntry *oldEntries = table->entries;
+    size_t oldCapacity = table->capacity;
+
+    allocSlots(table, newCapacity);
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (!(oldCtrl[i] & CTRL_EMPTY)) {
+            insertEntry(table, oldEntries[i].key, oldEntries[i].hash,
+                        oldEntries[i].value);
         }
     }
 
-    table->entries = newEntries;
-    table->capacity = newCapacity;
+    // the arena can't take the old slots back, they hold the next key copies
+    size_t oldLen = oldCapacity + oldCapacity * sizeof(HTableEntry);
+    if (oldLen > table->keyPoolLen) {
+        table->keyPool = (char *)oldCtrl;
+        table->keyPoolLen = oldLen;
+    }
+}
+
+void HTableExpand(HTable *table, size_t newCapacity) {
+    size_t capacity = HTABLE_INITIAL_CAP;
+    while (capacity < newCapacity) {
+        capacity <<= 1;
+    }
+    if (capacity > table->capacity) {
+        rehash(table, capacity);
+    }
 }
 
 void HTableSet(HTable *table, const char *key, int elmnt) {
-    if (table->size >= table->capacity / 2) {
-        HTableExpand(table, table->capacity << 1);
+    uint64_t hash = hashKey(key);
+    HTableEntry *entry = findEntry(table, key, hash);
+    if (entry != NULL) {
+        entry->value = elmnt;
+        return;
     }
 
-    return HTableSetEntry(table->arena, table->entries, table->capacity, key, elmnt,
-                          &table->size);
+    // at most 7/8 of the slots used, tombstones included
+    if ((table->size + table->tombstones + 1) * 8 > table->capacity * 7) {
+        // mostly tombstones, cleaning them up is enough
+        bool crowded = (table->size + 1) * 16 > table->capacity * 7;
+        rehash(table, crowded ? table->capacity << 1 : table->capacity);
+    }
+    insertEntry(table, copyKey(table, key), hash, elmnt);
 }
 
 int HTableGet(HTable *table, const char *key) {
-    uint64_t hash = hashKey(key);
-    size_t index = (hash & (table->capacity - 1));
+    HTableEntry *entry = findEntry(table, key, hashKey(key));
+    return entry != NULL ? entry->value : -1;
+}
+
+bool HTableRemove(HTable *table, const char *key) {
+    HTableEntry *entry = findEntry(table, key, hashKey(key));
+    if (entry == NULL) {
+        return false;
+    }
+
+    // lookups stop at a group with an empty slot, so if the group already
+    // has one nothing was ever placed past it and the slot can be empty too
+    size_t slot = entry - table->entries;
+    const uint8_t *group = &table->ctrl[slot & ~(size_t)(HTABLE_GROUP_WIDTH - 1)];
+    if (groupMatch(group, CTRL_EMPTY) != 0) {
+        table->ctrl[slot] = CTRL_EMPTY;
+    } else {
+        table->ctrl[slot] = CTRL_DELETED;
+        ++table->tombstones;
+    }
+    --table->size;
+    return true;
+}
+
+uint64_t HashBytes(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+void BitsetInit(Bitset *set, Arena *arena, int bits) {
+    assert(bits > 0);
+    set->bits = bits;
+    set->wordsCount = (bits + 63) / 64;
+    set->words = ArenaAllocAligned(arena, sizeof(uint64_t) * set->wordsCount,
+                                   _Alignof(uint64_t));
+}
+
+void BitsetClearAll(Bitset *set) {
+    memset(set->words, 0, sizeof(uint64_t) * set->wordsCount);
+}
+
+void BitsetSet(Bitset *set, int bit) {
+    assert(0 <= bit && bit < set->bits);
+    set->words[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
 
-    while (table->entries[index].key != NULL) {
-        if (strcmp(key, table->entries[index].key) == 0) {
-            return table->entries[index].value;
+void BitsetClear(Bitset *set, int bit) {
+    assert(0 <= bit && bit < set->bits);
+    set->words[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+bool BitsetTest(const Bitset *set, int bit) {
+    assert(0 <= bit && bit < set->bits);
+    return (set->words[bit / 64] >> (bit % 64)) & 1;
+}
+
+int BitsetCount(const Bitset *set) {
+    int count = 0;
+    for (int i = 0; i < set->wordsCount; ++i) {
+        count += __builtin_popcountll(set->words[i]);
+    }
+    return count;
+}
+
+int BitsetNext(const Bitset *set, int from) {
+    if (from >= set->bits) {
+        return -1;
+    }
+
+    // bits below from are masked out of the first word
+    int i = from / 64;
+    uint64_t word = set->words[i] & (~(uint64_t)0 << (from % 64));
+    while (word == 0) {
+        if (++i >= set->wordsCount) {
+            return -1;
         }
-        index = (index + 1) % table->capacity;
+        word = set->words[i];
     }
+    return i * 64 + __builtin_ctzll(word);
+}
 
-    return -1;
+void BitsetAnd(Bitset *dst, const Bitset *src) {
+    assert(dst->bits == src->bits);
+    for (int i = 0; i < dst->wordsCount; ++i) {
+        dst->words[i] &= src->words[i];
+    }
+}
+
+void BitsetOr(Bitset *dst, const Bitset *src) {
+    assert(dst->bits == src->bits);
+    for (int i = 0; i < dst->wordsCount; ++i) {
+        dst->words[i] |= src->words[i];
+    }
 }
@@ -1,12 +1,21 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #define Kilobyte(k) (k * 1024)
 #define Megabyte(m) (m * 1024 * 1024)
 #define Gigabyte(g) (g * 1024 * 1024 * 1024)
 
+#define HTABLE_GROUP_WIDTH 16
+
+// FNV-1a offset basis, the hash of no bytes
+#define HASH_SEED 14695981039346656037UL
+
 #ifndef DEFAULT_ALIGNMENT
 #define DEFAULT_ALIGNMENT (2 * sizeof(void *))
 #endif
@@ -33,21 +42,41 @@ typedef struct AList {
 
 typedef struct HTableEntry {
     const char *key;
+    uint64_t hash;
     int value;
 } HTableEntry;
 
+// Open addressing in groups of HTABLE_GROUP_WIDTH slots. Every slot has a
+// control byte: empty, deleted, or the low 7 bits of the hash of its key,
+// so a whole group is matched at once and most key compares are skipped
 typedef struct HTable {
     Arena *arena;
+    uint8_t *ctrl;
     HTableEntry *entries;
     size_t capacity;
     size_t size;
+    size_t tombstones;
+
+    // tables outgrown by this one, key copies are carved out of them
+    char *keyPool;
+    size_t keyPoolLen;
 } HTable;
 
+// Fixed size set of bits, scanned a word at a time
+typedef struct Bitset {
+    uint64_t *words;
+    int bits;
+    int wordsCount;
+} Bitset;
+
 // Arena Allocator
 //
+// Allocations that don't fit return NULL and leave the arena as it was
 void ArenaInit(Arena *arena, void *backingBuffer, size_t capacity);
 void ArenaReset(Arena *arena);
 void *ArenaAllocAligned(Arena *arena, size_t size, size_t align);
+// for memory that is written right away, skips zeroing it
+void *ArenaAllocAlignedNoZero(Arena *arena, size_t size, size_t align);
 void *ArenaReallocAligned(Arena *arena, void *oldMemory, size_t oldSize, size_t newSize,
                           size_t align);
 void *ArenaAlloc(Arena *arena, size_t size);
@@ -72,5 +101,142 @@ void HTableExpand(HTable *table, size_t newCapacity);
 void HTableReset(HTable *table);
 void HTableSet(HTable *table, const char *key, int elmnt);
 int HTableGet(HTable *table, const char *key);
+bool HTableRemove(HTable *table, const char *key);
+
+// FNV-1a of the bytes continuing from hash, chains over several buffers
+// starting from HASH_SEED
+uint64_t HashBytes(uint64_t hash, const void *data, size_t len);
+
+// Bitset
+//
+// for (int bit = BitsetNext(set, 0); bit >= 0; bit = BitsetNext(set, bit + 1))
+// visits every set bit in order
+void BitsetInit(Bitset *set, Arena *arena, int bits);
+void BitsetClearAll(Bitset *set);
+void BitsetSet(Bitset *set, int bit);
+void BitsetClear(Bitset *set, int bit);
+bool BitsetTest(const Bitset *set, int bit);
+int BitsetCount(const Bitset *set);
+int BitsetNext(const Bitset *set, int from);
+void BitsetAnd(Bitset *dst, const Bitset *src);
+void BitsetOr(Bitset *dst, const Bitset *src);
+
+// Typed containers
+//
+// ARRAY_DEFINE(Name, T) defines Name, a growable array of T, and its
+// functions Name##Init, Name##Reserve, Name##Push, Name##Append,
+// Name##SwapRemove and Name##Reset. Growing past a full arena fails, Push
+// returns NULL then.
+#define ARRAY_DEFINE(Name, T)                                                          \
+    typedef struct Name {                                                              \
+        Arena *arena;                                                                  \
+        T *items;                                                                      \
+        size_t size;                                                                   \
+        size_t capacity;                                                               \
+    } Name;                                                                            \
+                                                                                       \
+    static inline void Name##Init(Name *array, Arena *arena, size_t capacity) {        \
+        array->arena = arena;                                                          \
+        array->items = capacity > 0 ? ArenaAllocAligned(arena, sizeof(T) * capacity,   \
+                                                        _Alignof(T))                   \
+                                    : NULL;                                            \
+        array->size = 0;                                                               \
+        array->capacity = capacity;                                                    \
+    }                                                                                  \
+                                                                                       \
+    /* false when the arena is full, the items are kept as they were */                \
+    static inline bool Name##Reserve(Name *array, size_t capacity) {                   \
+        if (capacity <= array->capacity) {                                             \
+            return true;                                                               \
+        }                                                                              \
+        size_t newCapacity = array->capacity > 0 ? array->capacity : 8;                \
+        while (newCapacity < capacity) {                                               \
+            newCapacity <<= 1;                                                         \
+        }                                                                              \
+        /* grows in place when the items are the last allocation */                    \
+        T *items = ArenaReallocAligned(array->arena, array->items,                     \
+                                       sizeof(T) * array->capacity,                    \
+                                       sizeof(T) * newCapacity, _Alignof(T));          \
+        if (items == NULL) {                                                           \
+            return false;                                                              \
+        }                                                                              \
+        array->items = items;                                                          \
+        array->capacity = newCapacity;                                                 \
+        return true;                                                                   \
+    }                                                                                  \
+                                                                                       \
+    static inline T *Name##Push(Name *array, T item) {                                 \
+        if (!Name##Reserve(array, array->size + 1)) {                                  \
+            return NULL;                                                               \
+        }                                                                              \
+        array->items[array->size] = item;                                              \
+        return &array->items[array->size++];                                           \
+    }                                                                                  \
+                                                                                       \
+    static inline bool Name##Append(Name *array, const T *items, size_t count) {       \
+        if (!Name##Reserve(array, array->size + count)) {                              \
+            return false;                                                              \
+        }                                                                              \
+        memcpy(&array->items[array->size], items, sizeof(T) * count);                  \
+        array->size += count;                                                          \
+        return true;                                                                   \
+    }                                                                                  \
+                                                                                       \
+    /* the last item takes the place of the removed one */                             \
+    static inline void Name##SwapRemove(Name *array, size_t idx) {                     \
+        assert(idx < array->size);                                                     \
+        array->items[idx] = array->items[--array->size];                               \
+    }                                                                                  \
+                                                                                       \
+    static inline void Name##Reset(Name *array) {                                      \
+        array->size = 0;                                                               \
+    }
+
+// RING_DEFINE(Name, T) defines Name, a fixed power of two ring of T, and
+// its functions Name##Init, Name##Push, Name##Pop, Name##Peek and
+// Name##Count. Pushing into a full ring fails.
+#define RING_DEFINE(Name, T)                                                           \
+    typedef struct Name {                                                              \
+        T *items;                                                                      \
+        uint32_t head;                                                                 \
+        uint32_t tail;                                                                 \
+        uint32_t mask;                                                                 \
+    } Name;                                                                            \
+                                                                                       \
+    static inline void Name##Init(Name *ring, Arena *arena, uint32_t capacity) {       \
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);                      \
+        ring->items = ArenaAllocAligned(arena, sizeof(T) * capacity, _Alignof(T));     \
+        ring->head = 0;                                                                \
+        ring->tail = 0;                                                                \
+        ring->mask = capacity - 1;                                                     \
+    }                                                                                  \
+                                                                                       \
+    static inline uint32_t Name##Count(const Name *ring) {                             \
+        return ring->tail - ring->head;                                                \
+    }                                                                                  \
+                                                                                       \
+    static inline bool Name##Push(Name *ring, T item) {                                \
+        if (ring->tail - ring->head > ring->mask) {                                    \
+            return false;                                                              \
+        }                                                                              \
+        ring->items[ring->tail++ & ring->mask] = item;                                 \
+        return true;                                                                   \
+    }                                                                                  \
+                                                                                       \
+    static inline bool Name##Pop(Name *ring, T *item) {                                \
+        if (ring->head == ring->tail) {                                                \
+            return false;                                                              \
+        }                                                                              \
+        *item = ring->items[ring->head++ & ring->mask];                                \
+        return true;                                                                   \
+    }                                                                                  \
+                                                                                       \
+    /* idx 0 is the oldest item */                                                     \
+    static inline T *Name##Peek(Name *ring, uint32_t idx) {                            \
+        if (idx >= ring->tail - ring->head) {                                          \
+            return NULL;                                                               \
+        }                                                                              \
+        return &ring->items[(ring->head + idx) & ring->mask];                          \
+    }
 
 #endif // !UTILS_H
@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "utils.c"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WARMUP_RUNS 5
+#define BENCH_RUNS  200
+#define MAX_RESULTS 32
+#define KEYS_COUNT  4096
+#define TABLE_CAP   8192
+
+typedef void (*BenchFn)(void *ctx, int ops);
+
+typedef struct BenchResult {
+    const char *name;
+    double minNs, medianNs, p99Ns;
+} BenchResult;
+
+static BenchResult results[MAX_RESULTS];
+static int resultsCount;
+
+// everything benchmarked feeds this so nothing is optimized away
+static volatile uintptr_t sink;
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// What HTable used to be: linear probing on bare keys, a strcmp per slot
+typedef struct LegacyTable {
+    Arena *arena;
+    HTableEntry *entries;
+    size_t capacity;
+    size_t size;
+} LegacyTable;
+
+static uint64_t legacyHash(const char *key) {
+    uint64_t hash = HASH_SEED;
+    for (const char *p = key; *p; p++) {
+        hash ^= (uint64_t)(unsigned char)(*p);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static void legacySetEntry(Arena *arena, HTableEntry *entries, size_t capacity,
+                           const char *key, int elmnt, size_t *pSize) {
+    size_t index = legacyHash(key) & (capacity - 1);
+    while (entries[index].key != NULL) {
+        if (strcmp(key, entries[index].key) == 0) {
+            entries[index].value = elmnt;
+        }
+        index = (index + 1) % capacity;
+    }
+    if (pSize != NULL) {
+        char *dupKey = ArenaAlloc(arena, strlen(key) + 1);
+        strcpy(dupKey, key);
+        key = dupKey;
+        (*pSize)++;
+    }
+    entries[index].key = key;
+    entries[index].value = elmnt;
+}
+
+static void legacySet(LegacyTable *table, const char *key, int elmnt) {
+    if (table->size >= table->capacity / 2) {
+        size_t newCapacity = table->capacity << 1;
+        HTableEntry *newEntries =
+            ArenaAlloc(table->arena, newCapacity * sizeof(HTableEntry));
+        for (size_t i = 0; i < table->capacity; ++i) {
+            if (table->entries[i].key != NULL) {
+                legacySetEntry(table->arena, newEntries, newCapacity,
+                               table->entries[i].key, table->entries[i].value, NULL);
+            }
+        }
+        table->entries = newEntries;
+        table->capacity = newCapacity;
+    }
+    legacySetEntry(table->arena, table->entries, table->capacity, key, elmnt,
+                   &table->size);
+}
+
+static int legacyGet(LegacyTable *table, const char *key) {
+    size_t index = legacyHash(key) & (table->capacity - 1);
+    while (table->entries[index].key != NULL) {
+        if (strcmp(key, table->entries[index].key) == 0) {
+            return table->entries[index].value;
+        }
+        index = (index + 1) % table->capacity;
+    }
+    return -1;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// ns per op of every run, after a few runs to warm the caches up
+static void run(const char *name, BenchFn fn, void *ctx, int ops) {
+    double samples[BENCH_RUNS];
+
+    for (int i = 0; i < WARMUP_RUNS; ++i) {
+        fn(ctx, ops);
+    }
+    for (int i = 0; i < BENCH_RUNS; ++i) {
+        double start = nowMs();
+        fn(ctx, ops);
+        samples[i] = (nowMs() - start) * 1e6 / ops;
+    }
+    qsort(samples, BENCH_RUNS, sizeof(double), compareDouble);
+
+    assert(resultsCount < MAX_RESULTS);
+    results[resultsCount++] = (BenchResult){.name = name,
+                                            .minNs = samples[0],
+                                            .medianNs = samples[BENCH_RUNS / 2],
+                                            .p99Ns = samples[BENCH_RUNS * 99 / 100]};
+}
+
+typedef struct AllocCtx {
+    Arena arena;
+    size_t size;
+} AllocCtx;
+
+static void benchAllocZero(void *ctx, int ops) {
+    AllocCtx *alloc = ctx;
+    ArenaReset(&alloc->arena);
+    for (int i = 0; i < ops; ++i) {
+        sink += (uintptr_t)ArenaAlloc(&alloc->arena, alloc->size);
+    }
+}
+
+static void benchAllocNoZero(void *ctx, int ops) {
+    AllocCtx *alloc = ctx;
+    ArenaReset(&alloc->arena);
+    for (int i = 0; i < ops; ++i) {
+        sink += (uintptr_t)ArenaAllocAlignedNoZero(&alloc->arena, alloc->size,
+                                                   DEFAULT_ALIGNMENT);
+    }
+}
+
+static void benchRealloc(void *ctx, int ops) {
+    AllocCtx *alloc = ctx;
+    ArenaReset(&alloc->arena);
+    // a block growing in place, like an array appended to
+    void *block = ArenaAlloc(&alloc->arena, alloc->size);
+    for (int i = 0; i < ops; ++i) {
+        block = ArenaRealloc(&alloc->arena, block, alloc->size * (i + 1),
+                             alloc->size * (i + 2));
+    }
+    sink += (uintptr_t)block;
+}
+
+static void benchAListAppend(void *ctx, int ops) {
+    AllocCtx *alloc = ctx;
+    AList list;
+    ArenaReset(&alloc->arena);
+    AListInit(&list, &alloc->arena);
+    for (int i = 0; i < ops; ++i) {
+        AListAppend(&list, i);
+    }
+    sink += list.size;
+}
+
+typedef struct TableCtx {
+    Arena arena;
+    HTable table;
+    LegacyTable legacy;
+    char (*keys)[32];
+    int keysCount;
+    // lookups start at this key, past keysCount they all miss
+    int first;
+} TableCtx;
+
+static void benchTableSet(void *ctx, int ops) {
+    TableCtx *table = ctx;
+    ArenaReset(&table->arena);
+    HTableInit(&table->table, &table->arena);
+    for (int i = 0; i < ops; ++i) {
+        HTableSet(&table->table, table->keys[i % table->keysCount], i);
+    }
+    sink += table->table.size;
+}
+
+static void benchTableGet(void *ctx, int ops) {
+    TableCtx *table = ctx;
+    for (int i = 0; i < ops; ++i) {
+        int key = table->first + i % table->keysCount;
+        sink += HTableGet(&table->table, table->keys[key]);
+    }
+}
+
+static void benchLegacyGet(void *ctx, int ops) {
+    TableCtx *table = ctx;
+    for (int i = 0; i < ops; ++i) {
+        int key = table->first + i % table->keysCount;
+        sink += legacyGet(&table->legacy, table->keys[key]);
+    }
+}
+
+static void benchHash(void *ctx, int ops) {
+    const char *key = ctx;
+    for (int i = 0; i < ops; ++i) {
+        sink += hashKey(key);
+    }
+}
+
+static void printJson(FILE *file) {
+    fprintf(file, "{\n  \"unit\": \"ns/op\",\n  \"runs\": %d,\n  \"results\": [\n",
+            BENCH_RUNS);
+    for (int i = 0; i < resultsCount; ++i) {
+        fprintf(file, "    {\"name\": \"%s\", \"min\": %.2f, \"median\": %.2f, ",
+                results[i].name, results[i].minNs, results[i].medianNs);
+        fprintf(file, "\"p99\": %.2f}%s\n", results[i].p99Ns,
+                i + 1 < resultsCount ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    AllocCtx alloc = {.size = 64};
+    ArenaInit(&alloc.arena, malloc(Megabyte(64)), Megabyte(64));
+
+    run("arena_alloc_64", benchAllocZero, &alloc, 10000);
+    run("arena_alloc_64_nozero", benchAllocNoZero, &alloc, 10000);
+    alloc.size = 4096;
+    run("arena_alloc_4k", benchAllocZero, &alloc, 1000);
+    run("arena_alloc_4k_nozero", benchAllocNoZero, &alloc, 1000);
+    alloc.size = 16;
+    run("arena_realloc_in_place", benchRealloc, &alloc, 10000);
+    run("alist_append", benchAListAppend, &alloc, 100000);
+    free(alloc.arena.buff);
+
+    // keys past TABLE_CAP are never inserted, looking them up misses
+    TableCtx table = {.keysCount = KEYS_COUNT};
+    table.keys = malloc(sizeof(*table.keys) * TABLE_CAP * 2);
+    for (int i = 0; i < TABLE_CAP * 2; ++i) {
+        snprintf(table.keys[i], sizeof(table.keys[i]), "prison_tile_%d", i);
+    }
+    ArenaInit(&table.arena, malloc(Megabyte(64)), Megabyte(64));
+    run("htable_set", benchTableSet, &table, KEYS_COUNT);
+
+    // more and more keys in a table of the same size, up to its 7/8 limit
+    const char *names[][2] = {{"htable_get_hit_25", "htable_get_miss_25"},
+                              {"htable_get_hit_50", "htable_get_miss_50"},
+                              {"htable_get_hit_85", "htable_get_miss_85"}};
+    const int loads[] = {TABLE_CAP / 4, TABLE_CAP / 2, TABLE_CAP * 85 / 100};
+    for (int load = 0; load < 3; ++load) {
+        ArenaReset(&table.arena);
+        HTableInit(&table.table, &table.arena);
+        HTableExpand(&table.table, TABLE_CAP);
+        table.keysCount = loads[load];
+        for (int i = 0; i < table.keysCount; ++i) {
+            HTableSet(&table.table, table.keys[i], i);
+        }
+        assert(table.table.capacity == TABLE_CAP);
+        table.first = 0;
+        run(names[load][0], benchTableGet, &table, 100000);
+        table.first = TABLE_CAP;
+        run(names[load][1], benchTableGet, &table, 100000);
+    }
+
+    // what HTable used to be, it grew at half load
+    table.legacy = (LegacyTable){.arena = &table.arena, .capacity = HTABLE_INITIAL_CAP};
+    table.legacy.entries =
+        ArenaAlloc(&table.arena, sizeof(HTableEntry) * table.legacy.capacity);
+    table.keysCount = KEYS_COUNT;
+    for (int i = 0; i < table.keysCount; ++i) {
+        legacySet(&table.legacy, table.keys[i], i);
+    }
+    table.first = 0;
+    run("legacy_get_hit", benchLegacyGet, &table, 100000);
+    table.first = TABLE_CAP;
+    run("legacy_get_miss", benchLegacyGet, &table, 100000);
+    free(table.arena.buff);
+    free(table.keys);
+
+    run("hash_key_16", benchHash, "prison_tile_1234", 100000);
+    run("hash_key_64", benchHash,
+        "assets/spritesheets/entities/policeman_walk_left_frame_0001.png", 100000);
+
+    printf("%-24s %10s %10s %10s\n", "benchmark", "min ns", "median ns", "p99 ns");
+    for (int i = 0; i < resultsCount; ++i) {
+        printf("%-24s %10.2f %10.2f %10.2f\n", results[i].name, results[i].minNs,
+               results[i].medianNs, results[i].p99Ns);
+    }
+
+    // the JSON goes next to the benchmark binary
+    char jsonPath[512];
+    snprintf(jsonPath, sizeof(jsonPath), "%s.json", argv[0]);
+    FILE *json = fopen(jsonPath, "w");
+    if (json == NULL) {
+        fprintf(stderr, "can't write %s\n", jsonPath);
+        return 1;
+    }
+    printJson(json);
+    fclose(json);
+    printf("\nwrote %s\n", jsonPath);
+
+    return 0;
+}
@@ -3,11 +3,25 @@
 #include "utils.h"
 #include <stdio.h>
 
+typedef struct Point {
+    float x, y;
+} Point;
+
+ARRAY_DEFINE(PointArray, Point)
+ARRAY_DEFINE(IntArray, int)
+RING_DEFINE(IntRing, int)
+
 char g_assertMsg[MU_MSGBUF_LEN];
 int g_testsRun = 0;
 
 static char *testAListAppend(void);
 static char *testHTableSet(void);
+static char *testHTableOverwrite(void);
+static char *testHTableRemove(void);
+static char *testArray(void);
+static char *testArrayFillArena(void);
+static char *testRing(void);
+static char *testBitset(void);
 static char *allTests(void);
 
 int main(void) {
@@ -85,8 +99,256 @@ static char *testHTableSet(void) {
     MU_PASS;
 }
 
+static char *testHTableOverwrite(void) {
+    unsigned char buffer[Kilobyte(100)];
+    Arena arena;
+    HTable table;
+
+    ArenaInit(&arena, buffer, Kilobyte(100));
+    HTableInit(&table, &arena);
+
+    // setting a key again replaces its value, also across growth
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 200; ++i) {
+            char key[32];
+            snprintf(key, sizeof(key), "sprite_%d", i);
+            HTableSet(&table, key, i + round);
+        }
+    }
+
+    MU_ASSERT_FMT(200 == table.size, "Expected size %d, but got %lu", 200, table.size);
+    int got = HTableGet(&table, "sprite_150");
+    MU_ASSERT_FMT(152 == got, "Expected %d, but got %d", 152, got);
+    got = HTableGet(&table, "sprite_200");
+    MU_ASSERT_FMT(-1 == got, "Expected missing key %d, but got %d", -1, got);
+
+    MU_PASS;
+}
+
+static char *testHTableRemove(void) {
+    unsigned char buffer[Kilobyte(100)];
+    Arena arena;
+    HTable table;
+    char key[32];
+
+    ArenaInit(&arena, buffer, Kilobyte(100));
+    HTableInit(&table, &arena);
+    for (int i = 0; i < 100; ++i) {
+        snprintf(key, sizeof(key), "entity_%d", i);
+        HTableSet(&table, key, i);
+    }
+    for (int i = 0; i < 100; i += 2) {
+        snprintf(key, sizeof(key), "entity_%d", i);
+        MU_ASSERT(HTableRemove(&table, key), "Expected the key to be removed");
+    }
+    MU_ASSERT(!HTableRemove(&table, "entity_0"), "Expected no second remove");
+    MU_ASSERT_FMT(50 == table.size, "Expected size %d, but got %lu", 50, table.size);
+
+    for (int i = 0; i < 100; ++i) {
+        snprintf(key, sizeof(key), "entity_%d", i);
+        int expect = i % 2 == 0 ? -1 : i;
+        int got = HTableGet(&table, key);
+        MU_ASSERT_FMT(expect == got, "Expected %d, but got %d", expect, got);
+    }
+
+    // churn reuses deleted slots instead of growing forever
+    size_t capacity = table.capacity;
+    for (int i = 0; i < 2000; ++i) {
+        snprintf(key, sizeof(key), "bullet_%d", i);
+        HTableSet(&table, key, i);
+        HTableRemove(&table, key);
+    }
+    MU_ASSERT_FMT(capacity == table.capacity, "Expected capacity %lu, but got %lu",
+                  capacity, table.capacity);
+    int got = HTableGet(&table, "entity_99");
+    MU_ASSERT_FMT(99 == got, "Expected %d, but got %d", 99, got);
+
+    MU_PASS;
+}
+
+static char *testArray(void) {
+    unsigned char buffer[Kilobyte(10)];
+    Arena arena;
+    PointArray points;
+    Point batch[10];
+
+    ArenaInit(&arena, buffer, Kilobyte(10));
+    PointArrayInit(&points, &arena, 0);
+    for (int i = 0; i < 10; ++i) {
+        batch[i] = (Point){(float)i, (float)-i};
+    }
+
+    for (int i = 0; i < 20; ++i) {
+        PointArrayPush(&points, (Point){100.0f + i, 0.0f});
+    }
+    PointArrayAppend(&points, batch, 10);
+    MU_ASSERT_FMT(30 == points.size, "Expected size %d, but got %lu", 30, points.size);
+    MU_ASSERT_FMT(32 == points.capacity, "Expected capacity %d, but got %lu", 32,
+                  points.capacity);
+    MU_ASSERT(points.items[29].y == -9.0f, "Expected the batch at the back");
+
+    // the only allocation in the arena grew in place
+    MU_ASSERT_FMT(sizeof(Point) * 32 == arena.currOffset,
+                  "Expected %lu bytes used, but got %lu", sizeof(Point) * 32,
+                  arena.currOffset);
+
+    PointArraySwapRemove(&points, 0);
+    MU_ASSERT_FMT(29 == points.size, "Expected size %d, but got %lu", 29, points.size);
+    MU_ASSERT(points.items[0].x == 9.0f, "Expected the last point moved to the front");
+
+    PointArrayReserve(&points, 100);
+    MU_ASSERT_FMT(128 == points.capacity, "Expected capacity %d, but got %lu", 128,
+                  points.capacity);
+    MU_ASSERT(points.items[1].x == 101.0f, "Expected items kept when reserving");
+
+    MU_PASS;
+}
+
+static char *testArrayFillArena(void) {
+    // guard bytes right past the arena catch writes beyond it
+    struct {
+        unsigned char arena[64];
+        unsigned char guard[32];
+    } memory;
+    Arena arena;
+    IntArray ints;
+
+    memset(&memory, 0xAB, sizeof(memory));
+    ArenaInit(&arena, memory.arena, sizeof(memory.arena));
+    IntArrayInit(&ints, &arena, 4);
+    MU_ASSERT(IntArrayPush(&ints, 0) != NULL, "Expected the first push to fit");
+
+    // a grown tail is cleared, nothing past it
+    MU_ASSERT(IntArrayReserve(&ints, 8), "Expected 8 ints to fit");
+    for (size_t i = 1; i < ints.capacity; ++i) {
+        MU_ASSERT_FMT(ints.items[i] == 0, "Expected item %lu cleared, but got %x", i,
+                      ints.items[i]);
+    }
+
+    for (int i = 1; i < 16; ++i) {
+        MU_ASSERT_FMT(IntArrayPush(&ints, i) != NULL, "Expected push %d to fit", i);
+        MU_ASSERT_FMT(arena.currOffset <= arena.buffLen,
+                      "Expected at most %lu bytes used, but got %lu", arena.buffLen,
+                      arena.currOffset);
+    }
+    MU_ASSERT_FMT(16 == ints.capacity && sizeof(memory.arena) == arena.currOffset,
+                  "Expected the arena full, but got capacity %lu using %lu bytes",
+                  ints.capacity, arena.currOffset);
+
+    // growing past a full arena fails and keeps the items
+    int more[2] = {16, 17};
+    MU_ASSERT(IntArrayPush(&ints, 16) == NULL, "Expected the push to fail");
+    MU_ASSERT(!IntArrayAppend(&ints, more, 2), "Expected the append to fail");
+    MU_ASSERT(ArenaAlloc(&arena, 1) == NULL, "Expected no room left");
+    MU_ASSERT_FMT(ints.size == 16 && ints.capacity == 16,
+                  "Expected 16 items kept, but got %lu of %lu", ints.size,
+                  ints.capacity);
+    for (int i = 0; i < 16; ++i) {
+        MU_ASSERT_FMT(ints.items[i] == i, "Expected %d, but got %d", i, ints.items[i]);
+    }
+    for (size_t i = 0; i < sizeof(memory.guard); ++i) {
+        MU_ASSERT_FMT(memory.guard[i] == 0xAB, "Expected guard byte %lu untouched", i);
+    }
+
+    // a first allocation through realloc is aligned as asked
+    ArenaInit(&arena, memory.arena, sizeof(memory.arena));
+    ArenaAlloc(&arena, 1);
+    void *aligned = ArenaReallocAligned(&arena, NULL, 0, 8, 32);
+    MU_ASSERT(((uintptr_t)aligned & 31) == 0, "Expected 32 byte alignment");
+
+    MU_PASS;
+}
+
+static char *testRing(void) {
+    unsigned char buffer[Kilobyte(1)];
+    Arena arena;
+    IntRing ring;
+    int value;
+
+    ArenaInit(&arena, buffer, Kilobyte(1));
+    IntRingInit(&ring, &arena, 4);
+
+    // wraps around several times
+    int next = 0, expect = 0;
+    for (int round = 0; round < 5; ++round) {
+        while (IntRingPush(&ring, next)) {
+            ++next;
+        }
+        MU_ASSERT_FMT(4 == IntRingCount(&ring), "Expected count %d, but got %u", 4,
+                      IntRingCount(&ring));
+        int oldest = *IntRingPeek(&ring, 0);
+        MU_ASSERT_FMT(expect == oldest, "Expected oldest %d, but got %d", expect,
+                      oldest);
+        MU_ASSERT(IntRingPeek(&ring, 4) == NULL, "Expected nothing past the newest");
+
+        for (int i = 0; i < 3; ++i) {
+            IntRingPop(&ring, &value);
+            MU_ASSERT_FMT(expect == value, "Expected %d, but got %d", expect, value);
+            ++expect;
+        }
+    }
+
+    while (IntRingPop(&ring, &value)) {
+    }
+    MU_ASSERT_FMT(0 == IntRingCount(&ring), "Expected count %d, but got %u", 0,
+                  IntRingCount(&ring));
+
+    MU_PASS;
+}
+
+static char *testBitset(void) {
+    unsigned char buffer[Kilobyte(1)];
+    Arena arena;
+    Bitset set, other;
+    int bits[] = {0, 5, 63, 64, 130, 199};
+
+    ArenaInit(&arena, buffer, Kilobyte(1));
+    BitsetInit(&set, &arena, 200);
+    BitsetInit(&other, &arena, 200);
+    for (int i = 0; i < 6; ++i) {
+        BitsetSet(&set, bits[i]);
+    }
+    BitsetClear(&set, 5);
+
+    MU_ASSERT_FMT(5 == BitsetCount(&set), "Expected %d bits, but got %d", 5,
+                  BitsetCount(&set));
+    MU_ASSERT(BitsetTest(&set, 63) && !BitsetTest(&set, 5), "Expected bit 63 only");
+
+    int visited = 0;
+    for (int bit = BitsetNext(&set, 0); bit >= 0; bit = BitsetNext(&set, bit + 1)) {
+        int expect = bits[visited == 0 ? 0 : visited + 1];
+        MU_ASSERT_FMT(expect == bit, "Expected bit %d, but got %d", expect, bit);
+        ++visited;
+    }
+    MU_ASSERT_FMT(5 == visited, "Expected %d visited, but got %d", 5, visited);
+    MU_ASSERT_FMT(-1 == BitsetNext(&set, 200), "Expected %d, but got %d", -1,
+                  BitsetNext(&set, 200));
+
+    BitsetSet(&other, 64);
+    BitsetSet(&other, 100);
+    BitsetAnd(&other, &set);
+    MU_ASSERT_FMT(64 == BitsetNext(&other, 0), "Expected %d, but got %d", 64,
+                  BitsetNext(&other, 0));
+    MU_ASSERT_FMT(1 == BitsetCount(&other), "Expected %d bit, but got %d", 1,
+                  BitsetCount(&other));
+    BitsetOr(&other, &set);
+    MU_ASSERT_FMT(5 == BitsetCount(&other), "Expected %d bits, but got %d", 5,
+                  BitsetCount(&other));
+    BitsetClearAll(&other);
+    MU_ASSERT_FMT(-1 == BitsetNext(&other, 0), "Expected %d, but got %d", -1,
+                  BitsetNext(&other, 0));
+
+    MU_PASS;
+}
+
 static char *allTests(void) {
     MU_TEST(testAListAppend);
     MU_TEST(testHTableSet);
+    MU_TEST(testHTableOverwrite);
+    MU_TEST(testHTableRemove);
+    MU_TEST(testArray);
+    MU_TEST(testArrayFillArena);
+    MU_TEST(testRing);
+    MU_TEST(testBitset);
     MU_PASS;
 }
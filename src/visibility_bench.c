@@ -0,0 +1,123 @@
+// the fixture directory and clock_gettime
+#define _POSIX_C_SOURCE 200809L
+// the game's modules without a window, draws are recorded
+#define RENDER_NO_RAYLIB
+
+#include "headless.h"
+#include "assets.c"
+#include "collision.c"
+#include "ecs.c"
+#include "ecs.h"
+#include "lightgrid.c"
+#include "mapstream.c"
+#include "net.c"
+#include "parser.c"
+#include "particles.c"
+#include "projectiles.c"
+#include "render.c"
+#include "spatial.c"
+#include "utils.c"
+#include <stdio.h>
+#include <time.h>
+
+#define WORLD_SIZE  8192.0f
+#define CELL_SIZE   128.0f
+#define MOVING      16
+#define BENCH_TICKS 2000
+#define SPRITE_SIZE 16
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static float benchRandom(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / (float)(1u << 24);
+}
+
+// 'visible' sprites inside the 800x600 view, the rest outside it, and a few
+// of each moving every tick
+static void bench(int total, int visible) {
+    static unsigned char buffer[Megabyte(1)];
+    Arena arena;
+    Visibility vis;
+    uint32_t seed = 1;
+
+    EntityCompInit();
+    ArenaInit(&arena, buffer, sizeof(buffer));
+    VisibilityInit(&vis, &arena, WORLD_SIZE, WORLD_SIZE, CELL_SIZE);
+    int camera = EntityCreate();
+    ComponentCreate(camera, COMP_CAMERA);
+    SpriteId sprite = AssetsGetSpriteId("zombie");
+
+    int first = EntityCreateBatch(total);
+    for (int i = 0; i < total; ++i) {
+        int entity = first + i;
+        TransformComp *transf = ComponentCreate(entity, COMP_TRANSFORM);
+        float x = benchRandom(&seed), y = benchRandom(&seed);
+        if (i < visible) {
+            transf->position =
+                (Vector2){x * (800 - SPRITE_SIZE), y * (600 - SPRITE_SIZE)};
+        } else {
+            transf->position = (Vector2){1000.0f + x * (WORLD_SIZE - 1100.0f),
+                                         1000.0f + y * (WORLD_SIZE - 1100.0f)};
+        }
+        SpriteRender *spriteRender = ComponentCreate(entity, COMP_SPRITERENDER);
+        spriteRender->sprite = sprite;
+        VisibilityAdd(&vis, entity);
+    }
+    SystemTransformUpdate();
+    SystemVisibilityUpdate(camera, &vis);
+
+    double elapsedTotal = 0.0, worst = 0.0;
+    for (int tick = 0; tick < BENCH_TICKS; ++tick) {
+        // shuffled back and forth, they stay on their side of the view
+        float step = tick % 2 == 0 ? 1.0f : -1.0f;
+        for (int i = 0; i < MOVING; ++i) {
+            int entity = i % 2 == 0 ? first + i : first + visible + i;
+            TransformComp *transf = ComponentGet(entity, COMP_TRANSFORM);
+            transf->position.x += step;
+            TransformMarkDirty(entity);
+        }
+
+        double start = nowMs();
+        SystemTransformUpdate();
+        SystemVisibilityUpdate(camera, &vis);
+        double elapsed = nowMs() - start;
+        elapsedTotal += elapsed;
+        worst = elapsed > worst ? elapsed : worst;
+    }
+
+    printf("%5d total %5d visible  mean %7.4f ms  worst %7.4f ms\n", vis.totalCount,
+           vis.visibleCount, elapsedTotal / BENCH_TICKS, worst);
+    EntityCompDestroy();
+}
+
+int main(void) {
+    static const char sprites[] = "zombie 0 0 16 16\n";
+    if (FixtureDirCreate("visibility_bench") != 0 ||
+        WriteFakePng("bench.png", SPRITE_SIZE, SPRITE_SIZE) != 0 ||
+        WriteFile("bench.sprite", sprites, strlen(sprites)) != 0 || AssetsInit() != 0) {
+        return 1;
+    }
+    AssetAdd(ASSET_LOADER_SPRITESHEET, "bench");
+    if (AssetLoadSync() != 0) {
+        return 1;
+    }
+
+    // the cost follows what the camera sees, not how many there are
+    printf("Visibility update, %d moving, %d ticks\n", MOVING, BENCH_TICKS);
+    int totals[] = {500, 2000, 4000};
+    int visibles[] = {50, 400};
+    for (int v = 0; v < 2; ++v) {
+        for (int t = 0; t < 3; ++t) {
+            bench(totals[t], visibles[v]);
+        }
+    }
+
+    AssetSetDestroy(AssetSetGet());
+    FixtureDirRemove();
+    return 0;
+}